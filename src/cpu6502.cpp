@@ -30,47 +30,91 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
 
 #include "cpu6502.h"
 #include "read_ihx.h"
 
-static double tv_diff;
-#if !(defined _WIN32) && !(defined _WIN64)
-#include <sys/time.h>
-static struct timeval tv_start, tv_stop;
-
-#else
+#if (defined _WIN32) || (defined _WIN64)
 #include <Windows.h>
-LARGE_INTEGER freq, start, stop;
 #endif
 
 // -------------------------------------------------------------------------
-// Terminal control utility functions for enabling/diabling input echoing
+// Decimal mode ADC and SBC lookup tables, generated at compile time.
+// There is a table for each carry in value, with entries indexed by the
+// accumulator (bits 15:8) and the operand (bits 7:0), holding the result
+// in bits 7:0 and the carry and overflow flags in bits 15:8.
 // -------------------------------------------------------------------------
 
-static void pre_run_setup()
+static constexpr uint16_t bcd_adc (const uint8_t acc, const uint8_t mem_val, const bool carry)
 {
-#if !(defined _WIN32) && !(defined _WIN64)
-    // Log time just before running (LINUX only)
-    (void)gettimeofday(&tv_start, NULL);
-#else
-    QueryPerformanceFrequency(&freq);
-    QueryPerformanceCounter(&start);
-#endif 
+    // Do low digit BCD addition and flag if result has carried ( > 9)
+    uint16_t tmp       = (acc & MASK_LO_NIB) + (mem_val & MASK_LO_NIB) + (carry ? 1 : 0);
+    bool     bcd_carry = tmp > 9;
+
+    // Get low digit result, adjusting if carried
+    uint16_t lo_nib    = bcd_carry ? (tmp + 0x06) & MASK_LO_NIB : tmp;
+
+    // Do high digit BCD addition, adding in carry from low digit as applicable, and flag if carried
+    tmp                = (acc & MASK_HI_NIB) + (mem_val & MASK_HI_NIB) + (bcd_carry ? 0x10 : 0);
+    bcd_carry          = (tmp > 0x90);
+
+    // Get high digit result, adjusting if carried
+    uint16_t hi_nib    = bcd_carry ? (tmp + 0x60) & MASK_HI_NIB : tmp;
+
+    uint16_t flags     = (((tmp & SIGN_MASK)==0) ^ ((acc & SIGN_MASK)==0) ? OVFLW_MASK : 0) |
+                         (bcd_carry                                       ? CARRY_MASK : 0);
+
+    return (flags << 8) | ((hi_nib | lo_nib) & MASK_8BIT);
 }
 
-static void post_run_setup()
+static constexpr uint16_t bcd_sbc (const uint8_t acc, const uint8_t mem_val, const bool carry)
 {
-#if !(defined _WIN32) && !(defined _WIN64)
-    // Get time just after running, and calculate run time (LINUX only)
-    (void)gettimeofday(&tv_stop, NULL);
-    tv_diff = ((float)(tv_stop.tv_sec - tv_start.tv_sec)*1e6) + ((float)(tv_stop.tv_usec - tv_start.tv_usec));
-#else
-    QueryPerformanceCounter(&stop);
-    tv_diff = (double)(stop.QuadPart - start.QuadPart)*1e6/(double)freq.QuadPart;
-#endif 
+    // Do low digit BCD subtraction and flag if result has borrowed ( < 0)
+    int16_t  tmp        = (acc & MASK_LO_NIB) - (mem_val & MASK_LO_NIB) - (carry ? 0 : 1);
+    bool     bcd_borrow = tmp < 0;
+
+    // Get low digit result, adjusting if borrowed
+    int16_t  lo_nib     = bcd_borrow ? (tmp - 6) & MASK_LO_NIB : tmp;
+
+    // Do high digit BCD subtraction, factoring in borrow from low digit as applicable, and flag if borrowed
+    tmp                 = (acc & MASK_HI_NIB) - (mem_val & MASK_HI_NIB) - (bcd_borrow ? 0x10 : 0);
+    bcd_borrow          = tmp < 0;
+
+    // Get high digit result, adjusting if borrowed
+    int16_t  hi_nib     = bcd_borrow ? (tmp - 0x60) & MASK_HI_NIB : tmp;
+
+    uint16_t flags      = (((tmp & SIGN_MASK) == 0) ^ ((acc & SIGN_MASK) == 0) ? OVFLW_MASK : 0) |
+                          (!bcd_borrow                                         ? CARRY_MASK : 0);
+
+    return (flags << 8) | ((hi_nib | lo_nib) & MASK_8BIT);
 }
 
+// Each table is a separate constant expression, keeping within compilers' evaluation limits
+template <uint16_t (*FUNC)(const uint8_t, const uint8_t, const bool), bool CARRY>
+struct wy65_bcd_tbl_t
+{
+    uint16_t entry[WY65_BCD_TBL_SIZE];
+
+    constexpr wy65_bcd_tbl_t() : entry()
+    {
+        for (uint32_t idx = 0; idx < WY65_BCD_TBL_SIZE; idx++)
+        {
+            entry[idx] = FUNC(idx >> 8, idx & MASK_8BIT, CARRY);
+        }
+    }
+};
+
+static constexpr wy65_bcd_tbl_t<bcd_adc, false> bcd_adc_tbl0;
+static constexpr wy65_bcd_tbl_t<bcd_adc, true>  bcd_adc_tbl1;
+static constexpr wy65_bcd_tbl_t<bcd_sbc, false> bcd_sbc_tbl0;
+static constexpr wy65_bcd_tbl_t<bcd_sbc, true>  bcd_sbc_tbl1;
+
+// Tables indexed by carry in
+static constexpr const uint16_t* bcd_adc_tbl[2] = {bcd_adc_tbl0.entry, bcd_adc_tbl1.entry};
+static constexpr const uint16_t* bcd_sbc_tbl[2] = {bcd_sbc_tbl0.entry, bcd_sbc_tbl1.entry};
+
 // -------------------------------------------------------------------------
 // cpu6502
 //
@@ -78,278 +122,132 @@ static void post_run_setup()
 //
 // -------------------------------------------------------------------------
 
-cpu6502::cpu6502()
+template <class BUS>
+cpu6502_core<BUS>::cpu6502_core()
 {
     // Reset internal class state
-    ext_wr_mem        = NULL;
-    ext_rd_mem        = NULL;
     fp                = NULL;
+    fp_owned          = false;
     nextPc            = INVALID_NEXT_PC;
+    pending           = 0;
+    reset_mode        = DEFAULT;
+    p_cycle_func      = NULL;
+    p_cycle_ctx       = NULL;
+    until_pc          = WY65_ADDR_SPACE_SIZE;
+    until_addr        = 0;
+    until_len         = 0;
+    until_value       = 0;
+    idle_detect       = false;
+    idle_valid        = false;
+    idle_misses       = 0;
+    wr_changes        = 0;
+    engine            = WY65_DEFAULT_ENGINE;
+    wr_hooks          = false;
+    p_dcache          = NULL;
+    p_blk_tbl         = NULL;
+    p_uop_pool        = NULL;
+    p_code_byte       = NULL;
+    uop_pool_used     = 0;
+    blk_invalidated   = false;
+    p_jit_code        = NULL;
+    jit_code_used     = 0;
+    p_jit_tbl         = NULL;
+    jit_last_pc       = 0;
+    p_static_tbl      = NULL;
+    static_cpu_type   = BASE;
+    fuse_en           = true;
+    p_pair_prof       = NULL;
+    flags_nz          = 1;
+    flags_lazy        = false;
+    nirq_lines        = NO_ACTIVE_IRQS;
+    state.nirq_line   = NO_ACTIVE_IRQS;
     state.waiting     = false;
     state.stopped     = false;
     state.mode_c      = BASE;
 
-    // Initialise instruction table
-    int idx           = 0;
-
-    set_tbl_entry(instr_tbl[idx++], "BRK",  &cpu6502::BRK, 7, NON, BASE /* 0x00 */);
-    set_tbl_entry(instr_tbl[idx++], "ORA",  &cpu6502::ORA, 6, IDX, BASE /* 0x01 */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 2, IMM, C02  /* 0x02 */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0x03 */);
-    set_tbl_entry(instr_tbl[idx++], "TSB",  &cpu6502::TSB, 5, ZPG, C02  /* 0x04 */); // 65C02
-    set_tbl_entry(instr_tbl[idx++], "ORA",  &cpu6502::ORA, 3, ZPG, BASE /* 0x05 */);
-    set_tbl_entry(instr_tbl[idx++], "ASL",  &cpu6502::ASL, 5, ZPG, BASE /* 0x06 */);
-    set_tbl_entry(instr_tbl[idx++], "RMB0", &cpu6502::RMB, 5, ZPG, WRK  /* 0x07 */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "PHP",  &cpu6502::PHP, 3, NON, BASE /* 0x08 */);
-    set_tbl_entry(instr_tbl[idx++], "ORA",  &cpu6502::ORA, 2, IMM, BASE /* 0x09 */);
-    set_tbl_entry(instr_tbl[idx++], "ASL",  &cpu6502::ASL, 2, ACC, BASE /* 0x0A */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0x0B */);
-    set_tbl_entry(instr_tbl[idx++], "TSB",  &cpu6502::TSB, 6, ABS, C02  /* 0x0C */); // 65C02
-    set_tbl_entry(instr_tbl[idx++], "ORA",  &cpu6502::ORA, 4, ABS, BASE /* 0x0D */);
-    set_tbl_entry(instr_tbl[idx++], "ASL",  &cpu6502::ASL, 6, ABS, BASE /* 0x0E */);
-    set_tbl_entry(instr_tbl[idx++], "BBR0", &cpu6502::BBR, 5, ZPR, WRK  /* 0x0F */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "BPL",  &cpu6502::BPL, 2, REL, BASE /* 0x10 */);
-    set_tbl_entry(instr_tbl[idx++], "ORA",  &cpu6502::ORA, 5, IDY, BASE /* 0x11 */);
-    set_tbl_entry(instr_tbl[idx++], "ORA",  &cpu6502::ORA, 5, IDZ, C02  /* 0x12 */); // 65C02
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0x13 */);
-    set_tbl_entry(instr_tbl[idx++], "TRB",  &cpu6502::TRB, 5, ZPG, C02  /* 0x14 */); // 65C02
-    set_tbl_entry(instr_tbl[idx++], "ORA",  &cpu6502::ORA, 4, ZPX, BASE /* 0x15 */);
-    set_tbl_entry(instr_tbl[idx++], "ASL",  &cpu6502::ASL, 6, ZPX, BASE /* 0x16 */);
-    set_tbl_entry(instr_tbl[idx++], "RMB1", &cpu6502::RMB, 5, ZPG, WRK  /* 0x17 */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "CLC",  &cpu6502::CLC, 2, NON, BASE /* 0x18 */);
-    set_tbl_entry(instr_tbl[idx++], "ORA",  &cpu6502::ORA, 4, ABY, BASE /* 0x19 */);
-    set_tbl_entry(instr_tbl[idx++], "INC",  &cpu6502::INC, 2, ACC, C02  /* 0x1A */); // 65C02
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0x1B */);
-    set_tbl_entry(instr_tbl[idx++], "TRB",  &cpu6502::TRB, 6, ABS, C02  /* 0x1C */); // 65C02
-    set_tbl_entry(instr_tbl[idx++], "ORA",  &cpu6502::ORA, 4, ABX, BASE /* 0x1D */);
-    set_tbl_entry(instr_tbl[idx++], "ASL",  &cpu6502::ASL, 7, ABX, BASE /* 0x1E */);
-    set_tbl_entry(instr_tbl[idx++], "BBR1", &cpu6502::BBR, 5, ZPR, WRK  /* 0x1F */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "JSR",  &cpu6502::JSR, 6, ABS, BASE /* 0x20 */);
-    set_tbl_entry(instr_tbl[idx++], "AND",  &cpu6502::AND, 6, IDX, BASE /* 0x21 */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 2, IMM, C02  /* 0x22 */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0x23 */);
-    set_tbl_entry(instr_tbl[idx++], "BIT",  &cpu6502::BIT, 3, ZPG, BASE /* 0x24 */);
-    set_tbl_entry(instr_tbl[idx++], "AND",  &cpu6502::AND, 3, ZPG, BASE /* 0x25 */);
-    set_tbl_entry(instr_tbl[idx++], "ROL",  &cpu6502::ROL, 5, ZPG, BASE /* 0x26 */);
-    set_tbl_entry(instr_tbl[idx++], "RMB2", &cpu6502::RMB, 5, ZPG, WRK  /* 0x27 */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "PLP",  &cpu6502::PLP, 4, NON, BASE /* 0x28 */);
-    set_tbl_entry(instr_tbl[idx++], "AND",  &cpu6502::AND, 2, IMM, BASE /* 0x29 */);
-    set_tbl_entry(instr_tbl[idx++], "ROL",  &cpu6502::ROL, 2, ACC, BASE /* 0x2A */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0x2B */);
-    set_tbl_entry(instr_tbl[idx++], "BIT",  &cpu6502::BIT, 4, ABS, BASE /* 0x2C */);
-    set_tbl_entry(instr_tbl[idx++], "AND",  &cpu6502::AND, 4, ABS, BASE /* 0x2D */);
-    set_tbl_entry(instr_tbl[idx++], "ROL",  &cpu6502::ROL, 6, ABS, BASE /* 0x2E */);
-    set_tbl_entry(instr_tbl[idx++], "BBR2", &cpu6502::BBR, 5, ZPR, WRK  /* 0x2F */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "BMI",  &cpu6502::BMI, 2, REL, BASE /* 0x30 */);
-    set_tbl_entry(instr_tbl[idx++], "AND",  &cpu6502::AND, 5, IDY, BASE /* 0x31 */);
-    set_tbl_entry(instr_tbl[idx++], "AND",  &cpu6502::AND, 5, IDZ, C02  /* 0x32 */); // 65C02
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0x33 */);
-    set_tbl_entry(instr_tbl[idx++], "BIT",  &cpu6502::BIT, 4, ZPX, C02  /* 0x34 */); // 65C02
-    set_tbl_entry(instr_tbl[idx++], "AND",  &cpu6502::AND, 4, ZPX, BASE /* 0x35 */);
-    set_tbl_entry(instr_tbl[idx++], "ROL",  &cpu6502::ROL, 6, ZPX, BASE /* 0x36 */);
-    set_tbl_entry(instr_tbl[idx++], "RMB3", &cpu6502::RMB, 5, ZPG, WRK  /* 0x37 */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "SEC",  &cpu6502::SEC, 2, NON, BASE /* 0x38 */);
-    set_tbl_entry(instr_tbl[idx++], "AND",  &cpu6502::AND, 4, ABY, BASE /* 0x39 */);
-    set_tbl_entry(instr_tbl[idx++], "DEC",  &cpu6502::DEC, 2, ACC, C02  /* 0x3A */); // 65C02
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0x3B */);
-    set_tbl_entry(instr_tbl[idx++], "BIT",  &cpu6502::BIT, 4, ABX, C02  /* 0x3C */); // 65C02
-    set_tbl_entry(instr_tbl[idx++], "AND",  &cpu6502::AND, 4, ABX, BASE /* 0x3D */);
-    set_tbl_entry(instr_tbl[idx++], "ROL",  &cpu6502::ROL, 7, ABX, BASE /* 0x3E */);
-    set_tbl_entry(instr_tbl[idx++], "BBR3", &cpu6502::BBR, 5, ZPR, WRK  /* 0x3F */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "RTI",  &cpu6502::RTI, 6, NON, BASE /* 0x40 */);
-    set_tbl_entry(instr_tbl[idx++], "EOR",  &cpu6502::EOR, 6, IDX, BASE /* 0x41 */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 2, IMM, C02  /* 0x42 */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0x43 */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 3, ZPG, C02  /* 0x44 */);
-    set_tbl_entry(instr_tbl[idx++], "EOR",  &cpu6502::EOR, 3, ZPG, BASE /* 0x45 */);
-    set_tbl_entry(instr_tbl[idx++], "LSR",  &cpu6502::LSR, 5, ZPG, BASE /* 0x46 */);
-    set_tbl_entry(instr_tbl[idx++], "RMB4", &cpu6502::RMB, 5, ZPG, WRK  /* 0x47 */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "PHA",  &cpu6502::PHA, 3, NON, BASE /* 0x48 */);
-    set_tbl_entry(instr_tbl[idx++], "EOR",  &cpu6502::EOR, 2, IMM, BASE /* 0x49 */);
-    set_tbl_entry(instr_tbl[idx++], "LSR",  &cpu6502::LSR, 2, ACC, BASE /* 0x4A */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, N4B, C02  /* 0x4B */);
-    set_tbl_entry(instr_tbl[idx++], "JMP",  &cpu6502::JMP, 3, ABS, BASE /* 0x4C */);
-    set_tbl_entry(instr_tbl[idx++], "EOR",  &cpu6502::EOR, 4, ABS, BASE /* 0x4D */);
-    set_tbl_entry(instr_tbl[idx++], "LSR",  &cpu6502::LSR, 6, ABS, BASE /* 0x4E */);
-    set_tbl_entry(instr_tbl[idx++], "BBR4", &cpu6502::BBR, 5, ZPR, WRK  /* 0x4F */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "BVC",  &cpu6502::BVC, 2, REL, BASE /* 0x50 */);
-    set_tbl_entry(instr_tbl[idx++], "EOR",  &cpu6502::EOR, 5, IDY, BASE /* 0x51 */);
-    set_tbl_entry(instr_tbl[idx++], "EOR",  &cpu6502::EOR, 5, IDZ, BASE /* 0x52 */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0x53 */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 4, ZPX, C02  /* 0x54 */);
-    set_tbl_entry(instr_tbl[idx++], "EOR",  &cpu6502::EOR, 4, ZPX, BASE /* 0x55 */);
-    set_tbl_entry(instr_tbl[idx++], "LSR",  &cpu6502::LSR, 6, ZPX, BASE /* 0x56 */);
-    set_tbl_entry(instr_tbl[idx++], "RMB5", &cpu6502::RMB, 5, ZPG, WRK  /* 0x57 */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "CLI",  &cpu6502::CLI, 2, NON, BASE /* 0x58 */);
-    set_tbl_entry(instr_tbl[idx++], "EOR",  &cpu6502::EOR, 4, ABY, BASE /* 0x59 */);
-    set_tbl_entry(instr_tbl[idx++], "PHY",  &cpu6502::PHY, 3, NON, C02  /* 0x5A */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0x5B */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 8, ABX, C02  /* 0x5C */);
-    set_tbl_entry(instr_tbl[idx++], "EOR",  &cpu6502::EOR, 4, ABX, BASE /* 0x5D */);
-    set_tbl_entry(instr_tbl[idx++], "LSR",  &cpu6502::LSR, 7, ABX, BASE /* 0x5E */);
-    set_tbl_entry(instr_tbl[idx++], "BBR5", &cpu6502::BBR, 5, ZPR, WRK  /* 0x5F */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "RTS",  &cpu6502::RTS, 6, NON, BASE /* 0x60 */);
-    set_tbl_entry(instr_tbl[idx++], "ADC",  &cpu6502::ADC, 6, IDX, BASE /* 0x61 */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 2, IMM, C02  /* 0x62 */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0x63 */);
-    set_tbl_entry(instr_tbl[idx++], "STZ",  &cpu6502::STZ, 3, ZPG, C02  /* 0x64 */); // 65C02
-    set_tbl_entry(instr_tbl[idx++], "ADC",  &cpu6502::ADC, 3, ZPG, BASE /* 0x65 */);
-    set_tbl_entry(instr_tbl[idx++], "ROR",  &cpu6502::ROR, 5, ZPG, BASE /* 0x66 */);
-    set_tbl_entry(instr_tbl[idx++], "RMB6", &cpu6502::RMB, 5, ZPG, WRK  /* 0x67 */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "PLA",  &cpu6502::PLA, 4, NON, BASE /* 0x68 */);
-    set_tbl_entry(instr_tbl[idx++], "ADC",  &cpu6502::ADC, 2, IMM, BASE /* 0x69 */);
-    set_tbl_entry(instr_tbl[idx++], "ROR",  &cpu6502::ROR, 2, ACC, BASE /* 0x6A */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0x6B */);
-    set_tbl_entry(instr_tbl[idx++], "JMP",  &cpu6502::JMP, 5, IND, BASE /* 0x6C */);
-    set_tbl_entry(instr_tbl[idx++], "ADC",  &cpu6502::ADC, 4, ABS, BASE /* 0x6D */);
-    set_tbl_entry(instr_tbl[idx++], "ROR",  &cpu6502::ROR, 6, ABS, BASE /* 0x6E */);
-    set_tbl_entry(instr_tbl[idx++], "BBR6", &cpu6502::BBR, 5, ZPR, WRK  /* 0x6F */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "BVS",  &cpu6502::BVS, 2, REL, BASE /* 0x70 */);
-    set_tbl_entry(instr_tbl[idx++], "ADC",  &cpu6502::ADC, 5, IDY, BASE /* 0x71 */);
-    set_tbl_entry(instr_tbl[idx++], "ADC",  &cpu6502::ADC, 5, IDZ, C02  /* 0x72 */); // 65C02
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0x73 */);
-    set_tbl_entry(instr_tbl[idx++], "STZ",  &cpu6502::STZ, 4, ZPX, C02  /* 0x74 */); // 65C02
-    set_tbl_entry(instr_tbl[idx++], "ADC",  &cpu6502::ADC, 4, ZPX, BASE /* 0x75 */);
-    set_tbl_entry(instr_tbl[idx++], "ROR",  &cpu6502::ROR, 6, ZPX, BASE /* 0x76 */);
-    set_tbl_entry(instr_tbl[idx++], "RMB7", &cpu6502::RMB, 5, ZPG, WRK  /* 0x77 */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "SEI",  &cpu6502::SEI, 2, NON, BASE /* 0x78 */);
-    set_tbl_entry(instr_tbl[idx++], "ADC",  &cpu6502::ADC, 4, ABY, BASE /* 0x79 */);
-    set_tbl_entry(instr_tbl[idx++], "PLY",  &cpu6502::PLY, 4, NON, C02  /* 0x7A */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0x7B */);
-    set_tbl_entry(instr_tbl[idx++], "JMP",  &cpu6502::JMP, 6, IAX, C02  /* 0x7C */); // 65C02
-    set_tbl_entry(instr_tbl[idx++], "ADC",  &cpu6502::ADC, 4, ABX, BASE /* 0x7D */);
-    set_tbl_entry(instr_tbl[idx++], "ROR",  &cpu6502::ROR, 7, ABX, BASE /* 0x7E */);
-    set_tbl_entry(instr_tbl[idx++], "BBR7", &cpu6502::BBR, 5, ZPR, WRK  /* 0x7F */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "BRA",  &cpu6502::BRA, 3, REL, C02  /* 0x80 */); // 65C02
-    set_tbl_entry(instr_tbl[idx++], "STA",  &cpu6502::STA, 6, IDX, BASE /* 0x81 */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 2, IMM, C02  /* 0x82 */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0x83 */);
-    set_tbl_entry(instr_tbl[idx++], "STY",  &cpu6502::STY, 3, ZPG, BASE /* 0x84 */);
-    set_tbl_entry(instr_tbl[idx++], "STA",  &cpu6502::STA, 3, ZPG, BASE /* 0x85 */);
-    set_tbl_entry(instr_tbl[idx++], "STX",  &cpu6502::STX, 3, ZPG, BASE /* 0x86 */);
-    set_tbl_entry(instr_tbl[idx++], "SMB0", &cpu6502::SMB, 5, ZPG, WRK  /* 0x87 */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "DEY",  &cpu6502::DEY, 2, NON, BASE /* 0x88 */);
-    set_tbl_entry(instr_tbl[idx++], "BIT",  &cpu6502::BIT, 2, IMM, C02  /* 0x89 */); // 65C02
-    set_tbl_entry(instr_tbl[idx++], "TXA",  &cpu6502::TXA, 2, NON, BASE /* 0x8A */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0x8B */);
-    set_tbl_entry(instr_tbl[idx++], "STY",  &cpu6502::STY, 4, ABS, BASE /* 0x8C */);
-    set_tbl_entry(instr_tbl[idx++], "STA",  &cpu6502::STA, 4, ABS, BASE /* 0x8D */);
-    set_tbl_entry(instr_tbl[idx++], "STX",  &cpu6502::STX, 4, ABS, BASE /* 0x8E */);
-    set_tbl_entry(instr_tbl[idx++], "BBS0", &cpu6502::BBS, 5, ZPR, WRK  /* 0x8F */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "BCC",  &cpu6502::BCC, 2, REL, BASE /* 0x90 */);
-    set_tbl_entry(instr_tbl[idx++], "STA",  &cpu6502::STA, 6, IDY, BASE /* 0x91 */);
-    set_tbl_entry(instr_tbl[idx++], "STA",  &cpu6502::STA, 5, IDZ, C02  /* 0x92 */); // 65C02
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0x93 */);
-    set_tbl_entry(instr_tbl[idx++], "STY",  &cpu6502::STY, 4, ZPX, BASE /* 0x94 */);
-    set_tbl_entry(instr_tbl[idx++], "STA",  &cpu6502::STA, 4, ZPX, BASE /* 0x95 */);
-    set_tbl_entry(instr_tbl[idx++], "STX",  &cpu6502::STX, 4, ZPY, BASE /* 0x96 */);
-    set_tbl_entry(instr_tbl[idx++], "SMB1", &cpu6502::SMB, 5, ZPG, WRK  /* 0x97 */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "TYA",  &cpu6502::TYA, 2, NON, BASE /* 0x98 */);
-    set_tbl_entry(instr_tbl[idx++], "STA",  &cpu6502::STA, 5, ABY, BASE /* 0x99 */);
-    set_tbl_entry(instr_tbl[idx++], "TXS",  &cpu6502::TXS, 2, NON, BASE /* 0x9A */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0x9B */);
-    set_tbl_entry(instr_tbl[idx++], "STZ",  &cpu6502::STZ, 4, ABS, C02  /* 0x9C */); // 65C02
-    set_tbl_entry(instr_tbl[idx++], "STA",  &cpu6502::STA, 5, ABX, BASE /* 0x9D */);
-    set_tbl_entry(instr_tbl[idx++], "STZ",  &cpu6502::STZ, 5, ABX, C02  /* 0x9E */); // 65C02
-    set_tbl_entry(instr_tbl[idx++], "BBS1", &cpu6502::BBS, 5, ZPR, WRK  /* 0x9F */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "LDY",  &cpu6502::LDY, 2, IMM, BASE /* 0xA0 */);
-    set_tbl_entry(instr_tbl[idx++], "LDA",  &cpu6502::LDA, 6, IDX, BASE /* 0xA1 */);
-    set_tbl_entry(instr_tbl[idx++], "LDX",  &cpu6502::LDX, 2, IMM, BASE /* 0xA2 */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0xA3 */);
-    set_tbl_entry(instr_tbl[idx++], "LDY",  &cpu6502::LDY, 3, ZPG, BASE /* 0xA4 */);
-    set_tbl_entry(instr_tbl[idx++], "LDA",  &cpu6502::LDA, 3, ZPG, BASE /* 0xA5 */);
-    set_tbl_entry(instr_tbl[idx++], "LDX",  &cpu6502::LDX, 3, ZPG, BASE /* 0xA6 */);
-    set_tbl_entry(instr_tbl[idx++], "SMB2", &cpu6502::SMB, 5, ZPG, WRK  /* 0xA7 */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "TAY",  &cpu6502::TAY, 2, NON, BASE /* 0xA8 */);
-    set_tbl_entry(instr_tbl[idx++], "LDA",  &cpu6502::LDA, 2, IMM, BASE /* 0xA9 */);
-    set_tbl_entry(instr_tbl[idx++], "TAX",  &cpu6502::TAX, 2, NON, BASE /* 0xAA */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0xAB */);
-    set_tbl_entry(instr_tbl[idx++], "LDY",  &cpu6502::LDY, 4, ABS, BASE /* 0xAC */);
-    set_tbl_entry(instr_tbl[idx++], "LDA",  &cpu6502::LDA, 4, ABS, BASE /* 0xAD */);
-    set_tbl_entry(instr_tbl[idx++], "LDX",  &cpu6502::LDX, 4, ABS, BASE /* 0xAE */);
-    set_tbl_entry(instr_tbl[idx++], "BBS2", &cpu6502::BBS, 5, ZPR, WRK  /* 0xAF */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "BCS",  &cpu6502::BCS, 2, REL, BASE /* 0xB0 */);
-    set_tbl_entry(instr_tbl[idx++], "LDA",  &cpu6502::LDA, 5, IDY, BASE /* 0xB1 */);
-    set_tbl_entry(instr_tbl[idx++], "LDA",  &cpu6502::LDA, 5, IDZ, C02  /* 0xB2 */); // 65C02
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0xB3 */);
-    set_tbl_entry(instr_tbl[idx++], "LDY",  &cpu6502::LDY, 4, ZPX, BASE /* 0xB4 */);
-    set_tbl_entry(instr_tbl[idx++], "LDA",  &cpu6502::LDA, 4, ZPX, BASE /* 0xB5 */);
-    set_tbl_entry(instr_tbl[idx++], "LDX",  &cpu6502::LDX, 4, ZPY, BASE /* 0xB6 */);
-    set_tbl_entry(instr_tbl[idx++], "SMB3", &cpu6502::SMB, 5, ZPG, WRK  /* 0xB7 */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "CLV",  &cpu6502::CLV, 2, NON, BASE /* 0xB8 */);
-    set_tbl_entry(instr_tbl[idx++], "LDA",  &cpu6502::LDA, 4, ABY, BASE /* 0xB9 */);
-    set_tbl_entry(instr_tbl[idx++], "TSX",  &cpu6502::TSX, 2, NON, BASE /* 0xBA */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0xBB */);
-    set_tbl_entry(instr_tbl[idx++], "LDY",  &cpu6502::LDY, 4, ABX, BASE /* 0xBC */);
-    set_tbl_entry(instr_tbl[idx++], "LDA",  &cpu6502::LDA, 4, ABX, BASE /* 0xBD */);
-    set_tbl_entry(instr_tbl[idx++], "LDX",  &cpu6502::LDX, 4, ABY, BASE /* 0xBE */);
-    set_tbl_entry(instr_tbl[idx++], "BBS3", &cpu6502::BBS, 5, ZPR, WRK  /* 0xBF */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "CPY",  &cpu6502::CPY, 2, IMM, BASE /* 0xC0 */);
-    set_tbl_entry(instr_tbl[idx++], "CMP",  &cpu6502::CMP, 6, IDX, BASE /* 0xC1 */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 2, IMM, C02  /* 0xC2 */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0xC3 */);
-    set_tbl_entry(instr_tbl[idx++], "CPY",  &cpu6502::CPY, 3, ZPG, BASE /* 0xC4 */);
-    set_tbl_entry(instr_tbl[idx++], "CMP",  &cpu6502::CMP, 3, ZPG, BASE /* 0xC5 */);
-    set_tbl_entry(instr_tbl[idx++], "DEC",  &cpu6502::DEC, 5, ZPG, BASE /* 0xC6 */);
-    set_tbl_entry(instr_tbl[idx++], "SMB4", &cpu6502::SMB, 5, ZPG, WRK  /* 0xC7 */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "INY",  &cpu6502::INY, 2, NON, BASE /* 0xC8 */);
-    set_tbl_entry(instr_tbl[idx++], "CMP",  &cpu6502::CMP, 2, IMM, BASE /* 0xC9 */);
-    set_tbl_entry(instr_tbl[idx++], "DEX",  &cpu6502::DEX, 2, NON, BASE /* 0xCA */);
-    set_tbl_entry(instr_tbl[idx++], "WAI",  &cpu6502::WAI, 3, NON, WDC  /* 0xCB */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "CPY",  &cpu6502::CPY, 4, ABS, BASE /* 0xCC */);
-    set_tbl_entry(instr_tbl[idx++], "CMP",  &cpu6502::CMP, 4, ABS, BASE /* 0xCD */);
-    set_tbl_entry(instr_tbl[idx++], "DEC",  &cpu6502::DEC, 6, ABS, BASE /* 0xCE */);
-    set_tbl_entry(instr_tbl[idx++], "BBS4", &cpu6502::BBS, 5, ZPR, WRK  /* 0xCF */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "BNE",  &cpu6502::BNE, 2, REL, BASE /* 0xD0 */);
-    set_tbl_entry(instr_tbl[idx++], "CMP",  &cpu6502::CMP, 5, IDY, BASE /* 0xD1 */);
-    set_tbl_entry(instr_tbl[idx++], "CMP",  &cpu6502::CMP, 5, IDZ, C02  /* 0xD2 */); // 65C02
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0xD3 */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 4, ZPX, C02  /* 0xD4 */);
-    set_tbl_entry(instr_tbl[idx++], "CMP",  &cpu6502::CMP, 4, ZPX, BASE /* 0xD5 */);
-    set_tbl_entry(instr_tbl[idx++], "DEC",  &cpu6502::DEC, 6, ZPX, BASE /* 0xD6 */);
-    set_tbl_entry(instr_tbl[idx++], "SMB5", &cpu6502::SMB, 5, ZPG, WRK  /* 0xD7 */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "CLD",  &cpu6502::CLD, 2, NON, BASE /* 0xD8 */);
-    set_tbl_entry(instr_tbl[idx++], "CMP",  &cpu6502::CMP, 4, ABY, BASE /* 0xD9 */);
-    set_tbl_entry(instr_tbl[idx++], "PHX",  &cpu6502::PHX, 3, NON, C02  /* 0xDA */);
-    set_tbl_entry(instr_tbl[idx++], "STP",  &cpu6502::STP, 3, NON, WDC  /* 0xDB */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 4, ABS, C02  /* 0xDC */);
-    set_tbl_entry(instr_tbl[idx++], "CMP",  &cpu6502::CMP, 4, ABX, BASE /* 0xDD */);
-    set_tbl_entry(instr_tbl[idx++], "DEC",  &cpu6502::DEC, 7, ABX, BASE /* 0xDE */);
-    set_tbl_entry(instr_tbl[idx++], "BBS5", &cpu6502::BBS, 5, ZPR, WRK  /* 0xDF */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "CPX",  &cpu6502::CPX, 2, IMM, BASE /* 0xE0 */);
-    set_tbl_entry(instr_tbl[idx++], "SBC",  &cpu6502::SBC, 6, IDX, BASE /* 0xE1 */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 2, IMM, C02  /* 0xE2 */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0xE3 */);
-    set_tbl_entry(instr_tbl[idx++], "CPX",  &cpu6502::CPX, 3, ZPG, BASE /* 0xE4 */);
-    set_tbl_entry(instr_tbl[idx++], "SBC",  &cpu6502::SBC, 3, ZPG, BASE /* 0xE5 */);
-    set_tbl_entry(instr_tbl[idx++], "INC",  &cpu6502::INC, 5, ZPG, BASE /* 0xE6 */);
-    set_tbl_entry(instr_tbl[idx++], "SMB6", &cpu6502::SMB, 5, ZPG, WRK  /* 0xE7 */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "INX",  &cpu6502::INX, 2, NON, BASE /* 0xE8 */);
-    set_tbl_entry(instr_tbl[idx++], "SBC",  &cpu6502::SBC, 2, IMM, BASE /* 0xE9 */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 2, NON, BASE /* 0xEA */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0xEB */);
-    set_tbl_entry(instr_tbl[idx++], "CPX",  &cpu6502::CPX, 4, ABS, BASE /* 0xEC */);
-    set_tbl_entry(instr_tbl[idx++], "SBC",  &cpu6502::SBC, 4, ABS, BASE /* 0xED */);
-    set_tbl_entry(instr_tbl[idx++], "INC",  &cpu6502::INC, 6, ABS, BASE /* 0xEE */);
-    set_tbl_entry(instr_tbl[idx++], "BBS6", &cpu6502::BBS, 5, ZPR, WRK  /* 0xEF */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "BEQ",  &cpu6502::BEQ, 2, REL, BASE /* 0xF0 */);
-    set_tbl_entry(instr_tbl[idx++], "SBC",  &cpu6502::SBC, 5, IDY, BASE /* 0xF1 */);
-    set_tbl_entry(instr_tbl[idx++], "SBC",  &cpu6502::SBC, 5, IDZ, C02  /* 0xF2 */); // 65C02
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0xF3 */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 4, ZPX, C02  /* 0xF4 */);
-    set_tbl_entry(instr_tbl[idx++], "SBC",  &cpu6502::SBC, 4, ZPX, BASE /* 0xF5 */);
-    set_tbl_entry(instr_tbl[idx++], "INC",  &cpu6502::INC, 6, ZPX, BASE /* 0xF6 */);
-    set_tbl_entry(instr_tbl[idx++], "SMB7", &cpu6502::SMB, 5, ZPG, WRK  /* 0xF7 */); // WDC65C02
-    set_tbl_entry(instr_tbl[idx++], "SED",  &cpu6502::SED, 2, NON, BASE /* 0xF8 */);
-    set_tbl_entry(instr_tbl[idx++], "SBC",  &cpu6502::SBC, 4, ABY, BASE /* 0xF9 */);
-    set_tbl_entry(instr_tbl[idx++], "PLX",  &cpu6502::PLX, 4, NON, C02  /* 0xFA */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 1, NON, C02  /* 0xFB */);
-    set_tbl_entry(instr_tbl[idx++], "NOP",  &cpu6502::NOP, 4, ABS, C02  /* 0xFC */);
-    set_tbl_entry(instr_tbl[idx++], "SBC",  &cpu6502::SBC, 4, ABX, BASE /* 0xFD */);
-    set_tbl_entry(instr_tbl[idx++], "INC",  &cpu6502::INC, 7, ABX, BASE /* 0xFE */);
-    set_tbl_entry(instr_tbl[idx++], "BBS7", &cpu6502::BBS, 5, ZPR, WRK  /* 0xFF */); // WDC65C02
+    // Select the instruction table for the default variant
+    instr_tbl         = instr_tbls[state.mode_c];
+
+    memset(rom_page, 0, sizeof(rom_page));
+    memset(cow_page, 0, sizeof(cow_page));
+    pages_mapped      = false;
+
+    for (uint32_t page_num = 0; page_num < WY65_NUM_MAP_PAGES; page_num++)
+    {
+        set_unmapped_page(page_num);
+    }
+
+    set_fusion_pairs(NULL, 0);
+    set_dis_output(NULL);
 }
 
+// -------------------------------------------------------------------------
+// ~cpu6502
+//
+// Class destructor
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+cpu6502_core<BUS>::~cpu6502_core()
+{
+    enable_decode_cache(false);
+
+    // Release pages shared with forked models
+    for (uint32_t page_num = 0; page_num < WY65_NUM_MAP_PAGES; page_num++)
+    {
+        if (cow_page[page_num] != NULL && cow_page[page_num]->refs.fetch_sub(1) == 1)
+        {
+            delete cow_page[page_num];
+        }
+    }
+
+    delete [] p_blk_tbl;
+    delete [] p_uop_pool;
+    delete [] p_code_byte;
+    delete [] p_static_tbl;
+    delete [] p_pair_prof;
+
+    jit_free();
+
+    if (fp != NULL && fp_owned)
+    {
+        fclose(fp);
+    }
+}
+
+// -------------------------------------------------------------------------
+// instr_tbls
+//
+// The instruction table for each CPU variant, constructed at compile time
+// from WY65_OPCODE_TABLE, which lists the opcodes in order. The instruction
+// loops then need no per-instruction check of the CPU variant.
+//
+// -------------------------------------------------------------------------
+
+#define WY65_TBL_ENTRY(_variant, _op, _str, _func, _cyc, _mode, _cpu) \
+    tbl_entry(_variant, _str, #_func, &cpu6502_core::_func<_mode>, &cpu6502_core::NOP<nop_mode(_variant, _mode, _cpu)>, _cyc, _mode, _cpu),
+
+#define WY65_TBL_ENTRY_BASE(...) WY65_TBL_ENTRY(BASE, __VA_ARGS__)
+#define WY65_TBL_ENTRY_C02(...)  WY65_TBL_ENTRY(C02,  __VA_ARGS__)
+#define WY65_TBL_ENTRY_WRK(...)  WY65_TBL_ENTRY(WRK,  __VA_ARGS__)
+#define WY65_TBL_ENTRY_WDC(...)  WY65_TBL_ENTRY(WDC,  __VA_ARGS__)
+
+template <class BUS>
+constexpr typename cpu6502_core<BUS>::tbl_t cpu6502_core<BUS>::instr_tbls[WY65_NUM_CPU_TYPES][WY65_INSTR_SPACE_SIZE] =
+{
+    {WY65_OPCODE_TABLE(WY65_TBL_ENTRY_BASE)},
+    {WY65_OPCODE_TABLE(WY65_TBL_ENTRY_C02)},
+    {WY65_OPCODE_TABLE(WY65_TBL_ENTRY_WRK)},
+    {WY65_OPCODE_TABLE(WY65_TBL_ENTRY_WDC)}
+};
+
+#undef WY65_TBL_ENTRY
+#undef WY65_TBL_ENTRY_BASE
+#undef WY65_TBL_ENTRY_C02
+#undef WY65_TBL_ENTRY_WRK
+#undef WY65_TBL_ENTRY_WDC
+
 // -------------------------------------------------------------------------
 // calc_address()
 //
@@ -357,12 +255,15 @@ cpu6502::cpu6502()
 // mode. If a page is crossed (for relevant instructions), return status
 //  in supplied variable (pg_crossed).
 //
-// NB: On entry p_regs->pc should be pointing to memory location after 
-// opcode.
+// NB: On entry the operand bytes have been fetched to p_op->operand, and
+// p_regs->pc is pointing to the next instruction. Modes that cannot cross a
+// page leave pg_crossed as a constant false, so the check folds away in the
+// calling instruction method.
 //
 // -------------------------------------------------------------------------
 
-uint32_t cpu6502::calc_addr(const addr_mode_e mode, wy65_reg_t* p_regs, bool &pg_crossed)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+inline uint32_t cpu6502_core<BUS>::calc_addr(const op_t* p_op, wy65_reg_t* p_regs, bool &pg_crossed)
 {
     uint32_t addr      = INVALID_ADDR;
     uint32_t tmp_addr;
@@ -370,103 +271,94 @@ uint32_t cpu6502::calc_addr(const addr_mode_e mode, wy65_reg_t* p_regs, bool &pg
     // Default to no page crossing
     pg_crossed         = false;
 
-    switch(mode)
+    // MODE is a compile time constant, so only the relevant case is compiled
+    // into each instruction method instantiation
+    switch(MODE)
     {
     case IND:
-        tmp_addr      = rd_mem(p_regs->pc);
-        tmp_addr     |= rd_mem(((p_regs->pc & MASK_8BIT) == MASK_8BIT && state.mode_c == BASE) ? (p_regs->pc & 0xff00) :  p_regs->pc+1) << 8;
+        // The base 6502 does not carry into the pointer's high byte when
+        // the pointer's low byte is at the end of a page
+        tmp_addr      = p_op->operand;
         addr          = rd_mem(tmp_addr);
-        addr         |= rd_mem(tmp_addr+1) << 8;
-        
-        p_regs->pc   += 2;
+        addr         |= rd_mem(((tmp_addr & MASK_8BIT) == MASK_8BIT && state.mode_c == BASE) ? (tmp_addr & 0xff00) : (tmp_addr+1) & MASK_16BIT) << 8;
         break;       
                      
+    // Zero page pointers wrap within zero page, so a pointer at 0xff has its
+    // high byte at 0x00
     case IDX:        
-        tmp_addr      = (rd_mem(p_regs->pc) + p_regs->x) & MASK_8BIT;
-        addr          = rd_mem(tmp_addr) | (rd_mem(tmp_addr+1) << 8);
-        p_regs->pc   += 1;
+        tmp_addr      = (p_op->operand + p_regs->x) & MASK_8BIT;
+        addr          = rd_mem(tmp_addr) | (rd_mem((tmp_addr+1) & MASK_8BIT) << 8);
         break;
 
     case IDY:
-        tmp_addr      = rd_mem(p_regs->pc);
-        tmp_addr      = rd_mem(tmp_addr) | (rd_mem(tmp_addr+1) << 8);
+        tmp_addr      = p_op->operand & MASK_8BIT;
+        tmp_addr      = rd_mem(tmp_addr) | (rd_mem((tmp_addr+1) & MASK_8BIT) << 8);
         addr          = (tmp_addr + p_regs->y) & MASK_16BIT;
         pg_crossed    = ((addr ^ tmp_addr) >> 8) ? true : false;
-        p_regs->pc   += 1;
         break;
 
     case ABS:
-        addr          = rd_mem(p_regs->pc) | (rd_mem(p_regs->pc+1) << 8);
-        p_regs->pc   += 2;
+        addr          = p_op->operand;
         break;
 
     case ABX:
-        tmp_addr      = rd_mem(p_regs->pc) | (rd_mem(p_regs->pc+1) << 8);
+        tmp_addr      = p_op->operand;
         addr          = (tmp_addr + p_regs->x) & MASK_16BIT;
         pg_crossed    = ((addr ^ tmp_addr) >> 8) ? true : false;
-        p_regs->pc   += 2;
         break;
 
     case ABY:
-        tmp_addr      = rd_mem(p_regs->pc) | (rd_mem(p_regs->pc+1) << 8);
+        tmp_addr      = p_op->operand;
         addr          = (tmp_addr + p_regs->y) & MASK_16BIT;
         pg_crossed    = ((addr ^ tmp_addr) >> 8) ? true : false;
-        p_regs->pc   += 2;
         break;
 
     case ZPG:
-        addr          = rd_mem(p_regs->pc) & MASK_8BIT;
-        p_regs->pc   += 1;
+        addr          = p_op->operand & MASK_8BIT;
         break;
 
     case ZPX:
-        addr          = (rd_mem(p_regs->pc) + p_regs->x) & MASK_8BIT;
-        p_regs->pc   += 1;
+        addr          = (p_op->operand + p_regs->x) & MASK_8BIT;
         break;
 
     case ZPY:
-        addr          = (rd_mem(p_regs->pc) + p_regs->y) & MASK_8BIT;
-        p_regs->pc   += 1;
+        addr          = (p_op->operand + p_regs->y) & MASK_8BIT;
         break;
 
     case REL:
-        tmp_addr      = p_regs->pc + 1;                             // Location of next instruction in cpu_memory
+        tmp_addr      = p_regs->pc;                                 // Location of next instruction in cpu_memory
 
-        addr          = (tmp_addr + (int8_t)rd_mem(p_regs->pc)) & MASK_16BIT;
+        addr          = (tmp_addr + (int8_t)p_op->operand) & MASK_16BIT;
         pg_crossed    = ((addr ^ tmp_addr) >> 8) ? true : false;
-        p_regs->pc    = tmp_addr;                                   // Default PC to next instruction
         break;
 
     case IMM:
-        addr          = p_regs->pc;
-        p_regs->pc   += 1;
+        // Immediate data is in p_op->operand (see rd_data()), but return the
+        // location of the operand byte for completeness
+        addr          = (p_regs->pc - 1) & MASK_16BIT;
         break;
 
     // 65C02 only
     case IAX:
         // Get 16 bit operand and add X 
-        tmp_addr      = rd_mem(p_regs->pc) | (rd_mem(p_regs->pc+1) << 8); 
-        tmp_addr      = (tmp_addr + p_regs->x) & MASK_16BIT;
+        tmp_addr      = (p_op->operand + p_regs->x) & MASK_16BIT;
 
         // Address is value located at above address location
         addr          = rd_mem(tmp_addr) | (rd_mem(tmp_addr+1) << 8);
-        p_regs->pc   += 2;
         break;
 
-    // WDC 65C02 only. Unlike relative addressing PC remains pointing 
-    // at byte after opcode (for Zero page address), and BBS/BBR instructions
-    // must advance PC by 2 when branch not taken.
+    // WDC 65C02 only. The first operand byte is the zero page address, tested
+    // by the BBS/BBR instructions, and the second is the relative branch offset.
     case ZPR:
-        tmp_addr      = p_regs->pc + 2;                             // Location of next instruction in cpu_memory
+        tmp_addr      = p_regs->pc;                                 // Location of next instruction in cpu_memory
 
-        addr          = (tmp_addr + (int8_t)rd_mem(p_regs->pc+1)) & MASK_16BIT;
+        addr          = (tmp_addr + (int8_t)(p_op->operand >> 8)) & MASK_16BIT;
         pg_crossed    = ((addr ^ tmp_addr) >> 8) ? true : false;
         break;
 
     case IDZ:
-        tmp_addr      = rd_mem(p_regs->pc);
-        addr          = rd_mem(tmp_addr) | (rd_mem(tmp_addr+1) << 8);
-        p_regs->pc   += 1;
+        tmp_addr      = p_op->operand & MASK_8BIT;
+        addr          = rd_mem(tmp_addr) | (rd_mem((tmp_addr+1) & MASK_8BIT) << 8);
         break;
 
     // No address required
@@ -479,57 +371,37 @@ uint32_t cpu6502::calc_addr(const addr_mode_e mode, wy65_reg_t* p_regs, bool &pg
 }
 
 // -------------------------------------------------------------------------
-// Instruction methods. All take an op_t pointer as input (opcode,
-// addressing mode and minimum execution cycles. The final execution
-// count is returned on exit (with extras for page crossing, branching
-// etc., as relevant, added in).
+// Instruction methods. All take an op_t pointer as input (opcode and
+// minimum execution cycles). The addressing mode is a template parameter,
+// with a specialisation instantiated for each table entry. The final
+// execution count is returned on exit (with extras for page crossing,
+// branching etc., as relevant, added in).
 // -------------------------------------------------------------------------
 
-int cpu6502::ADC (const op_t* p_op) 
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::ADC (const op_t* p_op) 
 {
     bool     page_crossed;
     int32_t  result;
 
     bool bcd          = (state.regs.flags & BCD_MASK) ? true : false;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
     // Fetch the operand from memory
-    uint8_t mem_val   = rd_mem(addr);
+    uint8_t mem_val   = rd_data<MODE>(p_op, addr);
     uint8_t acc       = state.regs.a;
 
     if (bcd)
     {
-        uint16_t tmp;
-        uint16_t lo_nib;
-        uint16_t hi_nib;
-        bool     bcd_carry;
-        
-        // Do low digit BCD addition and flag if result has carried ( > 9)
-        tmp               = (acc & MASK_LO_NIB) + (mem_val & MASK_LO_NIB) + (state.regs.flags & CARRY_MASK);
-        bcd_carry         = tmp > 9;
-
-        // Get low digit result, adjusting if carried
-        lo_nib            = bcd_carry ? (tmp + 0x06) & MASK_LO_NIB : tmp;
-                
-        // Do high digit BCD addition, adding in carry from low digit as applicable, and flag if carried
-        tmp               = (acc & MASK_HI_NIB) + (mem_val & MASK_HI_NIB) + (bcd_carry ? 0x10 : 0);
-        bcd_carry         = (tmp > 0x90);
-
-        // Get high digit result, adjusting if carried
-        hi_nib            = bcd_carry ? (tmp + 0x60) & MASK_HI_NIB : tmp;
-                     
-        // Combine two digits into accumulator
-        state.regs.a      = (hi_nib | lo_nib) & MASK_8BIT;
+        // Look up the result and the carry and overflow flags
+        uint16_t res      = bcd_adc_tbl[state.regs.flags & CARRY_MASK][(acc << 8) | mem_val];
 
-        // Clear affected flags
-        state.regs.flags &= ~(CARRY_MASK | ZERO_MASK | OVFLW_MASK | SIGN_MASK);
+        state.regs.a      = res & MASK_8BIT;
 
-        state.regs.flags |= (state.regs.a == 0)                             ? ZERO_MASK  : 0;
-        state.regs.flags |= ((tmp & SIGN_MASK)==0) ^ ((acc & SIGN_MASK)==0) ? OVFLW_MASK : 0;
-        state.regs.flags |= bcd_carry                                       ? CARRY_MASK : 0;
-        state.regs.flags |= state.regs.a & SIGN_MASK;
+        state.regs.flags  = (state.regs.flags & ~(CARRY_MASK | OVFLW_MASK)) | (res >> 8);
+        set_nz(state.regs.a);
     }
     else
     {
@@ -541,13 +413,12 @@ int cpu6502::ADC (const op_t* p_op)
         uint32_t res_uns  = state.regs.a  + mem_val + ((state.regs.flags & CARRY_MASK) ? 1 : 0);
         
         // Clear affected flags
-        state.regs.flags &= ~(CARRY_MASK | ZERO_MASK | OVFLW_MASK | SIGN_MASK);
+        state.regs.flags &= ~(CARRY_MASK | OVFLW_MASK);
         
         // Set flags, based on extended result
         state.regs.flags |= (res_uns >=  0x100U)            ? CARRY_MASK : 0;
-        state.regs.flags |= ((result & MASK_8BIT) == 0)     ? ZERO_MASK  : 0;
         state.regs.flags |= (result < -128 || result > 127) ? OVFLW_MASK : 0;
-        state.regs.flags |= (result & SIGN_MASK)            ? SIGN_MASK  : 0;
+        set_nz(result);
         
         // Store result in accumulator
         state.regs.a      = result & MASK_8BIT;
@@ -557,42 +428,39 @@ int cpu6502::ADC (const op_t* p_op)
     return p_op->exec_cycles + (page_crossed ? 1 : 0) + (bcd ? 1 : 0);
 }
 
-int cpu6502::AND (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::AND (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
-
-    state.regs.a      = state.regs.a & rd_mem(addr);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
-    // Clear affected flags
-    state.regs.flags &= ~(ZERO_MASK | SIGN_MASK);
+    state.regs.a      = state.regs.a & rd_data<MODE>(p_op, addr);
 
-    state.regs.flags |= (state.regs.a == 0)   ?  ZERO_MASK  : 0;
-    state.regs.flags |= state.regs.a & SIGN_MASK;
+    set_nz(state.regs.a);
 
     return p_op->exec_cycles + (page_crossed ? 1 : 0);
 }
 
-int cpu6502::ASL (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::ASL (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
-    uint8_t val      = ((p_op->mode == ACC) ? (uint32_t)state.regs.a : (uint32_t)rd_mem(addr));
+    uint8_t val      = ((MODE == ACC) ? (uint32_t)state.regs.a : (uint32_t)rd_mem(addr));
     uint8_t result   = val << 1;
 
     // Clear affected flags
-    state.regs.flags &= ~(ZERO_MASK | CARRY_MASK | SIGN_MASK);
+    state.regs.flags &= ~CARRY_MASK;
 
-    state.regs.flags |= !(result & MASK_8BIT) ? ZERO_MASK  : 0;
     state.regs.flags |= (val & 0x80)          ? CARRY_MASK : 0;
-    state.regs.flags |= result & SIGN_MASK;
+    set_nz(result);
 
-    if (p_op->mode == ACC)
+    if (MODE == ACC)
     {
         state.regs.a  = result;
     }
@@ -602,15 +470,16 @@ int cpu6502::ASL (const op_t* p_op)
     }
 
     // For 65C02 1 cycle quicker for ABX and no page crossing
-    return p_op->exec_cycles - ((!page_crossed && p_op->mode == ABX) ? 1 : 0);  
+    return p_op->exec_cycles - ((!page_crossed && MODE == ABX) ? 1 : 0);  
 }
 
-int cpu6502::BCC (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::BCC (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
     if (!(state.regs.flags & CARRY_MASK))
     {
@@ -624,12 +493,13 @@ int cpu6502::BCC (const op_t* p_op)
     }
 }
 
-int cpu6502::BCS (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::BCS (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
     if (state.regs.flags & CARRY_MASK)
     {
@@ -643,14 +513,15 @@ int cpu6502::BCS (const op_t* p_op)
     }
 }
 
-int cpu6502::BEQ (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::BEQ (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
-    if (state.regs.flags & ZERO_MASK)
+    if (flag_z())
     {
         state.regs.pc = addr;
 
@@ -662,41 +533,43 @@ int cpu6502::BEQ (const op_t* p_op)
     }
 }
 
-int cpu6502::BIT (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::BIT (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
-    uint8_t  mem_val  = rd_mem(addr);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
+    uint8_t  mem_val  = rd_data<MODE>(p_op, addr);
 
     bool is_zero      = (state.regs.a & mem_val) ? false : true;
 
-    // Clear affected flags
-    state.regs.flags &= ~ZERO_MASK;
-
-    state.regs.flags |= is_zero ? ZERO_MASK  : 0;
-
     // O and N bits not altered for immediate mode
-    if (p_op->mode != IMM)
+    if (MODE != IMM)
     {
-      state.regs.flags &= ~(OVFLW_MASK | SIGN_MASK);
+      state.regs.flags &= ~OVFLW_MASK;
 
       state.regs.flags |= mem_val & OVFLW_MASK;
-      state.regs.flags |= mem_val & SIGN_MASK;
+
+      set_nz(mem_val & SIGN_MASK, is_zero);
+    }
+    else
+    {
+      set_nz(flag_n(), is_zero);
     }
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::BMI (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::BMI (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
-    if (state.regs.flags & SIGN_MASK)
+    if (flag_n())
     {
         state.regs.pc = addr;
 
@@ -708,14 +581,15 @@ int cpu6502::BMI (const op_t* p_op)
     }
 }
 
-int cpu6502::BNE (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::BNE (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
-    if (!(state.regs.flags & ZERO_MASK))
+    if (!flag_z())
     {
         state.regs.pc = addr;
 
@@ -727,14 +601,15 @@ int cpu6502::BNE (const op_t* p_op)
     }
 }
 
-int cpu6502::BPL (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::BPL (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
-    if (!(state.regs.flags & SIGN_MASK))
+    if (!flag_n())
     {
         state.regs.pc = addr;
 
@@ -746,7 +621,8 @@ int cpu6502::BPL (const op_t* p_op)
     }
 }
 
-int cpu6502::BRK (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::BRK (const op_t* p_op)
 {
     state.regs.flags |= BRK_MASK;
 
@@ -758,7 +634,7 @@ int cpu6502::BRK (const op_t* p_op)
 
     wr_mem(state.regs.sp | 0x100, (state.regs.pc >> 8) & MASK_8BIT); state.regs.sp--;
     wr_mem(state.regs.sp | 0x100, state.regs.pc & MASK_8BIT); state.regs.sp--;
-    wr_mem(state.regs.sp | 0x100, state.regs.flags); state.regs.sp--;
+    wr_mem(state.regs.sp | 0x100, get_flags()); state.regs.sp--;
 
     state.regs.flags |= INT_MASK;
 
@@ -772,12 +648,13 @@ int cpu6502::BRK (const op_t* p_op)
     return p_op->exec_cycles;
 }
 
-int cpu6502::BVC (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::BVC (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
     if (!(state.regs.flags & OVFLW_MASK))
     {
@@ -791,12 +668,13 @@ int cpu6502::BVC (const op_t* p_op)
     }
 }
 
-int cpu6502::BVS (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::BVS (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
     if (state.regs.flags & OVFLW_MASK)
     {
@@ -810,126 +688,128 @@ int cpu6502::BVS (const op_t* p_op)
     }
 }
 
-int cpu6502::CLC (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::CLC (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
     state.regs.flags &= ~(CARRY_MASK);
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::CLD (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::CLD (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
     state.regs.flags &= ~(BCD_MASK);
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::CLI (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::CLI (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
     state.regs.flags &= ~(INT_MASK);
 
-    // After clearing the I flag, check for interrupt
-    irq();
+    // After clearing the I flag, any active IRQ is taken at the next instruction
+    irq_update();
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::CLV (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::CLV (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
     state.regs.flags &= ~(OVFLW_MASK);
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::CMP (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::CMP (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr         = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr         = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
-    int32_t result        = (int32_t)state.regs.a - (int32_t)rd_mem(addr);
+    int32_t result        = (int32_t)state.regs.a - (int32_t)rd_data<MODE>(p_op, addr);
 
-    state.regs.flags     &= ~(ZERO_MASK | CARRY_MASK | SIGN_MASK);
+    state.regs.flags     &= ~CARRY_MASK;
+    state.regs.flags     |= (result >= 0) ? CARRY_MASK : 0;
 
-    state.regs.flags     |= (result == 0)   ? ZERO_MASK  : 0;
-    state.regs.flags     |= (result >= 0)   ? CARRY_MASK : 0;
-    state.regs.flags     |= (result & 0x80) ? SIGN_MASK  : 0;
+    set_nz(result);
 
     return p_op->exec_cycles + (page_crossed ? 1 : 0);
 }
 
-int cpu6502::CPX (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::CPX (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
-    int32_t result    = (int32_t)state.regs.x - (int32_t)rd_mem(addr);
+    int32_t result    = (int32_t)state.regs.x - (int32_t)rd_data<MODE>(p_op, addr);
 
-    state.regs.flags &= ~(ZERO_MASK | CARRY_MASK | SIGN_MASK);
+    state.regs.flags &= ~CARRY_MASK;
+    state.regs.flags |= (result >= 0) ? CARRY_MASK : 0;
 
-    state.regs.flags |= (result == 0)   ? ZERO_MASK  : 0;
-    state.regs.flags |= (result >= 0)   ? CARRY_MASK : 0;
-    state.regs.flags |= (result & 0x80) ? SIGN_MASK  : 0;
+    set_nz(result);
 
     return p_op->exec_cycles + (page_crossed ? 1 : 0);
 }
 
-int cpu6502::CPY (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::CPY (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
-    int32_t result    = (int32_t)state.regs.y - (int32_t)rd_mem(addr);
+    int32_t result    = (int32_t)state.regs.y - (int32_t)rd_data<MODE>(p_op, addr);
 
-    state.regs.flags     &= ~(ZERO_MASK | CARRY_MASK | SIGN_MASK);
+    state.regs.flags     &= ~CARRY_MASK;
+    state.regs.flags     |= (result >= 0) ? CARRY_MASK : 0;
 
-    state.regs.flags |= (result == 0)   ? ZERO_MASK  : 0;
-    state.regs.flags |= (result >= 0)   ? CARRY_MASK : 0;
-    state.regs.flags |= (result & 0x80) ? SIGN_MASK  : 0;
+    set_nz(result);
 
     return p_op->exec_cycles + (page_crossed ? 1 : 0);
 }
 
-int cpu6502::DEC (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::DEC (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
-
-    uint8_t result    = ((p_op->mode == ACC) ? state.regs.a : rd_mem(addr)) - 1;
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
-    state.regs.flags &= ~(ZERO_MASK | SIGN_MASK);
+    uint8_t result    = ((MODE == ACC) ? state.regs.a : rd_mem(addr)) - 1;
 
-    state.regs.flags |= (result == 0)   ? ZERO_MASK  : 0;
-    state.regs.flags |= (result & 0x80) ? SIGN_MASK  : 0;
+    set_nz(result);
 
-    if (p_op->mode == ACC)
+    if (MODE == ACC)
     {
         state.regs.a  = result;
     }
@@ -941,77 +821,68 @@ int cpu6502::DEC (const op_t* p_op)
     return p_op->exec_cycles;
 }
 
-int cpu6502::DEX (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::DEX (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
     uint8_t result    = state.regs.x - 1;
 
-    state.regs.flags &= ~(ZERO_MASK | SIGN_MASK);
-
-    state.regs.flags |= (result == 0)   ? ZERO_MASK  : 0;
-    state.regs.flags |= (result & 0x80) ? SIGN_MASK  : 0;
+    set_nz(result);
 
     state.regs.x      = result;
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::DEY (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::DEY (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
     uint8_t result    = state.regs.y - 1;
 
-    state.regs.flags &= ~(ZERO_MASK | SIGN_MASK);
-
-    state.regs.flags |= (result == 0)   ? ZERO_MASK  : 0;
-    state.regs.flags |= (result & 0x80) ? SIGN_MASK  : 0;
+    set_nz(result);
 
     state.regs.y      = result;
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::EOR (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::EOR (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
-    state.regs.a      = state.regs.a ^ rd_mem(addr);
+    state.regs.a      = state.regs.a ^ rd_data<MODE>(p_op, addr);
 
-    // Clear affected flags
-    state.regs.flags &= ~(ZERO_MASK | SIGN_MASK);
-                     
-    state.regs.flags |= (state.regs.a == 0)   ?  ZERO_MASK  : 0;
-    state.regs.flags |= (state.regs.a & 0x80) ?  SIGN_MASK  : 0;
+    set_nz(state.regs.a);
 
     return p_op->exec_cycles + (page_crossed ? 1 : 0);
 }
 
-int cpu6502::INC (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::INC (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
-    uint8_t result    = ((p_op->mode == ACC) ? state.regs.a : rd_mem(addr)) + 1;
+    uint8_t result    = ((MODE == ACC) ? state.regs.a : rd_mem(addr)) + 1;
 
-    state.regs.flags &= ~(ZERO_MASK | SIGN_MASK);
+    set_nz(result);
 
-    state.regs.flags |= (result == 0)   ? ZERO_MASK  : 0;
-    state.regs.flags |= (result & 0x80) ? SIGN_MASK  : 0;
-
-    if (p_op->mode == ACC)
+    if (MODE == ACC)
     {
         state.regs.a  = result & MASK_8BIT;
     }
@@ -1023,62 +894,60 @@ int cpu6502::INC (const op_t* p_op)
     return p_op->exec_cycles;
 }
 
-int cpu6502::INX (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::INX (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
     uint8_t result    = state.regs.x + 1;
 
-    state.regs.flags &= ~(ZERO_MASK | SIGN_MASK);
-
-    state.regs.flags |= (result == 0)   ? ZERO_MASK  : 0;
-    state.regs.flags |= (result & 0x80) ? SIGN_MASK  : 0;
+    set_nz(result);
 
     state.regs.x      = result;
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::INY (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::INY (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
     uint8_t result    = state.regs.y + 1;
 
-    state.regs.flags &= ~(ZERO_MASK | SIGN_MASK);
-
-    state.regs.flags |= (result == 0)   ? ZERO_MASK  : 0;
-    state.regs.flags |= (result & 0x80) ? SIGN_MASK  : 0;
+    set_nz(result);
 
     state.regs.y      = result;
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::JMP (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::JMP (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
     state.regs.pc     = addr;
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::JSR (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::JSR (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
     uint16_t pc_m1    = state.regs.pc - 1;
     
@@ -1090,74 +959,68 @@ int cpu6502::JSR (const op_t* p_op)
     return p_op->exec_cycles;
 }
 
-int cpu6502::LDA (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::LDA (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
     
-    state.regs.a      = rd_mem(addr);
+    state.regs.a      = rd_data<MODE>(p_op, addr);
     
-    state.regs.flags &= ~(ZERO_MASK | SIGN_MASK);
-
-    state.regs.flags |= (state.regs.a == 0)   ? ZERO_MASK  : 0;
-    state.regs.flags |= (state.regs.a & 0x80) ? SIGN_MASK  : 0;
+    set_nz(state.regs.a);
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::LDX (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::LDX (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
     
-    state.regs.x      = rd_mem(addr);
+    state.regs.x      = rd_data<MODE>(p_op, addr);
     
-    state.regs.flags &= ~(ZERO_MASK | SIGN_MASK);
-
-    state.regs.flags |= (state.regs.x == 0)   ? ZERO_MASK  : 0;
-    state.regs.flags |= (state.regs.x & 0x80) ? SIGN_MASK  : 0;
+    set_nz(state.regs.x);
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::LDY (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::LDY (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
     
-    state.regs.y      = rd_mem(addr);
+    state.regs.y      = rd_data<MODE>(p_op, addr);
     
-    state.regs.flags &= ~(ZERO_MASK | SIGN_MASK);
-
-    state.regs.flags |= (state.regs.y == 0)   ? ZERO_MASK  : 0;
-    state.regs.flags |= (state.regs.y & 0x80) ? SIGN_MASK  : 0;
+    set_nz(state.regs.y);
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::LSR (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::LSR (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
-    uint8_t val      = (p_op->mode == ACC) ? state.regs.a : rd_mem(addr);
+    uint8_t val      = (MODE == ACC) ? state.regs.a : rd_mem(addr);
     uint8_t result   = (val >> 1) & 0x7f; 
 
-    state.regs.flags &= ~(ZERO_MASK | CARRY_MASK | SIGN_MASK);
-
-    state.regs.flags |= (result == 0)   ? ZERO_MASK  : 0;
-    state.regs.flags |= (result & 0x80) ? SIGN_MASK  : 0;
+    state.regs.flags &= ~CARRY_MASK;
     state.regs.flags |= (val    & 0x01) ? CARRY_MASK : 0;
 
-    if (p_op->mode == ACC)
+    set_nz(result);
+
+    if (MODE == ACC)
     {
         state.regs.a  = result;
     }
@@ -1169,93 +1032,86 @@ int cpu6502::LSR (const op_t* p_op)
     return p_op->exec_cycles;
 }
 
-int cpu6502::NOP (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::NOP (const op_t*)
 {
-    bool page_crossed;
-
     // Could reach here for undocumented instructions. Opcode table has 
     // an 'address mode' for each  instruction to indicate the instructions 
-    // probable byte size, so call calc_addr to skip these bytes.
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
-
+    // probable byte size, so these bytes have already been skipped when
+    // the operand was fetched.
     return 0;
 }
 
-int cpu6502::ORA (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::ORA (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
-
-    state.regs.a      = state.regs.a | rd_mem(addr);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
-    // Clear affected flags
-    state.regs.flags &= ~(ZERO_MASK | SIGN_MASK);
+    state.regs.a      = state.regs.a | rd_data<MODE>(p_op, addr);
 
-    state.regs.flags |= (state.regs.a == 0)   ?  ZERO_MASK  : 0;
-    state.regs.flags |= (state.regs.a & 0x80) ?  SIGN_MASK  : 0;
+    set_nz(state.regs.a);
 
     return p_op->exec_cycles + (page_crossed ? 1 : 0);
 }
 
-int cpu6502::PHA (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::PHA (const op_t* p_op)
 {
     wr_mem(state.regs.sp | 0x100, state.regs.a); state.regs.sp--;
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::PHP (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::PHP (const op_t* p_op)
 {
-    wr_mem(state.regs.sp | 0x100, state.regs.flags | 0x30); state.regs.sp--;
+    wr_mem(state.regs.sp | 0x100, get_flags() | 0x30); state.regs.sp--;
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::PLA (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::PLA (const op_t* p_op)
 {
     state.regs.sp++;
     state.regs.a      = rd_mem(state.regs.sp | 0x100);
 
-    // Clear affected flags
-    state.regs.flags &= ~(ZERO_MASK | SIGN_MASK);
-
-    state.regs.flags |= (state.regs.a == 0)   ?  ZERO_MASK  : 0;
-    state.regs.flags |= (state.regs.a & 0x80) ?  SIGN_MASK  : 0;
+    set_nz(state.regs.a);
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::PLP (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::PLP (const op_t* p_op)
 {
     state.regs.sp++;
     
-    state.regs.flags  = rd_mem(state.regs.sp | 0x100);
-
-    // I flags status updated, so check for interrupts
-    irq();
+    // I flags status updated (and any active IRQ pending) by set_flags()
+    set_flags(rd_mem(state.regs.sp | 0x100));
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::ROL (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::ROL (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
-    uint32_t val      = (p_op->mode == ACC) ? state.regs.a : rd_mem(addr);
+    uint32_t val      = (MODE == ACC) ? state.regs.a : rd_mem(addr);
     uint32_t result   = (val << 1) | ((state.regs.flags & CARRY_MASK) ? 1 : 0);
 
-    state.regs.flags &= ~(ZERO_MASK | CARRY_MASK | SIGN_MASK);
+    state.regs.flags &= ~CARRY_MASK;
+    state.regs.flags |= (val    & 0x80) ? CARRY_MASK : 0;
 
-    state.regs.flags |= ((result & MASK_8BIT) == 0) ? ZERO_MASK  : 0;
-    state.regs.flags |= (result & 0x80)             ? SIGN_MASK  : 0;
-    state.regs.flags |= (val    & 0x80)             ? CARRY_MASK : 0;
+    set_nz(result);
 
-    if (p_op->mode == ACC)
+    if (MODE == ACC)
     {
         state.regs.a  = result & MASK_8BIT;
     }
@@ -1267,23 +1123,23 @@ int cpu6502::ROL (const op_t* p_op)
     return p_op->exec_cycles;
 }
 
-int cpu6502::ROR (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::ROR (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
-    uint32_t val      = (p_op->mode == ACC) ? state.regs.a : rd_mem(addr);
+    uint32_t val      = (MODE == ACC) ? state.regs.a : rd_mem(addr);
     uint32_t result   = ((val >> 1) & 0x7f) | ((state.regs.flags & CARRY_MASK) ? 0x80 : 0);
 
-    state.regs.flags &= ~(ZERO_MASK | CARRY_MASK | SIGN_MASK);
-
-    state.regs.flags |= (result == 0)   ? ZERO_MASK  : 0;
-    state.regs.flags |= (result & 0x80) ? SIGN_MASK  : 0;
+    state.regs.flags &= ~CARRY_MASK;
     state.regs.flags |= (val    & 0x01) ? CARRY_MASK : 0;
 
-    if (p_op->mode == ACC)
+    set_nz(result);
+
+    if (MODE == ACC)
     {
         state.regs.a  = result & MASK_8BIT;
     }
@@ -1295,10 +1151,11 @@ int cpu6502::ROR (const op_t* p_op)
     return p_op->exec_cycles;
 }
 
-int cpu6502::RTI (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::RTI (const op_t* p_op)
 {
     state.regs.sp++;
-    state.regs.flags  = rd_mem(state.regs.sp | 0x100);
+    set_flags(rd_mem(state.regs.sp | 0x100));
     state.regs.sp++;
     state.regs.pc     = rd_mem(state.regs.sp | 0x100);
     state.regs.sp++;
@@ -1307,7 +1164,8 @@ int cpu6502::RTI (const op_t* p_op)
     return p_op->exec_cycles;
 }
 
-int cpu6502::RTS (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::RTS (const op_t* p_op)
 {
     state.regs.sp++;
     state.regs.pc     = rd_mem(state.regs.sp | 0x100);
@@ -1319,50 +1177,29 @@ int cpu6502::RTS (const op_t* p_op)
     return p_op->exec_cycles;
 }
 
-int cpu6502::SBC (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::SBC (const op_t* p_op)
 {
     bool page_crossed;
 
     bool bcd = (state.regs.flags & BCD_MASK) ? true : false;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
     // Fetch the operand from memory
-    uint8_t mem_val   = rd_mem(addr);
+    uint8_t mem_val   = rd_data<MODE>(p_op, addr);
     uint8_t acc       = state.regs.a;
 
     if (bcd)
     {
-        int16_t tmp;
-        int16_t lo_nib;
-        int16_t hi_nib;
-        bool    bcd_borrow;
-        
-        // Do low digit BCD addition and flag if result has borrowed ( < 0)
-        tmp = (acc & MASK_LO_NIB) - (mem_val & MASK_LO_NIB) - ((state.regs.flags & CARRY_MASK) ? 0 : 1);
-        bcd_borrow = tmp < 0;
-
-        // Get low digit result, adjusting if borrowed
-        lo_nib = bcd_borrow ? (tmp - 6) & MASK_LO_NIB : tmp;
+        // Look up the result and the carry and overflow flags
+        uint16_t res      = bcd_sbc_tbl[state.regs.flags & CARRY_MASK][(acc << 8) | mem_val];
 
-        // Do high digit BCD addition, factoring in borrow from low digit as applicable, and flag if borrowed
-        tmp = (acc & MASK_HI_NIB) - (mem_val & MASK_HI_NIB) - (bcd_borrow ? 0x10 : 0);
-        bcd_borrow = tmp < 0;
-
-        // Get high digit result, adjusting if borrowed
-        hi_nib = bcd_borrow ? (tmp - 0x60) & MASK_HI_NIB : tmp;
-
-        // Combine two digits into accumulator
-        state.regs.a  = hi_nib | lo_nib;
-
-        // Clear affected flags
-        state.regs.flags &= ~(CARRY_MASK | ZERO_MASK | OVFLW_MASK | SIGN_MASK);
+        state.regs.a      = res & MASK_8BIT;
 
-        state.regs.flags |= (state.regs.a == 0)                                 ? ZERO_MASK  : 0;
-        state.regs.flags |= ((tmp & SIGN_MASK) == 0) ^ ((acc & SIGN_MASK) == 0) ? OVFLW_MASK : 0;
-        state.regs.flags |= !bcd_borrow                                         ? CARRY_MASK : 0;
-        state.regs.flags |= state.regs.a & SIGN_MASK;
+        state.regs.flags  = (state.regs.flags & ~(CARRY_MASK | OVFLW_MASK)) | (res >> 8);
+        set_nz(state.regs.a);
     }
     else
     {
@@ -1374,13 +1211,12 @@ int cpu6502::SBC (const op_t* p_op)
         uint32_t res_uns  = state.regs.a - mem_val - ((state.regs.flags & CARRY_MASK) ? 0 : 1);
         
         // Clear affected flags
-        state.regs.flags &= ~(CARRY_MASK | ZERO_MASK | OVFLW_MASK | SIGN_MASK);
+        state.regs.flags &= ~(CARRY_MASK | OVFLW_MASK);
         
         // Set flags, based on extended result
         state.regs.flags |= !(res_uns >=  0x100U)             ?  CARRY_MASK : 0;
-        state.regs.flags |= ((result & MASK_8BIT) == 0)       ?  ZERO_MASK  : 0;
         state.regs.flags |= (((result>>1) ^ res_uns) & 0x80)  ?  OVFLW_MASK : 0;
-        state.regs.flags |= (result & 0x80)                   ?  SIGN_MASK  : 0;
+        set_nz(result);
         
         // Store result in accumulator
         state.regs.a  = result & MASK_8BIT;
@@ -1390,176 +1226,168 @@ int cpu6502::SBC (const op_t* p_op)
     return p_op->exec_cycles + (page_crossed ? 1 : 0) + (bcd ? 1 : 0);
 }
 
-int cpu6502::SEC (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::SEC (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
     state.regs.flags |= CARRY_MASK;
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::SED (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::SED (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
     state.regs.flags |= BCD_MASK;
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::SEI (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::SEI (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
 
     state.regs.flags |= INT_MASK;
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::STA (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::STA (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
     
     wr_mem(addr, state.regs.a);
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::STX (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::STX (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
     
     wr_mem(addr, state.regs.x);
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::STY (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::STY (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
     
     wr_mem(addr, state.regs.y);
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::TAX (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::TAX (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
     
     state.regs.x      = state.regs.a;
 
-    // Clear affected flags
-    state.regs.flags &= ~(ZERO_MASK | SIGN_MASK);
-
-    state.regs.flags |= (state.regs.x == 0)   ?  ZERO_MASK  : 0;
-    state.regs.flags |= (state.regs.x & 0x80) ?  SIGN_MASK  : 0;
+    set_nz(state.regs.x);
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::TAY (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::TAY (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
     
     state.regs.y      = state.regs.a;
 
-    // Clear affected flags
-    state.regs.flags &= ~(ZERO_MASK | SIGN_MASK);
-
-    state.regs.flags |= (state.regs.y == 0)   ?  ZERO_MASK  : 0;
-    state.regs.flags |= (state.regs.y & 0x80) ?  SIGN_MASK  : 0;
+    set_nz(state.regs.y);
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::TSX (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::TSX (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
     
     state.regs.x      = state.regs.sp;
 
-    // Clear affected flags
-    state.regs.flags &= ~(ZERO_MASK | SIGN_MASK);
-
-    state.regs.flags |= (state.regs.x == 0)   ?  ZERO_MASK  : 0;
-    state.regs.flags |= (state.regs.x & 0x80) ?  SIGN_MASK  : 0;
+    set_nz(state.regs.x);
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::TXA (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::TXA (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
     
     state.regs.a      = state.regs.x;
 
-    // Clear affected flags
-    state.regs.flags &= ~(ZERO_MASK | SIGN_MASK);
-                     
-    state.regs.flags |= (state.regs.a == 0)   ?  ZERO_MASK  : 0;
-    state.regs.flags |= (state.regs.a & 0x80) ?  SIGN_MASK  : 0;
+    set_nz(state.regs.a);
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::TXS (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::TXS (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
     
     state.regs.sp     = state.regs.x;
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::TYA (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::TYA (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
     
     state.regs.a      = state.regs.y;
 
-    // Clear affected flags
-    state.regs.flags &= ~(ZERO_MASK | SIGN_MASK);
-
-    state.regs.flags |= (state.regs.a == 0)   ?  ZERO_MASK  : 0;
-    state.regs.flags |= (state.regs.a & 0x80) ?  SIGN_MASK  : 0;
+    set_nz(state.regs.a);
 
     return p_op->exec_cycles;
 }
@@ -1567,15 +1395,16 @@ int cpu6502::TYA (const op_t* p_op)
 // -------------------------------------------------------------------------
 // Instruction for the 65C02/WDC 65C02
 
-int cpu6502::BBR (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::BBR (const op_t* p_op)
 {
     bool page_crossed;
 
     // Fetch address of branch
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
     
-    // Fetch byte at indicated zero page address (PC is pointing to it)
-    uint8_t zp_byte = rd_mem(rd_mem(state.regs.pc));
+    // Fetch byte at indicated zero page address (first operand byte)
+    uint8_t zp_byte = rd_mem(p_op->operand & MASK_8BIT);
     
     if (!(zp_byte & (1 << ((p_op->opcode >> 4) & 0x7))))
     {
@@ -1585,22 +1414,21 @@ int cpu6502::BBR (const op_t* p_op)
     }
     else
     {
-        // Advance PC to next instruction
-        state.regs.pc += 2;
         return p_op->exec_cycles;
     }
 
 }
 
-int cpu6502::BBS (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::BBS (const op_t* p_op)
 {
     bool page_crossed;
   
     // Fetch address of branch
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
     
-    // Fetch byte at indicated zero page address (PC is pointing to it)
-    uint8_t zp_byte = rd_mem(rd_mem(state.regs.pc));
+    // Fetch byte at indicated zero page address (first operand byte)
+    uint8_t zp_byte = rd_mem(p_op->operand & MASK_8BIT);
     
     if (zp_byte & (1 << ((p_op->opcode >> 4) & 0x7)))
     {
@@ -1610,18 +1438,17 @@ int cpu6502::BBS (const op_t* p_op)
     }
     else
     {
-        // Advance PC to next instruction
-        state.regs.pc += 2;
         return p_op->exec_cycles;
     }
 }
 
-int cpu6502::RMB (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::RMB (const op_t* p_op)
 {
     bool page_crossed;
 
     // Fetch address of branch
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
     
     uint8_t zp_byte = rd_mem(addr) & ~(1 << ((p_op->opcode >> 4) & 0x7));
     
@@ -1630,12 +1457,13 @@ int cpu6502::RMB (const op_t* p_op)
     return p_op->exec_cycles;
 }
 
-int cpu6502::SMB (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::SMB (const op_t* p_op)
 {
     bool page_crossed;
 
     // Fetch address of branch
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
     
     uint8_t zp_byte = rd_mem(addr) | (1 << ((p_op->opcode >> 4) & 0x7));
     
@@ -1644,71 +1472,72 @@ int cpu6502::SMB (const op_t* p_op)
     return p_op->exec_cycles;
 }
 
-int cpu6502::BRA (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::BRA (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
     
     state.regs.pc = addr;
     
     return p_op->exec_cycles + 1 + (page_crossed ? 1 : 0);
 }
 
-int cpu6502::TRB (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::TRB (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
     uint8_t  mem_val  = rd_mem(addr);
     
     wr_mem(addr, mem_val & ~(state.regs.a));
     
     bool is_zero      = (state.regs.a & mem_val) ? false : true;
     
-    // Clear affected flags
-    state.regs.flags &= ~(ZERO_MASK);
-    
-    state.regs.flags |= is_zero ? ZERO_MASK  : 0;
+    // Update Z, leaving N unchanged
+    set_nz(flag_n(), is_zero);
     
     return p_op->exec_cycles;
 }
 
-int cpu6502::TSB (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::TSB (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
     uint8_t  mem_val  = rd_mem(addr);
     
     wr_mem(addr, mem_val | state.regs.a);
     
     bool is_zero      = (state.regs.a & mem_val) ? false : true;
     
-    // Clear affected flags
-    state.regs.flags &= ~(ZERO_MASK);
-    
-    state.regs.flags |= is_zero ? ZERO_MASK  : 0;
+    // Update Z, leaving N unchanged
+    set_nz(flag_n(), is_zero);
     
     return p_op->exec_cycles;
 }
 
-int cpu6502::STZ (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::STZ (const op_t* p_op)
 {
     bool page_crossed;
 
-    // Fetch address of data (and update PC)
-    uint32_t addr     = calc_addr(p_op->mode, &state.regs, page_crossed);
+    // Fetch address of data
+    uint32_t addr     = calc_addr<MODE>(p_op, &state.regs, page_crossed);
         
     wr_mem(addr, 0x00);
         
     return p_op->exec_cycles;
 }
 
-int cpu6502::PHX (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::PHX (const op_t* p_op)
 {
 
     wr_mem(state.regs.sp | 0x100, state.regs.x); state.regs.sp--;
@@ -1716,48 +1545,44 @@ int cpu6502::PHX (const op_t* p_op)
     return p_op->exec_cycles;
 }
 
-int cpu6502::PHY (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::PHY (const op_t* p_op)
 {
     wr_mem(state.regs.sp | 0x100, state.regs.y); state.regs.sp--;
 
     return p_op->exec_cycles;
 }
 
-int cpu6502::PLX (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::PLX (const op_t* p_op)
 {
     state.regs.sp++;
     state.regs.x      = rd_mem(state.regs.sp | 0x100);
     
-    // Clear affected flags
-    state.regs.flags &= ~(ZERO_MASK | SIGN_MASK);
-    
-    state.regs.flags |= (state.regs.x == 0)   ?  ZERO_MASK  : 0;
-    state.regs.flags |= (state.regs.x & 0x80) ?  SIGN_MASK  : 0;
+    set_nz(state.regs.x);
     
     return p_op->exec_cycles;
 }
 
-int cpu6502::PLY (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::PLY (const op_t* p_op)
 {
     state.regs.sp++;
     state.regs.y      = rd_mem(state.regs.sp | 0x100);
     
-    // Clear affected flags
-    state.regs.flags &= ~(ZERO_MASK | SIGN_MASK);
-    
-    state.regs.flags |= (state.regs.y == 0)   ?  ZERO_MASK  : 0;
-    state.regs.flags |= (state.regs.y & 0x80) ?  SIGN_MASK  : 0;
+    set_nz(state.regs.y);
     
     return p_op->exec_cycles;
 }
 
-int cpu6502::WAI (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::WAI (const op_t* p_op)
 {
     // Cycles returned only on first execution of wait
     uint32_t cycles = state.waiting ? 0 : p_op->exec_cycles;
     
     // If here, and an active interrupt, then I bit set, and we simply continue
-    if (state.nirq_line != NO_ACTIVE_IRQS)
+    if (nirq_lines.load() != NO_ACTIVE_IRQS)
     {
         state.waiting = false;
     }
@@ -1771,7 +1596,8 @@ int cpu6502::WAI (const op_t* p_op)
     return cycles;
 }
 
-int cpu6502::STP (const op_t* p_op)
+template <class BUS> template <typename cpu6502_core<BUS>::addr_mode_e MODE>
+int cpu6502_core<BUS>::STP (const op_t* p_op)
 {
     uint32_t cycles = state.stopped ? 0 : p_op->exec_cycles;
 
@@ -1813,7 +1639,8 @@ int cpu6502::STP (const op_t* p_op)
 
 // LCOV_EXCL_START
 
-void cpu6502::disassemble (const int      opcode, 
+template <class BUS>
+void cpu6502_core<BUS>::disassemble (const int      opcode, 
                            const uint16_t pc, 
                            const uint64_t cycles, 
                            const bool     disable_jmp_mrk, 
@@ -1822,13 +1649,17 @@ void cpu6502::disassemble (const int      opcode,
                            const uint8_t  x, 
                            const uint8_t  y, 
                            const uint8_t  sp, 
-                           const uint8_t  flags,
-                           const char*    fname)
+                           const uint8_t  flags)
 {
 
     if (fp == NULL)
     {
-        fp = fopen(fname, "wb");
+        if ((fp = fopen(dis_fname, "wb")) == NULL)
+        {
+            return;
+        }
+
+        fp_owned = true;
         fprintf(fp, "CPU6502 Disassembler output\n\n");
     }
 
@@ -1841,9 +1672,9 @@ void cpu6502::disassemble (const int      opcode,
         fprintf(fp, "            *\n");
     }
 
-    // The opcode string is forced to be "???" when the cpu type for the opcode
+    // The opcode string is "???" in the table when the cpu type for the opcode
     // is later than the current revision mode.
-    const char* str   = (instr_tbl[opcode].cpu_type <= state.mode_c) ? instr_tbl[opcode].op_str : "???";
+    const char* str   = instr_tbl[opcode].op_str;
 
 #ifdef WY65_EN_PRINT_CYCLES
     fprintf(fp, "%8d : %04x   ", cycles, pc);
@@ -1947,585 +1778,4131 @@ void cpu6502::disassemble (const int      opcode,
 // LCOV_EXCL_STOP
 
 // -------------------------------------------------------------------------
-// execute()
-//
-// Executes a single instruction. Internally checks for outstanding IRQ 
-// first before proceeding to execute the opcoden. Optional control of 
-// disassemling instruction if icount is between start_count and stop_count.
-// Jump marks (marked spaces between PC discontinuities) can be enabled/
-// disabled.
+// decode()
 //
-// Returns the PC after the instruction, and the cycles taked to execute. 
+// Fetch the opcode and operand bytes at the PC into op, advancing the PC
+// to the next instruction, and return the instruction method. When the
+// decode cache is enabled, a valid entry for the PC is used without
+// accessing memory, else the entry is filled if the code at the PC may be
+// cached (internal memory, or a page declared as ROM).
 //
 // -------------------------------------------------------------------------
 
-wy65_exec_status_t cpu6502::execute (const uint32_t icount, const uint32_t start_count, const uint32_t stop_count, const bool en_jmp_mrks)
-{   
-    op_t               op;
-    wy65_exec_status_t rtn_val;
-    int                num_cycles;
+template <class BUS>
+inline typename cpu6502_core<BUS>::pInstrFunc_t cpu6502_core<BUS>::decode (op_t &op)
+{
+    uint16_t pc       = state.regs.pc;
 
-    op.opcode         = rd_mem(state.regs.pc++);
+    if (p_dcache != NULL && p_dcache[pc].instr_bytes != 0)
+    {
+        const dinstr_t* p_entry = &p_dcache[pc];
 
-    tbl_t curr_instr  = instr_tbl[op.opcode];
+        op.opcode         = p_entry->opcode;
+        op.operand        = p_entry->operand;
+        op.exec_cycles    = p_entry->exec_cycles;
+        state.regs.pc    += p_entry->instr_bytes;
 
-    // If the opcode points to an instruction that is greater than the selected 6502 type
-    // redirect pFunc to the NOP function.
-    if (curr_instr.cpu_type > state.mode_c)
-    {
-        curr_instr.pFunc = instr_tbl[NOP_OPCODE_BASE].pFunc; // LCOV_EXCL_LINE --- testing with all instructions enabled
+        return p_entry->pFunc;
     }
 
-    if (icount >= start_count && icount < stop_count)
-    {
-        // In BeebEm testing, disassemble in the execute() function
-        disassemble(op.opcode, 
-                    state.regs.pc-1, 
-                    state.cycles, 
-                    !en_jmp_mrks, 
-                    true, 
-                    state.regs.a, 
-                    state.regs.x, 
-                    state.regs.y, 
-                    state.regs.sp, 
-                    state.regs.flags);
-    }
+    op.opcode         = rd_mem(state.regs.pc++);
 
-    op.exec_cycles    = curr_instr.exec_cycles;
-    op.mode           = curr_instr.addr_mode; 
+    // Opcodes not supported by the selected 6502 type are bound to NOP in the table
+    const tbl_t* p_instr = &instr_tbl[op.opcode];
 
-    // Execute instruction and get number of cycles (which may be more than op.exec_cycles; e.g. page crossing)
-    num_cycles        = (this->*curr_instr.pFunc)(&op);
+    op.exec_cycles    = p_instr->exec_cycles;
+    fetch_operand(op, p_instr->op_bytes);
 
-    state.cycles     += num_cycles;
+    if (p_dcache != NULL && is_cacheable(pc))
+    {
+        dinstr_t* p_entry = &p_dcache[pc];
 
-    rtn_val.cycles    = num_cycles;
-    rtn_val.pc        = state.regs.pc;
-    rtn_val.flags     = state.regs.flags;
+        p_entry->pFunc       = p_instr->pFunc;
+        p_entry->operand     = op.operand;
+        p_entry->opcode      = op.opcode;
+        p_entry->exec_cycles = op.exec_cycles;
+        p_entry->instr_bytes = 1 + p_instr->op_bytes;
+    }
 
-    return rtn_val;
+    return p_instr->pFunc;
 }
 
 // -------------------------------------------------------------------------
-// nmi_interrupt()
+// enable_decode_cache()
 //
-// Generates an NMI. NMI is falling edge triggered, and calling this 
-// function emulates this single event. The flags an PC are pushed on to the
-// stack, the interrupt mask set (I flag), and the PC set to the vector
-// defined at address 0xfffa
+// Allocate (and clear) or free the decode cache. The cache has an entry for
+// every address in the 6502 address space.
 //
 // -------------------------------------------------------------------------
 
-void cpu6502::nmi_interrupt ()
+template <class BUS>
+void cpu6502_core<BUS>::enable_decode_cache (const bool enable)
 {
-    // If waiting, PC was not advanced past the WAI opcode, so do this before pushing PC
-    if (state.waiting)
+    if (enable && p_dcache == NULL)
     {
-        state.regs.pc++;
-        state.waiting = false;
-    }
-
-    wr_mem(state.regs.sp | 0x100, (state.regs.pc >> 8) & MASK_8BIT); state.regs.sp--;
-    wr_mem(state.regs.sp | 0x100, state.regs.pc & MASK_8BIT);        state.regs.sp--;
-    wr_mem(state.regs.sp | 0x100, state.regs.flags);                 state.regs.sp--;
-
-    state.regs.flags |= INT_MASK;
+        p_dcache      = new dinstr_t[WY65_ADDR_SPACE_SIZE];
+        invalidate_decode_cache();
 
-    state.regs.pc     = (uint16_t)rd_mem(NMI_VEC_ADDR) | ((uint16_t)rd_mem(NMI_VEC_ADDR+1) << 8);
+        // JIT compiled code does not maintain the decode cache, so discard it
+        flush_blocks();
+    }
+    else if (!enable && p_dcache != NULL)
+    {
+        delete [] p_dcache;
+        p_dcache      = NULL;
+    }
 
-    state.cycles     += NMI_CYCLES;
+    update_wr_hooks();
 }
 
 // -------------------------------------------------------------------------
-// irq()
+// invalidate_decode_cache()
 //
-// Checks for, and execution of, maskable interrupts. IRQs are level 
-// sensitive (active low). The nirq_line state has 16 lines bitmapped,
-// and if any are low, and interrupts are enabled (I flag is low),
-// The PC and state are pushed on the stack, the I flag set, and the
-// PC set to the interrupt vector defined at address 0xfffe.
+// Invalidate the decode cache entries, and the blocks, for any instruction
+// that may include a byte in the given region. By default, the whole of
+// both caches is invalidated.
 //
 // -------------------------------------------------------------------------
 
-void cpu6502::irq ()
+template <class BUS>
+void cpu6502_core<BUS>::invalidate_decode_cache (const uint32_t start_addr, const uint32_t len)
 {
-    if (state.nirq_line != NO_ACTIVE_IRQS && !(state.regs.flags & INT_MASK) && !state.stopped)
+    if (p_dcache != NULL && len != 0)
     {
-        // If waiting, PC was not advanced past the WAI opcode, so do this before pushing PC
-        if (state.waiting)
+        // Instructions are up to 3 bytes, so start up to two bytes before the region
+        uint32_t count = (len >= WY65_ADDR_SPACE_SIZE - 2) ? WY65_ADDR_SPACE_SIZE : len + 2;
+
+        for (uint32_t idx = 0; idx < count; idx++)
         {
-            state.regs.pc++;
-            state.waiting = false;
+            p_dcache[(start_addr - 2 + idx) & (WY65_ADDR_SPACE_SIZE-1)].instr_bytes = 0;
         }
+    }
 
-        wr_mem(state.regs.sp | 0x100, (state.regs.pc >> 8) & MASK_8BIT);  state.regs.sp--;
-        wr_mem(state.regs.sp | 0x100, state.regs.pc & MASK_8BIT);         state.regs.sp--;
-        wr_mem(state.regs.sp | 0x100, state.regs.flags & ~BRK_MASK);      state.regs.sp--;
-        
-        state.regs.flags |= INT_MASK;
-        
-        state.regs.pc     = (uint16_t)rd_mem(IRQ_VEC_ADDR) | ((uint16_t)rd_mem(IRQ_VEC_ADDR+1) << 8);
-
-        state.cycles      += IRQ_CYCLES;
+    if (p_blk_tbl != NULL && len != 0)
+    {
+        if (len >= WY65_ADDR_SPACE_SIZE)
+        {
+            flush_blocks();
+        }
+        else
+        {
+            for (uint32_t idx = 0; idx < len; idx++)
+            {
+                if (p_code_byte[(start_addr + idx) & (WY65_ADDR_SPACE_SIZE-1)])
+                {
+                    invalidate_blocks(start_addr + idx);
+                }
+            }
+        }
     }
 }
 
 // -------------------------------------------------------------------------
-// activate_irq()
+// set_rom_region()
 //
-// Activates (sets low) one of the sixteen IRQ lines, as defined by id. This
-// has a default value of 0.
+// Mark the whole pages within a region as ROM (or not) for the decode cache.
+// Code in ROM pages is cached even when external memory functions are
+// registered. Cached entries for the pages are invalidated.
 //
 // -------------------------------------------------------------------------
 
-void cpu6502::activate_irq (const uint16_t id)
+template <class BUS>
+void cpu6502_core<BUS>::set_rom_region (const uint32_t start_addr, const uint32_t len, const bool is_rom)
 {
-    // Activate the IRQ line if 'id' in range, else ignore.
-    if (id < NUM_INTERNAL_IRQS)
+    // Round the start up, and the end down, to page boundaries
+    uint32_t start_page = (start_addr + WY65_ROM_PAGE_SIZE - 1) >> WY65_ROM_PAGE_BITS;
+    uint32_t end_page   = (start_addr + len) >> WY65_ROM_PAGE_BITS;
+
+    for (uint32_t page = start_page; page < end_page && page < (WY65_ADDR_SPACE_SIZE >> WY65_ROM_PAGE_BITS); page++)
     {
-        state.nirq_line  &= ~(1 << id);
+        rom_page[page] = is_rom;
     }
 
-    // Check for interrupt at each assertion of an IRQ line
-    irq();
+    invalidate_decode_cache(start_addr, len);
 }
 
 // -------------------------------------------------------------------------
-// deactivate_irq()
+// set_pages()
 //
-// Dectivates (sets low) one of the sixteen IRQ lines, as defined by id. 
-// This has a default value of 0.
+// Set the page table entries for the whole pages within a region. All
+// cached decodes, blocks and native code are discarded, as the memory
+// they were built from (or accessed directly) may no longer be mapped.
+// Pages shared copy-on-write are first copied back to internal memory. The
+// pages are no longer declared as ROM, until declared again (as by
+// map_rom_pages()).
 //
 // -------------------------------------------------------------------------
 
-void cpu6502::deactivate_irq (const uint16_t id)
+template <class BUS>
+void cpu6502_core<BUS>::set_pages (const uint32_t start_addr, const uint32_t len, const wy65_page_t &page)
 {
-    // Deactivate the IRQ line if 'id' in range, else ignore.
-    if (id < NUM_INTERNAL_IRQS)
+    // Round the start up, and the end down, to page boundaries
+    uint32_t start_page = (start_addr + WY65_MAP_PAGE_SIZE - 1) >> WY65_MAP_PAGE_BITS;
+    uint32_t end_page   = (start_addr + len) >> WY65_MAP_PAGE_BITS;
+    bool     unmap      = page.p_rd == NULL && page.p_wr == NULL && page.rd_func == NULL && page.wr_func == NULL;
+
+    unshare_pages(start_page, end_page);
+
+    for (uint32_t page_num = start_page; page_num < end_page && page_num < WY65_NUM_MAP_PAGES; page_num++)
+    {
+        uint32_t offset         = (page_num - start_page) << WY65_MAP_PAGE_BITS;
+
+        if (unmap)
+        {
+            set_unmapped_page(page_num);
+            continue;
+        }
+
+        page_tbl[page_num]      = page;
+        page_tbl[page_num].p_rd = (page.p_rd != NULL) ? page.p_rd + offset : NULL;
+        page_tbl[page_num].p_wr = (page.p_wr != NULL) ? page.p_wr + offset : NULL;
+    }
+
+    if (end_page > start_page)
     {
-        state.nirq_line  |= 1 << id;
+        set_rom_region(start_page << WY65_MAP_PAGE_BITS, (end_page - start_page) << WY65_MAP_PAGE_BITS, false);
     }
+
+    update_pages_mapped();
+    invalidate_decode_cache();
 }
 
 // -------------------------------------------------------------------------
-// reset()
+// update_pages_mapped()
+//
+// Set whether any page is mapped, so that native JIT code does not access
+// internal memory directly
 //
-// Emulates a hard reset. All the 6502 registers are reset, the PC is
-// updated with the vector at 0xfffc and interrupts are disabled. In
-// addition, the internal cycle count is cleared.
-// 
 // -------------------------------------------------------------------------
 
-void cpu6502::reset (cpu_type_e mode)
+template <class BUS>
+void cpu6502_core<BUS>::update_pages_mapped (void)
 {
-    // Reset the CPU state.
-    state.regs.flags  = INT_MASK;
-    state.regs.pc     = (uint16_t)rd_mem(RESET_VEC_ADDR) | ((uint16_t)rd_mem(RESET_VEC_ADDR+1) << 8);
-    state.regs.a      = 0;
-    state.regs.x      = 0;
-    state.regs.y      = 0;
-    state.regs.sp     = 0xff;
-
-    state.cycles      = RST_CYCLES;
-    state.nirq_line   = NO_ACTIVE_IRQS;
-    state.waiting     = false;
-    state.stopped     = false;
-
-    if (mode != DEFAULT)
+    pages_mapped = false;
+    for (uint32_t page_num = 0; page_num < WY65_NUM_MAP_PAGES; page_num++)
     {
-        state.mode_c      = mode; // Set which CPU variant mode we're in from argument (default BASE)
+        pages_mapped |= !page_unmapped(page_num);
     }
 }
 
 // -------------------------------------------------------------------------
-// register_mem_funcs()
-//
-// Register external memory functions for use in memory read/write accesses,
-// to allow interfacing with external memory system. By default, internal
-// memory is accessed. If this function is used to set two external
-// functions all memory access will use these instead. The external
-// functions must be of type:
-//
-//   void <ExtWrFuncName> (int addr, unsigned char data)
-//   int  <ExtRdFuncName> (int addr)
-//
-// If the external application functions are not quite these types, then 
-// wrapper functions will need constructing. The types defined here were
-// chosen based on BeebEm's memory access functions. (see website at
-// http://www.mkw.me.uk/beebem).
+// wr_mem_slow()
 //
-// It is possible to override only one access method (not sure why anyone
-// would want to) by setting one or the other arguments to NULL.
+// Write to memory not made directly by wr_mem(): to a write protected page
+// (discarded), a device, the bus or, with write hooks, to memory. The hooks
+// invalidate cached decodes and blocks for the address, count writes
+// modifying memory for idle detection, and check the run_until() memory
+// condition.
 //
 // -------------------------------------------------------------------------
 
-// LCOV_EXCL_START
-void cpu6502::register_mem_funcs (wy65_p_writemem_t p_wfunc, wy65_p_readmem_t p_rfunc)
+template <class BUS>
+void cpu6502_core<BUS>::wr_mem_slow (int addr, unsigned char data)
 {
-    ext_wr_mem        = p_wfunc;
-    ext_rd_mem        = p_rfunc;
-}
+    const wy65_page_t* p_page = &page_tbl[(addr >> WY65_MAP_PAGE_BITS) & (WY65_NUM_MAP_PAGES-1)];
+
+    if (p_page->p_wr == NULL && p_page->wr_func == NULL && (p_page->p_rd != NULL || p_page->rd_func != NULL))
+    {
+        return;
+    }
+
+    if (p_dcache != NULL)
+    {
+        invalidate_dcache_entries(addr);
+    }
+
+    if (p_code_byte != NULL && p_code_byte[addr & 0xffff])
+    {
+        invalidate_blocks(addr);
+    }
+
+    if (p_page->p_wr != NULL)
+    {
+        uint8_t* p_byte = &p_page->p_wr[addr & (WY65_MAP_PAGE_SIZE-1)];
+        wr_changes     += (*p_byte != data);
+        *p_byte         = data;
+    }
+    else if (p_page->wr_func != NULL)
+    {
+        wr_changes++;
+        p_page->wr_func(p_page->p_wr_ctx, addr, data);
+    }
+    else if (bus.ext_wr())
+    {
+        wr_changes++;
+        bus.write(addr, data);    // LCOV_EXCL_LINE
+    }
+#if WY65_MEM_SIZE < WY65_ADDR_SPACE_SIZE
+    else if ((uint32_t)addr >= WY65_MEM_SIZE)
+    {
+        // Beyond internal memory, so discarded
+    }
+#endif
+    else
+    {
+        wr_changes     += (mem[addr] != data);
+        mem[addr]       = data;
+    }
+
+    if ((uint32_t)((addr & 0xffff) - until_addr) < until_len)
+    {
+        until_mem_check();
+    }
+}
+
+// -------------------------------------------------------------------------
+// rd_mem_slow()
+//
+// Read from memory not made directly by rd_mem(): from a device, the bus,
+// or internal memory when only writes go to the bus
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+int cpu6502_core<BUS>::rd_mem_slow (int addr)
+{
+    const wy65_page_t* p_page = &page_tbl[(addr >> WY65_MAP_PAGE_BITS) & (WY65_NUM_MAP_PAGES-1)];
+
+    if (p_page->rd_func != NULL)
+    {
+        return p_page->rd_func(p_page->p_rd_ctx, addr);
+    }
+
+    if (bus.ext_rd()
+#ifdef BITMATCH
+        && addr != 0xfe81 // When bitmatching on BeebEm, don't read from the FDC result register (it's a pop read)
+#endif
+        )
+    {
+        return bus.read(addr);     // LCOV_EXCL_LINE
+    }
+#if WY65_MEM_SIZE < WY65_ADDR_SPACE_SIZE
+    else if ((uint32_t)addr >= WY65_MEM_SIZE)
+    {
+        return 0;                  // Beyond internal memory
+    }
+#endif
+
+    return mem[addr];
+}
+
+// -------------------------------------------------------------------------
+// map_mem_pages()
+//
+// Map the whole pages within a region directly to host memory. p_rd and
+// p_wr point to the host memory for the start of the region, and a NULL
+// p_wr makes the pages read only.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::map_mem_pages (const uint32_t start_addr, const uint32_t len, uint8_t* p_rd, uint8_t* p_wr)
+{
+    // Host memory pointers are for the start of the region, so adjust for
+    // a start address rounded up to a page boundary
+    uint32_t    skip = ((start_addr + WY65_MAP_PAGE_SIZE - 1) & ~(WY65_MAP_PAGE_SIZE - 1)) - start_addr;
+    wy65_page_t page = {(p_rd != NULL) ? p_rd + skip : NULL, (p_wr != NULL) ? p_wr + skip : NULL, NULL, NULL, NULL, NULL};
+
+    set_pages(start_addr, len, page);
+}
+
+// -------------------------------------------------------------------------
+// map_io_pages()
+//
+// Map the whole pages within a region to device handlers, called with the
+// full address of the access, and the host context p_ctx for handlers
+// taking one. Handlers without a context are called via an adapter.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::map_io_pages (const uint32_t start_addr, const uint32_t len, wy65_p_writemem_t p_wfunc, wy65_p_readmem_t p_rfunc)
+{
+    wy65_page_t page = {NULL, NULL,
+                        (p_rfunc != NULL) ? wy65_readmem_adapter  : NULL,
+                        (p_wfunc != NULL) ? wy65_writemem_adapter : NULL,
+                        reinterpret_cast<void*>(p_rfunc),
+                        reinterpret_cast<void*>(p_wfunc)};
+
+    set_pages(start_addr, len, page);
+}
+
+template <class BUS>
+void cpu6502_core<BUS>::map_io_pages (const uint32_t start_addr, const uint32_t len, wy65_p_writemem_ctx_t p_wfunc, wy65_p_readmem_ctx_t p_rfunc, void* p_ctx)
+{
+    wy65_page_t page = {NULL, NULL, p_rfunc, p_wfunc, p_ctx, p_ctx};
+
+    set_pages(start_addr, len, page);
+}
+
+// -------------------------------------------------------------------------
+// unmap_pages()
+//
+// Remove the mapping of the whole pages within a region
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::unmap_pages (const uint32_t start_addr, const uint32_t len)
+{
+    wy65_page_t page = {NULL, NULL, NULL, NULL, NULL, NULL};
+
+    set_pages(start_addr, len, page);
+}
+
+// -------------------------------------------------------------------------
+// map_rom_pages()
+//
+// Map the whole pages within a region to a read only image for reads, with
+// writes discarded (no write memory or handler for the page) or passed to
+// p_wfunc, and declare the pages as ROM.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::map_rom_pages (const uint32_t start_addr, const uint32_t len, const uint8_t* p_rom,
+                                       wy65_p_writemem_ctx_t p_wfunc, void* p_ctx)
+{
+    // The image is only ever read through the page table, as the pages have no
+    // write memory
+    uint32_t    skip = ((start_addr + WY65_MAP_PAGE_SIZE - 1) & ~(WY65_MAP_PAGE_SIZE - 1)) - start_addr;
+    wy65_page_t page = {const_cast<uint8_t*>(p_rom) + skip, NULL, NULL, p_wfunc, NULL, p_ctx};
+
+    set_pages(start_addr, len, page);
+    set_rom_region(start_addr, len);
+}
+
+// -------------------------------------------------------------------------
+// cow_write()
+//
+// Write handler for a page shared copy-on-write, called with the model as
+// the context. The page is copied back to the model's internal memory
+// before the write, and is no longer shared by the model.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::cow_write (void* p_ctx, int addr, unsigned char data)
+{
+    cpu6502_core* p_cpu    = (cpu6502_core*)p_ctx;
+    uint32_t      page_num = (addr >> WY65_MAP_PAGE_BITS) & (WY65_NUM_MAP_PAGES-1);
+
+    p_cpu->unshare_pages(page_num, page_num + 1);
+    p_cpu->mem[addr & (WY65_ADDR_SPACE_SIZE-1)] = data;
+}
+
+// -------------------------------------------------------------------------
+// unshare_pages()
+//
+// Copy any pages shared copy-on-write in the range back to internal memory,
+// release the shared pages (freeing those no longer shared by any model)
+// and unmap them. The decodes cached for the pages remain valid, as the
+// page contents are unchanged.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::unshare_pages (const uint32_t start_page, const uint32_t end_page)
+{
+    bool unshared = false;
+
+    for (uint32_t page_num = start_page; page_num < end_page && page_num < WY65_NUM_MAP_PAGES; page_num++)
+    {
+        cow_page_t* p_cow = cow_page[page_num];
+
+        if (p_cow != NULL)
+        {
+            memcpy(&mem[page_num << WY65_MAP_PAGE_BITS], p_cow->data, WY65_MAP_PAGE_SIZE);
+
+            if (p_cow->refs.fetch_sub(1) == 1)
+            {
+                delete p_cow;
+            }
+
+            cow_page[page_num] = NULL;
+            set_unmapped_page(page_num);
+            unshared           = true;
+        }
+    }
+
+    if (unshared)
+    {
+        update_pages_mapped();
+    }
+}
+
+// -------------------------------------------------------------------------
+// get_flags()
+//
+// Returns the flags register. When flags are being evaluated lazily, the
+// N and Z flags are constructed from the last result.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+uint8_t cpu6502_core<BUS>::get_flags (void)
+{
+    if (flags_lazy)
+    {
+        return (state.regs.flags & ~(SIGN_MASK | ZERO_MASK)) | (flag_n() ? SIGN_MASK : 0) | (flag_z() ? ZERO_MASK : 0);
+    }
+
+    return state.regs.flags;
+}
+
+// -------------------------------------------------------------------------
+// set_flags()
+//
+// Sets the flags register, and the lazily evaluated N and Z flags to match.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::set_flags (const uint8_t flags)
+{
+    state.regs.flags  = flags;
+
+    set_nz((flags & SIGN_MASK) != 0, (flags & ZERO_MASK) != 0);
+
+    // Clearing the I flag (e.g. by PLP or RTI) makes an active IRQ pending
+    irq_update();
+}
+
+// -------------------------------------------------------------------------
+// begin_lazy_flags()
+//
+// Switch to lazy evaluation of N and Z, as used by the instruction methods,
+// taking their state from the flags register.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::begin_lazy_flags (void)
+{
+    set_flags(state.regs.flags);
+
+    flags_lazy        = true;
+}
+
+// -------------------------------------------------------------------------
+// end_lazy_flags()
+//
+// Update the flags register with the lazily evaluated N and Z flags, which
+// then holds the complete processor status.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::end_lazy_flags (void)
+{
+    state.regs.flags  = get_flags();
+
+    flags_lazy        = false;
+}
+
+// -------------------------------------------------------------------------
+// execute()
+//
+// Executes a single instruction. Internally checks for outstanding IRQ 
+// first before proceeding to execute the opcoden. Optional control of 
+// disassemling instruction if icount is between start_count and stop_count.
+// Jump marks (marked spaces between PC discontinuities) can be enabled/
+// disabled.
+//
+// Returns the PC after the instruction, and the cycles taked to execute. 
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+wy65_exec_status_t cpu6502_core<BUS>::execute (const uint32_t icount, const uint32_t start_count, const uint32_t stop_count, const bool en_jmp_mrks)
+{   
+    op_t               op;
+    wy65_exec_status_t rtn_val;
+    uint64_t           start_cycles = state.cycles;
+
+    begin_lazy_flags();
+
+    // Take any pending interrupt before the instruction
+    if (events_pending())
+    {
+        take_events();
+    }
+
+    uint16_t pc       = state.regs.pc;
+
+    // Fetch and decode the instruction, advancing the PC past it
+    pInstrFunc_t pFunc = decode(op);
+
+    if (icount >= start_count && icount < stop_count)
+    {
+        // In BeebEm testing, disassemble in the execute() function
+        disassemble(op.opcode, 
+                    pc, 
+                    state.cycles, 
+                    !en_jmp_mrks, 
+                    true, 
+                    state.regs.a, 
+                    state.regs.x, 
+                    state.regs.y, 
+                    state.regs.sp, 
+                    get_flags());
+    }
+
+    // Execute instruction and get number of cycles (which may be more than op.exec_cycles; e.g. page crossing)
+    state.cycles     += (this->*pFunc)(&op);
+
+    end_lazy_flags();
+
+    // Cycles include those of any interrupt taken
+    rtn_val.cycles    = state.cycles - start_cycles;
+    rtn_val.pc        = state.regs.pc;
+    rtn_val.flags     = state.regs.flags;
+
+    return rtn_val;
+}
+
+// -------------------------------------------------------------------------
+// run()
+//
+// Executes instructions in a loop, without returning to the caller, until
+// one of the following occurs:
+//
+//   * max_instructions instructions have been executed
+//   * at least max_cycles cycles have elapsed
+//   * an instruction leaves the PC unchanged (branch/jump to self, WAI or
+//     STP)
+//   * request_stop() has been called (e.g. from a memory callback)
+//   * an idle loop is detected, if enabled (see idle_loop())
+//
+// Interrupts, resets and stop requests are all events in the pending word,
+// so that a single test at each instruction boundary detects any of them
+// (see service_events()). No disassembly is performed. Returns the PC and
+// flags after the last instruction, the number of instructions and cycles
+// for the call, and the reason for returning.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+wy65_run_status_t cpu6502_core<BUS>::run (const uint64_t max_instructions, const uint64_t max_cycles)
+{
+    op_t               op;
+    wy65_run_status_t  rtn_val;
+    uint64_t           icount       = 0;
+    uint64_t           start_cycles = state.cycles;
+    run_stop_e         reason;
+
+    if (engine == ENGINE_THREADED)
+    {
+        return run_threaded(max_instructions, max_cycles);
+    }
+    else if (engine == ENGINE_BLOCK || engine == ENGINE_JIT)
+    {
+        return run_block(max_instructions, max_cycles);
+    }
+    else if (engine == ENGINE_CYCLE)
+    {
+        return run_cycle(max_instructions, max_cycles);
+    }
+
+    pending.fetch_and(~(EVT_STOP | EVT_BREAK));
+    idle_valid        = false;
+
+    begin_lazy_flags();
+
+    while (true)
+    {
+        if (icount >= max_instructions)
+        {
+            reason    = STOP_INSTR_BUDGET;
+            break;
+        }
+
+        if ((state.cycles - start_cycles) >= max_cycles)
+        {
+            reason    = STOP_CYCLE_BUDGET;
+            break;
+        }
+
+        if (events_pending() && service_events(reason))
+        {
+            break;
+        }
+
+        uint16_t pc       = state.regs.pc;
+
+        pInstrFunc_t pFunc = decode(op);
+
+        state.cycles     += (this->*pFunc)(&op);
+        icount++;
+
+        // An unchanged PC means the program has either hung deliberately, or
+        // is waiting/stopped, and will not make progress without an external event
+        if (state.regs.pc == pc)
+        {
+            reason    = state.stopped ? STOP_HALTED : state.waiting ? STOP_WAITING : STOP_SELF_LOOP;
+            break;
+        }
+
+        if (state.regs.pc == until_pc)
+        {
+            reason    = STOP_PC;
+            break;
+        }
+
+        if (state.regs.pc < pc && idle_detect && idle_loop(icount, start_cycles, max_instructions, max_cycles))
+        {
+            reason    = STOP_IDLE;
+            break;
+        }
+    }
+
+    if (reason == STOP_WAITING && idle_detect)
+    {
+        idle_skip(icount, start_cycles, max_instructions, max_cycles, 0, 1);
+    }
+
+    end_lazy_flags();
+
+    rtn_val.pc           = state.regs.pc;
+    rtn_val.flags        = state.regs.flags;
+    rtn_val.instructions = icount;
+    rtn_val.cycles       = state.cycles - start_cycles;
+    rtn_val.stop_reason  = reason;
+
+    return rtn_val;
+}
+
+// -------------------------------------------------------------------------
+// run_until()
+//
+// Executes instructions as for run(), with the budgets, and optional PC and
+// memory value stop conditions, specified in cond. The PC condition is met
+// when an instruction leaves the PC at the given address, and the memory
+// condition when a write makes the memory at the given address (one or two
+// bytes) equal to the given value. The conditions only apply for this call.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+wy65_run_status_t cpu6502_core<BUS>::run_until (const wy65_run_until_t &cond)
+{
+    wy65_run_status_t rtn_val;
+
+    until_pc          = cond.stop_on_pc  ? cond.pc : WY65_ADDR_SPACE_SIZE;
+    until_addr        = cond.mem_addr;
+    until_len         = cond.stop_on_mem ? (cond.mem_word ? 2 : 1) : 0;
+    until_value       = cond.mem_word    ? cond.mem_value : (cond.mem_value & MASK_8BIT);
+    update_wr_hooks();
+
+    rtn_val           = run(cond.max_instructions, cond.max_cycles);
+
+    until_pc          = WY65_ADDR_SPACE_SIZE;
+    until_len         = 0;
+    update_wr_hooks();
+    pending.fetch_and(~EVT_BREAK);
+
+    return rtn_val;
+}
+
+// -------------------------------------------------------------------------
+// until_mem_check()
+//
+// Called on a write to the memory of the run_until() memory condition (and
+// after compiled blocks). If the memory now has the condition's value, an
+// EVT_BREAK event is made pending, stopping the run with STOP_MEM.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::until_mem_check (void)
+{
+    uint32_t value = rd_mem(until_addr);
+
+    if (until_len > 1)
+    {
+        value |= rd_mem((until_addr + 1) & 0xffff) << 8;
+    }
+
+    if (value == until_value)
+    {
+        pending.fetch_or(EVT_BREAK);
+    }
+}
+
+// -------------------------------------------------------------------------
+// idle_loop()
+//
+// Called by the run() engines, when enabled, after a backward branch or
+// jump. If the PC is that of the loop head checked previously, with the
+// registers and flags unchanged, and no writes having modified memory or
+// been made to a device since, then the loop iteration made no progress,
+// and will repeat until input (or an interrupt) changes what it reads. The
+// run is then skipped ahead by whole iterations, up to the budgets, and
+// true returned. Otherwise the state is recorded for the next check, unless
+// a different loop head is being checked, which is kept for a few other
+// backward branches or jumps (e.g. subroutine calls and returns within the
+// loop).
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+bool cpu6502_core<BUS>::idle_loop (uint64_t &icount, const uint64_t start_cycles, const uint64_t max_instructions, const uint64_t max_cycles)
+{
+    if (idle_valid && state.regs.pc == idle_regs.pc)
+    {
+        if (state.regs.a  == idle_regs.a  && state.regs.x     == idle_regs.x     && state.regs.y == idle_regs.y &&
+            state.regs.sp == idle_regs.sp && state.regs.flags == idle_regs.flags && flags_nz     == idle_nz     &&
+            wr_changes    == idle_wr_changes)
+        {
+            idle_skip(icount, start_cycles, max_instructions, max_cycles, icount - idle_icount, state.cycles - idle_cycles);
+            return true;
+        }
+    }
+    else if (idle_valid && ++idle_misses < WY65_IDLE_MAX_MISSES)
+    {
+        return false;
+    }
+
+    idle_valid        = true;
+    idle_misses       = 0;
+    idle_regs         = state.regs;
+    idle_nz           = flags_nz;
+    idle_wr_changes   = wr_changes;
+    idle_icount       = icount;
+    idle_cycles       = state.cycles;
+
+    return false;
+}
+
+// -------------------------------------------------------------------------
+// idle_skip()
+//
+// Advance the cycle and instruction counts by as many whole loop iterations
+// (of loop_instrs instructions and loop_cycles cycles) as fit within the
+// remaining budgets. Nothing is skipped if there are no budgets.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::idle_skip (uint64_t &icount, const uint64_t start_cycles, const uint64_t max_instructions, const uint64_t max_cycles,
+                                   const uint64_t loop_instrs, const uint64_t loop_cycles)
+{
+    uint64_t elapsed    = state.cycles - start_cycles;
+    uint64_t iterations = WY65_NO_LIMIT;
+
+    if (max_cycles != WY65_NO_LIMIT && loop_cycles != 0)
+    {
+        iterations = (elapsed < max_cycles) ? (max_cycles - elapsed) / loop_cycles : 0;
+    }
+
+    if (max_instructions != WY65_NO_LIMIT && loop_instrs != 0)
+    {
+        uint64_t instr_iterations = (icount < max_instructions) ? (max_instructions - icount) / loop_instrs : 0;
+
+        iterations = (instr_iterations < iterations) ? instr_iterations : iterations;
+    }
+
+    if (iterations != WY65_NO_LIMIT)
+    {
+        state.cycles     += iterations * loop_cycles;
+        icount           += iterations * loop_instrs;
+    }
+}
+
+// -------------------------------------------------------------------------
+// enable_idle_detect()
+//
+// Enable or disable idle loop detection in run(). Native code for the JIT
+// engine does not count memory writes, so all blocks are discarded, to be
+// recompiled with accesses made via the model when enabled.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::enable_idle_detect (const bool enable)
+{
+    idle_detect       = enable;
+    idle_valid        = false;
+
+    invalidate_decode_cache();
+    update_wr_hooks();
+}
+
+// -------------------------------------------------------------------------
+// run_forever()
+//
+// Executes instructions forever (with disassembly, if specified). Whenever
+// run() returns because the program is idle, waiting, stopped or hung, it
+// cannot progress without input or an interrupt, so the host thread is
+// yielded for WY65_IDLE_SLEEP_US before continuing.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::run_forever (bool disassem)
+{
+    while (disassem)
+    {
+        execute(0, 0, 0xffffffff);
+    }
+
+    while (true)
+    {
+        wy65_run_status_t status = run();
+
+        if (status.stop_reason != STOP_EVENT)
+        {
+#if !(defined _WIN32) && !(defined _WIN64)
+            usleep(WY65_IDLE_SLEEP_US);
+#else
+            Sleep((WY65_IDLE_SLEEP_US + 999) / 1000);
+#endif
+        }
+    }
+}
+
+// -------------------------------------------------------------------------
+// set_engine()
+//
+// Select the engine used by run(). Selecting an engine other than the block
+// or JIT engines discards any cached blocks, so that writes need not check
+// for modified block code whilst the blocks are unused.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::set_engine (const engine_type_e type)
+{
+    if (type != ENGINE_BLOCK && type != ENGINE_JIT && uop_pool_used != 0)
+    {
+        flush_blocks();
+    }
+
+    engine = type;
+}
+
+// -------------------------------------------------------------------------
+// set_dis_output()
+//
+// Select the disassembly output, closing any file the model had opened.
+// A file named fname is only opened when first disassembling.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::set_dis_output (FILE* p_file, const char* fname)
+{
+    if (fp != NULL && fp_owned)
+    {
+        fclose(fp);
+    }
+
+    fp       = p_file;
+    fp_owned = false;
+    nextPc   = INVALID_NEXT_PC;
+
+    strncpy(dis_fname, (fname != NULL) ? fname : WY65_DIS_FNAME, WY65_DIS_FNAME_SIZE - 1);
+    dis_fname[WY65_DIS_FNAME_SIZE - 1] = 0;
+}
+
+// -------------------------------------------------------------------------
+// run_threaded()
+//
+// Alternative engine for run(), with identical semantics. Rather than
+// copying an instruction table entry and calling the instruction method
+// via a pointer, each opcode has its own body in this function, generated
+// from WY65_OPCODE_TABLE, where the instruction method is called directly
+// with constant addressing mode and cycle count, allowing the compiler to
+// inline it. Where computed goto is available, each body ends with its own
+// fetch and indirect jump through a label table (threaded code), else a
+// switch statement is used.
+//
+// -------------------------------------------------------------------------
+
+// Checks made before fetching each instruction, and the fetch itself
+#define WY65_THREADED_FETCH                                                   \
+    if (icount >= max_instructions)                                           \
+    {                                                                         \
+        reason = STOP_INSTR_BUDGET;                                           \
+        goto run_done;                                                        \
+    }                                                                         \
+    if ((state.cycles - start_cycles) >= max_cycles)                          \
+    {                                                                         \
+        reason = STOP_CYCLE_BUDGET;                                           \
+        goto run_done;                                                        \
+    }                                                                         \
+    if (events_pending() && service_events(reason))                           \
+    {                                                                         \
+        goto run_done;                                                        \
+    }                                                                         \
+    pc             = state.regs.pc;                                           \
+    op.opcode      = rd_mem(state.regs.pc++)
+
+// Opcodes not supported by the selected CPU variant execute a NOP body for
+// the opcode's addressing mode (to skip the operand bytes). A dispatch table
+// for each variant selects between the opcode and NOP bodies, so there is no
+// variant test per instruction.
+#ifdef WY65_COMPUTED_GOTO
+# define WY65_THREADED_LABEL(_op)       L_##_op:
+# define WY65_THREADED_NOP_LABEL(_mode) N_##_mode:
+# define WY65_THREADED_ENTRY(_v, _op, _mode, _cpu) ((_cpu) <= (_v) ? &&L_##_op : nop_mode(_v, _mode, _cpu) == NON ? &&N_NON : &&N_##_mode),
+# define WY65_THREADED_NEXT             WY65_THREADED_FETCH; goto *p_dispatch[op.opcode]
+#else
+# define WY65_THREADED_LABEL(_op)       case _op:
+# define WY65_THREADED_NOP_LABEL(_mode) case (0x100 | _mode):
+# define WY65_THREADED_ENTRY(_v, _op, _mode, _cpu) ((_cpu) <= (_v) ? _op : (0x100 | nop_mode(_v, _mode, _cpu))),
+# define WY65_THREADED_NEXT             continue
+#endif
+
+#define WY65_THREADED_ENTRY_BASE(_op, _str, _func, _cyc, _mode, _cpu) WY65_THREADED_ENTRY(BASE, _op, _mode, _cpu)
+#define WY65_THREADED_ENTRY_C02(_op, _str, _func, _cyc, _mode, _cpu)  WY65_THREADED_ENTRY(C02,  _op, _mode, _cpu)
+#define WY65_THREADED_ENTRY_WRK(_op, _str, _func, _cyc, _mode, _cpu)  WY65_THREADED_ENTRY(WRK,  _op, _mode, _cpu)
+#define WY65_THREADED_ENTRY_WDC(_op, _str, _func, _cyc, _mode, _cpu)  WY65_THREADED_ENTRY(WDC,  _op, _mode, _cpu)
+
+// Common end of opcode body
+#define WY65_THREADED_END                                                     \
+        icount++;                                                             \
+        if (state.regs.pc == pc)                                              \
+        {                                                                     \
+            reason = state.stopped ? STOP_HALTED : state.waiting ? STOP_WAITING : STOP_SELF_LOOP; \
+            goto run_done;                                                    \
+        }                                                                     \
+        if (state.regs.pc == until_pc)                                        \
+        {                                                                     \
+            reason = STOP_PC;                                                 \
+            goto run_done;                                                    \
+        }                                                                     \
+        if (state.regs.pc < pc && idle_detect &&                              \
+            idle_loop(icount, start_cycles, max_instructions, max_cycles))    \
+        {                                                                     \
+            reason = STOP_IDLE;                                               \
+            goto run_done;                                                    \
+        }                                                                     \
+        WY65_THREADED_NEXT;
+
+// Opcode bodies
+#define WY65_THREADED_OP(_op, _str, _func, _cyc, _mode, _cpu)                 \
+    WY65_THREADED_LABEL(_op)                                                  \
+        fetch_operand(op, mode_op_bytes(_mode));                              \
+        op.exec_cycles = _cyc;                                                \
+        state.cycles  += _func<_mode>(&op);                                   \
+        WY65_THREADED_END
+
+// NOP bodies for unsupported opcodes, one per addressing mode
+#define WY65_THREADED_NOP(_mode)                                              \
+    WY65_THREADED_NOP_LABEL(_mode)                                            \
+        fetch_operand(op, mode_op_bytes(_mode));                              \
+        state.cycles  += NOP<_mode>(&op);                                     \
+        WY65_THREADED_END
+
+#define WY65_THREADED_NOPS                                                    \
+    WY65_THREADED_NOP(IND) WY65_THREADED_NOP(IDX) WY65_THREADED_NOP(IDY)      \
+    WY65_THREADED_NOP(ABS) WY65_THREADED_NOP(ABX) WY65_THREADED_NOP(ABY)      \
+    WY65_THREADED_NOP(IMM) WY65_THREADED_NOP(ZPG) WY65_THREADED_NOP(ZPX)      \
+    WY65_THREADED_NOP(ZPY) WY65_THREADED_NOP(ACC) WY65_THREADED_NOP(REL)      \
+    WY65_THREADED_NOP(ZPR) WY65_THREADED_NOP(IAX) WY65_THREADED_NOP(IDZ)      \
+    WY65_THREADED_NOP(NON)
+
+template <class BUS>
+wy65_run_status_t cpu6502_core<BUS>::run_threaded (const uint64_t max_instructions, const uint64_t max_cycles)
+{
+    op_t               op;
+    wy65_run_status_t  rtn_val;
+    uint64_t           icount       = 0;
+    uint64_t           start_cycles = state.cycles;
+    run_stop_e         reason;
+    uint16_t           pc;
+
+    pending.fetch_and(~(EVT_STOP | EVT_BREAK));
+    idle_valid        = false;
+
+    begin_lazy_flags();
+
+#ifdef WY65_COMPUTED_GOTO
+    typedef const void* dispatch_t;
+#else
+    typedef uint16_t    dispatch_t;
+#endif
+
+    static const dispatch_t dispatch_tbls[WY65_NUM_CPU_TYPES][WY65_INSTR_SPACE_SIZE] =
+    {
+        { WY65_OPCODE_TABLE(WY65_THREADED_ENTRY_BASE) },
+        { WY65_OPCODE_TABLE(WY65_THREADED_ENTRY_C02)  },
+        { WY65_OPCODE_TABLE(WY65_THREADED_ENTRY_WRK)  },
+        { WY65_OPCODE_TABLE(WY65_THREADED_ENTRY_WDC)  }
+    };
+
+    const dispatch_t* p_dispatch = dispatch_tbls[state.mode_c];
+
+#ifdef WY65_COMPUTED_GOTO
+    WY65_THREADED_NEXT;
+
+    WY65_OPCODE_TABLE(WY65_THREADED_OP)
+    WY65_THREADED_NOPS
+#else
+    while (true)
+    {
+        WY65_THREADED_FETCH;
+
+        switch (p_dispatch[op.opcode])
+        {
+        WY65_OPCODE_TABLE(WY65_THREADED_OP)
+        WY65_THREADED_NOPS
+        }
+    }
+#endif
+
+run_done:
+    if (reason == STOP_WAITING && idle_detect)
+    {
+        idle_skip(icount, start_cycles, max_instructions, max_cycles, 0, 1);
+    }
+
+    end_lazy_flags();
+
+    rtn_val.pc           = state.regs.pc;
+    rtn_val.flags        = state.regs.flags;
+    rtn_val.instructions = icount;
+    rtn_val.cycles       = state.cycles - start_cycles;
+    rtn_val.stop_reason  = reason;
+
+    return rtn_val;
+}
+
+#undef WY65_THREADED_FETCH
+#undef WY65_THREADED_LABEL
+#undef WY65_THREADED_NOP_LABEL
+#undef WY65_THREADED_ENTRY
+#undef WY65_THREADED_ENTRY_BASE
+#undef WY65_THREADED_ENTRY_C02
+#undef WY65_THREADED_ENTRY_WRK
+#undef WY65_THREADED_ENTRY_WDC
+#undef WY65_THREADED_NEXT
+#undef WY65_THREADED_END
+#undef WY65_THREADED_OP
+#undef WY65_THREADED_NOP
+#undef WY65_THREADED_NOPS
+
+// -------------------------------------------------------------------------
+// run_block()
+//
+// Alternative engine for run(), with the same semantics as for the other
+// engines, except that the cycle budget is only checked between blocks,
+// and so may be exceeded by up to a block's worth of cycles. Straight line
+// code, up to and including the next instruction that may change the flow
+// of control (branches, jumps, JSR, RTS, RTI, BRK, WAI and STP), is decoded
+// into a block of micro-ops, cached by entry PC. Each block is executed in
+// a tight loop, calling the same instruction methods as the other engines,
+// so that cycle counts are identical, with cycles summed for the block.
+//
+// Interrupts are taken at instruction boundaries, as for the other engines,
+// so a block is left early if an event becomes pending (e.g. the I flag is
+// cleared with an IRQ line active, or request_stop() is called), as well as
+// if the PC after a micro-op is not that of the next micro-op, or a write
+// invalidates the block (self-modifying code).
+//
+// For the JIT engine, blocks executed WY65_JIT_THRESHOLD times are compiled
+// to native code (see cpu6502_jit.cpp), where supported, which is then
+// executed in place of the block's micro-ops.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+wy65_run_status_t cpu6502_core<BUS>::run_block (const uint64_t max_instructions, const uint64_t max_cycles)
+{
+    op_t               op;
+    wy65_run_status_t  rtn_val;
+    uint64_t           icount       = 0;
+    uint64_t           start_cycles = state.cycles;
+    run_stop_e         reason;
+
+    // Allocate the block cache on first use
+    if (p_blk_tbl == NULL)
+    {
+        p_blk_tbl     = new blk_t[WY65_ADDR_SPACE_SIZE];
+        p_uop_pool    = new dinstr_t[WY65_BLOCK_POOL_SIZE];
+        p_code_byte   = new bool[WY65_ADDR_SPACE_SIZE];
+        flush_blocks();
+    }
+
+    // Allocate the JIT state on first use. If unsupported, the block engine is used
+    if (engine == ENGINE_JIT && p_jit_tbl == NULL)
+    {
+        jit_alloc();
+        flush_blocks();
+    }
+
+    pending.fetch_and(~(EVT_STOP | EVT_BREAK));
+    idle_valid        = false;
+
+    begin_lazy_flags();
+
+    while (true)
+    {
+        if (icount >= max_instructions)
+        {
+            reason    = STOP_INSTR_BUDGET;
+            break;
+        }
+
+        if ((state.cycles - start_cycles) >= max_cycles)
+        {
+            reason    = STOP_CYCLE_BUDGET;
+            break;
+        }
+
+        if (events_pending() && service_events(reason))
+        {
+            break;
+        }
+
+        uint16_t pc       = state.regs.pc;
+
+        // If no block can be built at this PC (code not cacheable), execute a single instruction
+        if (p_blk_tbl[pc].num_uops == 0 && !build_block(pc))
+        {
+            pInstrFunc_t pFunc = decode(op);
+
+            state.cycles     += (this->*pFunc)(&op);
+            icount++;
+        }
+        // Statically recompiled code for the block is used if registered, but not
+        // if it would exceed the instruction budget, or pass the run_until() PC
+        else if (p_blk_tbl[pc].p_static_fn != NULL && p_blk_tbl[pc].num_uops <= (max_instructions - icount) &&
+                 (until_pc <= pc || until_pc >= (uint32_t)pc + p_blk_tbl[pc].num_bytes))
+        {
+            blk_invalidated   = false;
+
+            // Static code accesses the flags register directly
+            end_lazy_flags();
+
+            wy65_static_rtn_t rtn = p_blk_tbl[pc].p_static_fn(this);
+
+            begin_lazy_flags();
+
+            state.cycles     += rtn.cycles;
+            icount           += rtn.instructions;
+            pc                = rtn.last_pc;
+        }
+        // If JIT enabled, the block is executed as native code when compiled, but
+        // not if it would exceed the instruction budget, or pass the run_until() PC.
+        // Native stores don't check the run_until() memory condition, so check after.
+        else if (engine == ENGINE_JIT && p_jit_tbl != NULL && 
+                 p_blk_tbl[pc].num_uops <= (max_instructions - icount) &&
+                 (until_pc <= pc || until_pc >= (uint32_t)pc + p_blk_tbl[pc].num_bytes) && jit_run_block(pc, icount))
+        {
+            if (until_len != 0)
+            {
+                until_mem_check();
+            }
+        }
+        // Compiling a block may discard all blocks when the code buffer is full
+        else if (p_blk_tbl[pc].num_uops == 0)
+        {
+            continue;
+        }
+        else
+        {
+            const blk_t*    p_blk  = &p_blk_tbl[pc];
+            const dinstr_t* p_uop  = &p_uop_pool[p_blk->first_uop];
+            uint64_t        num    = ((max_instructions - icount) < p_blk->num_uops) ? (max_instructions - icount) : p_blk->num_uops;
+            uint64_t        cycles = 0;
+            uint64_t        n;
+
+            blk_invalidated   = false;
+
+            for (n = 0; n < num; n++, p_uop++)
+            {
+                pc                = state.regs.pc;
+                state.regs.pc     = pc + p_uop->instr_bytes;
+
+                // A fused pair executes as one micro-op, if both within the budget. If
+                // the first instruction was left early, its PC is checked below as normal.
+                if (p_uop->fuse_idx != 0 && (n + 1) < num)
+                {
+                    fuse_rtn_t rtn    = (this->*fuse_tbl[p_uop->fuse_idx - 1].pFunc)(p_uop);
+
+                    cycles           += rtn.cycles;
+
+                    if (rtn.instructions > 1)
+                    {
+                        pc           += p_uop->instr_bytes;
+                        n++;
+                        p_uop++;
+                    }
+                }
+                else
+                {
+                    op.opcode         = p_uop->opcode;
+                    op.operand        = p_uop->operand;
+                    op.exec_cycles    = p_uop->exec_cycles;
+
+                    cycles           += (this->*p_uop->pFunc)(&op);
+                }
+
+                // Leave the block if flow of control changed, the block's code was modified, or an event is pending
+                if (state.regs.pc != (uint16_t)(pc + p_uop->instr_bytes) || blk_invalidated || events_pending() || state.regs.pc == until_pc)
+                {
+                    n++;
+                    break;
+                }
+            }
+
+            state.cycles     += cycles;
+            icount           += n;
+
+            // Count the adjacent instruction pairs executed, if profiling
+            if (p_pair_prof != NULL)
+            {
+                for (uint64_t idx = 1; idx < n; idx++)
+                {
+                    p_pair_prof[(p_uop_pool[p_blk->first_uop + idx - 1].opcode << 8) | p_uop_pool[p_blk->first_uop + idx].opcode]++;
+                }
+            }
+        }
+
+        // An unchanged PC means the program has either hung deliberately, or
+        // is waiting/stopped, and will not make progress without an external event
+        if (state.regs.pc == pc)
+        {
+            reason    = state.stopped ? STOP_HALTED : state.waiting ? STOP_WAITING : STOP_SELF_LOOP;
+            break;
+        }
+
+        if (state.regs.pc == until_pc)
+        {
+            reason    = STOP_PC;
+            break;
+        }
+
+        if (state.regs.pc < pc && idle_detect && idle_loop(icount, start_cycles, max_instructions, max_cycles))
+        {
+            reason    = STOP_IDLE;
+            break;
+        }
+    }
+
+    if (reason == STOP_WAITING && idle_detect)
+    {
+        idle_skip(icount, start_cycles, max_instructions, max_cycles, 0, 1);
+    }
+
+    end_lazy_flags();
+
+    rtn_val.pc           = state.regs.pc;
+    rtn_val.flags        = state.regs.flags;
+    rtn_val.instructions = icount;
+    rtn_val.cycles       = state.cycles - start_cycles;
+    rtn_val.stop_reason  = reason;
+
+    return rtn_val;
+}
+
+// -------------------------------------------------------------------------
+// build_block()
+//
+// Decode the block of instructions starting at entry_pc into the micro-op
+// pool, and mark its code bytes. Returns false, with no block built, if
+// the code at entry_pc is not cacheable. The block ends early at code that
+// is not cacheable, or at the maximum block length.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+bool cpu6502_core<BUS>::build_block (const uint16_t entry_pc)
+{
+    if (!is_cacheable(entry_pc))
+    {
+        return false;
+    }
+
+    // If the pool can't hold a maximum sized block, discard all blocks
+    if (uop_pool_used + WY65_MAX_BLOCK_INSTRS > WY65_BLOCK_POOL_SIZE)
+    {
+        flush_blocks();
+    }
+
+    blk_t*    p_blk   = &p_blk_tbl[entry_pc];
+    uint16_t  pc      = entry_pc;
+    uint32_t  num     = 0;
+    bool      ends_block;
+
+    do
+    {
+        dinstr_t*    p_uop   = &p_uop_pool[uop_pool_used + num];
+        const tbl_t* p_instr = &instr_tbl[rd_mem(pc)];
+
+        p_uop->pFunc       = p_instr->pFunc;
+        p_uop->opcode      = rd_mem(pc);
+        p_uop->operand     = 0;
+        if (p_instr->op_bytes > 0) p_uop->operand  = rd_mem((pc + 1) & 0xffff);
+        if (p_instr->op_bytes > 1) p_uop->operand |= rd_mem((pc + 2) & 0xffff) << 8;
+        p_uop->instr_bytes = 1 + p_instr->op_bytes;
+        p_uop->exec_cycles = p_instr->exec_cycles;
+
+        for (uint32_t idx = 0; idx < p_uop->instr_bytes; idx++)
+        {
+            p_code_byte[(pc + idx) & 0xffff] = true;
+        }
+
+        pc                += p_uop->instr_bytes;
+        num++;
+
+        ends_block         = p_instr->ends_block;
+    }
+    while (!ends_block && num < WY65_MAX_BLOCK_INSTRS && is_cacheable(pc));
+
+    // Fuse selected instruction pairs, with no overlap, unless profiling pairs
+    for (uint32_t idx = 0; idx < num; idx++)
+    {
+        dinstr_t* p_uop    = &p_uop_pool[uop_pool_used + idx];
+
+        p_uop->fuse_idx    = (fuse_en && p_pair_prof == NULL && idx + 1 < num) ? fuse_lookup((p_uop[0].opcode << 8) | p_uop[1].opcode) : 0;
+
+        if (p_uop->fuse_idx != 0)
+        {
+            p_uop[1].fuse_idx = 0;
+            idx++;
+        }
+    }
+
+    p_blk->first_uop  = uop_pool_used;
+    p_blk->num_uops   = num;
+    p_blk->num_bytes  = (pc - entry_pc) & 0xffff;
+    p_blk->exec_count = 0;
+
+    // Use statically recompiled code for the block, if compiled from the same code
+    p_blk->p_static_fn = (p_static_tbl != NULL) ? match_static_block(entry_pc, p_blk) : NULL;
+
+    uop_pool_used    += num;
+    update_wr_hooks();
+
+    return true;
+}
+
+// -------------------------------------------------------------------------
+// flush_blocks()
+//
+// Discard all blocks, and free the micro-op pool and JIT code buffer
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::flush_blocks (void)
+{
+    if (p_blk_tbl != NULL)
+    {
+        memset(p_blk_tbl,   0, WY65_ADDR_SPACE_SIZE * sizeof(blk_t));
+        memset(p_code_byte, 0, WY65_ADDR_SPACE_SIZE * sizeof(bool));
+
+        uop_pool_used   = 0;
+        blk_invalidated = true;
+    }
+
+    if (p_jit_tbl != NULL)
+    {
+        memset(p_jit_tbl,   0, WY65_ADDR_SPACE_SIZE * sizeof(jit_fn_t));
+
+        jit_code_used   = 0;
+    }
+
+    update_wr_hooks();
+}
+
+// -------------------------------------------------------------------------
+// invalidate_blocks()
+//
+// Called on a write to an address that is part of the code of one or more
+// blocks. All blocks including the address are invalidated (with their
+// micro-ops reclaimed at the next flush), and the address is no longer
+// marked as code.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::invalidate_blocks (const int addr)
+{
+    for (int offset = 0; offset < WY65_MAX_BLOCK_BYTES; offset++)
+    {
+        blk_t* p_blk = &p_blk_tbl[(addr - offset) & 0xffff];
+
+        if (p_blk->num_uops != 0 && p_blk->num_bytes > offset)
+        {
+            p_blk->num_uops = 0;
+            blk_invalidated = true;
+
+            if (p_jit_tbl != NULL)
+            {
+                p_jit_tbl[(addr - offset) & 0xffff] = NULL;
+            }
+        }
+    }
+
+    p_code_byte[addr & 0xffff] = false;
+}
+
+// -------------------------------------------------------------------------
+// fuse_pair()
+//
+// Fused handler for an instruction pair, with the instruction methods as
+// compile time constants, so that both may be inlined into a single
+// micro-op. The cycles are the sum of the two methods' cycles. On entry,
+// the PC is pointing to the second instruction. The second instruction is
+// not executed if the block engine would leave the block after the first,
+// or if it is at the run_until() PC, which acts as a breakpoint.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS> template <typename cpu6502_core<BUS>::pInstrFunc_t F0, typename cpu6502_core<BUS>::pInstrFunc_t F1>
+typename cpu6502_core<BUS>::fuse_rtn_t cpu6502_core<BUS>::fuse_pair (const dinstr_t* p_uop)
+{
+    op_t       op;
+    fuse_rtn_t rtn;
+    uint16_t   next_pc = state.regs.pc;
+
+    op.opcode          = p_uop[0].opcode;
+    op.operand         = p_uop[0].operand;
+    op.exec_cycles     = p_uop[0].exec_cycles;
+
+    rtn.cycles         = (this->*F0)(&op);
+    rtn.instructions   = 1;
+
+    if (state.regs.pc != next_pc || blk_invalidated || events_pending() || next_pc == until_pc)
+    {
+        return rtn;
+    }
+
+    state.regs.pc     += p_uop[1].instr_bytes;
+
+    op.opcode          = p_uop[1].opcode;
+    op.operand         = p_uop[1].operand;
+    op.exec_cycles     = p_uop[1].exec_cycles;
+
+    rtn.cycles        += (this->*F1)(&op);
+    rtn.instructions   = 2;
+
+    return rtn;
+}
+
+// -------------------------------------------------------------------------
+// fuse_tbl
+//
+// Fusible instruction pairs, for idioms common in 6502 code: compares,
+// register and memory increments/decrements and bit tests followed by a
+// conditional branch, and loads followed by a store of the same register.
+// Only opcodes with the same instruction in all CPU variants are used. The
+// number of entries is WY65_NUM_FUSE_PAIRS.
+//
+// -------------------------------------------------------------------------
+
+#define WY65_FUSE(_op0, _func0, _mode0, _op1, _func1, _mode1) \
+    {_op0, _op1, &cpu6502_core::fuse_pair<&cpu6502_core::_func0<_mode0>, &cpu6502_core::_func1<_mode1> >},
+
+#define WY65_FUSE_BRANCHES(_op0, _func0, _mode0)                                                 \
+    WY65_FUSE(_op0, _func0, _mode0, 0x10, BPL, REL) WY65_FUSE(_op0, _func0, _mode0, 0x30, BMI, REL) \
+    WY65_FUSE(_op0, _func0, _mode0, 0x50, BVC, REL) WY65_FUSE(_op0, _func0, _mode0, 0x70, BVS, REL) \
+    WY65_FUSE(_op0, _func0, _mode0, 0x90, BCC, REL) WY65_FUSE(_op0, _func0, _mode0, 0xB0, BCS, REL) \
+    WY65_FUSE(_op0, _func0, _mode0, 0xD0, BNE, REL) WY65_FUSE(_op0, _func0, _mode0, 0xF0, BEQ, REL)
+
+#define WY65_FUSE_STORES(_op0, _func0, _mode0, _op_zpg, _op_abs, _func1)                         \
+    WY65_FUSE(_op0, _func0, _mode0, _op_zpg, _func1, ZPG) WY65_FUSE(_op0, _func0, _mode0, _op_abs, _func1, ABS)
+
+template <class BUS>
+const typename cpu6502_core<BUS>::fuse_t cpu6502_core<BUS>::fuse_tbl[WY65_NUM_FUSE_PAIRS] =
+{
+    // Compare and branch
+    WY65_FUSE_BRANCHES(0xC9, CMP, IMM)
+    WY65_FUSE_BRANCHES(0xC5, CMP, ZPG)
+    WY65_FUSE_BRANCHES(0xE0, CPX, IMM)
+    WY65_FUSE_BRANCHES(0xC0, CPY, IMM)
+
+    // Register increment/decrement and branch
+    WY65_FUSE_BRANCHES(0xCA, DEX, NON)
+    WY65_FUSE_BRANCHES(0x88, DEY, NON)
+    WY65_FUSE_BRANCHES(0xE8, INX, NON)
+    WY65_FUSE_BRANCHES(0xC8, INY, NON)
+
+    // Memory increment/decrement and branch
+    WY65_FUSE_BRANCHES(0xE6, INC, ZPG)
+    WY65_FUSE_BRANCHES(0xEE, INC, ABS)
+    WY65_FUSE_BRANCHES(0xC6, DEC, ZPG)
+    WY65_FUSE_BRANCHES(0xCE, DEC, ABS)
+
+    // Bit test and branch
+    WY65_FUSE_BRANCHES(0x24, BIT, ZPG)
+    WY65_FUSE_BRANCHES(0x2C, BIT, ABS)
+
+    // Load and store
+    WY65_FUSE_STORES(0xA9, LDA, IMM, 0x85, 0x8D, STA)
+    WY65_FUSE_STORES(0xA5, LDA, ZPG, 0x85, 0x8D, STA)
+    WY65_FUSE_STORES(0xAD, LDA, ABS, 0x85, 0x8D, STA)
+    WY65_FUSE_STORES(0xA2, LDX, IMM, 0x86, 0x8E, STX)
+    WY65_FUSE_STORES(0xA6, LDX, ZPG, 0x86, 0x8E, STX)
+    WY65_FUSE_STORES(0xAE, LDX, ABS, 0x86, 0x8E, STX)
+    WY65_FUSE_STORES(0xA0, LDY, IMM, 0x84, 0x8C, STY)
+    WY65_FUSE_STORES(0xA4, LDY, ZPG, 0x84, 0x8C, STY)
+    WY65_FUSE_STORES(0xAC, LDY, ABS, 0x84, 0x8C, STY)
+};
+
+#undef WY65_FUSE
+#undef WY65_FUSE_BRANCHES
+#undef WY65_FUSE_STORES
+
+// -------------------------------------------------------------------------
+// enable_fusion()
+//
+// Enable or disable fusion of the selected instruction pairs. All blocks
+// are discarded, so that they are rebuilt accordingly.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::enable_fusion (const bool enable)
+{
+    fuse_en = enable;
+
+    flush_blocks();
+}
+
+// -------------------------------------------------------------------------
+// set_fusion_pairs()
+//
+// Select the instruction pairs to fuse, each as (first opcode << 8 |
+// second opcode), or all fusible pairs if p_pairs is NULL. Pairs without a
+// fused handler are ignored. All blocks are discarded, so that they are
+// rebuilt with the new selection. Returns the number of pairs selected.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+uint32_t cpu6502_core<BUS>::set_fusion_pairs (const uint16_t* p_pairs, const uint32_t num_pairs)
+{
+    uint32_t num_sel = 0;
+
+    memset(fuse_sel, 0, sizeof(fuse_sel));
+    fuse_all = (p_pairs == NULL);
+
+    for (uint32_t idx = 0; idx < WY65_NUM_FUSE_PAIRS; idx++)
+    {
+        uint16_t pair = (fuse_tbl[idx].opcode0 << 8) | fuse_tbl[idx].opcode1;
+        bool     sel  = (p_pairs == NULL);
+
+        for (uint32_t pidx = 0; pidx < num_pairs && !sel; pidx++)
+        {
+            sel = p_pairs[pidx] == pair;
+        }
+
+        if (sel)
+        {
+            fuse_sel[pair >> 5] |= 1U << (pair & 31);
+            num_sel++;
+        }
+    }
+
+    flush_blocks();
+
+    return num_sel;
+}
+
+// -------------------------------------------------------------------------
+// fuse_lookup()
+//
+// Returns the fuse_tbl index + 1 for a pair, if selected, else 0. The table
+// is only searched for selected pairs, when building blocks.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+uint8_t cpu6502_core<BUS>::fuse_lookup (const uint32_t pair)
+{
+    if ((fuse_sel[pair >> 5] & (1U << (pair & 31))) == 0)
+    {
+        return 0;
+    }
+
+    for (uint32_t idx = 0; idx < WY65_NUM_FUSE_PAIRS; idx++)
+    {
+        if (((uint32_t)fuse_tbl[idx].opcode0 << 8 | fuse_tbl[idx].opcode1) == pair)
+        {
+            return idx + 1;
+        }
+    }
+
+    return 0; // LCOV_EXCL_LINE
+}
+
+// -------------------------------------------------------------------------
+// enable_pair_profile()
+//
+// Enable (clearing any previous counts) or disable counting of adjacent
+// instruction pairs executed within blocks. Pairs are not fused while
+// profiling, so all blocks are discarded to be rebuilt unfused (or fused
+// again, when disabled).
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::enable_pair_profile (const bool enable)
+{
+    if (enable)
+    {
+        if (p_pair_prof == NULL)
+        {
+            p_pair_prof = new uint64_t[WY65_INSTR_SPACE_SIZE * WY65_INSTR_SPACE_SIZE];
+        }
+
+        memset(p_pair_prof, 0, WY65_INSTR_SPACE_SIZE * WY65_INSTR_SPACE_SIZE * sizeof(uint64_t));
+    }
+    else
+    {
+        delete [] p_pair_prof;
+        p_pair_prof = NULL;
+    }
+
+    flush_blocks();
+}
+
+// -------------------------------------------------------------------------
+// get_pair_profile()
+//
+// Return up to max_pairs of the instruction pairs with the highest
+// (non-zero) execution counts, in descending order, and whether each is
+// fusible. Returns the number of pairs returned (0 if not profiling).
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+uint32_t cpu6502_core<BUS>::get_pair_profile (wy65_pair_count_t* p_counts, const uint32_t max_pairs)
+{
+    uint32_t num = 0;
+
+    if (p_pair_prof == NULL)
+    {
+        return 0;
+    }
+
+    // Insert each counted pair into the sorted list, if it ranks within max_pairs
+    for (uint32_t pair = 0; pair < WY65_INSTR_SPACE_SIZE * WY65_INSTR_SPACE_SIZE; pair++)
+    {
+        uint64_t count = p_pair_prof[pair];
+
+        if (count == 0 || (num == max_pairs && (num == 0 || count <= p_counts[num-1].count)))
+        {
+            continue;
+        }
+
+        uint32_t pos = (num < max_pairs) ? num++ : num - 1;
+
+        for (; pos > 0 && p_counts[pos-1].count < count; pos--)
+        {
+            p_counts[pos] = p_counts[pos-1];
+        }
+
+        p_counts[pos].pair    = pair;
+        p_counts[pos].count   = count;
+        p_counts[pos].fusible = false;
+
+        for (uint32_t idx = 0; idx < WY65_NUM_FUSE_PAIRS; idx++)
+        {
+            p_counts[pos].fusible |= (uint32_t)((fuse_tbl[idx].opcode0 << 8) | fuse_tbl[idx].opcode1) == pair;
+        }
+    }
+
+    return num;
+}
+
+// -------------------------------------------------------------------------
+// nmi_interrupt()
+//
+// Generates an NMI. NMI is falling edge triggered, and calling this 
+// function emulates this single event, which is latched as a pending event
+// and taken at the next instruction boundary (see nmi()). This may safely
+// be called from within a memory callback, mid-instruction, or from
+// another thread. Edges made before the NMI is taken are merged, as for the
+// hardware's edge detector.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::nmi_interrupt ()
+{
+    pending.fetch_or(EVT_NMI);
+}
+
+// -------------------------------------------------------------------------
+// nmi()
+//
+// Takes an NMI. The flags an PC are pushed on to the stack, the interrupt
+// mask set (I flag), and the PC set to the vector defined at address 0xfffa
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::nmi ()
+{
+    // If waiting, PC was not advanced past the WAI opcode, so do this before pushing PC
+    if (state.waiting)
+    {
+        state.regs.pc++;
+        state.waiting = false;
+    }
+
+    // The cycle exact engine makes the interrupt's bus cycles in order
+    if (engine == ENGINE_CYCLE)
+    {
+        cycle_interrupt(NMI_VEC_ADDR, get_flags());
+        irq_update();
+        return;
+    }
+
+    wr_mem(state.regs.sp | 0x100, (state.regs.pc >> 8) & MASK_8BIT); state.regs.sp--;
+    wr_mem(state.regs.sp | 0x100, state.regs.pc & MASK_8BIT);        state.regs.sp--;
+    wr_mem(state.regs.sp | 0x100, get_flags());                      state.regs.sp--;
+
+    state.regs.flags |= INT_MASK;
+
+    state.regs.pc     = (uint16_t)rd_mem(NMI_VEC_ADDR) | ((uint16_t)rd_mem(NMI_VEC_ADDR+1) << 8);
+
+    state.cycles     += NMI_CYCLES;
+
+    irq_update();
+}
+
+// -------------------------------------------------------------------------
+// irq()
+//
+// Checks for, and execution of, maskable interrupts. IRQs are level 
+// sensitive (active low). The nirq_line state has 16 lines bitmapped,
+// and if any are low, and interrupts are enabled (I flag is low),
+// The PC and state are pushed on the stack, the I flag set, and the
+// PC set to the interrupt vector defined at address 0xfffe. Called at
+// instruction boundaries when an IRQ event is pending.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::irq ()
+{
+    if (nirq_lines.load() != NO_ACTIVE_IRQS && !(state.regs.flags & INT_MASK) && !state.stopped)
+    {
+        // If waiting, PC was not advanced past the WAI opcode, so do this before pushing PC
+        if (state.waiting)
+        {
+            state.regs.pc++;
+            state.waiting = false;
+        }
+
+        // The cycle exact engine makes the interrupt's bus cycles in order
+        if (engine == ENGINE_CYCLE)
+        {
+            cycle_interrupt(IRQ_VEC_ADDR, get_flags() & ~BRK_MASK);
+        }
+        else
+        {
+            wr_mem(state.regs.sp | 0x100, (state.regs.pc >> 8) & MASK_8BIT);  state.regs.sp--;
+            wr_mem(state.regs.sp | 0x100, state.regs.pc & MASK_8BIT);         state.regs.sp--;
+            wr_mem(state.regs.sp | 0x100, get_flags() & ~BRK_MASK);           state.regs.sp--;
+
+            state.regs.flags |= INT_MASK;
+
+            state.regs.pc     = (uint16_t)rd_mem(IRQ_VEC_ADDR) | ((uint16_t)rd_mem(IRQ_VEC_ADDR+1) << 8);
+
+            state.cycles      += IRQ_CYCLES;
+        }
+    }
+
+    // The I flag may have been set since the event became pending (e.g. by SEI)
+    irq_update();
+}
+
+// -------------------------------------------------------------------------
+// irq_update()
+//
+// Sets the pending IRQ event when any IRQ line is active and the I flag is
+// clear, else clears it, so that a held IRQ is only tested for at an
+// instruction boundary once it can be taken. Called by the running thread
+// when the I flag is cleared, or after an IRQ check.
+//
+// Another thread activating a line sets the event after the line, so when
+// clearing the event, the lines are checked again: the operations are
+// sequentially consistent, so either the activation is seen, or its event
+// is set after the clear.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+inline void cpu6502_core<BUS>::irq_update ()
+{
+    if (nirq_lines.load() != NO_ACTIVE_IRQS && !(state.regs.flags & INT_MASK))
+    {
+        pending.fetch_or(EVT_IRQ);
+    }
+    else if (pending.load(std::memory_order_relaxed) & EVT_IRQ)
+    {
+        pending.fetch_and(~EVT_IRQ);
+
+        if (nirq_lines.load() != NO_ACTIVE_IRQS && !(state.regs.flags & INT_MASK))
+        {
+            pending.fetch_or(EVT_IRQ); // LCOV_EXCL_LINE
+        }
+    }
+}
+
+// -------------------------------------------------------------------------
+// take_events()
+//
+// Takes any reset, NMI or IRQ pending at an instruction boundary, in that
+// order of priority. A requested reset continues the cycle count.
+//
+// The events may have been made pending by another thread, and were seen
+// with a relaxed load, so they are loaded again with acquire ordering,
+// pairing with the (release) read-modify-write that set them, making the
+// injecting thread's prior writes (e.g. the reset mode) visible. An NMI
+// edge is consumed with a single read-modify-write, so that an edge
+// injected meanwhile is not lost.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::take_events ()
+{
+    if (pending.load(std::memory_order_acquire) & EVT_RESET)
+    {
+        uint64_t cycles   = state.cycles;
+
+        reset(reset_mode.load(std::memory_order_relaxed));
+
+        state.cycles      = cycles + RST_CYCLES;
+    }
+
+    if (pending.fetch_and(~EVT_NMI) & EVT_NMI)
+    {
+        nmi();
+    }
+
+    if (pending.load(std::memory_order_relaxed) & EVT_IRQ)
+    {
+        irq();
+    }
+}
+
+// -------------------------------------------------------------------------
+// service_events()
+//
+// Called by the run() engines at an instruction boundary when any event is
+// pending. If a stop was requested, or the run_until() memory condition
+// met, returns true with the reason for stopping. Otherwise any pending
+// interrupt or reset is taken, and false returned.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+bool cpu6502_core<BUS>::service_events (run_stop_e &reason)
+{
+    uint32_t events   = pending.load(std::memory_order_relaxed);
+
+    if (events & (EVT_STOP | EVT_BREAK))
+    {
+        reason            = (events & EVT_BREAK) ? STOP_MEM : STOP_EVENT;
+        return true;
+    }
+
+    take_events();
+
+    return false;
+}
+
+// -------------------------------------------------------------------------
+// activate_irq()
+//
+// Activates (sets low) one of the sixteen IRQ lines, as defined by id. This
+// has a default value of 0. The interrupt is taken at the next instruction
+// boundary at which the I flag is clear, so this may safely be called from
+// within a memory callback, mid-instruction, or from another thread. The I
+// flag belongs to the running thread, so the IRQ event is set regardless,
+// and cleared at the boundary if the interrupt is masked (see irq()).
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::activate_irq (const uint16_t id)
+{
+    // Activate the IRQ line if 'id' in range, else ignore.
+    if (id < NUM_INTERNAL_IRQS)
+    {
+        nirq_lines.fetch_and(~(1U << id));
+        pending.fetch_or(EVT_IRQ);
+    }
+}
+
+// -------------------------------------------------------------------------
+// deactivate_irq()
+//
+// Dectivates (sets low) one of the sixteen IRQ lines, as defined by id. 
+// This has a default value of 0.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::deactivate_irq (const uint16_t id)
+{
+    // Deactivate the IRQ line if 'id' in range, else ignore. Any IRQ event
+    // still pending is cleared at the next boundary, when no line is active.
+    if (id < NUM_INTERNAL_IRQS)
+    {
+        nirq_lines.fetch_or(1U << id);
+    }
+}
+
+// -------------------------------------------------------------------------
+// reset()
+//
+// Emulates a hard reset. All the 6502 registers are reset, the PC is
+// updated with the vector at 0xfffc and interrupts are disabled. In
+// addition, the internal cycle count is cleared.
+// 
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::reset (cpu_type_e mode)
+{
+    // Reset the CPU state.
+    set_flags(INT_MASK);
+    state.regs.pc     = (uint16_t)rd_mem(RESET_VEC_ADDR) | ((uint16_t)rd_mem(RESET_VEC_ADDR+1) << 8);
+    state.regs.a      = 0;
+    state.regs.x      = 0;
+    state.regs.y      = 0;
+    state.regs.sp     = 0xff;
+
+    state.cycles      = RST_CYCLES;
+    state.nirq_line   = NO_ACTIVE_IRQS;
+    state.waiting     = false;
+    state.stopped     = false;
+
+    // Any active IRQ lines, and pending interrupts or reset, are discarded
+    nirq_lines        = NO_ACTIVE_IRQS;
+    pending.fetch_and(~(EVT_IRQ | EVT_NMI | EVT_RESET));
+
+    if (mode != DEFAULT)
+    {
+        state.mode_c      = mode; // Set which CPU variant mode we're in from argument (default BASE)
+    }
+
+    // Select the instruction table for the CPU variant
+    instr_tbl         = instr_tbls[state.mode_c];
+
+    // Cached decodes may be for a different variant
+    invalidate_decode_cache();
+}
+
+// -------------------------------------------------------------------------
+// load_mem()
+//
+// Loads a memory image into internal memory from start_addr, or clears the
+// whole of internal memory when p_data is NULL. Memory is written directly,
+// so any cached decodes or blocks for the region are invalidated.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+int cpu6502_core<BUS>::load_mem (const uint8_t* p_data, const uint32_t len, const uint16_t start_addr)
+{
+    if (p_data == NULL)
+    {
+        unshare_pages(0, WY65_NUM_MAP_PAGES);
+        memset(mem, 0, WY65_MEM_SIZE);
+        invalidate_decode_cache();
+
+        return 0;
+    }
+
+#if WY65_MEM_SIZE < WY65_ADDR_SPACE_SIZE
+    uint32_t avail = (start_addr < WY65_MEM_SIZE) ? WY65_MEM_SIZE - start_addr : 0;
+#else
+    uint32_t avail = WY65_MEM_SIZE - start_addr;
+#endif
+    uint32_t count = (len > avail) ? avail : len;
+
+    unshare_pages(start_addr >> WY65_MAP_PAGE_BITS, (start_addr + count + WY65_MAP_PAGE_SIZE - 1) >> WY65_MAP_PAGE_BITS);
+
+    memcpy(&mem[start_addr], p_data, count);
+    invalidate_decode_cache(start_addr, count);
+
+    return count;
+}
+
+// -------------------------------------------------------------------------
+// fork()
+//
+// Creates a copy of the model, sharing internal memory copy-on-write. Each
+// unmapped page of internal memory not already shared is first moved to a
+// new shared page (with no copy needed for pages already shared from an
+// earlier fork), and the fork then takes a reference to every shared page.
+// Whilst any page is shared, native JIT code may not access internal memory
+// directly, so existing native code is discarded when pages first become
+// mapped. So the first fork copies all of internal memory (64KB by default)
+// into heap pages (256 by default), and native JIT code of the model no
+// longer accesses memory directly until every page has been written to and
+// unshared, which for code and read only data is never.
+//
+// Pages mapped to host memory within the bus are re-based onto the fork's
+// copy of the bus, and pages mapped to other host RAM are given to the fork
+// as copy-on-write copies. Other writable host memory can't be isolated, and
+// no fork is made.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+cpu6502_core<BUS>* cpu6502_core<BUS>::fork (void)
+{
+    bool          int_mem    = !bus.ext_rd() && !bus.ext_wr();
+
+    for (uint32_t page_num = 0; page_num < WY65_NUM_MAP_PAGES; page_num++)
+    {
+        const wy65_page_t* p_page = &page_tbl[page_num];
+        uint32_t           addr   = page_num << WY65_MAP_PAGE_BITS;
+        bool               in_mem = int_mem && addr + WY65_MAP_PAGE_SIZE <= WY65_MEM_SIZE;
+
+        if (p_page->p_wr != NULL && !in_bus(p_page->p_wr) && (p_page->p_rd != p_page->p_wr || !in_mem))
+        {
+            return NULL;
+        }
+    }
+
+    cpu6502_core* p_fork     = new cpu6502_core;
+    bool          was_mapped = pages_mapped;
+
+    // The bus is copied first, as it determines the fork's unmapped page entries
+    p_fork->bus              = bus;
+
+    for (uint32_t page_num = 0; page_num < WY65_NUM_MAP_PAGES; page_num++)
+    {
+        uint32_t     addr   = page_num << WY65_MAP_PAGE_BITS;
+        wy65_page_t* p_page = &page_tbl[page_num];
+        bool         in_mem = int_mem && addr + WY65_MAP_PAGE_SIZE <= WY65_MEM_SIZE;
+
+        if (in_mem && cow_page[page_num] == NULL && page_unmapped(page_num))
+        {
+            cow_page_t* p_cow = new cow_page_t;
+
+            p_cow->refs       = 1;
+            memcpy(p_cow->data, &mem[addr], WY65_MAP_PAGE_SIZE);
+
+            cow_page[page_num] = p_cow;
+            *p_page            = {p_cow->data, NULL, NULL, cow_write, this, this};
+        }
+
+        if (cow_page[page_num] != NULL)
+        {
+            cow_page[page_num]->refs.fetch_add(1);
+
+            p_fork->cow_page[page_num] = cow_page[page_num];
+            p_fork->page_tbl[page_num] = {cow_page[page_num]->data, NULL, NULL, cow_write, p_fork, p_fork};
+        }
+        else if (page_unmapped(page_num))
+        {
+            p_fork->set_unmapped_page(page_num);
+        }
+        else if (p_page->p_wr != NULL && !in_bus(p_page->p_wr))
+        {
+            // Host RAM is copied to a page of the fork's own, copy-on-write, so that
+            // the fork's first write copies it to its internal memory
+            cow_page_t* p_cow = new cow_page_t;
+
+            p_cow->refs       = 1;
+            memcpy(p_cow->data, p_page->p_wr, WY65_MAP_PAGE_SIZE);
+
+            p_fork->cow_page[page_num] = p_cow;
+            p_fork->page_tbl[page_num] = {p_cow->data, NULL, NULL, cow_write, p_fork, p_fork};
+        }
+        else
+        {
+            // Host memory within the bus is re-based onto the fork's bus, and host
+            // ROM and devices are shared, whilst the internal memory they hide is copied
+            wy65_page_t* p_fpage = &p_fork->page_tbl[page_num];
+
+            p_fpage->p_rd     = (uint8_t*)rebase_to_bus(p_page->p_rd, p_fork);
+            p_fpage->p_wr     = (uint8_t*)rebase_to_bus(p_page->p_wr, p_fork);
+            p_fpage->rd_func  = p_page->rd_func;
+            p_fpage->wr_func  = p_page->wr_func;
+            p_fpage->p_rd_ctx = rebase_to_bus(p_page->p_rd_ctx, p_fork);
+            p_fpage->p_wr_ctx = rebase_to_bus(p_page->p_wr_ctx, p_fork);
+
+            if (in_mem)
+            {
+                memcpy(&p_fork->mem[addr], &mem[addr], WY65_MAP_PAGE_SIZE);
+            }
+        }
+    }
+
+    update_pages_mapped();
+    p_fork->update_pages_mapped();
+
+    if (!was_mapped && pages_mapped)
+    {
+        flush_blocks();
+    }
+
+    // Copy the settings and the CPU state. The pending events are set before
+    // the flags, which may make an active IRQ pending.
+    p_fork->fp           = fp_owned ? NULL : fp;
+    p_fork->nextPc       = nextPc;
+    p_fork->p_cycle_func = p_cycle_func;
+    p_fork->p_cycle_ctx  = p_cycle_ctx;
+    p_fork->idle_detect  = idle_detect;
+    p_fork->update_wr_hooks();
+    p_fork->engine       = engine;
+    p_fork->fuse_en      = fuse_en;
+    p_fork->instr_tbl    = instr_tbl;
+
+    memcpy(p_fork->rom_page,  rom_page,  sizeof(rom_page));
+    memcpy(p_fork->dis_fname, dis_fname, sizeof(dis_fname));
+
+    if (!fuse_all)
+    {
+        memcpy(p_fork->fuse_sel, fuse_sel, sizeof(fuse_sel));
+        p_fork->fuse_all = false;
+    }
+
+    p_fork->state        = state;
+    p_fork->reset_mode   = reset_mode.load();
+    p_fork->nirq_lines   = nirq_lines.load();
+    p_fork->pending      = pending.load() & (EVT_IRQ | EVT_NMI | EVT_RESET);
+    p_fork->set_flags(get_flags());
+
+    return p_fork;
+}
+
+// -------------------------------------------------------------------------
+// register_mem_funcs()
+//
+// Register external memory functions for use in memory read/write accesses,
+// to allow interfacing with external memory system. By default, internal
+// memory is accessed. If this function is used to set two external
+// functions all memory access will use these instead. The external
+// functions must be of type:
+//
+//   void <ExtWrFuncName> (int addr, unsigned char data)
+//   int  <ExtRdFuncName> (int addr)
+//
+// If the external application functions are not quite these types, then 
+// wrapper functions will need constructing. The types defined here were
+// chosen based on BeebEm's memory access functions. (see website at
+// http://www.mkw.me.uk/beebem).
+//
+// It is possible to override only one access method (not sure why anyone
+// would want to) by setting one or the other arguments to NULL.
+//
+// The functions may instead take a host context as their first argument,
+// registered with the functions as p_ctx, so that host state (such as
+// memory) need not be global:
+//
+//   void <ExtWrFuncName> (void* p_ctx, int addr, unsigned char data)
+//   int  <ExtRdFuncName> (void* p_ctx, int addr)
+//
+// -------------------------------------------------------------------------
+
+// LCOV_EXCL_START
+template <class BUS>
+void cpu6502_core<BUS>::register_mem_funcs (wy65_p_writemem_t p_wfunc, wy65_p_readmem_t p_rfunc)
+{
+    bus.register_funcs(p_wfunc, p_rfunc);
+
+    // Unmapped pages now use the bus, or internal memory
+    for (uint32_t page_num = 0; page_num < WY65_NUM_MAP_PAGES; page_num++)
+    {
+        if (page_unmapped(page_num))
+        {
+            set_unmapped_page(page_num);
+        }
+    }
+
+    // Cached decodes may be from the internal memory
+    invalidate_decode_cache();
+}
 // LCOV_EXCL_STOP
 
-#ifdef WY65_STANDALONE
+template <class BUS>
+void cpu6502_core<BUS>::register_mem_funcs (wy65_p_writemem_ctx_t p_wfunc, wy65_p_readmem_ctx_t p_rfunc, void* p_ctx)
+{
+    bus.register_funcs(p_wfunc, p_rfunc, p_ctx);
+
+    // Unmapped pages now use the bus, or internal memory
+    for (uint32_t page_num = 0; page_num < WY65_NUM_MAP_PAGES; page_num++)
+    {
+        if (page_unmapped(page_num))
+        {
+            set_unmapped_page(page_num);
+        }
+    }
+
+    // Cached decodes may be from the internal memory
+    invalidate_decode_cache();
+}
+
+// -------------------------------------------------------------------------
+// Instantiate the model for the default bus (cpu6502), and for the host bus
+// class WY65_BUS, if defined. The methods in the JIT, static recompilation
+// and program loading source files are instantiated in those files.
+// -------------------------------------------------------------------------
+
+template class cpu6502_core<wy65_cb_bus_t>;
+
+#ifdef WY65_BUS
+template class cpu6502_core<WY65_BUS>;
+#endif
+
+#ifdef WY65_STANDALONE
+
+#include <thread>
+#include <chrono>
+#include <vector>
+
+#include "cpu6502_fleet.h"
+#include "cpu6502_batch.h"
+
+// -------------------------------------------------------------------------
+// interrupt_test()
+//
+// Performs testing of IRQ and NMI interrupts
+//
+// -------------------------------------------------------------------------
+
+bool interrupt_test(cpu6502 &cpu, cpu_type_e mode_c, uint16_t start_addr)
+{
+    bool     error        = false;
+    uint16_t old_irq_vec;
+
+    // ------------------------------------
+    // NMI Interrupt test
+    // ------------------------------------
+
+    // Reset
+    cpu.reset(mode_c);
+
+    // Execute an instruction
+    wy65_exec_status_t status = cpu.execute();
+
+    // Check returned PC is within three of the reset vector
+    if (status.pc < start_addr || status.pc >= (start_addr+3))
+    {
+        error = true; // LCOV_EXCL_LINE
+    }
+    // Make sure that the flags have the interrupt bit set
+    else if (!(status.flags & INT_MASK))
+    {
+        error = true; // LCOV_EXCL_LINE
+    }
+
+    if (!error)
+    {
+        uint16_t nmi_addr = TEST_ADDR1;
+
+        // Remember the IRQ vector already programmed in memory
+        old_irq_vec  = cpu.rd_mem(IRQ_VEC_ADDR);
+        old_irq_vec |= cpu.rd_mem(IRQ_VEC_ADDR+1) << 8;
+
+        // Load the NMI vector with the user start location, if specified
+        cpu.wr_mem(NMI_VEC_ADDR,    nmi_addr       & MASK_8BIT);
+        cpu.wr_mem(NMI_VEC_ADDR+1, (nmi_addr >> 8) & MASK_8BIT);
+
+        // Load NMI address with a NOP
+        cpu.wr_mem(nmi_addr,    NOP_OPCODE_BASE); // Load a NOP opcode
+        cpu.wr_mem(nmi_addr+1,  CLI_OPCODE);      // Load a CLI opcode
+
+        // Raise an interrupt
+        cpu.nmi_interrupt();
+
+        // Execute an instruction
+        status = cpu.execute();
+
+        // Check returned PC is address after nmi_addr
+        if (status.pc != (nmi_addr+1))
+        {
+            error = true; // LCOV_EXCL_LINE
+        }
+        // Check that the flags has the interrupt bit set, but not the break flag
+        else if (((status.flags & INT_MASK) == 0) || (status.flags & BRK_MASK))
+        {
+            error = true; // LCOV_EXCL_LINE
+        }
+        else
+        {
+            // Execute next instruction (CLI)
+            status = cpu.execute();
+
+            // Check interrupt flag clear, ready for IRQ testing
+            if (status.flags & INT_MASK)
+            {
+                error = true; // LCOV_EXCL_LINE
+            }
+        }
+    }
+
+    // ------------------------------------
+    // IRQ Interrupt test
+    // ------------------------------------
+
+    if (!error)
+    {
+        uint16_t irq_addr = TEST_ADDR2;
+
+        // Load the IRQ vector with the user start location, if specified
+        cpu.wr_mem(IRQ_VEC_ADDR,    irq_addr       & MASK_8BIT);
+        cpu.wr_mem(IRQ_VEC_ADDR+1, (irq_addr >> 8) & MASK_8BIT);
+
+        // Load IRQ address with a NOP
+        cpu.wr_mem(irq_addr,    NOP_OPCODE_BASE);
+
+        // Activate an IRQ
+        cpu.activate_irq();
+
+        // Execute an instruction
+        status = cpu.execute();
+
+        // Remove active IRQ
+        cpu.deactivate_irq();
+
+        // Check PC is irq_addr + 1
+        if (status.pc != (irq_addr+1))
+        {
+            error = true; // LCOV_EXCL_LINE
+        }
+        // Check interrupt flag set
+        else if (!(status.flags & INT_MASK))
+        {
+            error = true; // LCOV_EXCL_LINE
+        }
+
+        // Restore IRQ vector (for BRK instruction testing in main test)
+        cpu.wr_mem(IRQ_VEC_ADDR,    old_irq_vec       & MASK_8BIT);
+        cpu.wr_mem(IRQ_VEC_ADDR+1, (old_irq_vec >> 8) & MASK_8BIT);
+    }
+
+    return error;
+}
+
+// -------------------------------------------------------------------------
+// wait_stop_tests()
+//
+// Performs testing of WAI and STP instructions
+//
+// -------------------------------------------------------------------------
+
+bool wait_stop_tests(cpu6502 &cpu, uint16_t start_addr)
+{
+
+    wy65_exec_status_t status;
+    uint16_t           irq_vec;
+    uint16_t           nmi_vec;
+    bool               error        = false;
+
+    // ------------------------------------
+    // WAI test 
+    // ------------------------------------
+
+    // Get the IRQ vector already programmed in memory
+    irq_vec  = cpu.rd_mem(IRQ_VEC_ADDR);
+    irq_vec |= cpu.rd_mem(IRQ_VEC_ADDR+1) << 8;
+
+	// Update reset vector
+    uint16_t rst_addr = TEST_ADDR1;
+    cpu.wr_mem(RESET_VEC_ADDR,    rst_addr       & MASK_8BIT);
+    cpu.wr_mem(RESET_VEC_ADDR+1, (rst_addr >> 8) & MASK_8BIT);
+
+    // Program at rst_addr: WAI CLI WAI NOP
+    cpu.wr_mem(rst_addr,    WAI_OPCODE);
+    cpu.wr_mem(rst_addr+1,  CLI_OPCODE);
+    cpu.wr_mem(rst_addr+2,  WAI_OPCODE);
+    cpu.wr_mem(rst_addr+3,  NOP_OPCODE_BASE);
+
+    cpu.reset();
+
+	// Execute WAI (I is set)
+    status = cpu.execute();
+
+	// Check pc = rst_addr, and cycles != 0 --- i.e. now waiting (for the first time)
+	if (status.pc != rst_addr || status.cycles == 0)
+	{
+        error = true; // LCOV_EXCL_LINE
+	}
+	else
+	{
+	    // Execute WAI (I is set)
+        status = cpu.execute();
+    
+	    // Check pc = rst_addr, and cycles == 0 --- i.e. still waiting (not for the first time)
+	    if (status.pc != rst_addr || status.cycles != 0)
+	    {
+            error = true; // LCOV_EXCL_LINE
+	    }
+	}
+
+    // Test IRQ when waiting with I bit set
+    if (!error)
+    {
+        // Activate an interrupt (but I still set)
+        cpu.activate_irq();
+
+        // Execute WAI for a third time
+        status = cpu.execute();
+
+        // Deactivate IRQ
+        cpu.deactivate_irq();
+
+        // Check pc = rst_addr+1, and cycles != 0
+	    if (status.pc != rst_addr+1 || status.cycles != 0)
+	    {
+            error = true; // LCOV_EXCL_LINE
+	    }
+    }
+    
+    // Clear I flag and get to next WAI instruction, which then waits
+    if (!error)
+    {
+        // Execute CLI instruction
+        status = cpu.execute();
+
+        // Execute second WAI
+        status = cpu.execute();
+
+        // Check pc = rst_addr+2, count != 0
+        if (status.pc != rst_addr+2 || status.cycles == 0)
+        {
+            error = true;  // LCOV_EXCL_LINE
+        }
+        else
+        {
+            // Execute WAI again
+            status = cpu.execute();
+            // Check pc = rst_addr+2, count != 0
+            if (status.pc != rst_addr+2 || status.cycles != 0)
+            {
+                error = true;  // LCOV_EXCL_LINE
+            }
+        }
+    }
+
+    // Test IRQ when waiting with I bit clear
+    if (!error)
+    {
+        // Activate an interrupt (but I now clear)
+        cpu.activate_irq();
+
+        // Execute
+        status = cpu.execute();
+
+        // Check pc = irq_vec+1, count != 0
+        if (status.pc != irq_vec+1 || status.cycles == 0)
+        {
+            error = true;  // LCOV_EXCL_LINE
+        }
+    }
+
+    // Test NMI when waiting
+
+    nmi_vec  = TEST_ADDR3;
+
+    // Load the NMI vector
+    cpu.wr_mem(NMI_VEC_ADDR,    nmi_vec       & MASK_8BIT);
+    cpu.wr_mem(NMI_VEC_ADDR+1, (nmi_vec >> 8) & MASK_8BIT);
+
+    if (!error)
+    {
+        // Reset one more
+        cpu.reset();
+
+        // Execute WAI 
+        status = cpu.execute();
+
+        // Check pc = rst_addr, count != 0
+        if (status.pc != rst_addr || status.cycles == 0)
+        {
+            error = true;  // LCOV_EXCL_LINE
+        }
+        else
+        {
+            // Execute WAI again
+            status = cpu.execute();
+
+            // Check pc = rst_addr, count == 0
+            if (status.pc != rst_addr || status.cycles != 0)
+            {
+                error = true;  // LCOV_EXCL_LINE
+            }
+        }
+
+        if (!error)
+        {
+            // Activate an NMI
+            cpu.nmi_interrupt();
+            
+            // Execute
+            status = cpu.execute();
+            
+            // Check pc = nmi_vec+1, count != 0
+            if (status.pc != nmi_vec+1 || status.cycles == 0)
+            {
+                error = true;  // LCOV_EXCL_LINE
+            }
+        }
+    }
+
+    // ------------------------------------
+    // STP test
+    // ------------------------------------
+
+    if (!error)
+    {
+        // Update reset vector
+        uint16_t rst_addr = TEST_ADDR1;
+        cpu.wr_mem(RESET_VEC_ADDR,    rst_addr       & MASK_8BIT);
+        cpu.wr_mem(RESET_VEC_ADDR+1, (rst_addr >> 8) & MASK_8BIT);
+
+        // Program at rst_addr: CLI STP NOP
+        cpu.wr_mem(rst_addr,    CLI_OPCODE);
+        cpu.wr_mem(rst_addr+1,  STP_OPCODE);
+        cpu.wr_mem(rst_addr+2,  NOP_OPCODE_BASE);
+
+        cpu.reset();
+
+        // Execute CLI
+        status = cpu.execute();
+
+        // Execute STP
+        status = cpu.execute();
+
+        // Check pc = rst_addr+1, and cycles != 0
+	    if (status.pc != rst_addr+1 || status.cycles == 0)
+	    {
+            error = true; // LCOV_EXCL_LINE
+	    }
+        else
+        {
+            // Execute again
+            status = cpu.execute();
+
+            // Check pc = rst_addr+1, and cycles == 0
+	        if (status.pc != rst_addr+1 || status.cycles != 0)
+	        {
+                error = true; // LCOV_EXCL_LINE
+	        }
+        }
+
+        // Chekc IRQs ignored when stopped, even when I bit clear
+        if (!error)
+        {
+            // Raise interrupt (I is clear)
+            cpu.activate_irq();
+
+            // Execute again
+            status = cpu.execute();
+
+            // Deactivate IRQ
+            cpu.deactivate_irq();
+
+            // Check pc = rst_addr+1, and cycles == 0 -- i.e. Still stopped
+	        if (status.pc != rst_addr+1 || status.cycles != 0)
+	        {
+                error = true; // LCOV_EXCL_LINE
+	        }
+        }
+
+        // Restore reset vector
+        cpu.wr_mem(RESET_VEC_ADDR,    start_addr       & MASK_8BIT);
+        cpu.wr_mem(RESET_VEC_ADDR+1, (start_addr >> 8) & MASK_8BIT);
+    }
+
+    return error;
+}
+
+// -------------------------------------------------------------------------
+// mem_map_test()
+//
+// Checks accesses to pages mapped to host RAM, write protected host ROM and
+// device handlers (with and without a context), for both data accesses and
+// code executed from mapped pages. The pages are unmapped afterwards. Also
+// checks two models with memory functions accessing their own host memory
+// via a context.
+//
+// -------------------------------------------------------------------------
+
+// Device handlers without a context can only record accesses in file scope state
+static int     map_test_io;
+
+static void map_test_wr (int addr, unsigned char data) { map_test_io = (addr << 8) | data; }
+static int  map_test_rd (int addr) { return addr & MASK_8BIT; }
+
+static void map_test_ctx_wr (void* p_ctx, int addr, unsigned char data) { ((uint8_t*)p_ctx)[addr & MASK_16BIT] = data; }
+static int  map_test_ctx_rd (void* p_ctx, int addr) { return ((uint8_t*)p_ctx)[addr & MASK_16BIT]; }
+
+bool mem_map_test(cpu6502 &cpu)
+{
+    bool        error    = false;
+    wy65_reg_t* p_regs   = cpu.sr_regs();
+    uint16_t    ram_addr = TEST_MAP_ADDR;
+    uint16_t    rom_addr = TEST_MAP_ADDR + WY65_MAP_PAGE_SIZE;
+    uint16_t    io_addr  = TEST_MAP_ADDR + 2*WY65_MAP_PAGE_SIZE;
+    uint16_t    ctx_addr = TEST_MAP_ADDR + 3*WY65_MAP_PAGE_SIZE;
+    uint8_t*    p_mem[2] = {new uint8_t[WY65_ADDR_SPACE_SIZE], new uint8_t[WY65_ADDR_SPACE_SIZE]};
+    uint8_t     map_test_ram [WY65_MAP_PAGE_SIZE];
+    uint8_t     map_test_rom [WY65_MAP_PAGE_SIZE];
+
+    memset(map_test_ram, 0, sizeof(map_test_ram));
+    memset(map_test_rom, 0, sizeof(map_test_rom));
+    map_test_rom[0x07] = 0x5a;
+    map_test_io        = 0;
+
+    cpu.map_mem_pages(ram_addr, WY65_MAP_PAGE_SIZE, map_test_ram, map_test_ram);
+    cpu.map_mem_pages(rom_addr, WY65_MAP_PAGE_SIZE, map_test_rom, NULL);
+    cpu.map_io_pages (io_addr,  WY65_MAP_PAGE_SIZE, map_test_wr,  map_test_rd);
+    cpu.map_io_pages (ctx_addr, WY65_MAP_PAGE_SIZE, map_test_ctx_wr, map_test_ctx_rd, p_mem[0]);
+
+    // Program in the RAM page: LDA rom_addr+7; STA io_addr+0x10; STA rom_addr+8; STA ctx_addr+0x20
+    uint8_t prog[] = {LDA_ABS_OPCODE, 0x07, (uint8_t)(rom_addr >> 8),
+                      STA_ABS_OPCODE, 0x10, (uint8_t)(io_addr  >> 8),
+                      STA_ABS_OPCODE, 0x08, (uint8_t)(rom_addr >> 8),
+                      STA_ABS_OPCODE, 0x20, (uint8_t)(ctx_addr >> 8)};
+
+    for (uint32_t idx = 0; idx < sizeof(prog); idx++)
+    {
+        cpu.wr_mem(ram_addr + idx, prog[idx]);
+    }
+
+    if (memcmp(map_test_ram, prog, sizeof(prog)) || cpu.rd_mem(ram_addr + 1) != 0x07)
+    {
+        error = true; // LCOV_EXCL_LINE
+    }
+
+    if (!error)
+    {
+        p_regs->pc = ram_addr;
+
+        for (uint32_t idx = 0; idx < sizeof(prog)/3; idx++)
+        {
+            cpu.execute();
+        }
+
+        if (p_regs->a != 0x5a || map_test_rom[0x08] != 0 || map_test_io != (((io_addr + 0x10) << 8) | 0x5a) ||
+            cpu.rd_mem(io_addr + 0x34) != 0x34 || p_regs->pc != ram_addr + sizeof(prog) ||
+            p_mem[0][ctx_addr + 0x20] != 0x5a || cpu.rd_mem(ctx_addr + 0x20) != 0x5a)
+        {
+            error = true; // LCOV_EXCL_LINE
+        }
+    }
+
+    cpu.unmap_pages(TEST_MAP_ADDR, 4*WY65_MAP_PAGE_SIZE);
+
+    // Unmapped pages access internal memory again
+    cpu.wr_mem(rom_addr + 7, 0xa5);
+
+    if (map_test_rom[0x07] != 0x5a || cpu.rd_mem(rom_addr + 7) != 0xa5)
+    {
+        error = true; // LCOV_EXCL_LINE
+    }
+
+    // Two models, each with memory functions accessing their own memory
+    for (int idx = 0; idx < 2 && !error; idx++)
+    {
+        cpu6502* p_cpu = new cpu6502;
+
+        p_cpu->register_mem_funcs(map_test_ctx_wr, map_test_ctx_rd, p_mem[idx]);
+
+        // Program: LDA #idx; STA TEST_ADDR3
+        p_cpu->wr_mem(TEST_ADDR3,   LDA_IMM_OPCODE);
+        p_cpu->wr_mem(TEST_ADDR3+1, idx);
+        p_cpu->wr_mem(TEST_ADDR3+2, STA_ABS_OPCODE);
+        p_cpu->wr_mem(TEST_ADDR3+3, TEST_ADDR3 & MASK_8BIT);
+        p_cpu->wr_mem(TEST_ADDR3+4, TEST_ADDR3 >> 8);
+
+        p_cpu->sr_regs()->pc = TEST_ADDR3;
+        p_cpu->execute();
+        p_cpu->execute();
+
+        if (p_mem[idx][TEST_ADDR3] != idx || p_mem[idx][TEST_ADDR3+1] != idx)
+        {
+            error = true; // LCOV_EXCL_LINE
+        }
+
+        delete p_cpu;
+    }
+
+    delete [] p_mem[0];
+    delete [] p_mem[1];
+
+    return error;
+}
+
+// -------------------------------------------------------------------------
+// idle_test()
+//
+// Checks idle loop detection for each engine: a loop polling unchanged
+// memory, and one calling a subroutine, are idle and skipped to the cycle
+// budget, whilst one incrementing a memory location is not. For CPU
+// variants with WAI, waiting consumes the rest of the cycle budget.
+//
+// -------------------------------------------------------------------------
+
+bool idle_test(cpu6502 &cpu, cpu_type_e mode_c, engine_type_e engine)
+{
+    bool              error   = false;
+    wy65_reg_t*       p_regs  = cpu.sr_regs();
+    wy65_run_status_t status;
+    const uint64_t    budget  = 10000;
+
+    // Programs: polling loop, loop making progress, loop calling a subroutine, and WAI
+    const uint16_t    poll    = TEST_IDLE_ADDR;
+    const uint16_t    incr    = TEST_IDLE_ADDR + 0x10;
+    const uint16_t    call    = TEST_IDLE_ADDR + 0x20;
+    const uint16_t    wait    = TEST_IDLE_ADDR + 0x30;
+    const uint8_t     hi      = TEST_IDLE_ADDR >> 8;
+    const uint8_t     prog[]  = {LDA_ABS_OPCODE, 0xf0, hi, BEQ_OPCODE, 0xfb, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                 INC_ABS_OPCODE, 0xf1, hi, LDA_ABS_OPCODE, 0xf0, hi, BEQ_OPCODE, 0xf8, 0, 0, 0, 0, 0, 0, 0, 0,
+                                 JSR_OPCODE, 0x28, hi, BCC_OPCODE, 0xfb, 0, 0, 0, CLC_OPCODE, RTS_OPCODE, 0, 0, 0, 0, 0, 0,
+                                 CLI_OPCODE, WAI_OPCODE};
+
+    for (uint32_t idx = 0; idx < sizeof(prog); idx++)
+    {
+        cpu.wr_mem(TEST_IDLE_ADDR + idx, prog[idx]);
+    }
+
+    cpu.wr_mem(TEST_IDLE_ADDR + 0xf0, 0);
+
+    // Clear any waiting or stopped state from previous tests
+    cpu.reset(mode_c);
+
+    const engine_type_e engines[] = {ENGINE_INTERP, ENGINE_THREADED, ENGINE_BLOCK, ENGINE_JIT, ENGINE_CYCLE};
+
+    cpu.enable_idle_detect();
+
+    for (uint32_t idx = 0; idx < sizeof(engines)/sizeof(engines[0]) && !error; idx++)
+    {
+        cpu.set_engine(engines[idx]);
+
+        p_regs->pc = poll;
+        status     = cpu.run(WY65_NO_LIMIT, budget);
+
+        if (status.stop_reason != STOP_IDLE || status.pc != poll || status.cycles > budget || status.cycles <= budget - 16)
+        {
+            error = true; // LCOV_EXCL_LINE
+        }
+
+        p_regs->pc = poll;
+        status     = cpu.run();
+
+        if (status.stop_reason != STOP_IDLE || status.instructions > 16)
+        {
+            error = true; // LCOV_EXCL_LINE
+        }
+
+        p_regs->pc = incr;
+        status     = cpu.run(WY65_NO_LIMIT, budget);
+
+        if (status.stop_reason != STOP_CYCLE_BUDGET)
+        {
+            error = true; // LCOV_EXCL_LINE
+        }
+
+        p_regs->pc = call;
+        status     = cpu.run(WY65_NO_LIMIT, budget);
+
+        if (status.stop_reason != STOP_IDLE || status.cycles > budget || status.cycles <= budget - 32)
+        {
+            error = true; // LCOV_EXCL_LINE
+        }
+
+        if (mode_c >= WDC)
+        {
+            p_regs->pc = wait;
+            status     = cpu.run(WY65_NO_LIMIT, budget);
+
+            cpu.reset(mode_c);
+
+            if (status.stop_reason != STOP_WAITING || status.cycles != budget)
+            {
+                error = true; // LCOV_EXCL_LINE
+            }
+        }
+    }
+
+    cpu.enable_idle_detect(false);
+    cpu.set_engine(engine);
+
+    return error;
+}
+
+// -------------------------------------------------------------------------
+// run_until_test()
+//
+// Checks run_until() for each engine, with a loop incrementing a memory
+// location until it wraps to zero: stopping on a memory value, on a PC in
+// the middle of the loop, on a PC after the loop (with a memory condition
+// that isn't met), and on an instruction budget. The conditions must not
+// persist into a subsequent run(). Also checks stopping on a PC which is the
+// second instruction of a fused pair (a DEX/BNE loop).
+//
+// -------------------------------------------------------------------------
+
+bool run_until_test(cpu6502 &cpu, cpu_type_e mode_c, engine_type_e engine)
+{
+    bool              error   = false;
+    wy65_reg_t*       p_regs  = cpu.sr_regs();
+    wy65_run_status_t status;
+    wy65_run_until_t  cond;
+
+    // Program: loop incrementing count until zero, then jump to self
+    const uint16_t    count   = TEST_UNTIL_ADDR + 0xf0;
+    const uint16_t    done    = TEST_UNTIL_ADDR + 8;
+    const uint8_t     hi      = TEST_UNTIL_ADDR >> 8;
+    const uint8_t     prog[]  = {INC_ABS_OPCODE, 0xf0, hi, LDA_ABS_OPCODE, 0xf0, hi, BNE_OPCODE, 0xf8,
+                                 JMP_ABS_OPCODE, done & MASK_8BIT, hi};
+
+    // Program: loop decrementing X from 5 until zero, then jump to self
+    const uint16_t    loop2   = TEST_UNTIL_ADDR + 0x10;
+    const uint16_t    done2   = loop2 + 5;
+    const uint8_t     prog2[] = {LDX_IMM_OPCODE, 5, DEX_OPCODE, BNE_OPCODE, 0xfd,
+                                 JMP_ABS_OPCODE, done2 & MASK_8BIT, hi};
+
+    for (uint32_t idx = 0; idx < sizeof(prog); idx++)
+    {
+        cpu.wr_mem(TEST_UNTIL_ADDR + idx, prog[idx]);
+    }
+
+    for (uint32_t idx = 0; idx < sizeof(prog2); idx++)
+    {
+        cpu.wr_mem(loop2 + idx, prog2[idx]);
+    }
+
+    cpu.reset(mode_c);
+
+    const engine_type_e engines[] = {ENGINE_INTERP, ENGINE_THREADED, ENGINE_BLOCK, ENGINE_JIT, ENGINE_CYCLE};
+
+    for (uint32_t idx = 0; idx < sizeof(engines)/sizeof(engines[0]) && !error; idx++)
+    {
+        cpu.set_engine(engines[idx]);
+
+        // Stop on count reaching 0x20
+        memset(&cond, 0, sizeof(cond));
+        cond.max_instructions = WY65_NO_LIMIT;
+        cond.max_cycles       = WY65_NO_LIMIT;
+        cond.stop_on_mem      = true;
+        cond.mem_addr         = count;
+        cond.mem_value        = 0x20;
+
+        cpu.wr_mem(count, 0);
+        cpu.wr_mem(count + 1, 0);
+        p_regs->pc = TEST_UNTIL_ADDR;
+        status     = cpu.run_until(cond);
+
+        if (status.stop_reason != STOP_MEM || cpu.rd_mem(count) != 0x20 || status.instructions > 0x20 * 3)
+        {
+            error = true; // LCOV_EXCL_LINE
+        }
+
+        // Stop on the PC reaching the LDA, part way through the loop
+        memset(&cond, 0, sizeof(cond));
+        cond.max_instructions = WY65_NO_LIMIT;
+        cond.max_cycles       = WY65_NO_LIMIT;
+        cond.stop_on_pc       = true;
+        cond.pc               = TEST_UNTIL_ADDR + 3;
+
+        p_regs->pc = TEST_UNTIL_ADDR;
+        status     = cpu.run_until(cond);
+
+        if (status.stop_reason != STOP_PC || status.pc != TEST_UNTIL_ADDR + 3 || status.instructions != 1)
+        {
+            error = true; // LCOV_EXCL_LINE
+        }
+
+        // Stop on the PC leaving the loop, before a 16 bit memory value is reached
+        cond.pc               = done;
+        cond.stop_on_mem      = true;
+        cond.mem_word         = true;
+        cond.mem_addr         = count;
+        cond.mem_value        = 0x0100;
+
+        cpu.wr_mem(count, 0xfe);
+        p_regs->pc = TEST_UNTIL_ADDR;
+        status     = cpu.run_until(cond);
+
+        if (status.stop_reason != STOP_PC || status.pc != done || status.instructions != 6)
+        {
+            error = true; // LCOV_EXCL_LINE
+        }
+
+        // Stop on the instruction budget
+        memset(&cond, 0, sizeof(cond));
+        cond.max_instructions = 10;
+        cond.max_cycles       = WY65_NO_LIMIT;
+
+        p_regs->pc = TEST_UNTIL_ADDR;
+        status     = cpu.run_until(cond);
+
+        if (status.stop_reason != STOP_INSTR_BUDGET || status.instructions != 10)
+        {
+            error = true; // LCOV_EXCL_LINE
+        }
+
+        // Stop on the PC reaching the BNE, which would otherwise be fused with the DEX
+        memset(&cond, 0, sizeof(cond));
+        cond.max_instructions = WY65_NO_LIMIT;
+        cond.max_cycles       = WY65_NO_LIMIT;
+        cond.stop_on_pc       = true;
+        cond.pc               = loop2 + 3;
+
+        p_regs->pc = loop2;
+        status     = cpu.run_until(cond);
+
+        if (status.stop_reason != STOP_PC || status.pc != loop2 + 3 || status.instructions != 2 || p_regs->x != 4)
+        {
+            error = true; // LCOV_EXCL_LINE
+        }
+
+        // Conditions no longer apply, so the loop runs to the jump to self
+        cpu.wr_mem(count, 0);
+        p_regs->pc = TEST_UNTIL_ADDR;
+        status     = cpu.run();
+
+        if (status.stop_reason != STOP_SELF_LOOP || status.pc != done || cpu.rd_mem(count) != 0)
+        {
+            error = true; // LCOV_EXCL_LINE
+        }
+    }
+
+    cpu.set_engine(engine);
+
+    return error;
+}
+
+// -------------------------------------------------------------------------
+// cycle_test()
+//
+// Checks the bus cycles made by the cycle exact engine, for the base 6502
+// and the 65C02: a read-modify-write's dummy write (or read), an indexed
+// read's dummy read on crossing a page, and the JSR and RTS stack
+// sequences. Also checks the bus cycles of an IRQ.
+//
+// -------------------------------------------------------------------------
+
+typedef struct
+{
+    wy65_bus_cycle_t cycles[TEST_CYCLE_LOG_SIZE];
+    uint32_t         num;
+} cycle_test_log_t;
+
+static void cycle_test_log (void* p_ctx, const wy65_bus_cycle_t* p_cycle)
+{
+    cycle_test_log_t* p_log = (cycle_test_log_t*)p_ctx;
+
+    if (p_log->num < TEST_CYCLE_LOG_SIZE)
+    {
+        p_log->cycles[p_log->num++] = *p_cycle;
+    }
+}
+
+bool cycle_test(cpu6502 &cpu, cpu_type_e mode_c, engine_type_e engine)
+{
+    bool              error   = false;
+    wy65_reg_t*       p_regs  = cpu.sr_regs();
+    wy65_run_status_t status;
+    cycle_test_log_t  log;
+
+    // Program: LDX #1; INC count; LDA page_end,X; JSR sub; JMP *; ...; sub: RTS
+    const uint8_t     hi      = TEST_CYCLE_ADDR >> 8;
+    const uint16_t    count   = TEST_CYCLE_ADDR + 0xf0;
+    const uint16_t    sub     = TEST_CYCLE_ADDR + 0x10;
+    const uint8_t     prog[]  = {LDX_IMM_OPCODE, 0x01, INC_ABS_OPCODE, 0xf0, hi, LDA_ABX_OPCODE, 0xff, hi,
+                                 JSR_OPCODE, 0x10, hi, JMP_ABS_OPCODE, 0x0b, hi};
+
+    // Expected bus cycles, by address and type, for the base 6502. Entries 6 and 11 differ for the 65C02.
+    const uint16_t    addrs[] = {0xe600, 0xe601,
+                                 0xe602, 0xe603, 0xe604, 0xe6f0, 0xe6f0, 0xe6f0,
+                                 0xe605, 0xe606, 0xe607, 0xe600, 0xe700,
+                                 0xe608, 0xe609, 0x01ff, 0x01ff, 0x01fe, 0xe60a,
+                                 0xe610, 0xe611, 0x01fd, 0x01fe, 0x01ff, 0xe60a,
+                                 0xe60b, 0xe60c, 0xe60d};
+    const bus_cycle_e types[] = {BUS_OPCODE, BUS_READ,
+                                 BUS_OPCODE, BUS_READ, BUS_READ, BUS_READ, BUS_DUMMY_WRITE, BUS_WRITE,
+                                 BUS_OPCODE, BUS_READ, BUS_READ, BUS_DUMMY_READ, BUS_READ,
+                                 BUS_OPCODE, BUS_READ, BUS_DUMMY_READ, BUS_WRITE, BUS_WRITE, BUS_READ,
+                                 BUS_OPCODE, BUS_DUMMY_READ, BUS_DUMMY_READ, BUS_READ, BUS_READ, BUS_DUMMY_READ,
+                                 BUS_OPCODE, BUS_READ, BUS_READ};
+    const uint32_t    num_cycles = sizeof(addrs)/sizeof(addrs[0]);
+
+    for (uint32_t idx = 0; idx < sizeof(prog); idx++)
+    {
+        cpu.wr_mem(TEST_CYCLE_ADDR + idx, prog[idx]);
+    }
+
+    cpu.wr_mem(sub, RTS_OPCODE);
+
+    cpu.set_engine(ENGINE_CYCLE);
+    cpu.register_bus_cycle_func(cycle_test_log, &log);
+
+    for (uint32_t cmos = 0; cmos < 2 && !error; cmos++)
+    {
+        cpu.reset(cmos ? WDC : BASE);
+        cpu.wr_mem(count, 0x41);
+
+        p_regs->pc = TEST_CYCLE_ADDR;
+        p_regs->sp = 0xff;
+        log.num    = 0;
+        status     = cpu.run();
+
+        if (status.stop_reason != STOP_SELF_LOOP || status.instructions != 6 || status.cycles != num_cycles || log.num != num_cycles)
+        {
+            error = true; // LCOV_EXCL_LINE
+        }
+
+        for (uint32_t idx = 0; idx < log.num && !error; idx++)
+        {
+            uint16_t    addr = (cmos && idx == 11) ? 0xe607 : addrs[idx];
+            bus_cycle_e type = (cmos && idx == 6)  ? BUS_DUMMY_READ : types[idx];
+
+            if (log.cycles[idx].cycle != idx || log.cycles[idx].addr != addr || log.cycles[idx].type != type)
+            {
+                error = true; // LCOV_EXCL_LINE
+            }
+        }
+
+        // Check the data of the read-modify-write and the pushed return address
+        if (!error && (log.cycles[6].data != 0x41 || log.cycles[7].data != 0x42 ||
+                       log.cycles[16].data != hi  || log.cycles[17].data != 0x0a))
+        {
+            error = true; // LCOV_EXCL_LINE
+        }
+
+        // An IRQ makes two dummy reads at the PC, three pushes and two vector reads
+        p_regs->flags &= ~INT_MASK;
+        log.num        = 0;
+
+        cpu.activate_irq();
+        cpu.execute();
+        cpu.deactivate_irq();
+
+        if (log.num != IRQ_CYCLES || log.cycles[1].addr != 0xe60b || log.cycles[1].type != BUS_DUMMY_READ ||
+            log.cycles[4].addr != 0x01fd || log.cycles[4].type != BUS_WRITE || log.cycles[6].addr != IRQ_VEC_ADDR + 1)
+        {
+            error = true; // LCOV_EXCL_LINE
+        }
+    }
+
+    cpu.register_bus_cycle_func(NULL);
+    cpu.set_engine(engine);
+    cpu.reset(mode_c);
+
+    return error;
+}
+
+// -------------------------------------------------------------------------
+// zp_wrap_test()
+//
+// Checks, for each engine, that indirect addressing with a zero page
+// pointer at 0xff reads the pointer's high byte from 0x00 and not 0x100,
+// for (zp,X), (zp),Y and (for the 65C02) (zp) modes.
+//
+// -------------------------------------------------------------------------
+
+bool zp_wrap_test(cpu_type_e mode_c)
+{
+    bool    error = false;
+    bool    cmos  = mode_c != BASE;
+
+    const uint8_t prog[] = {
+        0xa2, 0x01,                                                        // LDX #1
+        0xa9, 0x5a,                                                        // LDA #$5A
+        0x81, 0xfe,                                                        // STA ($FE,X)
+        0xa0, 0x01,                                                        // LDY #1
+        0xb1, 0xff,                                                        // LDA ($FF),Y
+        0x85, 0x10,                                                        // STA $10
+        (uint8_t)(cmos ? 0xb2 : 0xea), (uint8_t)(cmos ? 0xff : 0xea),      // LDA ($FF) (or NOPs)
+        0x85, 0x11,                                                        // STA $11
+        JMP_ABS_OPCODE, (TEST_WRAP_ADDR+16) & MASK_8BIT, (TEST_WRAP_ADDR+16) >> 8}; // JMP *
+
+    const engine_type_e engines[] = {ENGINE_INTERP, ENGINE_THREADED, ENGINE_BLOCK, ENGINE_JIT, ENGINE_CYCLE};
+
+    for (uint32_t idx = 0; idx < sizeof(engines)/sizeof(engines[0]) && !error; idx++)
+    {
+        cpu6502* p_cpu = new cpu6502;
+
+        p_cpu->load_mem(NULL);
+        p_cpu->load_mem(prog, sizeof(prog), TEST_WRAP_ADDR);
+
+        // Pointer at 0xff to 0x3000 when wrapped, and 0x4000 if not
+        p_cpu->wr_mem(0x00ff, 0x00);
+        p_cpu->wr_mem(0x0000, 0x30);
+        p_cpu->wr_mem(0x0100, 0x40);
+        p_cpu->wr_mem(0x3001, 0xa5);
+        p_cpu->wr_mem(0x4001, 0x11);
+        p_cpu->wr_mem(RESET_VEC_ADDR,   TEST_WRAP_ADDR & MASK_8BIT);
+        p_cpu->wr_mem(RESET_VEC_ADDR+1, TEST_WRAP_ADDR >> 8);
+
+        p_cpu->set_engine(engines[idx]);
+        p_cpu->reset(mode_c);
+        p_cpu->run(100);
+
+        if (p_cpu->rd_mem(0x3000) != 0x5a || p_cpu->rd_mem(0x4000) != 0x00 || p_cpu->rd_mem(0x10) != 0xa5 ||
+            (cmos && p_cpu->rd_mem(0x11) != 0x5a))
+        {
+            error = true; // LCOV_EXCL_LINE
+        }
+
+        delete p_cpu;
+    }
+
+    return error;
+}
+
+// -------------------------------------------------------------------------
+// unsupported_test()
+//
+// Checks, for each CPU variant and engine, the PC advance of the Rockwell
+// bit instructions BBR0 (0x0F) and RMB0 (0x07), where unsupported. The
+// NMOS 6502 skips their operand bytes, and other 65C02s execute them as
+// single byte NOPs. X counts the INX opcodes executed, which are also the
+// operands of the instructions, with bit 0 at $E8 set so that BBR0 does
+// not branch.
+//
+// -------------------------------------------------------------------------
+
+bool unsupported_test(void)
+{
+    bool    error = false;
+
+    static const uint8_t prog[] = {
+        0xa2, 0x00,                                                        // LDX #0
+        0x0f, 0xe8, 0xe8,                                                  // BBR0 $E8,* (or NOP/INX/INX)
+        0x07, 0xe8,                                                        // RMB0 $E8   (or NOP/INX)
+        0xe8,                                                              // INX
+        JMP_ABS_OPCODE, (TEST_UNSUP_ADDR+8) & MASK_8BIT, (TEST_UNSUP_ADDR+8) >> 8}; // JMP *
+
+    const cpu_type_e    variants[] = {BASE, C02, WRK, WDC};
+    const engine_type_e engines[]  = {ENGINE_INTERP, ENGINE_THREADED, ENGINE_BLOCK, ENGINE_JIT, ENGINE_CYCLE};
+
+    for (uint32_t vdx = 0; vdx < sizeof(variants)/sizeof(variants[0]) && !error; vdx++)
+    {
+        for (uint32_t idx = 0; idx < sizeof(engines)/sizeof(engines[0]) && !error; idx++)
+        {
+            cpu6502*   p_cpu = new cpu6502;
+            wy65_reg_t regs;
+
+            p_cpu->load_mem(NULL);
+            p_cpu->load_mem(prog, sizeof(prog), TEST_UNSUP_ADDR);
+
+            p_cpu->wr_mem(0x00e8, 0x01);
+            p_cpu->wr_mem(RESET_VEC_ADDR,   TEST_UNSUP_ADDR & MASK_8BIT);
+            p_cpu->wr_mem(RESET_VEC_ADDR+1, TEST_UNSUP_ADDR >> 8);
+
+            p_cpu->set_engine(engines[idx]);
+            p_cpu->reset(variants[vdx]);
+            p_cpu->run(100);
+            p_cpu->get_regs(regs);
+
+            if (regs.x != ((variants[vdx] == C02) ? 4 : 1) || p_cpu->rd_mem(0x00e8) != ((variants[vdx] >= WRK) ? 0x00 : 0x01) ||
+                regs.pc != TEST_UNSUP_ADDR+8)
+            {
+                error = true; // LCOV_EXCL_LINE
+            }
+
+            delete p_cpu;
+        }
+    }
+
+    return error;
+}
+
+// -------------------------------------------------------------------------
+// event_test()
+//
+// Checks, for each engine, that events pending at instruction boundaries
+// are taken: an IRQ held whilst the I flag is set, taken once an RTI
+// clears it, a latched NMI and a requested reset.
+//
+// -------------------------------------------------------------------------
+
+bool event_test(cpu6502 &cpu, cpu_type_e mode_c, engine_type_e engine)
+{
+    bool              error   = false;
+    wy65_reg_t*       p_regs  = cpu.sr_regs();
+    wy65_run_status_t status;
+    uint16_t          vecs[3];
+
+    // Program: push a return address and flags with I clear, and RTI to a jump to self
+    const uint8_t     hi      = TEST_EVENT_ADDR >> 8;
+    const uint16_t    rtn     = TEST_EVENT_ADDR + 0x80;
+    const uint16_t    irq     = TEST_EVENT_ADDR + 0x90;
+    const uint16_t    nmi     = TEST_EVENT_ADDR + 0xa0;
+    const uint16_t    rst     = TEST_EVENT_ADDR + 0xb0;
+    const uint16_t    vec[3]  = {IRQ_VEC_ADDR, NMI_VEC_ADDR, RESET_VEC_ADDR};
+    const uint8_t     prog[]  = {LDA_IMM_OPCODE, hi, PHA_OPCODE, LDA_IMM_OPCODE, rtn & MASK_8BIT, PHA_OPCODE,
+                                 LDA_IMM_OPCODE, 0x00, PHA_OPCODE, RTI_OPCODE};
+
+    for (uint32_t idx = 0; idx < sizeof(prog); idx++)
+    {
+        cpu.wr_mem(TEST_EVENT_ADDR + idx, prog[idx]);
+    }
+
+    // Jumps to self at the return address and each vector's handler
+    const uint16_t    loops[4] = {rtn, irq, nmi, rst};
+
+    for (uint32_t idx = 0; idx < 4; idx++)
+    {
+        cpu.wr_mem(loops[idx],     JMP_ABS_OPCODE);
+        cpu.wr_mem(loops[idx] + 1, loops[idx] & MASK_8BIT);
+        cpu.wr_mem(loops[idx] + 2, hi);
+    }
+
+    for (uint32_t idx = 0; idx < 3; idx++)
+    {
+        vecs[idx] = cpu.rd_mem(vec[idx]) | (cpu.rd_mem(vec[idx] + 1) << 8);
+        cpu.wr_mem(vec[idx],     loops[idx + 1] & MASK_8BIT);
+        cpu.wr_mem(vec[idx] + 1, hi);
+    }
+
+    const engine_type_e engines[] = {ENGINE_INTERP, ENGINE_THREADED, ENGINE_BLOCK, ENGINE_JIT, ENGINE_CYCLE};
+
+    for (uint32_t idx = 0; idx < sizeof(engines)/sizeof(engines[0]) && !error; idx++)
+    {
+        cpu.set_engine(engines[idx]);
+        cpu.reset(mode_c);
+
+        // IRQ held with the I flag set (from reset), taken after the RTI, with the RTI's return address pushed
+        cpu.activate_irq();
+
+        p_regs->pc = TEST_EVENT_ADDR;
+        status     = cpu.run();
+
+        cpu.deactivate_irq();
+
+        if (status.stop_reason != STOP_SELF_LOOP || status.pc != irq || cpu.rd_mem(0x1ff) != hi || cpu.rd_mem(0x1fe) != (rtn & MASK_8BIT))
+        {
+            error = true; // LCOV_EXCL_LINE
+        }
+
+        // NMI latched, taken at the start of the next run
+        cpu.nmi_interrupt();
+
+        status     = cpu.run();
+
+        if (status.stop_reason != STOP_SELF_LOOP || status.pc != nmi)
+        {
+            error = true; // LCOV_EXCL_LINE
+        }
+
+        // Requested reset, with the cycle count continuing (so only the 3 cycle JMP counted)
+        cpu.request_reset();
+
+        status     = cpu.run();
+
+        if (status.stop_reason != STOP_SELF_LOOP || status.pc != rst || status.cycles != 3)
+        {
+            error = true; // LCOV_EXCL_LINE
+        }
+    }
+
+    for (uint32_t idx = 0; idx < 3; idx++)
+    {
+        cpu.wr_mem(vec[idx],      vecs[idx]       & MASK_8BIT);
+        cpu.wr_mem(vec[idx] + 1, (vecs[idx] >> 8) & MASK_8BIT);
+    }
+
+    cpu.set_engine(engine);
+    cpu.reset(mode_c);
+
+    return error;
+}
+
+// -------------------------------------------------------------------------
+// inject_test()
+//
+// Stress test of interrupt injection from another thread, as made by a
+// device model running on its own thread, for each engine. The device
+// thread alternately raises an IRQ and an NMI, waiting each time for the
+// program's handler to acknowledge it by writing to a device register,
+// whilst the model runs on this thread. Each interrupt must be taken
+// exactly once. Run under ThreadSanitizer with 'make tsan'.
+//
+// -------------------------------------------------------------------------
+
+typedef struct
+{
+    std::atomic<uint32_t> irq_acks;
+    std::atomic<uint32_t> nmi_acks;
+    std::atomic<bool>     done;
+    bool                  error;     // Accessed only by the device thread until joined
+    cpu6502*              p_cpu;
+} inject_test_ctx_t;
+
+// Device register write, on the model's thread: offset 0 acknowledges the IRQ, 1 the NMI
+static void inject_test_wr (void* p_ctx, int addr, unsigned char)
+{
+    inject_test_ctx_t* p_inj = (inject_test_ctx_t*)p_ctx;
+
+    if ((addr & MASK_8BIT) == 0)
+    {
+        p_inj->p_cpu->deactivate_irq(TEST_INJECT_IRQ_ID);
+        p_inj->irq_acks++;
+    }
+    else
+    {
+        p_inj->nmi_acks++;
+    }
+}
+
+static int inject_test_rd (void*, int)
+{
+    return 0; // LCOV_EXCL_LINE
+}
+
+// Device thread
+static void inject_test_device (inject_test_ctx_t* p_inj)
+{
+    for (uint32_t idx = 0; idx < TEST_INJECT_COUNT && !p_inj->error; idx++)
+    {
+        std::atomic<uint32_t>& acks     = (idx & 1) ? p_inj->nmi_acks : p_inj->irq_acks;
+        const uint32_t         expected = idx/2 + 1;
+
+        if (idx & 1)
+        {
+            p_inj->p_cpu->nmi_interrupt();
+        }
+        else
+        {
+            p_inj->p_cpu->activate_irq(TEST_INJECT_IRQ_ID);
+        }
+
+        // Wait for the acknowledge, with a timeout should the interrupt be lost (or
+        // taken more than once)
+        std::chrono::steady_clock::time_point timeout = std::chrono::steady_clock::now() +
+                                                        std::chrono::seconds(TEST_INJECT_TIMEOUT_S);
+
+        while (acks.load() != expected && !p_inj->error)
+        {
+            if (std::chrono::steady_clock::now() > timeout)
+            {
+                p_inj->error = true; // LCOV_EXCL_LINE
+            }
+
+            std::this_thread::yield();
+        }
+    }
+
+    p_inj->done = true;
+    p_inj->p_cpu->request_stop();
+}
+
+bool inject_test(cpu6502 &cpu, cpu_type_e mode_c, engine_type_e engine)
+{
+    bool              error   = false;
+    wy65_reg_t*       p_regs  = cpu.sr_regs();
+    uint16_t          vecs[2];
+
+    // Program: CLI, then loop incrementing X. Handlers: write the device register and RTI.
+    const uint8_t     hi      = TEST_INJECT_ADDR >> 8;
+    const uint8_t     io_hi   = TEST_INJECT_IO_ADDR >> 8;
+    const uint16_t    loop    = TEST_INJECT_ADDR + 1;
+    const uint16_t    hdlr[2] = {TEST_INJECT_ADDR + 0x10, TEST_INJECT_ADDR + 0x20};
+    const uint16_t    vec[2]  = {IRQ_VEC_ADDR, NMI_VEC_ADDR};
+    const uint8_t     prog[]  = {CLI_OPCODE, INX_OPCODE, JMP_ABS_OPCODE, loop & MASK_8BIT, hi};
+
+    for (uint32_t idx = 0; idx < sizeof(prog); idx++)
+    {
+        cpu.wr_mem(TEST_INJECT_ADDR + idx, prog[idx]);
+    }
+
+    for (uint32_t idx = 0; idx < 2; idx++)
+    {
+        cpu.wr_mem(hdlr[idx],     STA_ABS_OPCODE);
+        cpu.wr_mem(hdlr[idx] + 1, idx);
+        cpu.wr_mem(hdlr[idx] + 2, io_hi);
+        cpu.wr_mem(hdlr[idx] + 3, RTI_OPCODE);
+
+        vecs[idx] = cpu.rd_mem(vec[idx]) | (cpu.rd_mem(vec[idx] + 1) << 8);
+        cpu.wr_mem(vec[idx],     hdlr[idx] & MASK_8BIT);
+        cpu.wr_mem(vec[idx] + 1, hi);
+    }
+
+    const engine_type_e engines[] = {ENGINE_INTERP, ENGINE_THREADED, ENGINE_BLOCK, ENGINE_JIT, ENGINE_CYCLE};
+
+    for (uint32_t idx = 0; idx < sizeof(engines)/sizeof(engines[0]) && !error; idx++)
+    {
+        inject_test_ctx_t inj;
+
+        inj.irq_acks = 0;
+        inj.nmi_acks = 0;
+        inj.done     = false;
+        inj.error    = false;
+        inj.p_cpu    = &cpu;
+
+        cpu.map_io_pages(TEST_INJECT_IO_ADDR, WY65_MAP_PAGE_SIZE, inject_test_wr, inject_test_rd, &inj);
+        cpu.set_engine(engines[idx]);
+        cpu.reset(mode_c);
+
+        p_regs->pc = TEST_INJECT_ADDR;
+
+        std::thread device(inject_test_device, &inj);
+
+        // Run in slices, yielding between them for hosts with a single core
+        while (!inj.done.load())
+        {
+            cpu.run(TEST_INJECT_BUDGET);
+            std::this_thread::yield();
+        }
+
+        device.join();
+
+        if (inj.error || inj.irq_acks != TEST_INJECT_COUNT/2 || inj.nmi_acks != TEST_INJECT_COUNT/2)
+        {
+            error = true; // LCOV_EXCL_LINE
+        }
+
+        cpu.unmap_pages(TEST_INJECT_IO_ADDR, WY65_MAP_PAGE_SIZE);
+    }
+
+    for (uint32_t idx = 0; idx < 2; idx++)
+    {
+        cpu.wr_mem(vec[idx],      vecs[idx]       & MASK_8BIT);
+        cpu.wr_mem(vec[idx] + 1, (vecs[idx] >> 8) & MASK_8BIT);
+    }
+
+    cpu.set_engine(engine);
+    cpu.reset(mode_c);
+
+    return error;
+}
+
+// -------------------------------------------------------------------------
+// fleet_test()
+//
+// Runs many small jobs on a fleet of models, over all the engines. Each job
+// counts X down from a per job loop count, stores Y (set to the job's ID)
+// and jumps to itself. Every other job has an instruction budget that ends
+// within the loop. The setup hook sets A, and the done hook reads the stored
+// value, which must be clear for jobs that didn't reach the store (memory is
+// cleared between jobs). Every job's result must be returned exactly once.
+//
+// -------------------------------------------------------------------------
+
+typedef struct
+{
+    uint8_t  a;
+    uint8_t  stored;
+    uint32_t hooks;
+} fleet_test_ctx_t;
+
+static void fleet_test_setup (cpu6502* p_cpu, void* p_ctx)
+{
+    fleet_test_ctx_t* p_job = (fleet_test_ctx_t*)p_ctx;
+
+    p_cpu->sr_regs()->a = p_job->a;
+    p_job->hooks++;
+}
+
+static void fleet_test_done (cpu6502* p_cpu, void* p_ctx)
+{
+    fleet_test_ctx_t* p_job = (fleet_test_ctx_t*)p_ctx;
+
+    p_job->stored = p_cpu->sr_rd_mem(TEST_FLEET_RESULT_ADDR);
+    p_job->hooks++;
+}
+
+bool fleet_test(cpu_type_e mode_c)
+{
+    bool                  error   = false;
+    const uint16_t        self    = TEST_FLEET_ADDR + 9;
+    const engine_type_e   engines[] = {ENGINE_INTERP, ENGINE_THREADED, ENGINE_BLOCK, ENGINE_JIT, ENGINE_CYCLE};
+
+    std::vector<uint8_t>          images(TEST_FLEET_JOBS * TEST_FLEET_PROG_SIZE);
+    std::vector<fleet_test_ctx_t> ctx(TEST_FLEET_JOBS);
+    std::vector<uint32_t>         seen(TEST_FLEET_JOBS, 0);
+
+    cpu6502_fleet         fleet(TEST_FLEET_WORKERS);
+
+    for (uint32_t id = 0; id < TEST_FLEET_JOBS; id++)
+    {
+        const uint8_t    loops    = (id % MASK_8BIT) + 1;
+        uint8_t*         p_image  = &images[id * TEST_FLEET_PROG_SIZE];
+        const uint8_t    prog[TEST_FLEET_PROG_SIZE] = {LDX_IMM_OPCODE, loops,
+                                                       LDY_IMM_OPCODE, (uint8_t)id,
+                                                       DEX_OPCODE,
+                                                       BNE_OPCODE,     0xfd,
+                                                       STY_ZPG_OPCODE, TEST_FLEET_RESULT_ADDR,
+                                                       JMP_ABS_OPCODE, self & MASK_8BIT, self >> 8};
+        wy65_fleet_job_t job;
+
+        memcpy(p_image, prog, TEST_FLEET_PROG_SIZE);
+
+        ctx[id].a                = ~id & MASK_8BIT;
+        ctx[id].stored           = 0xff;
+        ctx[id].hooks            = 0;
+
+        job.id                   = id;
+        job.cpu_type             = mode_c;
+        job.engine               = engines[id % (sizeof(engines)/sizeof(engines[0]))];
+        job.p_image              = p_image;
+        job.image_len            = TEST_FLEET_PROG_SIZE;
+        job.load_addr            = TEST_FLEET_ADDR;
+        job.start_addr           = TEST_FLEET_ADDR;
+        job.max_instructions     = (id & 1) ? 2 + loops : WY65_NO_LIMIT;
+        job.max_cycles           = WY65_NO_LIMIT;
+        job.p_setup              = fleet_test_setup;
+        job.p_done               = fleet_test_done;
+        job.p_ctx                = &ctx[id];
+
+        fleet.submit(job);
+    }
+
+    wy65_fleet_result_t result;
+
+    while (fleet.wait_result(result))
+    {
+        const uint32_t    id    = result.id;
+
+        if (id >= TEST_FLEET_JOBS || seen[id]++ || result.worker >= fleet.num_workers())
+        {
+            error = true; // LCOV_EXCL_LINE
+            continue;     // LCOV_EXCL_LINE
+        }
 
-// -------------------------------------------------------------------------
-// STATIC VARIABLES FOR STANDALONE 
-// -------------------------------------------------------------------------
+        const uint8_t     loops = (id % MASK_8BIT) + 1;
+        fleet_test_ctx_t* p_job = &ctx[id];
+
+        if (p_job->hooks != 2 || result.regs.a != p_job->a || result.regs.y != (id & MASK_8BIT))
+        {
+            error = true; // LCOV_EXCL_LINE
+        }
+
+        if (id & 1)
+        {
+            // Budget ends after loops instructions of DEX/BNE pairs
+            if (result.status.stop_reason  != STOP_INSTR_BUDGET ||
+                result.status.instructions != 2U + loops        ||
+                result.regs.x              != loops - (loops + 1)/2 ||
+                p_job->stored              != 0)
+            {
+                error = true; // LCOV_EXCL_LINE
+            }
+        }
+        else if (result.status.stop_reason != STOP_SELF_LOOP ||
+                 result.status.pc          != self           ||
+                 result.regs.x             != 0              ||
+                 p_job->stored             != (id & MASK_8BIT))
+        {
+            error = true; // LCOV_EXCL_LINE
+        }
+    }
+
+    if (fleet.poll_result(result))
+    {
+        error = true; // LCOV_EXCL_LINE
+    }
 
-// The cpu6502 model
-static cpu6502  cpu;
+    for (uint32_t id = 0; id < TEST_FLEET_JOBS; id++)
+    {
+        if (seen[id] != 1)
+        {
+            error = true; // LCOV_EXCL_LINE
+        }
+    }
+
+    return error;
+}
 
 // -------------------------------------------------------------------------
-// interrupt_test()
+// batch_test()
 //
-// Performs testing of IRQ and NMI interrupts
+// Runs a program on a batch of lanes with different inputs, in two runs,
+// and checks that each lane's registers, cycles and memory match those of
+// a model executing the same program, with the same inputs, using
+// execute(). The program has data dependent branches (diverging the
+// lanes), a loop crossing a page boundary, an ADC carrying only from the
+// carry in, decimal mode ADC on some lanes, a subroutine with stack
+// operations, and an NMI on some lanes, so that lanes are stepped both
+// together and individually.
 //
 // -------------------------------------------------------------------------
 
-bool interrupt_test(cpu_type_e mode_c, uint16_t start_addr)
+static void batch_test_load (cpu6502* p_cpu, const uint32_t lane)
 {
-    bool     error        = false;
-    uint16_t old_irq_vec;
-
-    // ------------------------------------
-    // NMI Interrupt test
-    // ------------------------------------
-
-    // Reset
-    cpu.reset(mode_c);
+    static const uint8_t prog[] = {
+        0xd8,                   // CLD
+        0xa5, 0x10,             // LDA $10
+        0xa2, 0x08,             // LDX #$08
+        0x0a,                   // loop: ASL A
+        0x90, 0x02,             // BCC skip
+        0x49, 0x1d,             // EOR #$1D
+        0x65, 0x11,             // skip: ADC $11
+        0xca,                   // DEX
+        0xd0, 0xf6,             // BNE loop
+        0x85, 0x12,             // STA $12
+        0xa8,                   // TAY
+        0xe9, 0x40,             // SBC #$40
+        0xc5, 0x11,             // CMP $11
+        0xb0, 0x05,             // BCS over
+        0xf8,                   // SED
+        0x69, 0x15,             // ADC #$15
+        0xd8,                   // CLD
+        0xea,                   // NOP
+        0x4a,                   // over: LSR A
+        0x6a,                   // ROR A
+        0x24, 0x12,             // BIT $12
+        0x30, 0x03,             // BMI neg
+        0xe0, 0x00,             // CPX #$00
+        0xc8,                   // INY
+        0xba,                   // neg: TSX
+        0x8a,                   // TXA
+        0x09, 0x01,             // ORA #$01
+        0x2d, 0x10, 0x00,       // AND $0010
+        0xe8,                   // INX
+        0x88,                   // DEY
+        0x86, 0x13,             // STX $13
+        0x8c, 0x14, 0x00,       // STY $0014
+        0x48,                   // PHA
+        0x20, TEST_BATCH_SUB_ADDR & MASK_8BIT, TEST_BATCH_SUB_ADDR >> 8, // JSR sub
+        0x68,                   // PLA
+        0x18,                   // CLC
+        0x38,                   // SEC
+        0xb8,                   // CLV
+        0x6d, 0x12, 0x00,       // ADC $0012
+        0x85, 0x10,             // STA $10
+        0x38,                   // SEC
+        0xa5, 0x10,             // LDA $10
+        0x49, 0xff,             // EOR #$FF
+        0x65, 0x10,             // ADC $10 (carry from adding the carry in)
+        0xa9, 0x00,             // LDA #$00
+        0x69, 0x00,             // ADC #$00
+        0x85, 0x15,             // STA $15
+        0x4c, TEST_BATCH_ADDR & MASK_8BIT, TEST_BATCH_ADDR >> 8};        // JMP start
+
+    static const uint8_t sub[]  = {0xa4, 0x13,  // sub: LDY $13
+                                   0x2a,        // ROL A
+                                   0x60};       // RTS
+    static const uint8_t rti[]  = {RTI_OPCODE};
+    static const uint8_t vecs[] = {TEST_BATCH_NMI_ADDR & MASK_8BIT, TEST_BATCH_NMI_ADDR >> 8,
+                                   TEST_BATCH_ADDR     & MASK_8BIT, TEST_BATCH_ADDR     >> 8};
+    const uint8_t        in[]   = {(uint8_t)(lane * 37), (uint8_t)(lane * 11 + 5)};
+
+    p_cpu->load_mem(NULL);
+    p_cpu->load_mem(prog, sizeof(prog), TEST_BATCH_ADDR);
+    p_cpu->load_mem(sub,  sizeof(sub),  TEST_BATCH_SUB_ADDR);
+    p_cpu->load_mem(rti,  sizeof(rti),  TEST_BATCH_NMI_ADDR);
+    p_cpu->load_mem(vecs, sizeof(vecs), NMI_VEC_ADDR);
+    p_cpu->load_mem(in,   sizeof(in),   TEST_BATCH_IN_ADDR);
+}
 
-    // Execute an instruction
-    wy65_exec_status_t status = cpu.execute();
+bool batch_test(cpu_type_e mode_c)
+{
+    bool                 error    = false;
+    cpu6502_batch        batch(TEST_BATCH_LANES, mode_c);
+    cpu6502*             p_ref    = new cpu6502;
+    uint64_t             simd_instrs, scalar_instrs;
 
-    // Check returned PC is within three of the reset vector
-    if (status.pc < start_addr || status.pc >= (start_addr+3))
-    {
-        error = true; // LCOV_EXCL_LINE
-    }
-    // Make sure that the flags have the interrupt bit set
-    else if (!(status.flags & INT_MASK))
+    for (uint32_t lane = 0; lane < TEST_BATCH_LANES; lane++)
     {
-        error = true; // LCOV_EXCL_LINE
+        batch_test_load(batch.lane(lane), lane);
     }
 
-    if (!error)
-    {
-        uint16_t nmi_addr = TEST_ADDR1;
+    batch.reset();
 
-        // Remember the IRQ vector already programmed in memory
-        old_irq_vec  = cpu.rd_mem(IRQ_VEC_ADDR);
-        old_irq_vec |= cpu.rd_mem(IRQ_VEC_ADDR+1) << 8;
+    for (uint32_t lane = 0; lane < TEST_BATCH_LANES; lane += 7)
+    {
+        batch.lane(lane)->nmi_interrupt();
+    }
 
-        // Load the NMI vector with the user start location, if specified
-        cpu.wr_mem(NMI_VEC_ADDR,    nmi_addr       & MASK_8BIT);
-        cpu.wr_mem(NMI_VEC_ADDR+1, (nmi_addr >> 8) & MASK_8BIT);
+    batch.run(TEST_BATCH_INSTRS/2);
+    batch.run(TEST_BATCH_INSTRS/2);
 
-        // Load NMI address with a NOP
-        cpu.wr_mem(nmi_addr,    NOP_OPCODE_BASE); // Load a NOP opcode
-        cpu.wr_mem(nmi_addr+1,  CLI_OPCODE);      // Load a CLI opcode
+    for (uint32_t lane = 0; lane < TEST_BATCH_LANES && !error; lane++)
+    {
+        wy65_reg_t regs, ref_regs;
+        uint64_t   cycles = 0;
 
-        // Raise an interrupt
-        cpu.nmi_interrupt();
+        batch_test_load(p_ref, lane);
+        p_ref->reset(mode_c);
 
-        // Execute an instruction
-        status = cpu.execute();
+        if ((lane % 7) == 0)
+        {
+            p_ref->nmi_interrupt();
+        }
 
-        // Check returned PC is address after nmi_addr
-        if (status.pc != (nmi_addr+1))
+        for (uint32_t idx = 0; idx < TEST_BATCH_INSTRS; idx++)
         {
-            error = true; // LCOV_EXCL_LINE
+            cycles += p_ref->execute().cycles;
         }
-        // Check that the flags has the interrupt bit set, but not the break flag
-        else if (((status.flags & INT_MASK) == 0) || (status.flags & BRK_MASK))
+
+        batch.get_lane_regs(lane, regs);
+        p_ref->get_regs(ref_regs);
+
+        if (memcmp(&regs, &ref_regs, sizeof(wy65_reg_t)) || batch.get_lane_cycles(lane) != cycles)
         {
             error = true; // LCOV_EXCL_LINE
         }
-        else
-        {
-            // Execute next instruction (CLI)
-            status = cpu.execute();
 
-            // Check interrupt flag clear, ready for IRQ testing
-            if (status.flags & INT_MASK)
+        // Check the data and stack memory
+        for (uint32_t addr = 0; addr < 2*WY65_MAP_PAGE_SIZE; addr++)
+        {
+            if (batch.lane(lane)->sr_rd_mem(addr) != p_ref->sr_rd_mem(addr))
             {
                 error = true; // LCOV_EXCL_LINE
             }
         }
     }
 
-    // ------------------------------------
-    // IRQ Interrupt test
-    // ------------------------------------
+    // Both paths must have been exercised
+    batch.get_stats(simd_instrs, scalar_instrs);
 
-    if (!error)
+    if (simd_instrs == 0 || scalar_instrs == 0)
     {
-        uint16_t irq_addr = TEST_ADDR2;
+        error = true; // LCOV_EXCL_LINE
+    }
 
-        // Load the IRQ vector with the user start location, if specified
-        cpu.wr_mem(IRQ_VEC_ADDR,    irq_addr       & MASK_8BIT);
-        cpu.wr_mem(IRQ_VEC_ADDR+1, (irq_addr >> 8) & MASK_8BIT);
+    delete p_ref;
 
-        // Load IRQ address with a NOP
-        cpu.wr_mem(irq_addr,    NOP_OPCODE_BASE);
+    return error;
+}
 
-        // Activate an IRQ
-        cpu.activate_irq();
+// -------------------------------------------------------------------------
+// fork_test()
+//
+// Runs the batch test program on a model and forks it, and again with an
+// NMI pending. After each fork, the model and its fork are each run on,
+// and must match a model run for the same number of instructions (with
+// the same NMI) without forking. A write to a fork must not be seen by
+// the model, and a fork of a fork must keep its memory when the fork it
+// was made from is deleted. Host RAM mapped to a page must be isolated
+// between a model and its fork, and a model with write only host memory
+// must not be forked.
+//
+// -------------------------------------------------------------------------
 
-        // Execute an instruction
-        status = cpu.execute();
+static bool fork_test_match (cpu6502* p_cpu, const uint64_t cycles, cpu6502* p_ref, const uint64_t ref_cycles)
+{
+    wy65_reg_t regs, ref_regs;
+    bool       error = false;
 
-        // Remove active IRQ
-        cpu.deactivate_irq();
+    p_cpu->get_regs(regs);
+    p_ref->get_regs(ref_regs);
 
-        // Check PC is irq_addr + 1
-        if (status.pc != (irq_addr+1))
-        {
-            error = true; // LCOV_EXCL_LINE
-        }
-        // Check interrupt flag set
-        else if (!(status.flags & INT_MASK))
+    if (memcmp(&regs, &ref_regs, sizeof(wy65_reg_t)) || cycles != ref_cycles)
+    {
+        error = true; // LCOV_EXCL_LINE
+    }
+
+    for (uint32_t addr = 0; addr < WY65_ADDR_SPACE_SIZE; addr++)
+    {
+        if (p_cpu->sr_rd_mem(addr) != p_ref->sr_rd_mem(addr))
         {
             error = true; // LCOV_EXCL_LINE
         }
-
-        // Restore IRQ vector (for BRK instruction testing in main test)
-        cpu.wr_mem(IRQ_VEC_ADDR,    old_irq_vec       & MASK_8BIT);
-        cpu.wr_mem(IRQ_VEC_ADDR+1, (old_irq_vec >> 8) & MASK_8BIT);
     }
 
     return error;
 }
 
-// -------------------------------------------------------------------------
-// wait_stop_tests()
-//
-// Performs testing of WAI and STP instructions
-//
-// -------------------------------------------------------------------------
-
-bool wait_stop_tests(uint16_t start_addr)
+bool fork_test(cpu_type_e mode_c, engine_type_e engine)
 {
+    bool     error      = false;
+    cpu6502* p_cpu      = new cpu6502;
+    cpu6502* p_ref      = new cpu6502;
+    cpu6502* p_fork;
+    cpu6502* p_fork2;
+    uint64_t cycles, fork_cycles, ref_cycles;
 
-    wy65_exec_status_t status;
-    uint16_t           irq_vec;
-    uint16_t           nmi_vec;
-    bool               error        = false;
+    batch_test_load(p_ref, TEST_FORK_INPUTS);
+    p_ref->set_engine(engine);
+    p_ref->reset(mode_c);
+    ref_cycles   = p_ref->run(2*TEST_FORK_INSTRS).cycles;
 
-    // ------------------------------------
-    // WAI test 
-    // ------------------------------------
+    // Run the model to the fork point, fork it, and run both on. The model's
+    // blocks (and native code) were built before any pages were shared.
+    batch_test_load(p_cpu, TEST_FORK_INPUTS);
+    p_cpu->set_engine(engine);
+    p_cpu->reset(mode_c);
+    cycles       = p_cpu->run(TEST_FORK_INSTRS).cycles;
 
-    // Get the IRQ vector already programmed in memory
-    irq_vec  = cpu.rd_mem(IRQ_VEC_ADDR);
-    irq_vec |= cpu.rd_mem(IRQ_VEC_ADDR+1) << 8;
+    p_fork       = p_cpu->fork();
 
-	// Update reset vector
-    uint16_t rst_addr = TEST_ADDR1;
-    cpu.wr_mem(RESET_VEC_ADDR,    rst_addr       & MASK_8BIT);
-    cpu.wr_mem(RESET_VEC_ADDR+1, (rst_addr >> 8) & MASK_8BIT);
+    fork_cycles  = cycles + p_fork->run(TEST_FORK_INSTRS).cycles;
+    cycles      += p_cpu->run(TEST_FORK_INSTRS).cycles;
 
-    // Program at rst_addr: WAI CLI WAI NOP
-    cpu.wr_mem(rst_addr,    WAI_OPCODE);
-    cpu.wr_mem(rst_addr+1,  CLI_OPCODE);
-    cpu.wr_mem(rst_addr+2,  WAI_OPCODE);
-    cpu.wr_mem(rst_addr+3,  NOP_OPCODE_BASE);
+    error |= fork_test_match(p_cpu,  cycles,      p_ref, ref_cycles);
+    error |= fork_test_match(p_fork, fork_cycles, p_ref, ref_cycles);
 
-    cpu.reset();
+    delete p_fork;
 
-	// Execute WAI (I is set)
-    status = cpu.execute();
+    // Fork again with an NMI pending, which both must take
+    p_ref->nmi_interrupt();
+    ref_cycles  += p_ref->run(TEST_FORK_INSTRS).cycles;
 
-	// Check pc = rst_addr, and cycles != 0 --- i.e. now waiting (for the first time)
-	if (status.pc != rst_addr || status.cycles == 0)
-	{
+    p_cpu->nmi_interrupt();
+    p_fork       = p_cpu->fork();
+
+    fork_cycles  = cycles + p_fork->run(TEST_FORK_INSTRS).cycles;
+    cycles      += p_cpu->run(TEST_FORK_INSTRS).cycles;
+
+    error |= fork_test_match(p_cpu,  cycles,      p_ref, ref_cycles);
+    error |= fork_test_match(p_fork, fork_cycles, p_ref, ref_cycles);
+
+    // Writes to the fork must not be seen by the model
+    p_fork->sr_wr_mem(TEST_BATCH_IN_ADDR, p_cpu->sr_rd_mem(TEST_BATCH_IN_ADDR) ^ MASK_8BIT);
+    p_fork->sr_wr_mem(TEST_BATCH_ADDR,    NOP_OPCODE_BASE);
+
+    if (p_cpu->sr_rd_mem(TEST_BATCH_IN_ADDR) != p_ref->sr_rd_mem(TEST_BATCH_IN_ADDR) ||
+        p_cpu->sr_rd_mem(TEST_BATCH_ADDR)    != p_ref->sr_rd_mem(TEST_BATCH_ADDR)    ||
+        p_fork->sr_rd_mem(TEST_BATCH_ADDR)   != NOP_OPCODE_BASE)
+    {
         error = true; // LCOV_EXCL_LINE
-	}
-	else
-	{
-	    // Execute WAI (I is set)
-        status = cpu.execute();
-    
-	    // Check pc = rst_addr, and cycles == 0 --- i.e. still waiting (not for the first time)
-	    if (status.pc != rst_addr || status.cycles != 0)
-	    {
-            error = true; // LCOV_EXCL_LINE
-	    }
-	}
+    }
 
-    // Test IRQ when waiting with I bit set
-    if (!error)
+    // A fork of the fork keeps the pages shared with the deleted fork
+    p_fork2      = p_fork->fork();
+
+    delete p_fork;
+
+    if (p_fork2->sr_rd_mem(TEST_BATCH_ADDR) != NOP_OPCODE_BASE || p_fork2->sr_rd_mem(TEST_BATCH_ADDR + 1) != p_ref->sr_rd_mem(TEST_BATCH_ADDR + 1))
     {
-        // Activate an interrupt (but I still set)
-        cpu.activate_irq();
+        error = true; // LCOV_EXCL_LINE
+    }
 
-        // Execute WAI for a third time
-        status = cpu.execute();
+    delete p_fork2;
 
-        // Deactivate IRQ
-        cpu.deactivate_irq();
+    // Host RAM is copied to the fork, with writes by either not seen by the other
+    uint8_t host_ram[WY65_MAP_PAGE_SIZE];
 
-        // Check pc = rst_addr+1, and cycles != 0
-	    if (status.pc != rst_addr+1 || status.cycles != 0)
-	    {
-            error = true; // LCOV_EXCL_LINE
-	    }
+    memset(host_ram, 0, sizeof(host_ram));
+    host_ram[0]  = NOP_OPCODE_BASE;
+
+    p_cpu->map_mem_pages(TEST_FORK_HOST_ADDR, WY65_MAP_PAGE_SIZE, host_ram, host_ram);
+
+    p_fork       = p_cpu->fork();
+
+    p_fork->sr_wr_mem(TEST_FORK_HOST_ADDR,     ~NOP_OPCODE_BASE & MASK_8BIT);
+    p_cpu->sr_wr_mem (TEST_FORK_HOST_ADDR + 1,  NOP_OPCODE_BASE);
+
+    if (host_ram[0]                                != NOP_OPCODE_BASE                ||
+        host_ram[1]                                != NOP_OPCODE_BASE                ||
+        p_fork->sr_rd_mem(TEST_FORK_HOST_ADDR)     != (~NOP_OPCODE_BASE & MASK_8BIT) ||
+        p_fork->sr_rd_mem(TEST_FORK_HOST_ADDR + 1) != 0)
+    {
+        error = true; // LCOV_EXCL_LINE
     }
-    
-    // Clear I flag and get to next WAI instruction, which then waits
-    if (!error)
+
+    delete p_fork;
+
+    // Write only host memory can't be isolated, so the model is not forked
+    p_cpu->map_mem_pages(TEST_FORK_HOST_ADDR, WY65_MAP_PAGE_SIZE, NULL, host_ram);
+
+    if ((p_fork = p_cpu->fork()) != NULL)
     {
-        // Execute CLI instruction
-        status = cpu.execute();
+        delete p_fork; // LCOV_EXCL_LINE
+        error = true;  // LCOV_EXCL_LINE
+    }
 
-        // Execute second WAI
-        status = cpu.execute();
+    delete p_cpu;
+    delete p_ref;
 
-        // Check pc = rst_addr+2, count != 0
-        if (status.pc != rst_addr+2 || status.cycles == 0)
+    return error;
+}
+
+// -------------------------------------------------------------------------
+// rom_test()
+//
+// Maps one ROM image, holding a program and the reset vector, into several
+// models, each with its own input in RAM. The program stores a result in
+// RAM and writes to the ROM, which must be discarded, or trapped for the
+// models with a write handler, leaving the image unchanged. Once unmapped,
+// the pages must no longer be ROM, so that the program, copied to external
+// memory and then modified by the host, is not run from a stale cache.
+//
+// -------------------------------------------------------------------------
+
+typedef struct
+{
+    uint32_t count;
+    int      addr;
+    uint8_t  data;
+} rom_test_trap_t;
+
+static void rom_test_trap (void* p_ctx, int addr, unsigned char data)
+{
+    rom_test_trap_t* p_trap = (rom_test_trap_t*)p_ctx;
+
+    p_trap->count++;
+    p_trap->addr = addr;
+    p_trap->data = data;
+}
+
+bool rom_test(cpu_type_e mode_c, engine_type_e engine)
+{
+    bool            error = false;
+    uint8_t*        p_rom = new uint8_t[TEST_ROM_SIZE];
+    rom_test_trap_t trap[TEST_ROM_MODELS];
+
+    static const uint8_t prog[] = {
+        0xa5, TEST_ROM_IN_ADDR,                                            // loop: LDA in
+        0x0a,                                                              // ASL A
+        0x85, TEST_ROM_IN_ADDR + 1,                                        // STA in+1
+        0x8d, TEST_ROM_WR_ADDR & MASK_8BIT, TEST_ROM_WR_ADDR >> 8,         // STA rom
+        0xe6, TEST_ROM_IN_ADDR + 2,                                        // INC in+2
+        0x4c, TEST_ROM_ADDR & MASK_8BIT, TEST_ROM_ADDR >> 8};              // JMP loop
+
+    memset(p_rom, 0, TEST_ROM_SIZE);
+    memcpy(p_rom, prog, sizeof(prog));
+    p_rom[RESET_VEC_ADDR   - TEST_ROM_ADDR] = TEST_ROM_ADDR & MASK_8BIT;
+    p_rom[RESET_VEC_ADDR+1 - TEST_ROM_ADDR] = TEST_ROM_ADDR >> 8;
+
+    for (uint32_t idx = 0; idx < TEST_ROM_MODELS && !error; idx++)
+    {
+        cpu6502* p_cpu   = new cpu6502;
+        uint8_t  in      = idx + 1;
+        bool     trapped = (idx & 1) != 0;
+
+        memset(&trap[idx], 0, sizeof(rom_test_trap_t));
+
+        p_cpu->load_mem(NULL);
+        p_cpu->load_mem(&in, 1, TEST_ROM_IN_ADDR);
+        p_cpu->map_rom_pages(TEST_ROM_ADDR, TEST_ROM_SIZE, p_rom, trapped ? rom_test_trap : NULL, &trap[idx]);
+        p_cpu->set_engine(engine);
+        p_cpu->reset(mode_c);
+        p_cpu->run(TEST_ROM_INSTRS);
+
+        uint32_t loops = p_cpu->sr_rd_mem(TEST_ROM_IN_ADDR + 2);
+
+        if (p_cpu->sr_rd_mem(TEST_ROM_IN_ADDR + 1) != 2*in || loops == 0 || p_cpu->sr_rd_mem(TEST_ROM_WR_ADDR) != 0)
         {
-            error = true;  // LCOV_EXCL_LINE
+            error = true; // LCOV_EXCL_LINE
         }
-        else
+
+        // Trapped writes, with the full address and data, at most one more than the loop count
+        if (trapped ? (trap[idx].count < loops || trap[idx].count > loops + 1 ||
+                       trap[idx].addr != TEST_ROM_WR_ADDR || trap[idx].data != 2*in)
+                    : trap[idx].count != 0)
         {
-            // Execute WAI again
-            status = cpu.execute();
-            // Check pc = rst_addr+2, count != 0
-            if (status.pc != rst_addr+2 || status.cycles != 0)
-            {
-                error = true;  // LCOV_EXCL_LINE
-            }
+            error = true; // LCOV_EXCL_LINE
         }
-    }
-
-    // Test IRQ when waiting with I bit clear
-    if (!error)
-    {
-        // Activate an interrupt (but I now clear)
-        cpu.activate_irq();
 
-        // Execute
-        status = cpu.execute();
+        // Discarded writes must not reach internal memory below the ROM
+        p_cpu->unmap_pages(TEST_ROM_ADDR, TEST_ROM_SIZE);
 
-        // Check pc = irq_vec+1, count != 0
-        if (status.pc != irq_vec+1 || status.cycles == 0)
+        if (p_cpu->sr_rd_mem(TEST_ROM_WR_ADDR) != 0 || p_cpu->sr_rd_mem(TEST_ROM_ADDR) != 0)
         {
-            error = true;  // LCOV_EXCL_LINE
+            error = true; // LCOV_EXCL_LINE
         }
-    }
-
-    // Test NMI when waiting
 
-    nmi_vec  = TEST_ADDR3;
+        delete p_cpu;
+    }
 
-    // Load the NMI vector
-    cpu.wr_mem(NMI_VEC_ADDR,    nmi_vec       & MASK_8BIT);
-    cpu.wr_mem(NMI_VEC_ADDR+1, (nmi_vec >> 8) & MASK_8BIT);
+    // The image is unchanged
+    if (memcmp(p_rom, prog, sizeof(prog)) || p_rom[TEST_ROM_WR_ADDR - TEST_ROM_ADDR] != 0)
+    {
+        error = true; // LCOV_EXCL_LINE
+    }
 
+    // Run the program from external memory, over the unmapped ROM pages, and
+    // again after the host replaces its ASL with a NOP
     if (!error)
     {
-        // Reset one more
-        cpu.reset();
+        cpu6502* p_cpu   = new cpu6502;
+        uint8_t* p_ext   = new uint8_t[WY65_ADDR_SPACE_SIZE];
+        uint8_t  in      = TEST_ROM_MODELS + 1;
 
-        // Execute WAI 
-        status = cpu.execute();
+        memset(p_ext, 0, WY65_ADDR_SPACE_SIZE);
 
-        // Check pc = rst_addr, count != 0
-        if (status.pc != rst_addr || status.cycles == 0)
-        {
-            error = true;  // LCOV_EXCL_LINE
-        }
-        else
-        {
-            // Execute WAI again
-            status = cpu.execute();
+        p_cpu->register_mem_funcs(map_test_ctx_wr, map_test_ctx_rd, p_ext);
+        p_cpu->map_rom_pages(TEST_ROM_ADDR, TEST_ROM_SIZE, p_rom);
+        p_cpu->unmap_pages(TEST_ROM_ADDR, TEST_ROM_SIZE);
 
-            // Check pc = rst_addr, count == 0
-            if (status.pc != rst_addr || status.cycles != 0)
-            {
-                error = true;  // LCOV_EXCL_LINE
-            }
-        }
+        memcpy(&p_ext[TEST_ROM_ADDR], p_rom, TEST_ROM_SIZE);
+        p_ext[TEST_ROM_IN_ADDR] = in;
 
-        if (!error)
+        p_cpu->enable_decode_cache();
+        p_cpu->set_engine(engine);
+        p_cpu->reset(mode_c);
+        p_cpu->run(TEST_ROM_INSTRS);
+
+        p_ext[TEST_ROM_ADDR + 2] = NOP_OPCODE_BASE;
+        p_cpu->run(TEST_ROM_INSTRS);
+
+        if (p_ext[TEST_ROM_IN_ADDR + 1] != in)
         {
-            // Activate an NMI
-            cpu.nmi_interrupt();
-            
-            // Execute
-            status = cpu.execute();
-            
-            // Check pc = nmi_vec+1, count != 0
-            if (status.pc != nmi_vec+1 || status.cycles == 0)
-            {
-                error = true;  // LCOV_EXCL_LINE
-            }
+            error = true; // LCOV_EXCL_LINE
         }
+
+        delete p_cpu;
+        delete [] p_ext;
     }
 
-    // ------------------------------------
-    // STP test
-    // ------------------------------------
+    delete [] p_rom;
 
-    if (!error)
-    {
-        // Update reset vector
-        uint16_t rst_addr = TEST_ADDR1;
-        cpu.wr_mem(RESET_VEC_ADDR,    rst_addr       & MASK_8BIT);
-        cpu.wr_mem(RESET_VEC_ADDR+1, (rst_addr >> 8) & MASK_8BIT);
+    return error;
+}
 
-        // Program at rst_addr: CLI STP NOP
-        cpu.wr_mem(rst_addr,    CLI_OPCODE);
-        cpu.wr_mem(rst_addr+1,  STP_OPCODE);
-        cpu.wr_mem(rst_addr+2,  NOP_OPCODE_BASE);
+// -------------------------------------------------------------------------
+// alu_test()
+//
+// Exhaustively checks ADC and SBC, in binary and decimal modes, for all
+// accumulator, operand and carry in values. Decimal results are checked
+// against the functions generating the lookup tables, and against decimal
+// arithmetic for valid BCD values.
+//
+// -------------------------------------------------------------------------
 
-        cpu.reset();
+bool alu_test(cpu6502 &cpu, cpu_type_e mode_c)
+{
+    bool        error  = false;
+    wy65_reg_t* p_regs = cpu.sr_regs();
 
-        // Execute CLI
-        status = cpu.execute();
+    cpu.reset(mode_c);
 
-        // Execute STP
-        status = cpu.execute();
+    for (uint32_t idx = 0; idx < 8*WY65_BCD_TBL_SIZE && !error; idx++)
+    {
+        uint8_t  acc     = (idx >> 8) & MASK_8BIT;
+        uint8_t  mem_val = idx & MASK_8BIT;
+        bool     carry   = (idx & 0x10000) != 0;
+        bool     bcd     = (idx & 0x20000) != 0;
+        bool     sub     = (idx & 0x40000) != 0;
+        uint16_t exp;
+
+        if (bcd)
+        {
+            exp = sub ? bcd_sbc(acc, mem_val, carry) : bcd_adc(acc, mem_val, carry);
 
-        // Check pc = rst_addr+1, and cycles != 0
-	    if (status.pc != rst_addr+1 || status.cycles == 0)
-	    {
-            error = true; // LCOV_EXCL_LINE
-	    }
+            // With valid BCD values, the result must match decimal arithmetic
+            if ((acc & MASK_LO_NIB) < 10 && (acc >> 4) < 10 && (mem_val & MASK_LO_NIB) < 10 && (mem_val >> 4) < 10)
+            {
+                int32_t dec = (acc >> 4)*10 + (acc & MASK_LO_NIB) + (sub ? -1 : 1) * ((mem_val >> 4)*10 + (mem_val & MASK_LO_NIB)) + 
+                              (sub ? (carry ? 0 : -1) : (carry ? 1 : 0));
+                bool    c   = sub ? (dec >= 0) : (dec >= 100);
+
+                dec         = (dec + 100) % 100;
+
+                if ((exp & MASK_8BIT) != (uint32_t)(((dec / 10) << 4) | (dec % 10)) || ((exp >> 8) & CARRY_MASK) != (c ? CARRY_MASK : 0))
+                {
+                    error = true; // LCOV_EXCL_LINE
+                }
+            }
+        }
         else
         {
-            // Execute again
-            status = cpu.execute();
+            int32_t  res = sub ? acc - mem_val - (carry ? 0 : 1) : acc + mem_val + (carry ? 1 : 0);
+            bool     c   = sub ? (res >= 0) : (res > 0xff);
+            bool     v   = ((sub ? (acc ^ mem_val) : ~(acc ^ mem_val)) & (acc ^ res) & SIGN_MASK) != 0;
 
-            // Check pc = rst_addr+1, and cycles == 0
-	        if (status.pc != rst_addr+1 || status.cycles != 0)
-	        {
-                error = true; // LCOV_EXCL_LINE
-	        }
+            exp          = ((v ? OVFLW_MASK : 0) | (c ? CARRY_MASK : 0)) << 8 | (res & MASK_8BIT);
         }
 
-        // Chekc IRQs ignored when stopped, even when I bit clear
-        if (!error)
-        {
-            // Raise interrupt (I is clear)
-            cpu.activate_irq();
+        // Execute the immediate mode instruction with the test values
+        p_regs->a        = acc;
+        p_regs->flags    = (bcd ? BCD_MASK : 0) | (carry ? CARRY_MASK : 0);
 
-            // Execute again
-            status = cpu.execute();
+        cpu.sr_exec(sub ? SBC_IMM_OPCODE : ADC_IMM_OPCODE, mem_val);
 
-            // Deactivate IRQ
-            cpu.deactivate_irq();
+        uint8_t  flags   = (exp >> 8) | (bcd ? BCD_MASK : 0) | ((exp & SIGN_MASK) ? SIGN_MASK : 0) | ((exp & MASK_8BIT) ? 0 : ZERO_MASK);
 
-            // Check pc = rst_addr+1, and cycles == 0 -- i.e. Still stopped
-	        if (status.pc != rst_addr+1 || status.cycles != 0)
-	        {
-                error = true; // LCOV_EXCL_LINE
-	        }
+        if (p_regs->a != (exp & MASK_8BIT) || p_regs->flags != flags)
+        {
+            error = true; // LCOV_EXCL_LINE
         }
-
-        // Restore reset vector
-        cpu.wr_mem(RESET_VEC_ADDR,    start_addr       & MASK_8BIT);
-        cpu.wr_mem(RESET_VEC_ADDR+1, (start_addr >> 8) & MASK_8BIT);
     }
 
     return error;
@@ -2546,27 +5923,41 @@ bool wait_stop_tests(uint16_t start_addr)
 //
 // -------------------------------------------------------------------------
 
+#ifdef WY65_STATIC_REGISTER
+// Registration function of statically recompiled code linked in with the
+// executable (see the makefile's test_static target)
+void WY65_STATIC_REGISTER (cpu6502* p_cpu);
+#endif
+
 int main (int argc, char** argv)
 {
+    // The model
+    cpu6502            cpu;
 
     bool               read_bin         = true;
     bool               read_srecord     = false;
     bool               disable_testing  = false;
     cpu_type_e         mode_c           = BASE;
+    engine_type_e      engine           = WY65_DEFAULT_ENGINE;
+    bool               en_dcache        = false;
+    bool               en_pair_prof     = false;
     uint16_t           load_addr        = DEFAULT_LOAD_ADDR;
     uint16_t           start_addr       = DEFAULT_START_ADDR;
     uint32_t           start_dis_count  = DEFAULT_START_DIS_CNT;
     uint32_t           stop_dis_count   = DEFAULT_STOP_DIS_CNT;
     uint32_t           instr_count      = 0;
+    double             run_us           = 0;
 
+    std::chrono::steady_clock::time_point run_start;
     wy65_exec_status_t status;
     bool               error            = false;
     char*              fname            = DEFAULT_PROG_FILE_NAME;
+    char*              static_fname     = NULL;
     FILE*              prog_fp          = NULL;
     int                option;
 
     // Process command line options
-    while ((option = getopt(argc, argv, "f:I:M:l:s:S:E:cDh")) != EOF)
+    while ((option = getopt(argc, argv, "f:I:M:l:s:S:E:R:cDtbjCpPh")) != EOF)
     {
         switch(option)
         {
@@ -2597,17 +5988,38 @@ int main (int argc, char** argv)
         case 'E':
             stop_dis_count    = strtol(optarg, NULL, 0);
             break;
+        case 'R':
+            static_fname      = optarg;
+            break;
         case 'c':
             mode_c = WDC; // Turn on all opcodes
             break;
         case 'D':
             disable_testing = true;
             break;
+        case 't':
+            engine = ENGINE_THREADED;
+            break;
+        case 'b':
+            engine = ENGINE_BLOCK;
+            break;
+        case 'j':
+            engine = ENGINE_JIT;
+            break;
+        case 'C':
+            engine = ENGINE_CYCLE;
+            break;
+        case 'p':
+            en_dcache = true;
+            break;
+        case 'P':
+            en_pair_prof = true;
+            break;
         //LCOV_EXCL_START
         case 'h':
         case 'q':
             fprintf(stderr, "Usage: %s [[-f | -I | -M] <filename>][-l <addr>>][-s <addr>]\n"
-                "        [-S <count>][-E <count>][-c][-D]\n\n"
+                "        [-S <count>][-E <count>][-R <filename>][-c][-D][-t|-b|-j|-C][-p][-P]\n\n"
                 "    -f Binary program file name            (default %s)\n"
                 "    -I Intel Hex program file name\n"
                 "    -M Motorola S-Record program file name\n"
@@ -2615,8 +6027,15 @@ int main (int argc, char** argv)
                 "    -s Start address of program execution  (default 0x%04x)\n"
                 "    -S Disassemble start instruction count (default 0x%08x)\n"
                 "    -E Disassemble end instruction count   (default 0x%08x)\n"
+                "    -R Generate static recompiled C++ file and exit\n"
                 "    -c Enable 65C02 features               (default off)\n"
                 "    -D Disable testing and just run prog   (default enabled)\n"
+                "    -t Use threaded interpreter engine     (default off)\n"
+                "    -b Use basic block engine              (default off)\n"
+                "    -j Use basic block engine with JIT     (default off)\n"
+                "    -C Use cycle exact bus engine          (default off)\n"
+                "    -p Enable instruction decode cache     (default off)\n"
+                "    -P Profile instruction pairs (block engine, default off)\n"
                 "\n"
                           , argv[0]
                           , DEFAULT_PROG_FILE_NAME
@@ -2631,6 +6050,17 @@ int main (int argc, char** argv)
         }
     }
 
+    // Select interpreter engine for running the program
+    cpu.set_engine(engine);
+    cpu.enable_decode_cache(en_dcache);
+
+    // Pair profiling counts instructions executed by the block engine
+    if (en_pair_prof)
+    {
+        cpu.set_engine(ENGINE_BLOCK);
+        cpu.enable_pair_profile();
+    }
+
     // Select program format type, based on user selections
     prog_type_e ptype = read_bin ? BIN : read_srecord ? SREC : HEX;
 
@@ -2640,6 +6070,38 @@ int main (int argc, char** argv)
         return BAD_FILE_OPEN;
     }
 
+    // Generate statically recompiled code for the program, if specified, for the
+    // selected CPU variant, and with the start address as an additional entry point
+    if (static_fname != NULL)
+    {
+        FILE* fp = fopen(static_fname, "w");
+
+        if (fp == NULL)
+        {
+            return BAD_FILE_OPEN;
+        }
+
+        // Name the generated code from the file's base name
+        char        name[256];
+        const char* base = strrchr(static_fname, '/') ? strrchr(static_fname, '/') + 1 : static_fname;
+        uint32_t    len  = 0;
+
+        for (; base[len] && base[len] != '.' && len < sizeof(name) - 1; len++)
+        {
+            name[len] = isalnum(base[len]) ? base[len] : '_';
+        }
+        name[len] = 0;
+
+        cpu.reset(mode_c);
+
+        int num_blks = cpu.gen_static_code(fp, name, &start_addr, 1);
+        fclose(fp);
+
+        fprintf(stdout, "Generated %d blocks to %s\n", num_blks, static_fname);
+
+        return GOOD_RTN_STATUS;
+    }
+
     // Load the reset vector with the user start location, if specified
     cpu.wr_mem(RESET_VEC_ADDR,    start_addr       & MASK_8BIT);
     cpu.wr_mem(RESET_VEC_ADDR+1, (start_addr >> 8) & MASK_8BIT);
@@ -2650,7 +6112,7 @@ int main (int argc, char** argv)
 
     if (!disable_testing && !error)
     {
-        error = interrupt_test(mode_c, start_addr);
+        error = interrupt_test(cpu, mode_c, start_addr);
     }
 
     // ------------------------------------
@@ -2660,7 +6122,124 @@ int main (int argc, char** argv)
     // Only execute WAI and STP if selected opcode mode supports these
     if (!disable_testing && !error && mode_c >= WDC)
     {
-        error = wait_stop_tests(start_addr);
+        error = wait_stop_tests(cpu, start_addr);
+    }
+
+    // ------------------------------------
+    // Memory map tests
+    // ------------------------------------
+
+    if (!disable_testing && !error)
+    {
+        error = mem_map_test(cpu);
+    }
+
+    // ------------------------------------
+    // Idle loop detection tests
+    // ------------------------------------
+
+    if (!disable_testing && !error)
+    {
+        error = idle_test(cpu, mode_c, engine);
+    }
+
+    // ------------------------------------
+    // Run until condition tests
+    // ------------------------------------
+
+    if (!disable_testing && !error)
+    {
+        error = run_until_test(cpu, mode_c, engine);
+    }
+
+    // ------------------------------------
+    // Cycle exact engine tests
+    // ------------------------------------
+
+    if (!disable_testing && !error)
+    {
+        error = cycle_test(cpu, mode_c, engine);
+    }
+
+    // ------------------------------------
+    // Zero page pointer wrap tests
+    // ------------------------------------
+
+    if (!disable_testing && !error)
+    {
+        error = zp_wrap_test(mode_c);
+    }
+
+    // ------------------------------------
+    // Unsupported opcode tests
+    // ------------------------------------
+
+    if (!disable_testing && !error)
+    {
+        error = unsupported_test();
+    }
+
+    // ------------------------------------
+    // Pending event tests
+    // ------------------------------------
+
+    if (!disable_testing && !error)
+    {
+        error = event_test(cpu, mode_c, engine);
+    }
+
+    // ------------------------------------
+    // Interrupt injection stress test
+    // ------------------------------------
+
+    if (!disable_testing && !error)
+    {
+        error = inject_test(cpu, mode_c, engine);
+    }
+
+    // ------------------------------------
+    // Fleet runner test
+    // ------------------------------------
+
+    if (!disable_testing && !error)
+    {
+        error = fleet_test(mode_c);
+    }
+
+    // ------------------------------------
+    // Batch engine test
+    // ------------------------------------
+
+    if (!disable_testing && !error)
+    {
+        error = batch_test(mode_c);
+    }
+
+    // ------------------------------------
+    // Fork test
+    // ------------------------------------
+
+    if (!disable_testing && !error)
+    {
+        error = fork_test(mode_c, engine);
+    }
+
+    // ------------------------------------
+    // Shared ROM test
+    // ------------------------------------
+
+    if (!disable_testing && !error)
+    {
+        error = rom_test(mode_c, engine);
+    }
+
+    // ------------------------------------
+    // ADC and SBC tests
+    // ------------------------------------
+
+    if (!disable_testing && !error)
+    {
+        error = alu_test(cpu, mode_c);
     }
 
     // ------------------------------------
@@ -2682,26 +6261,51 @@ int main (int argc, char** argv)
             cpu.wr_mem(TEST_STATUS_ADDR+1, (BAD_TEST_STATUS >> 8) & MASK_8BIT);
         }
 
+#ifdef WY65_STATIC_REGISTER
+        // Register the linked in static code, used by the block and JIT engines
+        // wherever it matches the loaded program
+        WY65_STATIC_REGISTER(&cpu);
+#endif
+
         fprintf(stdout, "Executing %s from address 0x%04x ...\n\n", fname, start_addr); 
 
         // Assert a reset
         cpu.reset();
 
         // Start the clock
-        pre_run_setup();  
+        run_start = std::chrono::steady_clock::now();
 
         // Start executing instructions
         do 
         {
-            prev_pc = status.pc;
+            // Outside of the disassembly window, run at full speed up to the start
+            // of the window (if still to come), or until the program terminates
+            if (instr_count < start_dis_count || instr_count >= stop_dis_count)
+            {
+                uint64_t budget = (instr_count < start_dis_count) ? (uint64_t)(start_dis_count - instr_count) : WY65_NO_LIMIT;
+
+                wy65_run_status_t run_status = cpu.run(budget);
+
+                instr_count += (uint32_t)run_status.instructions;
+                status.pc    = run_status.pc;
 
-            status = cpu.execute(instr_count++, start_dis_count, stop_dis_count, true);
+                // Terminate if looping back to same instruction (i.e. deliberately hung)
+                terminate    = run_status.stop_reason != STOP_INSTR_BUDGET;
+            }
+            else
+            {
+                prev_pc   = status.pc;
+
+                status    = cpu.execute(instr_count++, start_dis_count, stop_dis_count, true);
+
+                // Terminate if looping back to same instruction (i.e. deliberately hung)
+                terminate = prev_pc == status.pc;
+            }
         }
-        // Terminate if looping back to same instruction (i.e. deliberately hung)
-        while (prev_pc != status.pc);
+        while (!terminate);
 
         // Stop the clock
-        post_run_setup();
+        run_us    = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - run_start).count();
 
         if (!disable_testing)
         {
@@ -2724,7 +6328,7 @@ int main (int argc, char** argv)
             fprintf(stdout, "* PASS *\n");
             fprintf(stdout, "********\n\n");
         
-            fprintf(stdout, "Executed %.2f million instructions (%.1f MIPS)\n\n", (float)instr_count/1e6, (float)instr_count/tv_diff);
+            fprintf(stdout, "Executed %.2f million instructions (%.1f MIPS)\n\n", (float)instr_count/1e6, (float)instr_count/run_us);
         }
         // LCOV_EXCL_START
         else
@@ -2742,6 +6346,26 @@ int main (int argc, char** argv)
         fprintf(stderr, "Terminated at PC = 0x%04x after %d instructions\n\n", status.pc, instr_count);
     }
 
+    // -----------------------------------
+    // Display instruction pair profile
+    // -----------------------------------
+
+    if (en_pair_prof)
+    {
+        wy65_pair_count_t counts[PAIR_PROF_DISP_CNT];
+        uint32_t          num = cpu.get_pair_profile(counts, PAIR_PROF_DISP_CNT);
+
+        fprintf(stdout, "Most executed instruction pairs:\n\n");
+
+        for (uint32_t idx = 0; idx < num; idx++)
+        {
+            fprintf(stdout, "    0x%02x 0x%02x %12llu%s\n", counts[idx].pair >> 8, counts[idx].pair & 0xff,
+                            (unsigned long long)counts[idx].count, counts[idx].fusible ? " (fused)" : "");
+        }
+
+        fprintf(stdout, "\n");
+    }
+
     return GOOD_RTN_STATUS;
 }
 
@@ -58,6 +58,7 @@ extern int optind;
 #define DEFAULT_START_ADDR       0x0400
 #define DEFAULT_START_DIS_CNT    0xffffffff
 #define DEFAULT_STOP_DIS_CNT     0xffffffff
+#define PAIR_PROF_DISP_CNT       16
 #define BAD_TEST_STATUS          0x0bad
 #define GOOD_TEST_STATUS         0x900d
 #define GOOD_RTN_STATUS          0
@@ -91,10 +92,34 @@ extern int optind;
 #define MASK_16BIT               0xffffU
 #define MASK_32BIT               0xffffffffU
 
+// Decimal mode ADC/SBC lookup table entries, for each accumulator and operand value
+#define WY65_BCD_TBL_SIZE        0x10000
+
 #define NOP_OPCODE_BASE          0xea
 #define CLI_OPCODE               0x58
 #define WAI_OPCODE               0xcb
 #define STP_OPCODE               0xdb
+#define ADC_IMM_OPCODE           0x69
+#define SBC_IMM_OPCODE           0xe9
+#define LDA_ABS_OPCODE           0xad
+#define LDA_IMM_OPCODE           0xa9
+#define INC_ABS_OPCODE           0xee
+#define BEQ_OPCODE               0xf0
+#define BCC_OPCODE               0x90
+#define JSR_OPCODE               0x20
+#define RTS_OPCODE               0x60
+#define CLC_OPCODE               0x18
+#define STA_ABS_OPCODE           0x8d
+#define BNE_OPCODE               0xd0
+#define JMP_ABS_OPCODE           0x4c
+#define LDX_IMM_OPCODE           0xa2
+#define LDA_ABX_OPCODE           0xbd
+#define PHA_OPCODE               0x48
+#define RTI_OPCODE               0x40
+#define INX_OPCODE               0xe8
+#define LDY_IMM_OPCODE           0xa0
+#define STY_ZPG_OPCODE           0x84
+#define DEX_OPCODE               0xca
 
 #define NMI_VEC_ADDR             0xfffa
 #define RESET_VEC_ADDR           0xfffc
@@ -104,6 +129,40 @@ extern int optind;
 #define TEST_ADDR2               0xfff2
 #define TEST_STATUS_ADDR         0xfff8
 #define TEST_ADDR3               0x0400
+#define TEST_MAP_ADDR            0xe000
+#define TEST_IDLE_ADDR           0xe400
+#define TEST_UNTIL_ADDR          0xe500
+#define TEST_CYCLE_ADDR          0xe600
+#define TEST_CYCLE_LOG_SIZE      64
+#define TEST_WRAP_ADDR           0x0200
+#define TEST_UNSUP_ADDR          0x0200
+#define TEST_EVENT_ADDR          0xe700
+#define TEST_INJECT_ADDR         0xe800
+#define TEST_INJECT_IO_ADDR      0xe900
+#define TEST_INJECT_IRQ_ID       1
+#define TEST_INJECT_COUNT        2000
+#define TEST_INJECT_BUDGET       1000
+#define TEST_INJECT_TIMEOUT_S    10
+#define TEST_FLEET_ADDR          0x0200
+#define TEST_FLEET_RESULT_ADDR   0x0010
+#define TEST_FLEET_PROG_SIZE     12
+#define TEST_FLEET_WORKERS       4
+#define TEST_FLEET_JOBS          500
+#define TEST_BATCH_ADDR          0x02f8
+#define TEST_BATCH_SUB_ADDR      0x0250
+#define TEST_BATCH_NMI_ADDR      0x0260
+#define TEST_BATCH_IN_ADDR       0x0010
+#define TEST_BATCH_LANES         40
+#define TEST_BATCH_INSTRS        5000
+#define TEST_FORK_INPUTS         3
+#define TEST_FORK_INSTRS         3000
+#define TEST_FORK_HOST_ADDR      0x1000
+#define TEST_ROM_ADDR            0x8000
+#define TEST_ROM_SIZE            0x8000
+#define TEST_ROM_WR_ADDR         0x8100
+#define TEST_ROM_IN_ADDR         0x0010
+#define TEST_ROM_MODELS          4
+#define TEST_ROM_INSTRS          1000
 
 // The 65C02 0x4B NOP instruction needs to be a two byte instruction
 // (apparently) when running on the BeeEm platform. Otherwise some programs
@@ -118,4 +177,275 @@ extern int optind;
 #define N4B                      NON /* Single byte instruction */
 #endif
 
+// Instruction table definition, in opcode order. Each entry gives the
+// opcode, mnemonic, instruction method, minimum execution cycles, addressing
+// mode and the CPU variant that introduced the instruction. The table is
+// expanded with a user supplied macro _X(opcode, str, func, cycles, mode, cpu)
+// wherever the instruction set is needed (e.g. the constructor's instruction
+// table initialisation and the threaded interpreter's opcode bodies).
+
+#define WY65_OPCODE_TABLE(_X) \
+    _X(0x00, "BRK",  BRK, 7, NON, BASE)                \
+    _X(0x01, "ORA",  ORA, 6, IDX, BASE)                \
+    _X(0x02, "NOP",  NOP, 2, IMM, C02 )                \
+    _X(0x03, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0x04, "TSB",  TSB, 5, ZPG, C02 ) /* 65C02 */    \
+    _X(0x05, "ORA",  ORA, 3, ZPG, BASE)                \
+    _X(0x06, "ASL",  ASL, 5, ZPG, BASE)                \
+    _X(0x07, "RMB0", RMB, 5, ZPG, WRK ) /* WDC65C02 */ \
+    _X(0x08, "PHP",  PHP, 3, NON, BASE)                \
+    _X(0x09, "ORA",  ORA, 2, IMM, BASE)                \
+    _X(0x0A, "ASL",  ASL, 2, ACC, BASE)                \
+    _X(0x0B, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0x0C, "TSB",  TSB, 6, ABS, C02 ) /* 65C02 */    \
+    _X(0x0D, "ORA",  ORA, 4, ABS, BASE)                \
+    _X(0x0E, "ASL",  ASL, 6, ABS, BASE)                \
+    _X(0x0F, "BBR0", BBR, 5, ZPR, WRK ) /* WDC65C02 */ \
+    _X(0x10, "BPL",  BPL, 2, REL, BASE)                \
+    _X(0x11, "ORA",  ORA, 5, IDY, BASE)                \
+    _X(0x12, "ORA",  ORA, 5, IDZ, C02 ) /* 65C02 */    \
+    _X(0x13, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0x14, "TRB",  TRB, 5, ZPG, C02 ) /* 65C02 */    \
+    _X(0x15, "ORA",  ORA, 4, ZPX, BASE)                \
+    _X(0x16, "ASL",  ASL, 6, ZPX, BASE)                \
+    _X(0x17, "RMB1", RMB, 5, ZPG, WRK ) /* WDC65C02 */ \
+    _X(0x18, "CLC",  CLC, 2, NON, BASE)                \
+    _X(0x19, "ORA",  ORA, 4, ABY, BASE)                \
+    _X(0x1A, "INC",  INC, 2, ACC, C02 ) /* 65C02 */    \
+    _X(0x1B, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0x1C, "TRB",  TRB, 6, ABS, C02 ) /* 65C02 */    \
+    _X(0x1D, "ORA",  ORA, 4, ABX, BASE)                \
+    _X(0x1E, "ASL",  ASL, 7, ABX, BASE)                \
+    _X(0x1F, "BBR1", BBR, 5, ZPR, WRK ) /* WDC65C02 */ \
+    _X(0x20, "JSR",  JSR, 6, ABS, BASE)                \
+    _X(0x21, "AND",  AND, 6, IDX, BASE)                \
+    _X(0x22, "NOP",  NOP, 2, IMM, C02 )                \
+    _X(0x23, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0x24, "BIT",  BIT, 3, ZPG, BASE)                \
+    _X(0x25, "AND",  AND, 3, ZPG, BASE)                \
+    _X(0x26, "ROL",  ROL, 5, ZPG, BASE)                \
+    _X(0x27, "RMB2", RMB, 5, ZPG, WRK ) /* WDC65C02 */ \
+    _X(0x28, "PLP",  PLP, 4, NON, BASE)                \
+    _X(0x29, "AND",  AND, 2, IMM, BASE)                \
+    _X(0x2A, "ROL",  ROL, 2, ACC, BASE)                \
+    _X(0x2B, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0x2C, "BIT",  BIT, 4, ABS, BASE)                \
+    _X(0x2D, "AND",  AND, 4, ABS, BASE)                \
+    _X(0x2E, "ROL",  ROL, 6, ABS, BASE)                \
+    _X(0x2F, "BBR2", BBR, 5, ZPR, WRK ) /* WDC65C02 */ \
+    _X(0x30, "BMI",  BMI, 2, REL, BASE)                \
+    _X(0x31, "AND",  AND, 5, IDY, BASE)                \
+    _X(0x32, "AND",  AND, 5, IDZ, C02 ) /* 65C02 */    \
+    _X(0x33, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0x34, "BIT",  BIT, 4, ZPX, C02 ) /* 65C02 */    \
+    _X(0x35, "AND",  AND, 4, ZPX, BASE)                \
+    _X(0x36, "ROL",  ROL, 6, ZPX, BASE)                \
+    _X(0x37, "RMB3", RMB, 5, ZPG, WRK ) /* WDC65C02 */ \
+    _X(0x38, "SEC",  SEC, 2, NON, BASE)                \
+    _X(0x39, "AND",  AND, 4, ABY, BASE)                \
+    _X(0x3A, "DEC",  DEC, 2, ACC, C02 ) /* 65C02 */    \
+    _X(0x3B, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0x3C, "BIT",  BIT, 4, ABX, C02 ) /* 65C02 */    \
+    _X(0x3D, "AND",  AND, 4, ABX, BASE)                \
+    _X(0x3E, "ROL",  ROL, 7, ABX, BASE)                \
+    _X(0x3F, "BBR3", BBR, 5, ZPR, WRK ) /* WDC65C02 */ \
+    _X(0x40, "RTI",  RTI, 6, NON, BASE)                \
+    _X(0x41, "EOR",  EOR, 6, IDX, BASE)                \
+    _X(0x42, "NOP",  NOP, 2, IMM, C02 )                \
+    _X(0x43, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0x44, "NOP",  NOP, 3, ZPG, C02 )                \
+    _X(0x45, "EOR",  EOR, 3, ZPG, BASE)                \
+    _X(0x46, "LSR",  LSR, 5, ZPG, BASE)                \
+    _X(0x47, "RMB4", RMB, 5, ZPG, WRK ) /* WDC65C02 */ \
+    _X(0x48, "PHA",  PHA, 3, NON, BASE)                \
+    _X(0x49, "EOR",  EOR, 2, IMM, BASE)                \
+    _X(0x4A, "LSR",  LSR, 2, ACC, BASE)                \
+    _X(0x4B, "NOP",  NOP, 1, N4B, C02 )                \
+    _X(0x4C, "JMP",  JMP, 3, ABS, BASE)                \
+    _X(0x4D, "EOR",  EOR, 4, ABS, BASE)                \
+    _X(0x4E, "LSR",  LSR, 6, ABS, BASE)                \
+    _X(0x4F, "BBR4", BBR, 5, ZPR, WRK ) /* WDC65C02 */ \
+    _X(0x50, "BVC",  BVC, 2, REL, BASE)                \
+    _X(0x51, "EOR",  EOR, 5, IDY, BASE)                \
+    _X(0x52, "EOR",  EOR, 5, IDZ, BASE)                \
+    _X(0x53, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0x54, "NOP",  NOP, 4, ZPX, C02 )                \
+    _X(0x55, "EOR",  EOR, 4, ZPX, BASE)                \
+    _X(0x56, "LSR",  LSR, 6, ZPX, BASE)                \
+    _X(0x57, "RMB5", RMB, 5, ZPG, WRK ) /* WDC65C02 */ \
+    _X(0x58, "CLI",  CLI, 2, NON, BASE)                \
+    _X(0x59, "EOR",  EOR, 4, ABY, BASE)                \
+    _X(0x5A, "PHY",  PHY, 3, NON, C02 )                \
+    _X(0x5B, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0x5C, "NOP",  NOP, 8, ABX, C02 )                \
+    _X(0x5D, "EOR",  EOR, 4, ABX, BASE)                \
+    _X(0x5E, "LSR",  LSR, 7, ABX, BASE)                \
+    _X(0x5F, "BBR5", BBR, 5, ZPR, WRK ) /* WDC65C02 */ \
+    _X(0x60, "RTS",  RTS, 6, NON, BASE)                \
+    _X(0x61, "ADC",  ADC, 6, IDX, BASE)                \
+    _X(0x62, "NOP",  NOP, 2, IMM, C02 )                \
+    _X(0x63, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0x64, "STZ",  STZ, 3, ZPG, C02 ) /* 65C02 */    \
+    _X(0x65, "ADC",  ADC, 3, ZPG, BASE)                \
+    _X(0x66, "ROR",  ROR, 5, ZPG, BASE)                \
+    _X(0x67, "RMB6", RMB, 5, ZPG, WRK ) /* WDC65C02 */ \
+    _X(0x68, "PLA",  PLA, 4, NON, BASE)                \
+    _X(0x69, "ADC",  ADC, 2, IMM, BASE)                \
+    _X(0x6A, "ROR",  ROR, 2, ACC, BASE)                \
+    _X(0x6B, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0x6C, "JMP",  JMP, 5, IND, BASE)                \
+    _X(0x6D, "ADC",  ADC, 4, ABS, BASE)                \
+    _X(0x6E, "ROR",  ROR, 6, ABS, BASE)                \
+    _X(0x6F, "BBR6", BBR, 5, ZPR, WRK ) /* WDC65C02 */ \
+    _X(0x70, "BVS",  BVS, 2, REL, BASE)                \
+    _X(0x71, "ADC",  ADC, 5, IDY, BASE)                \
+    _X(0x72, "ADC",  ADC, 5, IDZ, C02 ) /* 65C02 */    \
+    _X(0x73, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0x74, "STZ",  STZ, 4, ZPX, C02 ) /* 65C02 */    \
+    _X(0x75, "ADC",  ADC, 4, ZPX, BASE)                \
+    _X(0x76, "ROR",  ROR, 6, ZPX, BASE)                \
+    _X(0x77, "RMB7", RMB, 5, ZPG, WRK ) /* WDC65C02 */ \
+    _X(0x78, "SEI",  SEI, 2, NON, BASE)                \
+    _X(0x79, "ADC",  ADC, 4, ABY, BASE)                \
+    _X(0x7A, "PLY",  PLY, 4, NON, C02 )                \
+    _X(0x7B, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0x7C, "JMP",  JMP, 6, IAX, C02 ) /* 65C02 */    \
+    _X(0x7D, "ADC",  ADC, 4, ABX, BASE)                \
+    _X(0x7E, "ROR",  ROR, 7, ABX, BASE)                \
+    _X(0x7F, "BBR7", BBR, 5, ZPR, WRK ) /* WDC65C02 */ \
+    _X(0x80, "BRA",  BRA, 3, REL, C02 ) /* 65C02 */    \
+    _X(0x81, "STA",  STA, 6, IDX, BASE)                \
+    _X(0x82, "NOP",  NOP, 2, IMM, C02 )                \
+    _X(0x83, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0x84, "STY",  STY, 3, ZPG, BASE)                \
+    _X(0x85, "STA",  STA, 3, ZPG, BASE)                \
+    _X(0x86, "STX",  STX, 3, ZPG, BASE)                \
+    _X(0x87, "SMB0", SMB, 5, ZPG, WRK ) /* WDC65C02 */ \
+    _X(0x88, "DEY",  DEY, 2, NON, BASE)                \
+    _X(0x89, "BIT",  BIT, 2, IMM, C02 ) /* 65C02 */    \
+    _X(0x8A, "TXA",  TXA, 2, NON, BASE)                \
+    _X(0x8B, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0x8C, "STY",  STY, 4, ABS, BASE)                \
+    _X(0x8D, "STA",  STA, 4, ABS, BASE)                \
+    _X(0x8E, "STX",  STX, 4, ABS, BASE)                \
+    _X(0x8F, "BBS0", BBS, 5, ZPR, WRK ) /* WDC65C02 */ \
+    _X(0x90, "BCC",  BCC, 2, REL, BASE)                \
+    _X(0x91, "STA",  STA, 6, IDY, BASE)                \
+    _X(0x92, "STA",  STA, 5, IDZ, C02 ) /* 65C02 */    \
+    _X(0x93, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0x94, "STY",  STY, 4, ZPX, BASE)                \
+    _X(0x95, "STA",  STA, 4, ZPX, BASE)                \
+    _X(0x96, "STX",  STX, 4, ZPY, BASE)                \
+    _X(0x97, "SMB1", SMB, 5, ZPG, WRK ) /* WDC65C02 */ \
+    _X(0x98, "TYA",  TYA, 2, NON, BASE)                \
+    _X(0x99, "STA",  STA, 5, ABY, BASE)                \
+    _X(0x9A, "TXS",  TXS, 2, NON, BASE)                \
+    _X(0x9B, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0x9C, "STZ",  STZ, 4, ABS, C02 ) /* 65C02 */    \
+    _X(0x9D, "STA",  STA, 5, ABX, BASE)                \
+    _X(0x9E, "STZ",  STZ, 5, ABX, C02 ) /* 65C02 */    \
+    _X(0x9F, "BBS1", BBS, 5, ZPR, WRK ) /* WDC65C02 */ \
+    _X(0xA0, "LDY",  LDY, 2, IMM, BASE)                \
+    _X(0xA1, "LDA",  LDA, 6, IDX, BASE)                \
+    _X(0xA2, "LDX",  LDX, 2, IMM, BASE)                \
+    _X(0xA3, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0xA4, "LDY",  LDY, 3, ZPG, BASE)                \
+    _X(0xA5, "LDA",  LDA, 3, ZPG, BASE)                \
+    _X(0xA6, "LDX",  LDX, 3, ZPG, BASE)                \
+    _X(0xA7, "SMB2", SMB, 5, ZPG, WRK ) /* WDC65C02 */ \
+    _X(0xA8, "TAY",  TAY, 2, NON, BASE)                \
+    _X(0xA9, "LDA",  LDA, 2, IMM, BASE)                \
+    _X(0xAA, "TAX",  TAX, 2, NON, BASE)                \
+    _X(0xAB, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0xAC, "LDY",  LDY, 4, ABS, BASE)                \
+    _X(0xAD, "LDA",  LDA, 4, ABS, BASE)                \
+    _X(0xAE, "LDX",  LDX, 4, ABS, BASE)                \
+    _X(0xAF, "BBS2", BBS, 5, ZPR, WRK ) /* WDC65C02 */ \
+    _X(0xB0, "BCS",  BCS, 2, REL, BASE)                \
+    _X(0xB1, "LDA",  LDA, 5, IDY, BASE)                \
+    _X(0xB2, "LDA",  LDA, 5, IDZ, C02 ) /* 65C02 */    \
+    _X(0xB3, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0xB4, "LDY",  LDY, 4, ZPX, BASE)                \
+    _X(0xB5, "LDA",  LDA, 4, ZPX, BASE)                \
+    _X(0xB6, "LDX",  LDX, 4, ZPY, BASE)                \
+    _X(0xB7, "SMB3", SMB, 5, ZPG, WRK ) /* WDC65C02 */ \
+    _X(0xB8, "CLV",  CLV, 2, NON, BASE)                \
+    _X(0xB9, "LDA",  LDA, 4, ABY, BASE)                \
+    _X(0xBA, "TSX",  TSX, 2, NON, BASE)                \
+    _X(0xBB, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0xBC, "LDY",  LDY, 4, ABX, BASE)                \
+    _X(0xBD, "LDA",  LDA, 4, ABX, BASE)                \
+    _X(0xBE, "LDX",  LDX, 4, ABY, BASE)                \
+    _X(0xBF, "BBS3", BBS, 5, ZPR, WRK ) /* WDC65C02 */ \
+    _X(0xC0, "CPY",  CPY, 2, IMM, BASE)                \
+    _X(0xC1, "CMP",  CMP, 6, IDX, BASE)                \
+    _X(0xC2, "NOP",  NOP, 2, IMM, C02 )                \
+    _X(0xC3, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0xC4, "CPY",  CPY, 3, ZPG, BASE)                \
+    _X(0xC5, "CMP",  CMP, 3, ZPG, BASE)                \
+    _X(0xC6, "DEC",  DEC, 5, ZPG, BASE)                \
+    _X(0xC7, "SMB4", SMB, 5, ZPG, WRK ) /* WDC65C02 */ \
+    _X(0xC8, "INY",  INY, 2, NON, BASE)                \
+    _X(0xC9, "CMP",  CMP, 2, IMM, BASE)                \
+    _X(0xCA, "DEX",  DEX, 2, NON, BASE)                \
+    _X(0xCB, "WAI",  WAI, 3, NON, WDC ) /* WDC65C02 */ \
+    _X(0xCC, "CPY",  CPY, 4, ABS, BASE)                \
+    _X(0xCD, "CMP",  CMP, 4, ABS, BASE)                \
+    _X(0xCE, "DEC",  DEC, 6, ABS, BASE)                \
+    _X(0xCF, "BBS4", BBS, 5, ZPR, WRK ) /* WDC65C02 */ \
+    _X(0xD0, "BNE",  BNE, 2, REL, BASE)                \
+    _X(0xD1, "CMP",  CMP, 5, IDY, BASE)                \
+    _X(0xD2, "CMP",  CMP, 5, IDZ, C02 ) /* 65C02 */    \
+    _X(0xD3, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0xD4, "NOP",  NOP, 4, ZPX, C02 )                \
+    _X(0xD5, "CMP",  CMP, 4, ZPX, BASE)                \
+    _X(0xD6, "DEC",  DEC, 6, ZPX, BASE)                \
+    _X(0xD7, "SMB5", SMB, 5, ZPG, WRK ) /* WDC65C02 */ \
+    _X(0xD8, "CLD",  CLD, 2, NON, BASE)                \
+    _X(0xD9, "CMP",  CMP, 4, ABY, BASE)                \
+    _X(0xDA, "PHX",  PHX, 3, NON, C02 )                \
+    _X(0xDB, "STP",  STP, 3, NON, WDC ) /* WDC65C02 */ \
+    _X(0xDC, "NOP",  NOP, 4, ABS, C02 )                \
+    _X(0xDD, "CMP",  CMP, 4, ABX, BASE)                \
+    _X(0xDE, "DEC",  DEC, 7, ABX, BASE)                \
+    _X(0xDF, "BBS5", BBS, 5, ZPR, WRK ) /* WDC65C02 */ \
+    _X(0xE0, "CPX",  CPX, 2, IMM, BASE)                \
+    _X(0xE1, "SBC",  SBC, 6, IDX, BASE)                \
+    _X(0xE2, "NOP",  NOP, 2, IMM, C02 )                \
+    _X(0xE3, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0xE4, "CPX",  CPX, 3, ZPG, BASE)                \
+    _X(0xE5, "SBC",  SBC, 3, ZPG, BASE)                \
+    _X(0xE6, "INC",  INC, 5, ZPG, BASE)                \
+    _X(0xE7, "SMB6", SMB, 5, ZPG, WRK ) /* WDC65C02 */ \
+    _X(0xE8, "INX",  INX, 2, NON, BASE)                \
+    _X(0xE9, "SBC",  SBC, 2, IMM, BASE)                \
+    _X(0xEA, "NOP",  NOP, 2, NON, BASE)                \
+    _X(0xEB, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0xEC, "CPX",  CPX, 4, ABS, BASE)                \
+    _X(0xED, "SBC",  SBC, 4, ABS, BASE)                \
+    _X(0xEE, "INC",  INC, 6, ABS, BASE)                \
+    _X(0xEF, "BBS6", BBS, 5, ZPR, WRK ) /* WDC65C02 */ \
+    _X(0xF0, "BEQ",  BEQ, 2, REL, BASE)                \
+    _X(0xF1, "SBC",  SBC, 5, IDY, BASE)                \
+    _X(0xF2, "SBC",  SBC, 5, IDZ, C02 ) /* 65C02 */    \
+    _X(0xF3, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0xF4, "NOP",  NOP, 4, ZPX, C02 )                \
+    _X(0xF5, "SBC",  SBC, 4, ZPX, BASE)                \
+    _X(0xF6, "INC",  INC, 6, ZPX, BASE)                \
+    _X(0xF7, "SMB7", SMB, 5, ZPG, WRK ) /* WDC65C02 */ \
+    _X(0xF8, "SED",  SED, 2, NON, BASE)                \
+    _X(0xF9, "SBC",  SBC, 4, ABY, BASE)                \
+    _X(0xFA, "PLX",  PLX, 4, NON, C02 )                \
+    _X(0xFB, "NOP",  NOP, 1, NON, C02 )                \
+    _X(0xFC, "NOP",  NOP, 4, ABS, C02 )                \
+    _X(0xFD, "SBC",  SBC, 4, ABX, BASE)                \
+    _X(0xFE, "INC",  INC, 7, ABX, BASE)                \
+    _X(0xFF, "BBS7", BBS, 5, ZPR, WRK ) /* WDC65C02 */
+
+// Computed goto (a GCC/Clang extension) is used for threaded dispatch when
+// available. Define WY65_NO_COMPUTED_GOTO to use a switch statement instead.
+#if defined(__GNUC__) && !defined(WY65_NO_COMPUTED_GOTO)
+#define WY65_COMPUTED_GOTO
+#endif
+
 #endif
\ No newline at end of file
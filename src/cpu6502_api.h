@@ -33,13 +33,18 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
+#include <atomic>
 
 // -------------------------------------------------------------------------
 // DEFINES (override-able)
 // -------------------------------------------------------------------------
 
 // Allow internal memory size to be overridden at compile time, with a 
-// default size of 65536 (the maximum addressable space).
+// default size of 65536 (the maximum addressable space). With a smaller
+// size, reads of unmapped addresses beyond internal memory return 0 and
+// writes are discarded, so a model whose ROM (or other memory) is mapped
+// with map_rom_pages() or map_mem_pages() need only hold its RAM.
 #ifndef WY65_MEM_SIZE
 #define WY65_MEM_SIZE                 0x10000
 #endif
@@ -52,12 +57,57 @@
 
 // #define WY65_EN_PRINT_CYCLES
 
+// Default disassembly output file name (see set_dis_output()), and the
+// maximum length of a name, including its terminating NUL
+#ifndef WY65_DIS_FNAME
+#define WY65_DIS_FNAME                "cpu6502.log"
+#endif
+
+#ifndef WY65_DIS_FNAME_SIZE
+#define WY65_DIS_FNAME_SIZE           256
+#endif
+
 // Define LIB6502_DLL_LINKAGE in windows projects that will link to lib6502 
 // as a DLL, else leave undefined for projects that compile in the source 
 // code as part of their project.
 
 // #define LIB6502_DLL_LINKAGE
 
+// Select the interpreter engine used by run() at construction. Can be changed
+// at run time with set_engine(). Default is the table dispatch interpreter.
+#ifndef WY65_DEFAULT_ENGINE
+#define WY65_DEFAULT_ENGINE           ENGINE_INTERP
+#endif
+
+// Size of the micro-op pool for blocks in the block engine. When full, all
+// blocks are discarded and rebuilt as executed.
+#ifndef WY65_BLOCK_POOL_SIZE
+#define WY65_BLOCK_POOL_SIZE          0x10000
+#endif
+
+// Number of executions of a block in the JIT engine before it is compiled
+// to native code, and the size of the native code buffer
+#ifndef WY65_JIT_THRESHOLD
+#define WY65_JIT_THRESHOLD            16
+#endif
+
+#ifndef WY65_JIT_CODE_SIZE
+#define WY65_JIT_CODE_SIZE            0x1000000
+#endif
+
+// Time for which run_forever() yields the host thread when the program is
+// idle, waiting, stopped or hung, in microseconds
+#ifndef WY65_IDLE_SLEEP_US
+#define WY65_IDLE_SLEEP_US            1000
+#endif
+
+// Define WY65_BUS as a host memory bus class (see wy65_cb_bus_t), and
+// WY65_BUS_HDR as the header defining it, to instantiate the model for that
+// bus, as cpu6502_core<WY65_BUS>, in addition to cpu6502.
+
+// #define WY65_BUS                   my_bus_t
+// #define WY65_BUS_HDR               my_bus.h
+
 #define PUBLIC  public
 #ifndef BITMATCH
 #define PRIVATE private
@@ -72,6 +122,40 @@
 // The 8 bit architecture give a maximum of 256 possible opcodes.
 #define WY65_INSTR_SPACE_SIZE         256
 
+// Number of supported CPU variants (BASE, C02, WRK and WDC)
+#define WY65_NUM_CPU_TYPES            4
+
+// Size of the 6502 address space (independent of WY65_MEM_SIZE)
+#define WY65_ADDR_SPACE_SIZE          0x10000
+
+// Granularity of regions declared as ROM for the decode cache
+#define WY65_ROM_PAGE_BITS            8
+#define WY65_ROM_PAGE_SIZE            (1 << WY65_ROM_PAGE_BITS)
+
+// Page size and number of pages for the memory map page table
+#define WY65_MAP_PAGE_BITS            8
+#define WY65_MAP_PAGE_SIZE            (1 << WY65_MAP_PAGE_BITS)
+#define WY65_NUM_MAP_PAGES            (WY65_ADDR_SPACE_SIZE >> WY65_MAP_PAGE_BITS)
+
+// Maximum length of a basic block for the block engine, in instructions and bytes
+#define WY65_MAX_BLOCK_INSTRS         32
+#define WY65_MAX_BLOCK_BYTES          (WY65_MAX_BLOCK_INSTRS * 3)
+
+// Number of fusible instruction pairs (see fuse_tbl)
+#define WY65_NUM_FUSE_PAIRS           130
+
+// Budget value for run() meaning no limit
+#define WY65_NO_LIMIT                 0xffffffffffffffffULL
+
+// Number of backward branches or jumps elsewhere (e.g. subroutine calls and
+// returns) allowed within a loop for it to be detected as idle
+#define WY65_IDLE_MAX_MISSES          8
+
+// Native code generation for the JIT engine (x86-64 Linux hosts only)
+#if defined(__x86_64__) && defined(__linux__) && !defined(WY65_NO_JIT)
+#define WY65_JIT
+#endif
+
 #if (defined(_WIN32) || defined(_WIN64)) && defined (LIB6502_DLL_LINKAGE)
 // The DLL build needs to export, whereas those linking to it need import definitions
 # ifdef LIB6502_EXPORTS
@@ -96,6 +180,38 @@ enum cpu_type_e {
     DEFAULT   // Use default (or existing) mode
 };
 
+// Enumerated type for interpreter engine used by run()
+enum engine_type_e {
+    ENGINE_INTERP   = 0, // Instruction table dispatch via method pointers (as execute())
+    ENGINE_THREADED = 1, // Threaded code with inlined opcode bodies
+    ENGINE_BLOCK    = 2, // Cached basic blocks of decoded instructions
+    ENGINE_JIT      = 3, // As ENGINE_BLOCK, with hot blocks compiled to native code
+                         // (x86-64 Linux only, else same as ENGINE_BLOCK)
+    ENGINE_CYCLE    = 4  // Cycle exact bus engine, making every bus cycle of each
+                         // instruction in hardware order (see cpu6502_cycle.cpp)
+};
+
+// Type of a bus cycle made by the cycle exact engine
+enum bus_cycle_e {
+    BUS_OPCODE,          // Opcode fetch
+    BUS_READ,            // Operand, pointer, data or stack read
+    BUS_WRITE,           // Data or stack write
+    BUS_DUMMY_READ,      // Read with the data discarded
+    BUS_DUMMY_WRITE      // Write of the unmodified data by a base 6502 read-modify-write
+};
+
+// Bus cycle made by the cycle exact engine, as reported to a function registered
+// with register_bus_cycle_func()
+typedef struct
+{
+    uint64_t          cycle;         // Cycle count at the bus cycle
+    uint16_t          addr;
+    uint8_t           data;          // Data read or written
+    bus_cycle_e       type;
+} wy65_bus_cycle_t;
+
+typedef void (*wy65_p_bus_cycle_t)(void* p_ctx, const wy65_bus_cycle_t* p_cycle);
+
 enum prog_type_e {
     BIN,
     HEX,
@@ -111,6 +227,44 @@ typedef struct
 
 } wy65_exec_status_t;
 
+// Enumerated type for the reason a run() call returned
+enum run_stop_e {
+    STOP_INSTR_BUDGET,   // Instruction budget exhausted
+    STOP_CYCLE_BUDGET,   // Cycle budget exhausted
+    STOP_SELF_LOOP,      // Instruction branched or jumped to itself (e.g. JMP *)
+    STOP_WAITING,        // WAI executed with no active interrupt
+    STOP_HALTED,         // STP executed
+    STOP_EVENT,          // Stop requested by host via request_stop()
+    STOP_IDLE,           // Program is in an idle loop (see enable_idle_detect())
+    STOP_PC,             // PC reached the run_until() address
+    STOP_MEM             // Memory reached the run_until() value
+};
+
+// Stop conditions for run_until(), in addition to branch/jump to self, WAI
+// and STP, as for run()
+typedef struct
+{
+    uint64_t          max_instructions;  // Instruction budget (WY65_NO_LIMIT for none)
+    uint64_t          max_cycles;        // Cycle budget (WY65_NO_LIMIT for none)
+    bool              stop_on_pc;        // Stop when the PC reaches pc
+    uint16_t          pc;
+    bool              stop_on_mem;       // Stop when a write makes memory at mem_addr equal to
+    uint16_t          mem_addr;          // mem_value (a 16 bit little endian value if mem_word)
+    uint16_t          mem_value;
+    bool              mem_word;
+} wy65_run_until_t;
+
+// Structure for return status of run() function
+typedef struct
+{
+    uint16_t          pc;            // PC value after last instruction
+    uint8_t           flags;
+    uint64_t          instructions;  // Number of instructions executed in the call
+    uint64_t          cycles;        // Number of cycles elapsed in the call
+    run_stop_e        stop_reason;
+
+} wy65_run_status_t;
+
 // Structure for model's registers
 typedef struct
 {
@@ -135,16 +289,121 @@ typedef struct
     bool              stopped;
 } wy65_cpu_state_t;
 
+// Execution count of an adjacent instruction pair, from the pair profile
+typedef struct
+{
+    uint16_t          pair;          // First opcode in upper byte, second in lower
+    bool              fusible;       // Pair has a fused handler
+    uint64_t          count;
+} wy65_pair_count_t;
+
+// Return value of a statically recompiled block function
+typedef struct
+{
+    uint32_t          cycles;
+    uint16_t          instructions;
+    uint16_t          last_pc;       // PC of last instruction executed in the block
+} wy65_static_rtn_t;
+
+// Statically recompiled block, as generated by gen_static_code(), and its function,
+// called with a pointer to the model (of whichever bus type the code was built for)
+typedef wy65_static_rtn_t (*wy65_static_fn_t)(void* p_cpu);
+
+typedef struct
+{
+    uint16_t          entry_pc;
+    uint16_t          num_instrs;
+    uint16_t          num_bytes;
+    const uint8_t*    p_code;        // Code bytes the block was compiled from
+    wy65_static_fn_t  pFunc;
+} wy65_static_blk_t;
+
 // Define required types for external memory access functions
 typedef void (*wy65_p_writemem_t)(int, unsigned char);
 typedef int  (*wy65_p_readmem_t) (int);
 
+// External memory access functions called with a host context pointer, as
+// registered with the function, so that host state need not be global
+typedef void (*wy65_p_writemem_ctx_t)(void* p_ctx, int, unsigned char);
+typedef int  (*wy65_p_readmem_ctx_t) (void* p_ctx, int);
+
+// Adapters calling a function without a context, registered as the context
+inline void wy65_writemem_adapter (void* p_ctx, int addr, unsigned char data) { reinterpret_cast<wy65_p_writemem_t>(p_ctx)(addr, data); }
+inline int  wy65_readmem_adapter  (void* p_ctx, int addr)                     { return reinterpret_cast<wy65_p_readmem_t>(p_ctx)(addr); }
+
+// Memory map page table entry. Reads of a page are made directly from p_rd
+// if set, else via rd_func, and writes directly to p_wr if set, else via
+// wr_func. A mapped page with neither for writes is write protected. Pages
+// with nothing mapped use the memory bus or, when the bus does not take
+// accesses, point p_rd and p_wr to the internal memory for the page.
+typedef struct
+{
+    uint8_t*              p_rd;      // Host memory for reads, or NULL
+    uint8_t*              p_wr;      // Host memory for writes, or NULL
+    wy65_p_readmem_ctx_t  rd_func;   // Device read handler, or NULL
+    wy65_p_writemem_ctx_t wr_func;   // Device write handler, or NULL
+    void*                 p_rd_ctx;  // Contexts passed to the handlers
+    void*                 p_wr_ctx;
+} wy65_page_t;
+
+// -------------------------------------------------------------------------
+// MEMORY BUS DEFINITION
+// -------------------------------------------------------------------------
+
+// The model's memory accesses are made via a bus class, a template parameter
+// of cpu6502_core. ext_rd() and ext_wr() return whether reads and writes go to
+// the bus, rather than the model's internal memory, via read() and write().
+// A host's bus class, with these methods inline (and ext_rd()/ext_wr()
+// returning a constant), has its memory accesses inlined into the model.
+// register_funcs() is called by register_mem_funcs(), with functions without
+// and with a context (both overloads required), and may be empty.
+//
+// The default bus calls the external memory functions registered with
+// register_mem_funcs(), using internal memory when none are registered.
+// Functions without a context are called via an adapter, with the function
+// as its context.
+
+class wy65_cb_bus_t
+{
+PUBLIC:
+    wy65_cb_bus_t() : ext_wr_mem(NULL), ext_rd_mem(NULL), p_wr_ctx(NULL), p_rd_ctx(NULL) {};
+
+    inline bool        ext_rd             (void) { return ext_rd_mem != NULL; };
+    inline bool        ext_wr             (void) { return ext_wr_mem != NULL; };
+    inline int         read               (int addr) { return ext_rd_mem(p_rd_ctx, addr); };
+    inline void        write              (int addr, unsigned char data) { ext_wr_mem(p_wr_ctx, addr, data); };
+
+    inline void        register_funcs     (wy65_p_writemem_t p_wfunc, wy65_p_readmem_t p_rfunc) {
+                                              ext_wr_mem = (p_wfunc != NULL) ? wy65_writemem_adapter : NULL;
+                                              ext_rd_mem = (p_rfunc != NULL) ? wy65_readmem_adapter  : NULL;
+                                              p_wr_ctx   = reinterpret_cast<void*>(p_wfunc);
+                                              p_rd_ctx   = reinterpret_cast<void*>(p_rfunc);
+                                          };
+
+    inline void        register_funcs     (wy65_p_writemem_ctx_t p_wfunc, wy65_p_readmem_ctx_t p_rfunc, void* p_ctx) {
+                                              ext_wr_mem = p_wfunc;
+                                              ext_rd_mem = p_rfunc;
+                                              p_wr_ctx   = p_ctx;
+                                              p_rd_ctx   = p_ctx;
+                                          };
+
+PRIVATE:
+    // Pointers to external memory access methods, and their contexts. When
+    // NULL, internal memory used
+    wy65_p_writemem_ctx_t ext_wr_mem;
+    wy65_p_readmem_ctx_t  ext_rd_mem;
+    void*                 p_wr_ctx;
+    void*                 p_rd_ctx;
+};
+
 // -------------------------------------------------------------------------
 // CLASS DEFINITION
 // -------------------------------------------------------------------------
 
-// Class definitions of the model
-class cpu6502
+// Class definitions of the model, for a memory bus class. The model with the
+// default bus, calling external memory functions, is cpu6502 (see below).
+template <class BUS>
+class cpu6502_core
 {
 // Type definitions private to this class
 PRIVATE:
@@ -168,17 +427,66 @@ PRIVATE:
         NON
     };
 
-    // Opcode decode information
+    // Events pending at the next instruction boundary, as bits of a single word
+    // tested by the engines with one branch per instruction (or per block)
+    enum event_e {
+        EVT_IRQ   = 0x01,  // An IRQ line is active and the I flag clear
+        EVT_NMI   = 0x02,  // NMI edge latched
+        EVT_RESET = 0x04,  // Reset requested
+        EVT_BREAK = 0x08,  // run_until() memory condition met
+        EVT_STOP  = 0x10   // Stop requested
+    };
+
+    // Bus cycle sequence of an instruction in the cycle exact engine. Operations
+    // on data read from memory, or on a read-modify-write value, use the method
+    // of the immediate or accumulator mode opcode of the instruction (alu_opcode).
+    enum cyc_class_e {
+        CYC_IMPLIED,   // Single byte instruction, executed by its method
+        CYC_IMM,       // Immediate operand, executed by its method
+        CYC_READ,      // Memory read, with the alu_opcode operation
+        CYC_BIT,
+        CYC_STA,
+        CYC_STX,
+        CYC_STY,
+        CYC_STZ,
+        CYC_SHIFT,     // Read-modify-write, with the alu_opcode operation
+        CYC_INC,
+        CYC_DEC,
+        CYC_TRB,
+        CYC_TSB,
+        CYC_RMB,
+        CYC_SMB,
+        CYC_BRANCH,    // Relative branch, executed by its method
+        CYC_BBR,
+        CYC_BBS,
+        CYC_JMP,
+        CYC_JSR,
+        CYC_RTS,
+        CYC_RTI,
+        CYC_BRK,
+        CYC_PHA,
+        CYC_PHP,
+        CYC_PHX,
+        CYC_PHY,
+        CYC_PLA,
+        CYC_PLP,
+        CYC_PLX,
+        CYC_PLY,
+        CYC_NOP        // Operand fetches, then internal cycles to the table's count
+    };
+
+    // Opcode decode information. The addressing mode is a template parameter
+    // of the instruction methods, and so not needed here.
     typedef struct
     {
         uint8_t           opcode;
-        addr_mode_e       mode;
+        uint16_t          operand;     // Operand bytes, first byte in bits 7:0
         uint32_t          exec_cycles;
 
     } op_t;
     
     // Instruction function pointer type, for use in instruction table
-    typedef int (cpu6502::* pInstrFunc_t) (const op_t*);
+    typedef int (cpu6502_core::* pInstrFunc_t) (const op_t*);
     
     // Instruction table entry type.
     typedef struct
@@ -188,28 +496,112 @@ PRIVATE:
         uint32_t          exec_cycles;
         addr_mode_e       addr_mode;
         cpu_type_e        cpu_type;
+        uint32_t          op_bytes;    // Number of operand bytes following the opcode
+        bool              ends_block;  // Instruction may change the flow of control
+        cyc_class_e       cyc_class;   // Bus cycle sequence for the cycle exact engine
+        uint8_t           alu_opcode;  // Opcode of the operation on read or modified data
     } tbl_t; 
 
+    // Decoded instruction, as held in the decode cache (for a given PC value)
+    // and as the micro-ops of a block
+    typedef struct
+    {
+        pInstrFunc_t      pFunc;
+        uint16_t          operand;
+        uint8_t           opcode;
+        uint8_t           instr_bytes; // Opcode plus operand bytes. 0 when entry invalid
+        uint16_t          exec_cycles;
+        uint8_t           fuse_idx;    // Block engine: fuse_tbl index + 1 if fused with the next micro-op, else 0
+    } dinstr_t;
+
+    // Basic block of decoded instructions, for a given entry PC value
+    typedef struct
+    {
+        uint32_t          first_uop;   // Index of first micro-op in the pool
+        uint16_t          num_uops;    // 0 when block invalid
+        uint16_t          num_bytes;
+        uint32_t          exec_count;  // Number of executions, for JIT engine
+        wy65_static_fn_t  p_static_fn; // Matching statically recompiled code, or NULL
+    } blk_t;
+
+    // Return values of a JIT compiled block
+    typedef struct
+    {
+        uint64_t          cycles;
+        uint64_t          instructions;
+    } jit_rtn_t;
+
+    // JIT compiled block function type
+    typedef jit_rtn_t (*jit_fn_t) (void);
+
+    // Return values of a fused instruction pair handler. Only the first
+    // instruction is executed if it changes the flow of control (an interrupt),
+    // invalidates a block, or a stop is requested.
+    typedef struct
+    {
+        uint32_t          cycles;
+        uint32_t          instructions;
+    } fuse_rtn_t;
+
+    // Fused instruction pair handler type, executing a micro-op and the next
+    typedef fuse_rtn_t (cpu6502_core::* pFuseFunc_t) (const dinstr_t*);
+
+    // Fusible instruction pair, by opcodes, and its fused handler
+    typedef struct
+    {
+        uint8_t           opcode0;
+        uint8_t           opcode1;
+        pFuseFunc_t       pFunc;
+    } fuse_t;
+
+    // Page of internal memory shared copy-on-write between a model and its forks,
+    // freed when the last reference to it is released. Its data is not modified
+    // whilst shared.
+    typedef struct
+    {
+        std::atomic<uint32_t> refs;
+        uint8_t           data [WY65_MAP_PAGE_SIZE];
+    } cow_page_t;
+
 // Public methods
 PUBLIC:
 
     // Constructor
-    LIB6502_API                    cpu6502(); 
+    LIB6502_API                    cpu6502_core(); 
+
+    // Destructor
+    LIB6502_API                    ~cpu6502_core();
 
     // Reset function. Also clears cycle count and any active IRQ lines. Sets
     // supported opcode mode (default BASE)
     LIB6502_API void               reset              (cpu_type_e mode         = DEFAULT);
 
+    // Interrupts, resets and stops may be injected from any thread (e.g. a device model's
+    // own thread) whilst another thread runs the model, without locking. IRQ lines and
+    // events are atomic words, changed with sequentially consistent read-modify-writes,
+    // and consumed by the running thread at the next instruction boundary. Writes made
+    // by the injecting thread before the call are visible to the running thread when it
+    // takes the event (release/acquire). Only the functions below (and request_stop())
+    // may be called from a thread other than the one running the model.
+
+    // Request a reset, taken at the next instruction boundary, as for reset(), except
+    // that the cycle count continues.
+    LIB6502_API void               request_reset      (cpu_type_e mode         = DEFAULT) {
+                                                                  reset_mode.store(mode, std::memory_order_relaxed);
+                                                                  pending.fetch_or(EVT_RESET); };
+
     // Generate an NMI. NMI is falling edge triggered, and this function call
-    // emulates this single event.
+    // emulates this single event, latching it to be taken at the next instruction
+    // boundary.
     LIB6502_API void               nmi_interrupt      (void);
 
     // Activate (set to 0)/ deactive (set 1) a level sensitive IRQ line, with optional ID (default 0). 
-    // ID can be used to emulate up to 16 wire-ORed IRQs.
+    // ID can be used to emulate up to 16 wire-ORed IRQs. Whilst any line is active,
+    // the interrupt is taken at the first instruction boundary with the I flag clear.
     LIB6502_API void               activate_irq       (const uint16_t id       = 0);
     void                           deactivate_irq     (const uint16_t id       = 0);
 
-    // Execute a single instruction. Internally checks for outstanding IRQ first, 
+    // Execute a single instruction. Internally checks for outstanding interrupts first, 
     // before proceeding to execute an instruction. Optional control of disassembling
     // instruction if icount is between start_count and stop_count. Jump marks
     // (marked spaces between PC discontinuities) can be enabled/disabled.
@@ -218,26 +610,217 @@ PUBLIC:
                                                        const uint32_t stop_count       = 0xffffffff,
                                                        const bool     en_jmp_mrks      = true);
                                                        
-    LIB6502_API void               run_forever        (bool disassem = false) { while(true) execute(0, disassem ? 0 : 0xffffffff, 0xffffffff); }
+    // Execute instructions until either budget is used up, the program loops on
+    // itself, a WAI or STP instruction is reached, or request_stop() is called.
+    // Interrupts are processed as for execute(). Returns aggregate counts for
+    // the call and the reason for returning.
+    LIB6502_API wy65_run_status_t  run                (const uint64_t max_instructions = WY65_NO_LIMIT,
+                                                       const uint64_t max_cycles       = WY65_NO_LIMIT);
+
+    // As for run(), but with the budgets, and optional stop conditions on the PC and
+    // on a memory value, given in cond. The conditions are evaluated within the
+    // engine, with the returned stop reason indicating which fired. The memory value
+    // is checked on writes via the model, or at the end of a compiled block for the
+    // JIT engine.
+    LIB6502_API wy65_run_status_t  run_until          (const wy65_run_until_t &cond);
+
+    // Select the interpreter engine used by run(). Blocks cached by the block and
+    // JIT engines are discarded when selecting another engine.
+    LIB6502_API void               set_engine         (const engine_type_e type);
+
+    // Register a function called for every bus cycle made by the cycle exact engine
+    // (ENGINE_CYCLE), after the access, with the cycle count, address, data and type
+    // of cycle. NULL disables reporting. All cycles, including dummy reads and writes,
+    // access memory as normal, whether or not a function is registered.
+    LIB6502_API void               register_bus_cycle_func (const wy65_p_bus_cycle_t func, void* p_ctx = NULL) {
+                                                                  p_cycle_func = func; p_cycle_ctx = p_ctx; };
+
+    // Request that a run() in progress returns at the next instruction boundary.
+    // Intended to be called from within memory callbacks.
+    LIB6502_API void               request_stop       (void) { pending.fetch_or(EVT_STOP); };
+
+    // Execute instructions forever, yielding the host thread whilst the program is
+    // idle, waiting, stopped or hung
+    LIB6502_API void               run_forever        (bool disassem = false);
+
+    // Set the model's disassembly output, for execute() and run_forever(): a file opened
+    // by the host, which remains the host's to close, or, when p_file is NULL, a file
+    // named fname, opened by the model when it first disassembles and closed when it is
+    // destroyed (default a file named WY65_DIS_FNAME). Models disassembling at the same
+    // time need separate outputs.
+    LIB6502_API void               set_dis_output     (FILE* p_file, const char* fname = WY65_DIS_FNAME);
+
+    // Enable/disable detection of idle loops by run() (default disabled). A loop is
+    // idle when a backward branch or jump returns to the same PC with the registers
+    // unchanged, and no memory modified or device written in between (e.g. polling
+    // for input). run() then returns STOP_IDLE, first skipping ahead by whole loop
+    // iterations to the cycle or instruction budget, if given. A WAI with no
+    // interrupt similarly consumes the rest of the cycle budget.
+    LIB6502_API void               enable_idle_detect (const bool enable = true);
 
     // Register external memory functions for use in memory read/write accesses,
     // to allow interfacing with external memory system.
     LIB6502_API void               register_mem_funcs (wy65_p_writemem_t p_wfunc, wy65_p_readmem_t  p_rfunc);
 
+    // Register external memory functions called with a host context, p_ctx, allowing
+    // multiple models in a process to each access their own host system.
+    LIB6502_API void               register_mem_funcs (wy65_p_writemem_ctx_t p_wfunc,
+                                                       wy65_p_readmem_ctx_t  p_rfunc,
+                                                       void*                 p_ctx);
+
+    // Access to the memory bus, for host bus classes with state to set up
+    LIB6502_API BUS&               get_bus            (void) { return bus; };
+
+    // Map the whole pages (WY65_MAP_PAGE_SIZE bytes) within a region directly to
+    // host memory, at p_rd for reads, and p_wr for writes. A NULL p_wr write protects
+    // the pages (e.g. for ROM). Code in pages mapped to host memory is cached as for
+    // internal memory, so host modifications must be followed by invalidate_decode_cache().
+    LIB6502_API void               map_mem_pages      (const uint32_t start_addr,
+                                                       const uint32_t len,
+                                                       uint8_t*       p_rd,
+                                                       uint8_t*       p_wr);
+
+    // Map the whole pages within a region to device read and write handlers, called
+    // with the full address. A NULL p_wfunc write protects the pages.
+    LIB6502_API void               map_io_pages       (const uint32_t    start_addr,
+                                                       const uint32_t    len,
+                                                       wy65_p_writemem_t p_wfunc,
+                                                       wy65_p_readmem_t  p_rfunc);
+
+    // Map the whole pages within a region to device handlers called with a host
+    // context, p_ctx
+    LIB6502_API void               map_io_pages       (const uint32_t        start_addr,
+                                                       const uint32_t        len,
+                                                       wy65_p_writemem_ctx_t p_wfunc,
+                                                       wy65_p_readmem_ctx_t  p_rfunc,
+                                                       void*                 p_ctx);
+
+    // Map the whole pages within a region to a read only image by reference, so that
+    // one image (e.g. a ROM) may be shared by many models. Writes to the pages are
+    // discarded or, when p_wfunc is not NULL, passed to it (e.g. to trap them) with
+    // p_ctx. The pages are also declared as ROM for the decode cache (see
+    // set_rom_region()), and the image must not be modified whilst mapped.
+    LIB6502_API void               map_rom_pages      (const uint32_t        start_addr,
+                                                       const uint32_t        len,
+                                                       const uint8_t*        p_rom,
+                                                       wy65_p_writemem_ctx_t p_wfunc = NULL,
+                                                       void*                 p_ctx   = NULL);
+
+    // Remove the mapping of the whole pages within a region, which then use the
+    // memory bus (or internal memory)
+    LIB6502_API void               unmap_pages        (const uint32_t start_addr,
+                                                       const uint32_t len);
+
+    // Enable/disable caching of decoded instructions by PC, used by execute() and
+    // the table dispatch run() engine. Writes via the model invalidate affected
+    // entries. With external memory functions registered, only code in regions
+    // declared as ROM is cached (this also applies to the block engine).
+    LIB6502_API void               enable_decode_cache(const bool enable = true);
+
+    // Invalidate decode cache entries and blocks for a region of memory that has
+    // been modified other than through the model (e.g. by the host's external memory).
+    LIB6502_API void               invalidate_decode_cache (const uint32_t start_addr = 0,
+                                                            const uint32_t len        = WY65_ADDR_SPACE_SIZE);
+
+    // Declare (or undeclare) a region of memory as ROM, whose contents are never
+    // modified, for the decode cache. Only whole pages (WY65_ROM_PAGE_SIZE bytes)
+    // within the region are marked.
+    LIB6502_API void               set_rom_region     (const uint32_t start_addr,
+                                                       const uint32_t len,
+                                                       const bool     is_rom = true);
+
+    // Enable/disable fusion of common instruction pairs (e.g. DEX; BNE) into single
+    // micro-ops in the block engine (default enabled). Fusion is not applied while
+    // the pair profile is enabled.
+    LIB6502_API void               enable_fusion      (const bool enable = true);
+
+    // Select the instruction pairs to be fused, as (first opcode << 8 | second opcode),
+    // for example from get_pair_profile(). A NULL p_pairs selects all fusible pairs.
+    // Returns the number of selected pairs that are fusible.
+    LIB6502_API uint32_t           set_fusion_pairs   (const uint16_t* p_pairs,
+                                                       const uint32_t  num_pairs);
+
+    // Enable/disable (and clear) counting of adjacent instruction pairs executed in
+    // blocks by the block engine, for selecting the pairs to fuse
+    LIB6502_API void               enable_pair_profile(const bool enable = true);
+
+    // Get up to max_pairs of the most frequently executed instruction pairs, in
+    // descending order of count. Returns the number of pairs returned.
+    LIB6502_API uint32_t           get_pair_profile   (wy65_pair_count_t* p_counts,
+                                                       const uint32_t     max_pairs);
+
+    // Generate C++ source for statically recompiled blocks of the code reachable from
+    // the reset, IRQ and NMI vectors and any additional entry addresses. The output
+    // defines a function <name>_register(WY65_SR_CPU*) to register the blocks with a model,
+    // where WY65_SR_CPU defaults to cpu6502 and may be defined for a host bus instantiation.
+    LIB6502_API int                gen_static_code    (FILE*           fp,
+                                                       const char*     name,
+                                                       const uint16_t* p_entries   = NULL,
+                                                       const uint32_t  num_entries = 0);
+
+    // Register statically recompiled blocks for use by the block and JIT engines, for
+    // the given CPU variant. A block is only used when the code at its address matches
+    // that it was compiled from, else the block engine is used as normal.
+    LIB6502_API void               register_static_code (const wy65_static_blk_t* p_blks,
+                                                         const uint32_t           num_blks,
+                                                         const cpu_type_e         cpu_type);
+
+    // Get and set all the registers. Flags set with set_regs() take effect as for an
+    // instruction (e.g. clearing I whilst an IRQ line is active pends the interrupt).
+    LIB6502_API void               get_regs           (wy65_reg_t &regs) { regs = state.regs; regs.flags = get_flags(); };
+    LIB6502_API void               set_regs           (const wy65_reg_t &regs) { state.regs = regs; set_flags(regs.flags); };
+
+    // Whether an interrupt, reset or stop is pending, to be taken (or acted on) at
+    // the next instruction boundary
+    LIB6502_API bool               event_pending      (void) { return events_pending(); };
+
+    // Access to registers and memory for statically recompiled code only. sr_exec()
+    // executes an instruction with its instruction method, and sr_leave() indicates
+    // whether the code should return (blocks invalidated, or an event pending).
+    inline wy65_reg_t*             sr_regs            (void) { return &state.regs; };
+    inline int                     sr_rd_mem          (const int addr) { return rd_mem(addr); };
+    inline void                    sr_wr_mem          (const int addr, const uint8_t data) { wr_mem(addr, data); };
+    inline bool                    sr_leave           (void) { return blk_invalidated || events_pending(); };
+    LIB6502_API int                sr_exec            (const uint8_t opcode, const uint16_t operand);
+
     // Read program into memory. Call *after* register_mem_funcs(), if this is used.
     LIB6502_API int                read_prog          (const char *filename, const prog_type_e type = HEX, const uint16_t start_addr = 0);
 
+    // Load len bytes from p_data into internal memory at start_addr (truncated at the
+    // end of memory), or clear internal memory when p_data is NULL. Returns the number
+    // of bytes loaded.
+    LIB6502_API int                load_mem           (const uint8_t* p_data, const uint32_t len = 0, const uint16_t start_addr = 0);
+
     // Save and restore internal state to/from a file (that's already been opened). 
     // If *fp is NULL, just return size of state to be saved, else # byte written.
-    LIB6502_API int                save_state         (FILE* fp) {if (fp != NULL) return fwrite(&state, 1, sizeof(wy65_cpu_state_t), fp); 
+    LIB6502_API int                save_state         (FILE* fp) {if (fp != NULL) {state.regs.flags = get_flags(); state.nirq_line = nirq_lines;
+                                                                                   return fwrite(&state, 1, sizeof(wy65_cpu_state_t), fp);} 
                                                                   else return sizeof(wy65_cpu_state_t);};
-    LIB6502_API int                restore_state      (FILE* fp) {if (fp != NULL) return fread (&state, 1, sizeof(wy65_cpu_state_t), fp); 
+    LIB6502_API int                restore_state      (FILE* fp) {if (fp != NULL) {int n = fread(&state, 1, sizeof(wy65_cpu_state_t), fp); nirq_lines = state.nirq_line;
+                                                                                   set_flags(state.regs.flags);
+                                                                                   instr_tbl = instr_tbls[state.mode_c]; invalidate_decode_cache(); return n;}
                                                                   else return sizeof(wy65_cpu_state_t);};
-    LIB6502_API int                save_mem           (FILE* fp) {if (fp != NULL) return fwrite(&mem,   1, sizeof(WY65_MEM_SIZE), fp);
+    LIB6502_API int                save_mem           (FILE* fp) {if (fp != NULL) {unshare_pages(0, WY65_NUM_MAP_PAGES); return fwrite(&mem,   1, sizeof(WY65_MEM_SIZE), fp);}
                                                                   else return sizeof(WY65_MEM_SIZE);};
-    LIB6502_API int                restore_mem        (FILE* fp) {if (fp != NULL) return fread (&mem,   1, sizeof(WY65_MEM_SIZE), fp);
+    LIB6502_API int                restore_mem        (FILE* fp) {if (fp != NULL) {unshare_pages(0, WY65_NUM_MAP_PAGES); invalidate_decode_cache();
+                                                                                   return fread (&mem,   1, sizeof(WY65_MEM_SIZE), fp);}
                                                                   else return sizeof(WY65_MEM_SIZE);};
 
+    // Fork the model, returning a new model (to be deleted by the caller) with a copy of
+    // the CPU state, pending interrupts, bus, page mappings and settings, which may then
+    // run independently of this one (including on another thread). Internal memory is
+    // shared between the two copy-on-write, a page at a time, with each page copied only
+    // when either model first writes to it. Host memory mapped to pages from within the bus
+    // is re-based onto the fork's copy of the bus, and other host RAM is copied to the fork
+    // copy-on-write. Host ROM, devices and memory on an external bus are shared rather than
+    // copied. If host memory outside the bus is mapped for writes other than as RAM within
+    // the internal memory (e.g. write only, or with the bus taking accesses), the fork can't
+    // be isolated, and NULL is returned. The caches and registered statically recompiled
+    // code are not copied, so must be re-enabled on the fork if needed.
+    // A disassembly output set by the host is shared, but the fork opens its own file
+    // otherwise, which should be given a different name with set_dis_output().
+    LIB6502_API cpu6502_core*      fork               (void);
+
 // Private member functions
 PRIVATE:
     // Read Binary, Intel HEX or Motorola S-Record files into memory
@@ -245,8 +828,62 @@ PRIVATE:
     int                read_ihx           (const char *filename);
     int                read_srec          (const char *filename);
 
-    // Internal check and execution of maskable interrupts
+    // Threaded code engine for run(), with opcode bodies inlined into a single function
+    wy65_run_status_t  run_threaded       (const uint64_t max_instructions, const uint64_t max_cycles);
+
+    // Cycle exact bus engine for run() (cpu6502_cycle.cpp): instruction execution,
+    // operand fetch and addressing cycles, and interrupt entry
+    wy65_run_status_t  run_cycle          (const uint64_t max_instructions, const uint64_t max_cycles);
+    void               cycle_instr        (void);
+    uint16_t           cycle_addr         (const addr_mode_e mode, const bool fixup);
+    void               cycle_interrupt    (const uint16_t vector, const uint8_t flags);
+
+    // Single bus cycle of the cycle exact engine, reported to any registered function
+    inline void        cycle_report       (const uint16_t addr, const uint8_t data, const bus_cycle_e type) {
+                                              if (p_cycle_func != NULL) {
+                                                  wy65_bus_cycle_t cycle = {state.cycles, addr, data, type};
+                                                  p_cycle_func(p_cycle_ctx, &cycle);
+                                              }
+                                              state.cycles++;
+                                          };
+    inline uint8_t     cycle_rd           (const uint16_t addr, const bus_cycle_e type = BUS_READ) {
+                                              const uint8_t data = rd_mem(addr);
+                                              cycle_report(addr, data, type);
+                                              return data;
+                                          };
+    inline void        cycle_wr           (const uint16_t addr, const uint8_t data, const bus_cycle_e type = BUS_WRITE) {
+                                              wr_mem(addr, data);
+                                              cycle_report(addr, data, type);
+                                          };
+    inline void        cycle_push         (const uint8_t data) { cycle_wr(state.regs.sp-- | 0x100, data); };
+    inline uint8_t     cycle_pull         (void) { return cycle_rd(++state.regs.sp | 0x100); };
+
+    // Check whether memory matches the run_until() condition, requesting a stop if so
+    void               until_mem_check    (void);
+
+    // Idle loop check for run() at a backward branch or jump, and skipping ahead by
+    // whole loop iterations (or cycles whilst waiting) up to the budgets
+    bool               idle_loop          (uint64_t &icount, const uint64_t start_cycles,
+                                           const uint64_t max_instructions, const uint64_t max_cycles);
+    void               idle_skip          (uint64_t &icount, const uint64_t start_cycles,
+                                           const uint64_t max_instructions, const uint64_t max_cycles,
+                                           const uint64_t loop_instrs, const uint64_t loop_cycles);
+
+    // Internal check and execution of maskable interrupts, and execution of an NMI
     void               irq                (void);
+    void               nmi                (void);
+
+    // Update the pending IRQ event for the IRQ lines and I flag
+    inline void        irq_update         (void);
+
+    // Whether any event is pending, tested at each instruction boundary (a relaxed
+    // load, with take_events() ordering any data injected with the event)
+    inline bool        events_pending     (void) { return pending.load(std::memory_order_relaxed) != 0; };
+
+    // Take any interrupt or reset pending at an instruction boundary, and, for the
+    // run() engines, first check for a stop, returning true, with the reason, if so
+    void               take_events        (void);
+    bool               service_events     (run_stop_e &reason);
 
     // Disassemble opcode to logfile
     void               disassemble        (const int      opcode, 
@@ -258,20 +895,206 @@ PRIVATE:
                                            const uint8_t  x, 
                                            const uint8_t  y, 
                                            const uint8_t  sp, 
-                                           const uint8_t  flags,
-                                           const char*    fname = "cpu6502.log");
+                                           const uint8_t  flags);
+
+    // Lazily evaluated N and Z flags. While instruction methods are executing
+    // (flags_lazy set), the N and Z bits of state.regs.flags are not maintained.
+    // Instead, N is set when bit 7 or 8 of flags_nz is set, and Z when its low
+    // byte is zero, so that most instructions need only store their result.
+    inline void        set_nz             (const uint32_t result) { flags_nz = result & 0xff; };
+    inline void        set_nz             (const bool n, const bool z) { flags_nz = (n ? 0x100 : 0) | (z ? 0 : 1); };
+    inline bool        flag_n             (void) { return (flags_nz & 0x180) != 0; };
+    inline bool        flag_z             (void) { return (flags_nz & 0xff) == 0; };
+
+    // Flags register with N and Z evaluated, setting the flags register, and
+    // switching between lazy and held N and Z flags
+    uint8_t            get_flags          (void);
+    void               set_flags          (const uint8_t flags);
+    void               begin_lazy_flags   (void);
+    void               end_lazy_flags     (void);
 
     // Calculate and return the operand address, based on instruction addressing mode
-    uint32_t           calc_addr          (const addr_mode_e mode, wy65_reg_t* p_regs, bool &pg_crossed);
-
-    // Utility method to set an entry in the instruction table
-    inline void        set_tbl_entry      (tbl_t &t, char* s, pInstrFunc_t f, uint32_t c, addr_mode_e m, cpu_type_e cpu) {
-                                              t.op_str      =  s;
-                                              t.pFunc       =  f;
-                                              t.exec_cycles =  c;
-                                              t.addr_mode   =  m;
-                                              t.cpu_type    =  cpu;
+    template <addr_mode_e MODE>
+    inline uint32_t    calc_addr          (const op_t* p_op, wy65_reg_t* p_regs, bool &pg_crossed);
+
+    // Read instruction data, from the operand for immediate mode, else from memory
+    template <addr_mode_e MODE>
+    inline uint8_t     rd_data            (const op_t* p_op, const uint32_t addr) {
+                                              return (MODE == IMM) ? (p_op->operand & 0xff) : rd_mem(addr);
+                                          };
+
+    // Number of operand bytes following the opcode for an addressing mode
+    static constexpr uint32_t mode_op_bytes (const addr_mode_e m) {
+                                              return (m == ACC || m == NON)                         ? 0 :
+                                                     (m == IND || m == ABS || m == ABX || m == ABY || 
+                                                      m == IAX || m == ZPR)                         ? 2 : 1;
+                                          };
+
+    // Fetch the operand bytes at the PC, and advance the PC past them
+    inline void        fetch_operand      (op_t &op, const uint32_t op_bytes) {
+                                              op.operand = 0;
+                                              if (op_bytes > 0) op.operand  = rd_mem(state.regs.pc);
+                                              if (op_bytes > 1) op.operand |= rd_mem((state.regs.pc + 1) & 0xffff) << 8;
+                                              state.regs.pc += op_bytes;
+                                          };
+
+    // Fetch and decode the instruction at the PC, from the decode cache if enabled
+    inline pInstrFunc_t decode            (op_t &op);
+
+    // Invalidate decode cache entries for instructions that include a written address
+    inline void        invalidate_dcache_entries (const int addr) {
+                                              p_dcache[addr & 0xffff].instr_bytes       = 0;
+                                              p_dcache[(addr - 1) & 0xffff].instr_bytes = 0;
+                                              p_dcache[(addr - 2) & 0xffff].instr_bytes = 0;
+                                          };
+
+    // Compile time string comparison, for constructing the instruction tables
+    static constexpr bool str_eq          (const char* a, const char* b) {
+                                              return *a != *b ? false : *a == 0 ? true : str_eq(a + 1, b + 1);
                                           };
+
+    // Bus cycle sequence class for an instruction, from its method name and mode
+    static constexpr cyc_class_e cyc_class_of (const char* f, const addr_mode_e m) {
+                                              return str_eq(f, "NOP") ? CYC_NOP :
+                                                     m == IMM         ? CYC_IMM :
+                                                     m == REL         ? CYC_BRANCH :
+                                                     str_eq(f, "BRK") ? CYC_BRK : str_eq(f, "RTS") ? CYC_RTS :
+                                                     str_eq(f, "RTI") ? CYC_RTI : str_eq(f, "JSR") ? CYC_JSR :
+                                                     str_eq(f, "PHA") ? CYC_PHA : str_eq(f, "PHP") ? CYC_PHP :
+                                                     str_eq(f, "PHX") ? CYC_PHX : str_eq(f, "PHY") ? CYC_PHY :
+                                                     str_eq(f, "PLA") ? CYC_PLA : str_eq(f, "PLP") ? CYC_PLP :
+                                                     str_eq(f, "PLX") ? CYC_PLX : str_eq(f, "PLY") ? CYC_PLY :
+                                                     (m == ACC || m == NON) ? CYC_IMPLIED :
+                                                     str_eq(f, "JMP") ? CYC_JMP : str_eq(f, "BIT") ? CYC_BIT :
+                                                     str_eq(f, "BBR") ? CYC_BBR : str_eq(f, "BBS") ? CYC_BBS :
+                                                     str_eq(f, "STA") ? CYC_STA : str_eq(f, "STX") ? CYC_STX :
+                                                     str_eq(f, "STY") ? CYC_STY : str_eq(f, "STZ") ? CYC_STZ :
+                                                     str_eq(f, "INC") ? CYC_INC : str_eq(f, "DEC") ? CYC_DEC :
+                                                     str_eq(f, "TRB") ? CYC_TRB : str_eq(f, "TSB") ? CYC_TSB :
+                                                     str_eq(f, "RMB") ? CYC_RMB : str_eq(f, "SMB") ? CYC_SMB :
+                                                     (str_eq(f, "ASL") || str_eq(f, "LSR") ||
+                                                      str_eq(f, "ROL") || str_eq(f, "ROR")) ? CYC_SHIFT : CYC_READ;
+                                          };
+
+    // Immediate (or accumulator) mode opcode performing an instruction's operation
+    // on data, for instructions with that mode in all variants, else 0
+    static constexpr uint8_t alu_opcode_of (const char* f) {
+                                              return str_eq(f, "ORA") ? 0x09 : str_eq(f, "AND") ? 0x29 :
+                                                     str_eq(f, "EOR") ? 0x49 : str_eq(f, "ADC") ? 0x69 :
+                                                     str_eq(f, "LDY") ? 0xa0 : str_eq(f, "LDX") ? 0xa2 :
+                                                     str_eq(f, "LDA") ? 0xa9 : str_eq(f, "CPY") ? 0xc0 :
+                                                     str_eq(f, "CMP") ? 0xc9 : str_eq(f, "CPX") ? 0xe0 :
+                                                     str_eq(f, "SBC") ? 0xe9 : str_eq(f, "ASL") ? 0x0a :
+                                                     str_eq(f, "ROL") ? 0x2a : str_eq(f, "LSR") ? 0x4a :
+                                                     str_eq(f, "ROR") ? 0x6a : 0;
+                                          };
+
+    // Addressing mode of an opcode's entry for a CPU variant, and so of the NOP that an
+    // unsupported opcode is bound to. Rockwell's bit instructions are single byte NOPs on
+    // other 65C02s, whilst other unsupported opcodes have their operand bytes skipped.
+    static constexpr addr_mode_e nop_mode (const cpu_type_e variant, const addr_mode_e m, const cpu_type_e cpu) {
+                                              return (variant == C02 && cpu == WRK) ? NON : m;
+                                          };
+
+    // Utility method to construct an entry in an instruction table, for the given CPU
+    // variant. Opcodes introduced in a later variant are bound to NOP for the opcode's
+    // addressing mode (see nop_mode()), and disassemble as "???". Single byte NOPs take
+    // a single cycle.
+    static constexpr tbl_t tbl_entry      (const cpu_type_e variant, const char* s, const char* fn, pInstrFunc_t f,
+                                           pInstrFunc_t nop, uint32_t c, addr_mode_e m, cpu_type_e cpu) {
+                                              return {cpu <= variant ? s : "???",
+                                                      cpu <= variant ? f : nop,
+                                                      nop_mode(variant, m, cpu) == m ? c : 1,
+                                                      nop_mode(variant, m, cpu),
+                                                      cpu,
+                                                      mode_op_bytes(nop_mode(variant, m, cpu)),
+                                                      nop_mode(variant, m, cpu) == REL || nop_mode(variant, m, cpu) == ZPR ||
+                                                      (cpu <= variant && (str_eq(s, "JMP") || str_eq(s, "JSR") || str_eq(s, "RTS") ||
+                                                                          str_eq(s, "RTI") || str_eq(s, "BRK") || str_eq(s, "WAI") ||
+                                                                          str_eq(s, "STP"))),
+                                                      cpu <= variant ? cyc_class_of(fn, m) : CYC_NOP,
+                                                      alu_opcode_of(fn)};
+                                          };
+
+    // Block engine for run(), and its block cache management
+    wy65_run_status_t  run_block          (const uint64_t max_instructions, const uint64_t max_cycles);
+    bool               build_block        (const uint16_t entry_pc);
+    void               flush_blocks       (void);
+    void               invalidate_blocks  (const int addr);
+
+    // JIT compiler for the block engine (cpu6502_jit.cpp)
+    bool               jit_run_block      (uint16_t &pc, uint64_t &icount);
+    bool               jit_compile        (const uint16_t entry_pc);
+    bool               jit_alloc          (void);
+    void               jit_free           (void);
+    static jit_rtn_t   jit_exec_uop       (cpu6502_core* p_cpu, const dinstr_t* p_uop, const uint32_t pc);
+    static uint32_t    jit_code_write     (cpu6502_core* p_cpu, const uint32_t addr);
+
+    // Fused instruction pair handler, executing the methods for two micro-ops
+    template <pInstrFunc_t F0, pInstrFunc_t F1>
+    fuse_rtn_t         fuse_pair          (const dinstr_t* p_uop);
+
+    // fuse_tbl index + 1 for a pair (first opcode << 8 | second opcode), if selected, else 0
+    uint8_t            fuse_lookup        (const uint32_t pair);
+
+    // Statically recompiled code support (cpu6502_static.cpp)
+    wy65_static_fn_t   match_static_block (const uint16_t entry_pc, const blk_t* p_blk);
+    void               gen_static_addr    (char* buf, const addr_mode_e mode, const uint32_t operand, const int indent);
+    bool               gen_static_instr   (FILE* fp, const uint16_t pc, const uint32_t instr_num, const bool is_last);
+
+    // Code at an address may be cached if in internal memory, or a ROM page
+    inline bool        is_cacheable       (const uint16_t addr) {
+                                              const wy65_page_t* p_page = &page_tbl[addr >> WY65_MAP_PAGE_BITS];
+                                              if (p_page->p_rd != NULL)
+                                                  return true;
+                                              if (p_page->rd_func != NULL)
+                                                  return false;
+                                              return !bus.ext_rd() || rom_page[addr >> WY65_ROM_PAGE_BITS];
+                                          };
+
+    // Update page table entries for the whole pages within a region
+    void               set_pages          (const uint32_t start_addr, const uint32_t len, const wy65_page_t &page);
+    void               update_pages_mapped(void);
+
+    // Unmapped page table entries, for internal memory (accessed directly through
+    // the entry) unless beyond the internal memory or the bus takes accesses
+    inline void        set_unmapped_page  (const uint32_t page_num) {
+                                              uint32_t addr  = page_num << WY65_MAP_PAGE_BITS;
+                                              uint8_t* p_mem = (!bus.ext_rd() && !bus.ext_wr() && addr + WY65_MAP_PAGE_SIZE <= WY65_MEM_SIZE) ? &mem[addr] : NULL;
+                                              page_tbl[page_num] = {p_mem, p_mem, NULL, NULL, NULL, NULL};
+                                          };
+
+    inline bool        page_unmapped      (const uint32_t page_num) {
+                                              const wy65_page_t* p_page = &page_tbl[page_num];
+                                              uint32_t           addr   = page_num << WY65_MAP_PAGE_BITS;
+                                              return p_page->rd_func == NULL && p_page->wr_func == NULL && p_page->p_rd == p_page->p_wr &&
+                                                     (p_page->p_rd == NULL || (addr + WY65_MAP_PAGE_SIZE <= WY65_MEM_SIZE && p_page->p_rd == &mem[addr]));
+                                          };
+
+    // Host memory within the bus (e.g. its RAM), which a fork re-bases onto its own copy of the bus
+    inline bool        in_bus             (const void* p) {
+                                              return (uintptr_t)p >= (uintptr_t)&bus && (uintptr_t)p < (uintptr_t)&bus + sizeof(BUS);
+                                          };
+
+    inline void*       rebase_to_bus      (void* p, cpu6502_core* p_fork) {
+                                              return in_bus(p) ? (void*)((uintptr_t)&p_fork->bus + ((uintptr_t)p - (uintptr_t)&bus)) : p;
+                                          };
+
+    // Write hooks are needed whilst decodes or blocks are cached, a run_until()
+    // memory condition is set, or idle loops are being detected
+    inline void        update_wr_hooks    (void) { wr_hooks = p_dcache != NULL || uop_pool_used != 0 || until_len != 0 || idle_detect; };
+
+    // Memory accesses not made directly through the page table (devices, the bus,
+    // write protected pages, or writes with hooks)
+    void               wr_mem_slow        (int addr, unsigned char data);
+    int                rd_mem_slow        (int addr);
+
+    // Copy-on-write memory pages: write handler for shared pages, and copying of
+    // shared pages (from start_page up to, but not including, end_page) back to
+    // internal memory, releasing them
+    static void        cow_write          (void* p_ctx, int addr, unsigned char data);
+    void               unshare_pages      (const uint32_t start_page, const uint32_t end_page);
+
     // Utility to write program data to memory
     void               prog_write_data    (const uint32_t byte_count, const uint32_t addr, const uint8_t* buf_ptr);
 
@@ -284,117 +1107,227 @@ PUBLIC:
 #else
 PRIVATE:
 #endif
-    // Write to memory---either local, or via externally set method
+    // Write to memory---either mapped, local, or via externally set method. Writes
+    // to host (or internal) memory, with no write hooks needed, are made directly.
     inline void        wr_mem             (int addr, unsigned char data) {
-                                              if (ext_wr_mem != NULL) 
-                                                  ext_wr_mem(addr, data);   // LCOV_EXCL_LINE
-                                              else 
-                                                  mem[addr] = data;
+                                              uint8_t* p_wr = page_tbl[(addr >> WY65_MAP_PAGE_BITS) & (WY65_NUM_MAP_PAGES-1)].p_wr;
+                                              if (p_wr != NULL && !wr_hooks)
+                                                  p_wr[addr & (WY65_MAP_PAGE_SIZE-1)] = data;
+                                              else
+                                                  wr_mem_slow(addr, data);
                                           };
 
-    // Read from memory---either local, or via externally set method
+    // Read from memory---either mapped, local, or via externally set method
     inline int         rd_mem             (int addr) {
-                                               if (ext_rd_mem != NULL
-#ifdef BITMATCH
-                                                   && addr != 0xfe81 // When bitmatching on BeebEm, don't read from the FDC result register (it's a pop read)
-#endif
-                                                   ) 
-                                                   return ext_rd_mem(addr);   // LCOV_EXCL_LINE
-                                               else 
-                                                   return mem[addr]; 
+                                               const uint8_t* p_rd = page_tbl[(addr >> WY65_MAP_PAGE_BITS) & (WY65_NUM_MAP_PAGES-1)].p_rd;
+                                               if (p_rd != NULL)
+                                                   return p_rd[addr & (WY65_MAP_PAGE_SIZE-1)];
+                                               return rd_mem_slow(addr);
                                            };
 PRIVATE:
     // Instructions functions for base 6502 implementation
-    int                ADC                (const op_t* op);
-    int                AND                (const op_t* op);
-    int                ASL                (const op_t* op);
-    int                BCC                (const op_t* op);
-    int                BCS                (const op_t* op);
-    int                BEQ                (const op_t* op);
-    int                BIT                (const op_t* op);
-    int                BMI                (const op_t* op);
-    int                BNE                (const op_t* op);
-    int                BPL                (const op_t* op);
-    int                BRK                (const op_t* op);
-    int                BVC                (const op_t* op);
-    int                BVS                (const op_t* op);
-    int                CLC                (const op_t* op);
-    int                CLD                (const op_t* op);
-    int                CLI                (const op_t* op);
-    int                CLV                (const op_t* op);
-    int                CMP                (const op_t* op);                
-    int                CPX                (const op_t* op);
-    int                CPY                (const op_t* op);
-    int                DEC                (const op_t* op);
-    int                DEX                (const op_t* op);
-    int                DEY                (const op_t* op);
-    int                EOR                (const op_t* op);
-    int                INC                (const op_t* op);
-    int                INX                (const op_t* op);
-    int                INY                (const op_t* op);
-    int                JMP                (const op_t* op);
-    int                JSR                (const op_t* op);
-    int                LDA                (const op_t* op);
-    int                LDX                (const op_t* op);
-    int                LDY                (const op_t* op);
-    int                LSR                (const op_t* op);
-    int                NOP                (const op_t* op);
-    int                ORA                (const op_t* op);       
-    int                PHA                (const op_t* op);
-    int                PHP                (const op_t* op);
-    int                PLA                (const op_t* op);
-    int                PLP                (const op_t* op);
-    int                ROL                (const op_t* op);
-    int                ROR                (const op_t* op);
-    int                RTI                (const op_t* op);
-    int                RTS                (const op_t* op);
-    int                SBC                (const op_t* op);
-    int                SEC                (const op_t* op);
-    int                SED                (const op_t* op);
-    int                SEI                (const op_t* op);
-    int                STA                (const op_t* op);
-    int                STX                (const op_t* op);
-    int                STY                (const op_t* op);
-    int                TAX                (const op_t* op);
-    int                TAY                (const op_t* op);
-    int                TSX                (const op_t* op);
-    int                TXA                (const op_t* op);
-    int                TXS                (const op_t* op);
-    int                TYA                (const op_t* op);
+    template <addr_mode_e MODE> int ADC  (const op_t* op);
+    template <addr_mode_e MODE> int AND  (const op_t* op);
+    template <addr_mode_e MODE> int ASL  (const op_t* op);
+    template <addr_mode_e MODE> int BCC  (const op_t* op);
+    template <addr_mode_e MODE> int BCS  (const op_t* op);
+    template <addr_mode_e MODE> int BEQ  (const op_t* op);
+    template <addr_mode_e MODE> int BIT  (const op_t* op);
+    template <addr_mode_e MODE> int BMI  (const op_t* op);
+    template <addr_mode_e MODE> int BNE  (const op_t* op);
+    template <addr_mode_e MODE> int BPL  (const op_t* op);
+    template <addr_mode_e MODE> int BRK  (const op_t* op);
+    template <addr_mode_e MODE> int BVC  (const op_t* op);
+    template <addr_mode_e MODE> int BVS  (const op_t* op);
+    template <addr_mode_e MODE> int CLC  (const op_t* op);
+    template <addr_mode_e MODE> int CLD  (const op_t* op);
+    template <addr_mode_e MODE> int CLI  (const op_t* op);
+    template <addr_mode_e MODE> int CLV  (const op_t* op);
+    template <addr_mode_e MODE> int CMP  (const op_t* op);
+    template <addr_mode_e MODE> int CPX  (const op_t* op);
+    template <addr_mode_e MODE> int CPY  (const op_t* op);
+    template <addr_mode_e MODE> int DEC  (const op_t* op);
+    template <addr_mode_e MODE> int DEX  (const op_t* op);
+    template <addr_mode_e MODE> int DEY  (const op_t* op);
+    template <addr_mode_e MODE> int EOR  (const op_t* op);
+    template <addr_mode_e MODE> int INC  (const op_t* op);
+    template <addr_mode_e MODE> int INX  (const op_t* op);
+    template <addr_mode_e MODE> int INY  (const op_t* op);
+    template <addr_mode_e MODE> int JMP  (const op_t* op);
+    template <addr_mode_e MODE> int JSR  (const op_t* op);
+    template <addr_mode_e MODE> int LDA  (const op_t* op);
+    template <addr_mode_e MODE> int LDX  (const op_t* op);
+    template <addr_mode_e MODE> int LDY  (const op_t* op);
+    template <addr_mode_e MODE> int LSR  (const op_t* op);
+    template <addr_mode_e MODE> int NOP  (const op_t* op);
+    template <addr_mode_e MODE> int ORA  (const op_t* op);
+    template <addr_mode_e MODE> int PHA  (const op_t* op);
+    template <addr_mode_e MODE> int PHP  (const op_t* op);
+    template <addr_mode_e MODE> int PLA  (const op_t* op);
+    template <addr_mode_e MODE> int PLP  (const op_t* op);
+    template <addr_mode_e MODE> int ROL  (const op_t* op);
+    template <addr_mode_e MODE> int ROR  (const op_t* op);
+    template <addr_mode_e MODE> int RTI  (const op_t* op);
+    template <addr_mode_e MODE> int RTS  (const op_t* op);
+    template <addr_mode_e MODE> int SBC  (const op_t* op);
+    template <addr_mode_e MODE> int SEC  (const op_t* op);
+    template <addr_mode_e MODE> int SED  (const op_t* op);
+    template <addr_mode_e MODE> int SEI  (const op_t* op);
+    template <addr_mode_e MODE> int STA  (const op_t* op);
+    template <addr_mode_e MODE> int STX  (const op_t* op);
+    template <addr_mode_e MODE> int STY  (const op_t* op);
+    template <addr_mode_e MODE> int TAX  (const op_t* op);
+    template <addr_mode_e MODE> int TAY  (const op_t* op);
+    template <addr_mode_e MODE> int TSX  (const op_t* op);
+    template <addr_mode_e MODE> int TXA  (const op_t* op);
+    template <addr_mode_e MODE> int TXS  (const op_t* op);
+    template <addr_mode_e MODE> int TYA  (const op_t* op);
 
     // Functions for 65C02/WDC65C02 instructions
-    int                BBR                (const op_t* op);
-    int                BBS                (const op_t* op);
-    int                RMB                (const op_t* op);
-    int                SMB                (const op_t* op);
-    int                BRA                (const op_t* op);
-    int                TRB                (const op_t* op);
-    int                TSB                (const op_t* op);
-    int                STZ                (const op_t* op);
-    int                PHX                (const op_t* op);
-    int                PHY                (const op_t* op);
-    int                PLX                (const op_t* op);
-    int                PLY                (const op_t* op);
-    int                WAI                (const op_t* op);
-    int                STP                (const op_t* op);
+    template <addr_mode_e MODE> int BBR  (const op_t* op);
+    template <addr_mode_e MODE> int BBS  (const op_t* op);
+    template <addr_mode_e MODE> int RMB  (const op_t* op);
+    template <addr_mode_e MODE> int SMB  (const op_t* op);
+    template <addr_mode_e MODE> int BRA  (const op_t* op);
+    template <addr_mode_e MODE> int TRB  (const op_t* op);
+    template <addr_mode_e MODE> int TSB  (const op_t* op);
+    template <addr_mode_e MODE> int STZ  (const op_t* op);
+    template <addr_mode_e MODE> int PHX  (const op_t* op);
+    template <addr_mode_e MODE> int PHY  (const op_t* op);
+    template <addr_mode_e MODE> int PLX  (const op_t* op);
+    template <addr_mode_e MODE> int PLY  (const op_t* op);
+    template <addr_mode_e MODE> int WAI  (const op_t* op);
+    template <addr_mode_e MODE> int STP  (const op_t* op);
 
 // Private member variables
 PRIVATE:
 
-    // Pointers to external memory access methods. When NULL, internal memory used
-    wy65_p_writemem_t  ext_wr_mem;
-    wy65_p_readmem_t   ext_rd_mem;
+    // Memory bus, for accesses not to internal memory
+    BUS                bus;
 
     // Disassemble state
     FILE*              fp;
     uint32_t           nextPc;
 
-    // Instruction table entry array
-    tbl_t              instr_tbl [WY65_INSTR_SPACE_SIZE]; 
+    // Disassembly output file name, and whether fp was opened by the model
+    char               dis_fname [WY65_DIS_FNAME_SIZE];
+    bool               fp_owned;
+
+    // Events pending at the next instruction boundary (event_e bits), the CPU variant
+    // for a requested reset, and the IRQ lines (active low), all of which may be
+    // changed by other threads. state.nirq_line is a copy of the lines for saving.
+    std::atomic<uint32_t>   pending;
+    std::atomic<cpu_type_e> reset_mode;
+    std::atomic<uint32_t>   nirq_lines;
+
+    // Function, and its context, called for each bus cycle by the cycle exact engine
+    wy65_p_bus_cycle_t p_cycle_func;
+    void*              p_cycle_ctx;
+
+    // run_until() conditions: PC (WY65_ADDR_SPACE_SIZE when none), memory address,
+    // number of bytes (0 when none) and value. A memory match is an EVT_BREAK event.
+    uint32_t           until_pc;
+    uint16_t           until_addr;
+    uint32_t           until_len;
+    uint16_t           until_value;
+
+    // Idle loop detection: count of writes modifying memory (or to devices), and
+    // the state at the last backward branch or jump checked (see idle_loop())
+    bool               idle_detect;
+    uint32_t           wr_changes;
+    bool               idle_valid;
+    uint32_t           idle_misses;
+    wy65_reg_t         idle_regs;
+    uint16_t           idle_nz;
+    uint32_t           idle_wr_changes;
+    uint64_t           idle_icount;
+    uint64_t           idle_cycles;
+
+    // Interpreter engine selected for run()
+    engine_type_e      engine;
+
+    // Whether writes must go through wr_mem_slow() (see update_wr_hooks())
+    bool               wr_hooks;
+
+    // Instruction table for each CPU variant, constructed at compile time and
+    // shared between all instances. Opcodes not supported by a variant are bound
+    // to the NOP method for the opcode's addressing mode.
+    static const tbl_t instr_tbls [WY65_NUM_CPU_TYPES][WY65_INSTR_SPACE_SIZE];
+
+    // Instruction table for the selected CPU variant (set by reset())
+    const tbl_t*       instr_tbl;
+
+    // Decode cache, indexed by PC (NULL when disabled), and flags for pages
+    // declared as ROM
+    dinstr_t*          p_dcache;
+    bool               rom_page [WY65_ADDR_SPACE_SIZE / WY65_ROM_PAGE_SIZE];
+
+    // Memory map page table, and whether any page is mapped
+    wy65_page_t        page_tbl [WY65_NUM_MAP_PAGES];
+    bool               pages_mapped;
+
+    // Internal memory pages shared copy-on-write with forked models (NULL when not
+    // shared), which are mapped to the shared page for reads and to cow_write()
+    cow_page_t*        cow_page [WY65_NUM_MAP_PAGES];
+
+    // Block engine state: blocks indexed by entry PC, the micro-op pool, flags
+    // for bytes that are part of a block's code and whether a block was
+    // invalidated (NULL pointers until the block engine is first used)
+    blk_t*             p_blk_tbl;
+    dinstr_t*          p_uop_pool;
+    uint32_t           uop_pool_used;
+    bool*              p_code_byte;
+    bool               blk_invalidated;
+
+    // JIT engine state: native code buffer, compiled block functions indexed
+    // by entry PC (NULL until the JIT engine is first used), and the PC of the
+    // last instruction executed by a compiled block
+    uint8_t*           p_jit_code;
+    uint32_t           jit_code_used;
+    jit_fn_t*          p_jit_tbl;
+    uint16_t           jit_last_pc;
+
+    // Fusible instruction pairs, shared between all instances
+    static const fuse_t fuse_tbl [WY65_NUM_FUSE_PAIRS];
+
+    // Instruction pair fusion state: fusion enabled, a bit for each selected pair,
+    // indexed by (first opcode << 8 | second opcode), and pair execution counts
+    // (NULL when not profiling). fuse_all is set when all fusible pairs are
+    // selected.
+    bool               fuse_en;
+    bool               fuse_all;
+    uint32_t           fuse_sel [WY65_INSTR_SPACE_SIZE * WY65_INSTR_SPACE_SIZE / 32];
+    uint64_t*          p_pair_prof;
+
+    // Registered statically recompiled blocks, indexed by entry PC (NULL until
+    // registered), and the CPU variant they were compiled for
+    const wy65_static_blk_t** p_static_tbl;
+    cpu_type_e         static_cpu_type;
+
+    // Lazy N and Z flag state (see set_nz())
+    uint16_t           flags_nz;
+    bool               flags_lazy;
 
     // CPU state
     wy65_cpu_state_t   state;
     uint8_t            mem [WY65_MEM_SIZE];
 };
 
+// The model with the default bus, calling external memory functions registered
+// with register_mem_funcs(). It is instantiated in the model's source files.
+typedef cpu6502_core<wy65_cb_bus_t> cpu6502;
+
+extern template class cpu6502_core<wy65_cb_bus_t>;
+
+// Include the host bus class definition, if one is to be instantiated
+#ifdef WY65_BUS_HDR
+#define WY65_STRINGIFY(_x)            #_x
+#define WY65_XSTRINGIFY(_x)           WY65_STRINGIFY(_x)
+#include WY65_XSTRINGIFY(WY65_BUS_HDR)
+#endif
+
+#ifdef WY65_BUS
+extern template class cpu6502_core<WY65_BUS>;
+#endif
+
 #endif
\ No newline at end of file
@@ -0,0 +1,641 @@
+//=============================================================
+//
+// Copyright (c) 2024 Simon Southwell. All rights reserved.
+//
+// Date: 17th October 2026
+//
+// This file is part of the cpu6502 instruction set simulator
+// and contains the batch engine, stepping many models together
+// with SIMD register and flag updates whilst their PCs agree.
+//
+// This code is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// The code is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this code. If not, see <http://www.gnu.org/licenses/>.
+//
+//=============================================================
+
+// -------------------------------------------------------------------------
+// INCLUDES
+// -------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "cpu6502.h"
+#include "cpu6502_batch.h"
+
+// -------------------------------------------------------------------------
+// SIMD operations on vectors of lanes' byte registers
+//
+// AVX2 (32 lanes) or SSE2 (16 lanes) intrinsics are used when available,
+// else portable code on 16 lanes. Masks have lanes of 0xff (true) or 0x00.
+// -------------------------------------------------------------------------
+
+#if !defined(WY65_NO_SIMD) && defined(__AVX2__)
+
+#include <immintrin.h>
+
+#define WY65_BATCH_VEC_LANES          32
+
+typedef __m256i batch_vec_t;
+
+static inline batch_vec_t v_load  (const uint8_t* p)              { return _mm256_loadu_si256((const __m256i*)p); }
+static inline void        v_store (uint8_t* p, const batch_vec_t v) { _mm256_storeu_si256((__m256i*)p, v); }
+static inline batch_vec_t v_set1  (const uint8_t b)               { return _mm256_set1_epi8((char)b); }
+static inline batch_vec_t v_and   (const batch_vec_t a, const batch_vec_t b) { return _mm256_and_si256(a, b); }
+static inline batch_vec_t v_or    (const batch_vec_t a, const batch_vec_t b) { return _mm256_or_si256(a, b); }
+static inline batch_vec_t v_xor   (const batch_vec_t a, const batch_vec_t b) { return _mm256_xor_si256(a, b); }
+static inline batch_vec_t v_add   (const batch_vec_t a, const batch_vec_t b) { return _mm256_add_epi8(a, b); }
+static inline batch_vec_t v_sub   (const batch_vec_t a, const batch_vec_t b) { return _mm256_sub_epi8(a, b); }
+static inline batch_vec_t v_eq    (const batch_vec_t a, const batch_vec_t b) { return _mm256_cmpeq_epi8(a, b); }
+static inline batch_vec_t v_max   (const batch_vec_t a, const batch_vec_t b) { return _mm256_max_epu8(a, b); }
+static inline batch_vec_t v_srl1  (const batch_vec_t a)           { return _mm256_and_si256(_mm256_srli_epi16(a, 1), _mm256_set1_epi8(0x7f)); }
+static inline batch_vec_t v_sel   (const batch_vec_t m, const batch_vec_t a, const batch_vec_t b) { return _mm256_blendv_epi8(b, a, m); }
+static inline bool        v_any   (const batch_vec_t m)           { return _mm256_movemask_epi8(m) != 0; }
+
+#elif !defined(WY65_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+
+#include <emmintrin.h>
+
+#define WY65_BATCH_VEC_LANES          16
+
+typedef __m128i batch_vec_t;
+
+static inline batch_vec_t v_load  (const uint8_t* p)              { return _mm_loadu_si128((const __m128i*)p); }
+static inline void        v_store (uint8_t* p, const batch_vec_t v) { _mm_storeu_si128((__m128i*)p, v); }
+static inline batch_vec_t v_set1  (const uint8_t b)               { return _mm_set1_epi8((char)b); }
+static inline batch_vec_t v_and   (const batch_vec_t a, const batch_vec_t b) { return _mm_and_si128(a, b); }
+static inline batch_vec_t v_or    (const batch_vec_t a, const batch_vec_t b) { return _mm_or_si128(a, b); }
+static inline batch_vec_t v_xor   (const batch_vec_t a, const batch_vec_t b) { return _mm_xor_si128(a, b); }
+static inline batch_vec_t v_add   (const batch_vec_t a, const batch_vec_t b) { return _mm_add_epi8(a, b); }
+static inline batch_vec_t v_sub   (const batch_vec_t a, const batch_vec_t b) { return _mm_sub_epi8(a, b); }
+static inline batch_vec_t v_eq    (const batch_vec_t a, const batch_vec_t b) { return _mm_cmpeq_epi8(a, b); }
+static inline batch_vec_t v_max   (const batch_vec_t a, const batch_vec_t b) { return _mm_max_epu8(a, b); }
+static inline batch_vec_t v_srl1  (const batch_vec_t a)           { return _mm_and_si128(_mm_srli_epi16(a, 1), _mm_set1_epi8(0x7f)); }
+static inline batch_vec_t v_sel   (const batch_vec_t m, const batch_vec_t a, const batch_vec_t b) {
+                                                                    return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b)); }
+static inline bool        v_any   (const batch_vec_t m)           { return _mm_movemask_epi8(m) != 0; }
+
+#else
+
+#define WY65_BATCH_VEC_LANES          16
+
+typedef struct { uint8_t b[WY65_BATCH_VEC_LANES]; } batch_vec_t;
+
+#define WY65_BATCH_VEC_OP(_name, _expr)                                                               \
+static inline batch_vec_t _name (const batch_vec_t a, const batch_vec_t b) {                          \
+    batch_vec_t r; for (int i = 0; i < WY65_BATCH_VEC_LANES; i++) { r.b[i] = (uint8_t)(_expr); } return r; }
+
+WY65_BATCH_VEC_OP(v_and, a.b[i] & b.b[i])
+WY65_BATCH_VEC_OP(v_or,  a.b[i] | b.b[i])
+WY65_BATCH_VEC_OP(v_xor, a.b[i] ^ b.b[i])
+WY65_BATCH_VEC_OP(v_add, a.b[i] + b.b[i])
+WY65_BATCH_VEC_OP(v_sub, a.b[i] - b.b[i])
+WY65_BATCH_VEC_OP(v_eq,  (a.b[i] == b.b[i]) ? 0xff : 0)
+WY65_BATCH_VEC_OP(v_max, (a.b[i] > b.b[i]) ? a.b[i] : b.b[i])
+
+static inline batch_vec_t v_load  (const uint8_t* p)              { batch_vec_t r; memcpy(r.b, p, WY65_BATCH_VEC_LANES); return r; }
+static inline void        v_store (uint8_t* p, const batch_vec_t v) { memcpy(p, v.b, WY65_BATCH_VEC_LANES); }
+static inline batch_vec_t v_set1  (const uint8_t b)               { batch_vec_t r; memset(r.b, b, WY65_BATCH_VEC_LANES); return r; }
+static inline batch_vec_t v_srl1  (const batch_vec_t a)           { batch_vec_t r; for (int i = 0; i < WY65_BATCH_VEC_LANES; i++) r.b[i] = a.b[i] >> 1; return r; }
+static inline batch_vec_t v_sel   (const batch_vec_t m, const batch_vec_t a, const batch_vec_t b) {
+                                                                    return v_or(v_and(m, a), v_and(v_xor(m, v_set1(0xff)), b)); }
+static inline bool        v_any   (const batch_vec_t m)           { for (int i = 0; i < WY65_BATCH_VEC_LANES; i++) if (m.b[i]) return true; return false; }
+
+#endif
+
+// Flags register with N and Z set from a result
+static inline batch_vec_t v_set_nz (const batch_vec_t p, const batch_vec_t r)
+{
+    batch_vec_t nz = v_or(v_and(r, v_set1(SIGN_MASK)), v_and(v_eq(r, v_set1(0)), v_set1(ZERO_MASK)));
+
+    return v_or(v_and(p, v_set1((uint8_t)~(SIGN_MASK | ZERO_MASK))), nz);
+}
+
+// Flags register with C set from a mask
+static inline batch_vec_t v_set_c (const batch_vec_t p, const batch_vec_t c)
+{
+    return v_or(v_and(p, v_set1((uint8_t)~CARRY_MASK)), v_and(c, v_set1(CARRY_MASK)));
+}
+
+// Flags register for a compare of a register with a value (C set if no borrow)
+static inline batch_vec_t v_compare (const batch_vec_t p, const batch_vec_t r, const batch_vec_t v)
+{
+    return v_set_c(v_set_nz(p, v_sub(r, v)), v_eq(v_max(r, v), r));
+}
+
+// Binary add with carry of v to the accumulator, returning the result and
+// updating the flags. The carry out is set if either addition wraps.
+static inline batch_vec_t v_adc (batch_vec_t &p, const batch_vec_t a, const batch_vec_t v)
+{
+    batch_vec_t sum    = v_add(a, v);
+    batch_vec_t res    = v_add(sum, v_and(p, v_set1(CARRY_MASK)));
+    batch_vec_t no_c1  = v_eq(v_max(sum, a), sum);
+    batch_vec_t no_c2  = v_eq(v_max(res, sum), res);
+    batch_vec_t carry  = v_xor(v_and(no_c1, no_c2), v_set1(0xff));
+    batch_vec_t ovflw  = v_srl1(v_and(v_and(v_xor(a, res), v_xor(v, res)), v_set1(SIGN_MASK)));
+
+    p = v_set_c(v_set_nz(v_or(v_and(p, v_set1((uint8_t)~OVFLW_MASK)), ovflw), res), carry);
+
+    return res;
+}
+
+// -------------------------------------------------------------------------
+// Table of instructions stepped together with SIMD operations: their class,
+// length and cycles (as the instruction methods, which are the same for all
+// CPU variants for these instructions in binary mode)
+// -------------------------------------------------------------------------
+
+enum batch_op_e {
+    BATCH_NONE = 0,      // Executed individually with execute()
+    BATCH_IMPL,          // Implied or accumulator
+    BATCH_IMM,           // Immediate operand
+    BATCH_READ,          // Zero page or absolute operand read
+    BATCH_STORE,         // Zero page or absolute store
+    BATCH_BRANCH,        // Relative branch
+    BATCH_JUMP           // Absolute jump
+};
+
+typedef struct
+{
+    uint8_t kind;
+    uint8_t bytes;
+    uint8_t cycles;
+    bool    bcd;         // ADC or SBC, executed individually in decimal mode
+} batch_op_t;
+
+struct wy65_batch_op_tbl_t
+{
+    batch_op_t entry[WY65_INSTR_SPACE_SIZE];
+
+    constexpr void set (const uint8_t opcode, const batch_op_e kind, const uint8_t bytes, const uint8_t cycles,
+                        const bool bcd = false)
+    {
+        entry[opcode].kind   = kind;
+        entry[opcode].bytes  = bytes;
+        entry[opcode].cycles = cycles;
+        entry[opcode].bcd    = bcd;
+    }
+
+    // Register/memory instructions, with immediate, zero page and absolute opcodes
+    constexpr void set_alu (const uint8_t imm, const uint8_t zpg, const uint8_t abs, const bool bcd = false)
+    {
+        set(imm, BATCH_IMM,  2, 2, bcd);
+        set(zpg, BATCH_READ, 2, 3, bcd);
+        set(abs, BATCH_READ, 3, 4, bcd);
+    }
+
+    constexpr wy65_batch_op_tbl_t() : entry()
+    {
+        for (uint32_t idx = 0; idx < WY65_INSTR_SPACE_SIZE; idx++)
+        {
+            set(idx, BATCH_NONE, 0, 0);
+        }
+
+        // TAX, TAY, TXA, TYA, TSX, TXS, INX, INY, DEX, DEY
+        set(0xaa, BATCH_IMPL, 1, 2); set(0xa8, BATCH_IMPL, 1, 2); set(0x8a, BATCH_IMPL, 1, 2);
+        set(0x98, BATCH_IMPL, 1, 2); set(0xba, BATCH_IMPL, 1, 2); set(0x9a, BATCH_IMPL, 1, 2);
+        set(0xe8, BATCH_IMPL, 1, 2); set(0xc8, BATCH_IMPL, 1, 2); set(0xca, BATCH_IMPL, 1, 2);
+        set(0x88, BATCH_IMPL, 1, 2);
+
+        // CLC, SEC, CLV, CLD, SED, and NOP (whose method returns no cycles)
+        set(0x18, BATCH_IMPL, 1, 2); set(0x38, BATCH_IMPL, 1, 2); set(0xb8, BATCH_IMPL, 1, 2);
+        set(0xd8, BATCH_IMPL, 1, 2); set(0xf8, BATCH_IMPL, 1, 2); set(0xea, BATCH_IMPL, 1, 0);
+
+        // ASL A, LSR A, ROL A, ROR A
+        set(0x0a, BATCH_IMPL, 1, 2); set(0x4a, BATCH_IMPL, 1, 2); set(0x2a, BATCH_IMPL, 1, 2);
+        set(0x6a, BATCH_IMPL, 1, 2);
+
+        // LDA, LDX, LDY, AND, ORA, EOR, CMP, CPX, CPY, ADC, SBC
+        set_alu(0xa9, 0xa5, 0xad); set_alu(0xa2, 0xa6, 0xae); set_alu(0xa0, 0xa4, 0xac);
+        set_alu(0x29, 0x25, 0x2d); set_alu(0x09, 0x05, 0x0d); set_alu(0x49, 0x45, 0x4d);
+        set_alu(0xc9, 0xc5, 0xcd); set_alu(0xe0, 0xe4, 0xec); set_alu(0xc0, 0xc4, 0xcc);
+        set_alu(0x69, 0x65, 0x6d, true); set_alu(0xe9, 0xe5, 0xed, true);
+
+        // BIT zero page and absolute
+        set(0x24, BATCH_READ, 2, 3); set(0x2c, BATCH_READ, 3, 4);
+
+        // STA, STX, STY zero page and absolute
+        set(0x85, BATCH_STORE, 2, 3); set(0x8d, BATCH_STORE, 3, 4);
+        set(0x86, BATCH_STORE, 2, 3); set(0x8e, BATCH_STORE, 3, 4);
+        set(0x84, BATCH_STORE, 2, 3); set(0x8c, BATCH_STORE, 3, 4);
+
+        // BPL, BMI, BVC, BVS, BCC, BCS, BNE, BEQ, and JMP absolute
+        set(0x10, BATCH_BRANCH, 2, 2); set(0x30, BATCH_BRANCH, 2, 2); set(0x50, BATCH_BRANCH, 2, 2);
+        set(0x70, BATCH_BRANCH, 2, 2); set(0x90, BATCH_BRANCH, 2, 2); set(0xb0, BATCH_BRANCH, 2, 2);
+        set(0xd0, BATCH_BRANCH, 2, 2); set(0xf0, BATCH_BRANCH, 2, 2);
+        set(0x4c, BATCH_JUMP,   3, 3);
+    }
+};
+
+static constexpr wy65_batch_op_tbl_t batch_op_tbl;
+
+// -------------------------------------------------------------------------
+// Constructor
+//
+// Creates the lanes' models and register arrays, padded to whole vectors.
+// Padding lanes are never in a step's mask.
+//
+// -------------------------------------------------------------------------
+
+cpu6502_batch::cpu6502_batch(const uint32_t num_lanes, const cpu_type_e mode)
+{
+    nlanes        = num_lanes;
+    nlanes_padded = (num_lanes + WY65_BATCH_VEC_LANES - 1) & ~(WY65_BATCH_VEC_LANES - 1);
+    mode_c        = mode;
+
+    p_lanes       = new cpu6502*[nlanes];
+
+    for (uint32_t idx = 0; idx < nlanes; idx++)
+    {
+        p_lanes[idx] = new cpu6502;
+    }
+
+    p_a           = new uint8_t [nlanes_padded]();
+    p_x           = new uint8_t [nlanes_padded]();
+    p_y           = new uint8_t [nlanes_padded]();
+    p_sp          = new uint8_t [nlanes_padded]();
+    p_flags       = new uint8_t [nlanes_padded]();
+    p_pc          = new uint16_t[nlanes_padded]();
+    p_cycles      = new uint64_t[nlanes_padded]();
+    p_budget      = new uint64_t[nlanes_padded]();
+    p_mask        = new uint8_t [nlanes_padded]();
+    p_val         = new uint8_t [nlanes_padded]();
+
+    simd_count    = 0;
+    scalar_count  = 0;
+}
+
+// -------------------------------------------------------------------------
+// Destructor
+// -------------------------------------------------------------------------
+
+cpu6502_batch::~cpu6502_batch()
+{
+    for (uint32_t idx = 0; idx < nlanes; idx++)
+    {
+        delete p_lanes[idx];
+    }
+
+    delete [] p_lanes;
+    delete [] p_a;
+    delete [] p_x;
+    delete [] p_y;
+    delete [] p_sp;
+    delete [] p_flags;
+    delete [] p_pc;
+    delete [] p_cycles;
+    delete [] p_budget;
+    delete [] p_mask;
+    delete [] p_val;
+}
+
+// -------------------------------------------------------------------------
+// reset()
+//
+// Resets each lane's model and takes its registers
+//
+// -------------------------------------------------------------------------
+
+void cpu6502_batch::reset (void)
+{
+    for (uint32_t idx = 0; idx < nlanes; idx++)
+    {
+        wy65_reg_t regs;
+
+        p_lanes[idx]->reset(mode_c);
+        p_lanes[idx]->get_regs(regs);
+
+        set_lane_regs(idx, regs);
+        p_cycles[idx] = 0;
+    }
+}
+
+// -------------------------------------------------------------------------
+// get_lane_regs() / set_lane_regs()
+// -------------------------------------------------------------------------
+
+void cpu6502_batch::get_lane_regs (const uint32_t idx, wy65_reg_t &regs)
+{
+    regs.pc    = p_pc[idx];
+    regs.a     = p_a[idx];
+    regs.x     = p_x[idx];
+    regs.y     = p_y[idx];
+    regs.sp    = p_sp[idx];
+    regs.flags = p_flags[idx];
+}
+
+void cpu6502_batch::set_lane_regs (const uint32_t idx, const wy65_reg_t &regs)
+{
+    p_pc[idx]    = regs.pc;
+    p_a[idx]     = regs.a;
+    p_x[idx]     = regs.x;
+    p_y[idx]     = regs.y;
+    p_sp[idx]    = regs.sp;
+    p_flags[idx] = regs.flags;
+}
+
+// -------------------------------------------------------------------------
+// run()
+//
+// Steps the lanes at the lowest PC of those with instructions still to
+// execute, until every lane has executed max_instructions. Lanes that
+// diverge at a branch rejoin the others when their PCs next agree (e.g.
+// at the end of a forward branch, or loop exit).
+//
+// -------------------------------------------------------------------------
+
+void cpu6502_batch::run (const uint64_t max_instructions)
+{
+    for (uint32_t idx = 0; idx < nlanes; idx++)
+    {
+        p_budget[idx] = max_instructions;
+    }
+
+    while (true)
+    {
+        uint32_t min_pc = WY65_ADDR_SPACE_SIZE;
+
+        for (uint32_t idx = 0; idx < nlanes; idx++)
+        {
+            if (p_budget[idx] != 0 && p_pc[idx] < min_pc)
+            {
+                min_pc = p_pc[idx];
+            }
+        }
+
+        if (min_pc == WY65_ADDR_SPACE_SIZE)
+        {
+            break;
+        }
+
+        step((uint16_t)min_pc);
+    }
+}
+
+// -------------------------------------------------------------------------
+// step()
+//
+// Executes the instruction at pc for each lane at that PC. Lanes with the
+// same instruction as the first, if one that can be stepped together, are
+// masked for step_simd(), having read any memory operand, and the rest
+// executed individually. Each lane's PC and cycles are then updated, and
+// stores made, for the lanes stepped together.
+//
+// -------------------------------------------------------------------------
+
+void cpu6502_batch::step (const uint16_t pc)
+{
+    uint32_t          first   = 0;
+
+    while (p_budget[first] == 0 || p_pc[first] != pc)
+    {
+        first++;
+    }
+
+    const uint8_t     opcode  = p_lanes[first]->sr_rd_mem(pc);
+    const batch_op_t* p_op    = &batch_op_tbl.entry[opcode];
+    const uint16_t    next_pc = pc + p_op->bytes;
+    const uint8_t     oper_lo = (p_op->bytes > 1) ? p_lanes[first]->sr_rd_mem((pc + 1) & MASK_16BIT) : 0;
+    const uint8_t     oper_hi = (p_op->bytes > 2) ? p_lanes[first]->sr_rd_mem((pc + 2) & MASK_16BIT) : 0;
+    const uint16_t    addr    = (oper_hi << 8) | oper_lo;
+    uint32_t          count   = 0;
+
+    for (uint32_t idx = first; idx < nlanes; idx++)
+    {
+        if (p_budget[idx] == 0 || p_pc[idx] != pc)
+        {
+            continue;
+        }
+
+        cpu6502*      p_lane  = p_lanes[idx];
+
+        // Lanes with a different instruction, an event to take, or a decimal mode
+        // ADC/SBC, are executed individually
+        if (p_op->kind == BATCH_NONE                                                      ||
+            p_lane->event_pending()                                                       ||
+            (p_op->bcd && (p_flags[idx] & BCD_MASK))                                      ||
+            (idx != first && (p_lane->sr_rd_mem(pc) != opcode                             ||
+                             (p_op->bytes > 1 && p_lane->sr_rd_mem((pc + 1) & MASK_16BIT) != oper_lo) ||
+                             (p_op->bytes > 2 && p_lane->sr_rd_mem((pc + 2) & MASK_16BIT) != oper_hi))))
+        {
+            step_scalar(idx);
+            continue;
+        }
+
+        if (p_op->kind == BATCH_READ)
+        {
+            p_val[idx] = p_lane->sr_rd_mem(addr);
+        }
+
+        p_mask[idx] = 0xff;
+        count++;
+    }
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    step_simd(opcode, oper_lo);
+
+    for (uint32_t idx = first; idx < nlanes; idx++)
+    {
+        if (p_mask[idx] == 0)
+        {
+            continue;
+        }
+
+        uint16_t lane_pc = next_pc;
+        uint32_t cycles  = p_op->cycles;
+
+        if (p_op->kind == BATCH_BRANCH && p_val[idx])
+        {
+            lane_pc = (next_pc + (int8_t)oper_lo) & MASK_16BIT;
+            cycles += 1 + (((lane_pc ^ next_pc) >> 8) ? 1 : 0);
+        }
+        else if (p_op->kind == BATCH_JUMP)
+        {
+            lane_pc = addr;
+        }
+        else if (p_op->kind == BATCH_STORE)
+        {
+            // STY, STA and STX, by the lowest bits of the opcode
+            const uint8_t* p_reg = ((opcode & 0x03) == 0) ? p_y : ((opcode & 0x03) == 1) ? p_a : p_x;
+
+            p_lanes[idx]->sr_wr_mem(addr, p_reg[idx]);
+        }
+
+        p_pc[idx]      = lane_pc;
+        p_cycles[idx] += cycles;
+        p_budget[idx]--;
+        p_mask[idx]    = 0;
+    }
+
+    simd_count += count;
+}
+
+// -------------------------------------------------------------------------
+// step_scalar()
+//
+// Executes a lane's next instruction on its model
+//
+// -------------------------------------------------------------------------
+
+void cpu6502_batch::step_scalar (const uint32_t idx)
+{
+    wy65_reg_t         regs;
+    wy65_exec_status_t status;
+
+    get_lane_regs(idx, regs);
+    p_lanes[idx]->set_regs(regs);
+
+    status = p_lanes[idx]->execute();
+
+    p_lanes[idx]->get_regs(regs);
+    set_lane_regs(idx, regs);
+
+    p_cycles[idx] += status.cycles;
+    p_budget[idx]--;
+
+    scalar_count++;
+}
+
+// -------------------------------------------------------------------------
+// step_simd()
+//
+// Updates the registers and flags of the masked lanes for an instruction,
+// a vector of lanes at a time. Memory operands are in p_val, and a mask
+// of the lanes taking a branch is returned in p_val.
+//
+// -------------------------------------------------------------------------
+
+void cpu6502_batch::step_simd (const uint8_t opcode, const uint8_t operand)
+{
+    const bool is_imm = batch_op_tbl.entry[opcode].kind == BATCH_IMM;
+
+    for (uint32_t base = 0; base < nlanes_padded; base += WY65_BATCH_VEC_LANES)
+    {
+        batch_vec_t mask  = v_load(&p_mask[base]);
+
+        if (!v_any(mask))
+        {
+            continue;
+        }
+
+        batch_vec_t a     = v_load(&p_a[base]);
+        batch_vec_t x     = v_load(&p_x[base]);
+        batch_vec_t y     = v_load(&p_y[base]);
+        batch_vec_t sp    = v_load(&p_sp[base]);
+        batch_vec_t p     = v_load(&p_flags[base]);
+        batch_vec_t v     = is_imm ? v_set1(operand) : v_load(&p_val[base]);
+        batch_vec_t one   = v_set1(1);
+        batch_vec_t zero  = v_set1(0);
+        batch_vec_t taken = zero;
+
+        switch (opcode)
+        {
+        // Transfers, increments and decrements
+        case 0xaa: x  = a;              p = v_set_nz(p, x); break;   // TAX
+        case 0xa8: y  = a;              p = v_set_nz(p, y); break;   // TAY
+        case 0x8a: a  = x;              p = v_set_nz(p, a); break;   // TXA
+        case 0x98: a  = y;              p = v_set_nz(p, a); break;   // TYA
+        case 0xba: x  = sp;             p = v_set_nz(p, x); break;   // TSX
+        case 0x9a: sp = x;                                  break;   // TXS
+        case 0xe8: x  = v_add(x, one);  p = v_set_nz(p, x); break;   // INX
+        case 0xc8: y  = v_add(y, one);  p = v_set_nz(p, y); break;   // INY
+        case 0xca: x  = v_sub(x, one);  p = v_set_nz(p, x); break;   // DEX
+        case 0x88: y  = v_sub(y, one);  p = v_set_nz(p, y); break;   // DEY
+
+        // Flags
+        case 0x18: p  = v_and(p, v_set1((uint8_t)~CARRY_MASK)); break;   // CLC
+        case 0x38: p  = v_or (p, v_set1(CARRY_MASK));           break;   // SEC
+        case 0xb8: p  = v_and(p, v_set1((uint8_t)~OVFLW_MASK)); break;   // CLV
+        case 0xd8: p  = v_and(p, v_set1((uint8_t)~BCD_MASK));   break;   // CLD
+        case 0xf8: p  = v_or (p, v_set1(BCD_MASK));             break;   // SED
+        case 0xea:                                              break;   // NOP
+
+        // Accumulator shifts and rotates
+        case 0x0a: case 0x2a: case 0x4a: case 0x6a:
+        {
+            batch_vec_t c_in  = v_and(p, v_set1(CARRY_MASK));
+            bool        left  = opcode < 0x40;
+            batch_vec_t c_out = v_eq(v_and(a, v_set1(left ? SIGN_MASK : CARRY_MASK)), zero);
+            batch_vec_t res   = left ? v_add(a, a) : v_srl1(a);
+
+            if (opcode == 0x2a)
+            {
+                res = v_or(res, c_in);                                                  // ROL
+            }
+            else if (opcode == 0x6a)
+            {
+                res = v_or(res, v_and(v_eq(c_in, one), v_set1(SIGN_MASK)));             // ROR
+            }
+
+            a = res;
+            p = v_set_c(v_set_nz(p, a), v_xor(c_out, v_set1(0xff)));
+            break;
+        }
+
+        // Loads
+        case 0xa9: case 0xa5: case 0xad: a = v; p = v_set_nz(p, a); break;     // LDA
+        case 0xa2: case 0xa6: case 0xae: x = v; p = v_set_nz(p, x); break;     // LDX
+        case 0xa0: case 0xa4: case 0xac: y = v; p = v_set_nz(p, y); break;     // LDY
+
+        // Logical operations
+        case 0x29: case 0x25: case 0x2d: a = v_and(a, v); p = v_set_nz(p, a); break;   // AND
+        case 0x09: case 0x05: case 0x0d: a = v_or (a, v); p = v_set_nz(p, a); break;   // ORA
+        case 0x49: case 0x45: case 0x4d: a = v_xor(a, v); p = v_set_nz(p, a); break;   // EOR
+
+        // Compares
+        case 0xc9: case 0xc5: case 0xcd: p = v_compare(p, a, v); break;        // CMP
+        case 0xe0: case 0xe4: case 0xec: p = v_compare(p, x, v); break;        // CPX
+        case 0xc0: case 0xc4: case 0xcc: p = v_compare(p, y, v); break;        // CPY
+
+        // Binary mode add and subtract (subtract adds the operand's complement)
+        case 0x69: case 0x65: case 0x6d: a = v_adc(p, a, v); break;                     // ADC
+        case 0xe9: case 0xe5: case 0xed: a = v_adc(p, a, v_xor(v, v_set1(0xff))); break; // SBC
+
+        // BIT: N and V from the operand, Z from the operand ANDed with A
+        case 0x24: case 0x2c:
+            p = v_or(v_or(v_and(p, v_set1((uint8_t)~(SIGN_MASK | OVFLW_MASK | ZERO_MASK))),
+                          v_and(v, v_set1(SIGN_MASK | OVFLW_MASK))),
+                     v_and(v_eq(v_and(a, v), zero), v_set1(ZERO_MASK)));
+            break;
+
+        // Branches, on the flag selected by the top two opcode bits being the
+        // value of opcode bit 5
+        case 0x10: case 0x30: case 0x50: case 0x70: case 0x90: case 0xb0: case 0xd0: case 0xf0:
+        {
+            static const uint8_t flag[4] = {SIGN_MASK, OVFLW_MASK, CARRY_MASK, ZERO_MASK};
+
+            batch_vec_t clear = v_eq(v_and(p, v_set1(flag[opcode >> 6])), zero);
+
+            taken = (opcode & 0x20) ? v_xor(clear, v_set1(0xff)) : clear;
+            break;
+        }
+
+        // Stores and jumps don't change registers
+        default:
+            break;
+        }
+
+        v_store(&p_a[base],     v_sel(mask, a,  v_load(&p_a[base])));
+        v_store(&p_x[base],     v_sel(mask, x,  v_load(&p_x[base])));
+        v_store(&p_y[base],     v_sel(mask, y,  v_load(&p_y[base])));
+        v_store(&p_sp[base],    v_sel(mask, sp, v_load(&p_sp[base])));
+        v_store(&p_flags[base], v_sel(mask, p,  v_load(&p_flags[base])));
+        v_store(&p_val[base],   v_and(mask, taken));
+    }
+}
@@ -0,0 +1,129 @@
+//=============================================================
+//
+// Copyright (c) 2024 Simon Southwell. All rights reserved.
+//
+// Date: 17th October 2026
+//
+// This file is part of the cpu6502 instruction set simulator
+// and contains the header for the batch engine, stepping many
+// models' registers together in structure-of-arrays form.
+//
+// This code is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// The code is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this code. If not, see <http://www.gnu.org/licenses/>.
+//
+//=============================================================
+
+#ifndef _CPU6502_BATCH_H_
+#define _CPU6502_BATCH_H_
+
+// -------------------------------------------------------------------------
+// INCLUDES
+// -------------------------------------------------------------------------
+
+#include <stdint.h>
+
+#include "cpu6502_api.h"
+
+// -------------------------------------------------------------------------
+// DEFINES (override-able)
+// -------------------------------------------------------------------------
+
+// Define WY65_NO_SIMD to use portable code in place of SSE2/AVX2 intrinsics
+// for the lockstep register and flag updates
+
+// #define WY65_NO_SIMD
+
+// -------------------------------------------------------------------------
+// CLASS DEFINITION
+// -------------------------------------------------------------------------
+
+// Batch of models (lanes), typically running the same program on different
+// inputs. Each lane is a cpu6502, holding the lane's memory (set up by the
+// host via lane()), whilst the batch holds all lanes' registers and cycle
+// counts as arrays. Each step executes one instruction for the lanes at
+// the lowest PC, so that diverged lanes tend to reconverge. Where these
+// lanes have the same instruction, and it is a load, store, ALU, register
+// transfer, flag, branch or jump instruction without indexing, all of them
+// are updated together with SIMD operations. Otherwise (or for a lane with
+// a pending event, or decimal mode ADC/SBC), each lane executes the
+// instruction on its model with execute(). The results for each lane are
+// the same as executing its model with execute().
+class cpu6502_batch
+{
+// Public methods
+PUBLIC:
+
+    // Constructor, creating the lanes, which are reset to the CPU variant by reset()
+    LIB6502_API                    cpu6502_batch(const uint32_t num_lanes, const cpu_type_e mode = BASE);
+
+    // Destructor
+    LIB6502_API                    ~cpu6502_batch();
+
+    // Reset all the lanes (each from its own reset vector), clearing their cycle counts
+    LIB6502_API void               reset              (void);
+
+    // Execute max_instructions instructions on every lane
+    LIB6502_API void               run                (const uint64_t max_instructions);
+
+    // Lane's model, for setting up its memory, devices or interrupts. Its registers
+    // are accessed via the batch.
+    LIB6502_API cpu6502*           lane               (const uint32_t idx) { return p_lanes[idx]; };
+
+    LIB6502_API void               get_lane_regs      (const uint32_t idx, wy65_reg_t &regs);
+    LIB6502_API void               set_lane_regs      (const uint32_t idx, const wy65_reg_t &regs);
+
+    // Cycles executed by a lane since reset()
+    LIB6502_API uint64_t           get_lane_cycles    (const uint32_t idx) { return p_cycles[idx]; };
+
+    LIB6502_API uint32_t           num_lanes          (void) { return nlanes; };
+
+    // Number of lane instructions executed together with SIMD operations, and
+    // individually, since construction
+    LIB6502_API void               get_stats          (uint64_t &simd_instrs, uint64_t &scalar_instrs) {
+                                                          simd_instrs = simd_count; scalar_instrs = scalar_count; };
+
+// Private methods
+PRIVATE:
+
+    void                           step               (const uint16_t pc);
+    void                           step_scalar        (const uint32_t idx);
+    void                           step_simd          (const uint8_t opcode, const uint8_t operand);
+
+// Private member variables
+PRIVATE:
+
+    uint32_t                       nlanes;
+    uint32_t                       nlanes_padded;    // Rounded up to whole SIMD vectors
+    cpu_type_e                     mode_c;
+    cpu6502**                      p_lanes;
+
+    // Lanes' registers, cycle counts and remaining instructions for run()
+    uint8_t*                       p_a;
+    uint8_t*                       p_x;
+    uint8_t*                       p_y;
+    uint8_t*                       p_sp;
+    uint8_t*                       p_flags;
+    uint16_t*                      p_pc;
+    uint64_t*                      p_cycles;
+    uint64_t*                      p_budget;
+
+    // Per step lane mask (0xff for lanes stepped together) and lane values (memory
+    // operands in, branches taken out)
+    uint8_t*                       p_mask;
+    uint8_t*                       p_val;
+
+    uint64_t                       simd_count;
+    uint64_t                       scalar_count;
+};
+
+#endif
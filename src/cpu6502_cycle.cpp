@@ -0,0 +1,583 @@
+//=============================================================
+//
+// Copyright (c) 2024 Simon Southwell. All rights reserved.
+//
+// Date: 17th October 2026
+//
+// This file is part of the cpu6502 instruction set simulator
+// and contains the cycle exact bus engine, making every bus
+// cycle of each instruction, including dummy reads and writes,
+// in hardware order.
+//
+// This code is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// The code is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this code. If not, see <http://www.gnu.org/licenses/>.
+//
+//=============================================================
+
+// -------------------------------------------------------------------------
+// INCLUDES
+// -------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "cpu6502.h"
+
+// -------------------------------------------------------------------------
+// run_cycle()
+//
+// Cycle exact engine for run(), with the same stop conditions. Each
+// instruction is executed by cycle_instr(), making one memory access per
+// bus cycle, and counting the cycle count per bus cycle, so that the
+// counts reflect the hardware, rather than the instruction table's
+// execution cycles as used by the other engines. This is slower than the
+// other engines, and is for hosts with devices sensitive to the dummy
+// accesses, or needing the cycle at which each access is made.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+wy65_run_status_t cpu6502_core<BUS>::run_cycle (const uint64_t max_instructions, const uint64_t max_cycles)
+{
+    wy65_run_status_t  rtn_val;
+    uint64_t           icount       = 0;
+    uint64_t           start_cycles = state.cycles;
+    run_stop_e         reason;
+
+    pending.fetch_and(~(EVT_STOP | EVT_BREAK));
+    idle_valid        = false;
+
+    begin_lazy_flags();
+
+    while (true)
+    {
+        if (icount >= max_instructions)
+        {
+            reason    = STOP_INSTR_BUDGET;
+            break;
+        }
+
+        if ((state.cycles - start_cycles) >= max_cycles)
+        {
+            reason    = STOP_CYCLE_BUDGET;
+            break;
+        }
+
+        if (events_pending() && service_events(reason))
+        {
+            break;
+        }
+
+        uint16_t pc       = state.regs.pc;
+
+        cycle_instr();
+        icount++;
+
+        if (state.regs.pc == pc)
+        {
+            reason    = state.stopped ? STOP_HALTED : state.waiting ? STOP_WAITING : STOP_SELF_LOOP;
+            break;
+        }
+
+        if (state.regs.pc == until_pc)
+        {
+            reason    = STOP_PC;
+            break;
+        }
+
+        if (state.regs.pc < pc && idle_detect && idle_loop(icount, start_cycles, max_instructions, max_cycles))
+        {
+            reason    = STOP_IDLE;
+            break;
+        }
+    }
+
+    if (reason == STOP_WAITING && idle_detect)
+    {
+        idle_skip(icount, start_cycles, max_instructions, max_cycles, 0, 1);
+    }
+
+    end_lazy_flags();
+
+    rtn_val.pc           = state.regs.pc;
+    rtn_val.flags        = state.regs.flags;
+    rtn_val.instructions = icount;
+    rtn_val.cycles       = state.cycles - start_cycles;
+    rtn_val.stop_reason  = reason;
+
+    return rtn_val;
+}
+
+// -------------------------------------------------------------------------
+// cycle_addr()
+//
+// Fetches the operand bytes at the PC for a memory addressing mode, making
+// any pointer reads and dummy cycles in order, and returns the effective
+// address, with the PC advanced past the operand. Indexing across a page
+// takes a dummy read, also made without a page crossing if fixup is set
+// (stores and read-modify-writes). The base 6502 reads the address before
+// the index is added, or before the high byte is corrected, whilst the
+// 65C02 re-reads the last operand byte instead.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+uint16_t cpu6502_core<BUS>::cycle_addr (const addr_mode_e mode, const bool fixup)
+{
+    const bool     cmos = state.mode_c != BASE;
+    const uint16_t pc   = state.regs.pc;
+    uint16_t       base = 0;
+    uint16_t       addr = pc;
+    uint8_t        ptr;
+
+    switch (mode)
+    {
+    case ZPG:
+        addr          = cycle_rd(pc);
+        break;
+
+    case ZPX:
+    case ZPY:
+        base          = cycle_rd(pc);
+        cycle_rd(cmos ? pc : base, BUS_DUMMY_READ);
+        addr          = (base + ((mode == ZPX) ? state.regs.x : state.regs.y)) & MASK_8BIT;
+        break;
+
+    case ABS:
+        addr          = cycle_rd(pc);
+        addr         |= cycle_rd(pc + 1) << 8;
+        break;
+
+    case ABX:
+    case ABY:
+        base          = cycle_rd(pc);
+        base         |= cycle_rd(pc + 1) << 8;
+        addr          = base + ((mode == ABX) ? state.regs.x : state.regs.y);
+
+        if (fixup || ((addr ^ base) & 0xff00))
+        {
+            cycle_rd(cmos ? (uint16_t)(pc + 1) : ((base & 0xff00) | (addr & MASK_8BIT)), BUS_DUMMY_READ);
+        }
+        break;
+
+    case IDX:
+        base          = cycle_rd(pc);
+        cycle_rd(cmos ? pc : base, BUS_DUMMY_READ);
+        ptr           = base + state.regs.x;
+        addr          = cycle_rd(ptr);
+        addr         |= cycle_rd((uint8_t)(ptr + 1)) << 8;
+        break;
+
+    case IDY:
+        ptr           = cycle_rd(pc);
+        base          = cycle_rd(ptr);
+        base         |= cycle_rd((uint8_t)(ptr + 1)) << 8;
+        addr          = base + state.regs.y;
+
+        if (fixup || ((addr ^ base) & 0xff00))
+        {
+            cycle_rd(cmos ? pc : ((base & 0xff00) | (addr & MASK_8BIT)), BUS_DUMMY_READ);
+        }
+        break;
+
+    case IDZ:
+        ptr           = cycle_rd(pc);
+        addr          = cycle_rd(ptr);
+        addr         |= cycle_rd((uint8_t)(ptr + 1)) << 8;
+        break;
+
+    default:
+        break;
+    }
+
+    state.regs.pc     = pc + mode_op_bytes(mode);
+
+    return addr;
+}
+
+// -------------------------------------------------------------------------
+// cycle_instr()
+//
+// Executes the instruction at the PC, making each of its bus cycles in
+// order, starting with the opcode fetch. Operations on data are made by
+// the instruction methods of the opcode, or of the equivalent immediate or
+// accumulator mode opcode, called with the data as the operand, so that
+// results match the other engines. A base 6502 read-modify-write writes
+// the unmodified value back before the result, whilst the 65C02 re-reads
+// it. Whilst waiting or stopped, the WAI or STP is re-executed with no bus
+// cycles, as it returns no cycles in the other engines.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::cycle_instr (void)
+{
+    op_t     op;
+    uint16_t addr;
+    uint16_t next;
+    uint8_t  data;
+    uint8_t  acc;
+    int      cycles;
+
+    const bool cmos   = state.mode_c != BASE;
+
+    if (state.waiting || state.stopped)
+    {
+        op.opcode         = rd_mem(state.regs.pc++);
+        op.exec_cycles    = instr_tbl[op.opcode].exec_cycles;
+        fetch_operand(op, instr_tbl[op.opcode].op_bytes);
+
+        (this->*instr_tbl[op.opcode].pFunc)(&op);
+        return;
+    }
+
+    const uint16_t pc = state.regs.pc;
+
+    op.opcode         = cycle_rd(pc, BUS_OPCODE);
+    op.operand        = 0;
+
+    const tbl_t* p_instr = &instr_tbl[op.opcode];
+    const tbl_t* p_alu   = &instr_tbl[p_instr->alu_opcode];
+
+    op.exec_cycles    = p_instr->exec_cycles;
+    state.regs.pc     = pc + 1;
+
+    // 65C02 decimal mode ADC and SBC take an extra cycle, re-reading the data address
+    const bool bcd_cycle = cmos && (state.regs.flags & BCD_MASK) &&
+                           (p_instr->alu_opcode == ADC_IMM_OPCODE || p_instr->alu_opcode == SBC_IMM_OPCODE);
+
+    switch (p_instr->cyc_class)
+    {
+    case CYC_IMPLIED:
+        cycle_rd(state.regs.pc, BUS_DUMMY_READ);
+
+        // WAI and STP have further internal cycles
+        for (cycles = (this->*p_instr->pFunc)(&op); cycles > 2; cycles--)
+        {
+            cycle_rd(pc + 1, BUS_DUMMY_READ);
+        }
+        break;
+
+    case CYC_IMM:
+        op.operand    = cycle_rd(state.regs.pc++);
+        (this->*p_instr->pFunc)(&op);
+
+        if (bcd_cycle)
+        {
+            cycle_rd(pc + 1, BUS_DUMMY_READ);
+        }
+        break;
+
+    case CYC_READ:
+        addr          = cycle_addr(p_instr->addr_mode, false);
+        op.operand    = cycle_rd(addr);
+        (this->*p_alu->pFunc)(&op);
+
+        if (bcd_cycle)
+        {
+            cycle_rd(addr, BUS_DUMMY_READ);
+        }
+        break;
+
+    case CYC_BIT:
+        data          = cycle_rd(cycle_addr(p_instr->addr_mode, false));
+
+        state.regs.flags = (state.regs.flags & ~OVFLW_MASK) | (data & OVFLW_MASK);
+        set_nz(data & SIGN_MASK, (state.regs.a & data) == 0);
+        break;
+
+    case CYC_STA:
+        cycle_wr(cycle_addr(p_instr->addr_mode, true), state.regs.a);
+        break;
+
+    case CYC_STX:
+        cycle_wr(cycle_addr(p_instr->addr_mode, true), state.regs.x);
+        break;
+
+    case CYC_STY:
+        cycle_wr(cycle_addr(p_instr->addr_mode, true), state.regs.y);
+        break;
+
+    case CYC_STZ:
+        cycle_wr(cycle_addr(p_instr->addr_mode, true), 0);
+        break;
+
+    case CYC_SHIFT:
+    case CYC_INC:
+    case CYC_DEC:
+    case CYC_TRB:
+    case CYC_TSB:
+    case CYC_RMB:
+    case CYC_SMB:
+        // The 65C02 only takes the indexing cycle for shifts and rotates on a page crossing
+        addr          = cycle_addr(p_instr->addr_mode, !cmos || p_instr->cyc_class != CYC_SHIFT);
+        data          = cycle_rd(addr);
+
+        if (cmos)
+        {
+            cycle_rd(addr, BUS_DUMMY_READ);
+        }
+        else
+        {
+            cycle_wr(addr, data, BUS_DUMMY_WRITE);
+        }
+
+        switch (p_instr->cyc_class)
+        {
+        case CYC_SHIFT:
+            acc           = state.regs.a;
+            state.regs.a  = data;
+            (this->*p_alu->pFunc)(&op);
+            data          = state.regs.a;
+            state.regs.a  = acc;
+            break;
+        case CYC_INC:
+            set_nz(++data);
+            break;
+        case CYC_DEC:
+            set_nz(--data);
+            break;
+        case CYC_TRB:
+            set_nz(flag_n(), (state.regs.a & data) == 0);
+            data         &= ~state.regs.a;
+            break;
+        case CYC_TSB:
+            set_nz(flag_n(), (state.regs.a & data) == 0);
+            data         |= state.regs.a;
+            break;
+        case CYC_RMB:
+            data         &= ~(1 << ((op.opcode >> 4) & 0x7));
+            break;
+        default:
+            data         |= 1 << ((op.opcode >> 4) & 0x7);
+            break;
+        }
+
+        cycle_wr(addr, data);
+        break;
+
+    case CYC_BRANCH:
+        op.operand    = cycle_rd(state.regs.pc++);
+        next          = state.regs.pc;
+
+        // The method returns the extra cycles for a taken branch, and a page crossing
+        cycles        = (this->*p_instr->pFunc)(&op) - op.exec_cycles;
+
+        if (cycles > 0)
+        {
+            cycle_rd(next, BUS_DUMMY_READ);
+        }
+
+        if (cycles > 1)
+        {
+            cycle_rd(cmos ? next : ((next & 0xff00) | (state.regs.pc & MASK_8BIT)), BUS_DUMMY_READ);
+        }
+        break;
+
+    case CYC_BBR:
+    case CYC_BBS:
+        addr          = cycle_rd(state.regs.pc);
+        data          = cycle_rd(addr);
+        cycle_rd(addr, BUS_DUMMY_READ);
+        op.operand    = cycle_rd(state.regs.pc + 1);
+        state.regs.pc = next = pc + 3;
+
+        if (((data >> ((op.opcode >> 4) & 0x7)) & 1) == (p_instr->cyc_class == CYC_BBS ? 1 : 0))
+        {
+            state.regs.pc = next + (int8_t)op.operand;
+
+            cycle_rd(next, BUS_DUMMY_READ);
+
+            if ((state.regs.pc ^ next) & 0xff00)
+            {
+                cycle_rd(next, BUS_DUMMY_READ);
+            }
+        }
+        break;
+
+    case CYC_JMP:
+        addr          = cycle_rd(state.regs.pc);
+        addr         |= cycle_rd(state.regs.pc + 1) << 8;
+
+        if (p_instr->addr_mode == IAX)
+        {
+            cycle_rd(pc + 2, BUS_DUMMY_READ);
+            addr     += state.regs.x;
+        }
+        else if (p_instr->addr_mode == IND && cmos)
+        {
+            cycle_rd(pc + 2, BUS_DUMMY_READ);
+        }
+
+        if (p_instr->addr_mode != ABS)
+        {
+            // The base 6502 does not carry into the pointer's high byte
+            next          = (!cmos && (addr & MASK_8BIT) == MASK_8BIT) ? (addr & 0xff00) : (uint16_t)(addr + 1);
+            data          = cycle_rd(addr);
+            addr          = data | (cycle_rd(next) << 8);
+        }
+
+        state.regs.pc = addr;
+        break;
+
+    case CYC_JSR:
+        addr          = cycle_rd(state.regs.pc);
+        cycle_rd(state.regs.sp | 0x100, BUS_DUMMY_READ);
+        cycle_push((pc + 2) >> 8);
+        cycle_push((pc + 2) & MASK_8BIT);
+        addr         |= cycle_rd(pc + 2) << 8;
+
+        state.regs.pc = addr;
+        break;
+
+    case CYC_RTS:
+        cycle_rd(state.regs.pc, BUS_DUMMY_READ);
+        cycle_rd(state.regs.sp | 0x100, BUS_DUMMY_READ);
+        addr          = cycle_pull();
+        addr         |= cycle_pull() << 8;
+        cycle_rd(addr, BUS_DUMMY_READ);
+
+        state.regs.pc = addr + 1;
+        break;
+
+    case CYC_RTI:
+        cycle_rd(state.regs.pc, BUS_DUMMY_READ);
+        cycle_rd(state.regs.sp | 0x100, BUS_DUMMY_READ);
+        set_flags(cycle_pull());
+        addr          = cycle_pull();
+        addr         |= cycle_pull() << 8;
+
+        state.regs.pc = addr;
+        break;
+
+    case CYC_BRK:
+        // As for BRK(), the B flag is left set, and the pad byte skipped
+        state.regs.flags |= BRK_MASK | 0x20;
+
+        cycle_rd(state.regs.pc++);
+        cycle_push(state.regs.pc >> 8);
+        cycle_push(state.regs.pc & MASK_8BIT);
+        cycle_push(get_flags());
+
+        state.regs.flags |= INT_MASK;
+
+        if (cmos)
+        {
+            state.regs.flags &= ~BCD_MASK;
+        }
+
+        addr          = cycle_rd(IRQ_VEC_ADDR);
+        addr         |= cycle_rd(IRQ_VEC_ADDR + 1) << 8;
+
+        state.regs.pc = addr;
+        break;
+
+    case CYC_PHA:
+    case CYC_PHP:
+    case CYC_PHX:
+    case CYC_PHY:
+        cycle_rd(state.regs.pc, BUS_DUMMY_READ);
+        cycle_push((p_instr->cyc_class == CYC_PHA) ? state.regs.a :
+                   (p_instr->cyc_class == CYC_PHX) ? state.regs.x :
+                   (p_instr->cyc_class == CYC_PHY) ? state.regs.y : (get_flags() | 0x30));
+        break;
+
+    case CYC_PLA:
+    case CYC_PLP:
+    case CYC_PLX:
+    case CYC_PLY:
+        cycle_rd(state.regs.pc, BUS_DUMMY_READ);
+        cycle_rd(state.regs.sp | 0x100, BUS_DUMMY_READ);
+        data          = cycle_pull();
+
+        if (p_instr->cyc_class == CYC_PLP)
+        {
+            // I flags status updated (and any active IRQ pending) by set_flags()
+            set_flags(data);
+        }
+        else
+        {
+            ((p_instr->cyc_class == CYC_PLA) ? state.regs.a :
+             (p_instr->cyc_class == CYC_PLX) ? state.regs.x : state.regs.y) = data;
+            set_nz(data);
+        }
+        break;
+
+    case CYC_NOP:
+        // Undefined opcodes fetch any operand, then take internal cycles to the
+        // table's execution cycles, re-reading the last byte fetched
+        addr          = pc;
+
+        for (uint32_t idx = 0; idx < p_instr->op_bytes; idx++)
+        {
+            cycle_rd(addr = pc + 1 + idx);
+        }
+
+        for (cycles = 1 + p_instr->op_bytes; cycles < (int)p_instr->exec_cycles; cycles++)
+        {
+            cycle_rd(addr, BUS_DUMMY_READ);
+        }
+
+        state.regs.pc = pc + 1 + p_instr->op_bytes;
+        break;
+    }
+}
+
+// -------------------------------------------------------------------------
+// cycle_interrupt()
+//
+// Interrupt entry bus cycles for the cycle exact engine, called by irq()
+// and nmi() in place of their functional sequence: two dummy
+// reads at the PC, pushes of the PC and the given flags, and reads of the
+// vector.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::cycle_interrupt (const uint16_t vector, const uint8_t flags)
+{
+    uint16_t addr;
+
+    cycle_rd(state.regs.pc, BUS_DUMMY_READ);
+    cycle_rd(state.regs.pc, BUS_DUMMY_READ);
+    cycle_push(state.regs.pc >> 8);
+    cycle_push(state.regs.pc & MASK_8BIT);
+    cycle_push(flags);
+
+    state.regs.flags |= INT_MASK;
+
+    addr              = cycle_rd(vector);
+    addr             |= cycle_rd(vector + 1) << 8;
+
+    state.regs.pc     = addr;
+}
+
+// -------------------------------------------------------------------------
+// Instantiate the cycle exact engine methods for the default bus, and for
+// WY65_BUS, if defined (see cpu6502.cpp)
+// -------------------------------------------------------------------------
+
+#define WY65_CYCLE_INSTANTIATE(_bus)                                                                               \
+    template wy65_run_status_t cpu6502_core<_bus>::run_cycle       (const uint64_t max_instructions,             \
+                                                                    const uint64_t max_cycles);                   \
+    template void              cpu6502_core<_bus>::cycle_instr     (void);                                       \
+    template uint16_t          cpu6502_core<_bus>::cycle_addr      (const cpu6502_core<_bus>::addr_mode_e mode,  \
+                                                                    const bool fixup);                            \
+    template void              cpu6502_core<_bus>::cycle_interrupt (const uint16_t vector, const uint8_t flags);
+
+WY65_CYCLE_INSTANTIATE(wy65_cb_bus_t)
+
+#ifdef WY65_BUS
+WY65_CYCLE_INSTANTIATE(WY65_BUS)
+#endif
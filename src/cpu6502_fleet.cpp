@@ -0,0 +1,320 @@
+//=============================================================
+//
+// Copyright (c) 2024 Simon Southwell. All rights reserved.
+//
+// Date: 17th October 2026
+//
+// This file is part of the cpu6502 instruction set simulator
+// and contains the fleet runner, running jobs on many model
+// instances over a pool of work stealing worker threads.
+//
+// This code is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// The code is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this code. If not, see <http://www.gnu.org/licenses/>.
+//
+//=============================================================
+
+// -------------------------------------------------------------------------
+// INCLUDES
+// -------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <chrono>
+
+#include "cpu6502_fleet.h"
+
+// -------------------------------------------------------------------------
+// Constructor
+//
+// Creates a model for each worker and starts the worker threads
+//
+// -------------------------------------------------------------------------
+
+cpu6502_fleet::cpu6502_fleet(const uint32_t num_workers) : next_worker(0), queued(0), quit(false), outstanding(0)
+{
+    uint32_t count = num_workers;
+
+    if (count == WY65_FLEET_DEFAULT_WORKERS)
+    {
+        count = std::thread::hardware_concurrency();
+        count = (count == 0) ? 1 : count;
+    }
+
+    for (uint32_t idx = 0; idx < count; idx++)
+    {
+        worker_t* p_worker = new worker_t;
+
+        p_worker->p_cpu    = new cpu6502;
+        p_worker->busy     = false;
+
+        workers.push_back(p_worker);
+    }
+
+    // Start the workers only once all exist, as each may steal from any other
+    for (uint32_t idx = 0; idx < count; idx++)
+    {
+        workers[idx]->thread = std::thread(&cpu6502_fleet::worker_loop, this, idx);
+    }
+}
+
+// -------------------------------------------------------------------------
+// Destructor
+//
+// Stops the workers, discarding queued jobs. Jobs in progress are stopped
+// by requesting a stop until the worker is no longer busy, as a stop
+// requested before the run starts is discarded by run().
+//
+// -------------------------------------------------------------------------
+
+cpu6502_fleet::~cpu6502_fleet()
+{
+    {
+        std::lock_guard<std::mutex> lk(idle_lock);
+        quit = true;
+    }
+    idle_cv.notify_all();
+
+    for (uint32_t idx = 0; idx < workers.size(); idx++)
+    {
+        while (workers[idx]->busy)
+        {
+            workers[idx]->p_cpu->request_stop();
+            std::this_thread::yield();
+        }
+
+        workers[idx]->thread.join();
+    }
+
+    for (uint32_t idx = 0; idx < workers.size(); idx++)
+    {
+        delete workers[idx]->p_cpu;
+        delete workers[idx];
+    }
+}
+
+// -------------------------------------------------------------------------
+// submit()
+//
+// Queues a job on the next worker's queue in turn, and wakes a sleeping
+// worker. The count of queued jobs is incremented after the job is queued,
+// and the idle lock taken before notifying, so that a worker cannot miss
+// the job between checking the count and sleeping.
+//
+// -------------------------------------------------------------------------
+
+void cpu6502_fleet::submit (const wy65_fleet_job_t &job)
+{
+    worker_t* p_worker = workers[next_worker.fetch_add(1) % workers.size()];
+
+    {
+        std::lock_guard<std::mutex> lk(result_lock);
+        outstanding++;
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(p_worker->lock);
+        p_worker->jobs.push_back(job);
+    }
+
+    queued.fetch_add(1);
+
+    {
+        std::lock_guard<std::mutex> lk(idle_lock);
+    }
+    idle_cv.notify_one();
+}
+
+// -------------------------------------------------------------------------
+// wait_result()
+//
+// Waits for, and returns, the next completed job's result, returning false
+// if there are no jobs outstanding
+//
+// -------------------------------------------------------------------------
+
+bool cpu6502_fleet::wait_result (wy65_fleet_result_t &result)
+{
+    std::unique_lock<std::mutex> lk(result_lock);
+
+    if (outstanding == 0)
+    {
+        return false;
+    }
+
+    result_cv.wait(lk, [this]{ return !results.empty(); });
+
+    result = results.front();
+    results.pop_front();
+    outstanding--;
+
+    return true;
+}
+
+// -------------------------------------------------------------------------
+// poll_result()
+//
+// Returns the next completed job's result, if there is one
+//
+// -------------------------------------------------------------------------
+
+bool cpu6502_fleet::poll_result (wy65_fleet_result_t &result)
+{
+    std::lock_guard<std::mutex> lk(result_lock);
+
+    if (results.empty())
+    {
+        return false;
+    }
+
+    result = results.front();
+    results.pop_front();
+    outstanding--;
+
+    return true;
+}
+
+// -------------------------------------------------------------------------
+// get_job()
+//
+// Takes a job from the front of the worker's own queue or, if empty, from
+// the back of the other workers' queues, starting with the next worker.
+// Returns false if no job was found.
+//
+// -------------------------------------------------------------------------
+
+bool cpu6502_fleet::get_job (const uint32_t idx, wy65_fleet_job_t &job, bool &stolen)
+{
+    uint32_t count = (uint32_t)workers.size();
+
+    for (uint32_t offset = 0; offset < count; offset++)
+    {
+        worker_t* p_worker = workers[(idx + offset) % count];
+
+        std::lock_guard<std::mutex> lk(p_worker->lock);
+
+        if (!p_worker->jobs.empty())
+        {
+            if (offset == 0)
+            {
+                job = p_worker->jobs.front();
+                p_worker->jobs.pop_front();
+            }
+            else
+            {
+                job = p_worker->jobs.back();
+                p_worker->jobs.pop_back();
+            }
+
+            queued.fetch_sub(1);
+            stolen = (offset != 0);
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// -------------------------------------------------------------------------
+// worker_loop()
+//
+// Runs jobs until the fleet is destroyed, sleeping whilst no jobs are
+// queued. The worker is marked busy before checking for quitting, so
+// that the destructor sees any job that is about to run.
+//
+// -------------------------------------------------------------------------
+
+void cpu6502_fleet::worker_loop (const uint32_t idx)
+{
+    worker_t*        p_worker = workers[idx];
+    wy65_fleet_job_t job;
+    bool             stolen;
+
+    while (true)
+    {
+        p_worker->busy = true;
+
+        if (quit)
+        {
+            p_worker->busy = false;
+            break;
+        }
+
+        if (get_job(idx, job, stolen))
+        {
+            run_job(idx, job, stolen);
+            p_worker->busy = false;
+        }
+        else
+        {
+            p_worker->busy = false;
+
+            std::unique_lock<std::mutex> lk(idle_lock);
+            idle_cv.wait(lk, [this]{ return quit || queued != 0; });
+        }
+    }
+}
+
+// -------------------------------------------------------------------------
+// run_job()
+//
+// Prepares the worker's model for the job, runs it and queues the result
+//
+// -------------------------------------------------------------------------
+
+void cpu6502_fleet::run_job (const uint32_t idx, const wy65_fleet_job_t &job, const bool stolen)
+{
+    cpu6502*            p_cpu = workers[idx]->p_cpu;
+    wy65_fleet_result_t result;
+
+    // Return the model to internal memory only, and load the image
+    p_cpu->unmap_pages(0, WY65_ADDR_SPACE_SIZE);
+    p_cpu->register_mem_funcs((wy65_p_writemem_t)NULL, (wy65_p_readmem_t)NULL);
+    p_cpu->register_bus_cycle_func(NULL);
+    p_cpu->load_mem(NULL);
+    p_cpu->load_mem(job.p_image, job.image_len, job.load_addr);
+
+    p_cpu->set_engine(job.engine);
+    p_cpu->reset(job.cpu_type);
+    p_cpu->sr_regs()->pc = job.start_addr;
+
+    if (job.p_setup != NULL)
+    {
+        job.p_setup(p_cpu, job.p_ctx);
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    result.status = p_cpu->run(job.max_instructions, job.max_cycles);
+
+    std::chrono::steady_clock::time_point end   = std::chrono::steady_clock::now();
+
+    if (job.p_done != NULL)
+    {
+        job.p_done(p_cpu, job.p_ctx);
+    }
+
+    result.id         = job.id;
+    result.worker     = idx;
+    result.stolen     = stolen;
+    result.regs       = *p_cpu->sr_regs();
+    result.regs.flags = result.status.flags;
+    result.run_us     = std::chrono::duration<double, std::micro>(end - start).count();
+
+    {
+        std::lock_guard<std::mutex> lk(result_lock);
+        results.push_back(result);
+    }
+    result_cv.notify_one();
+}
@@ -0,0 +1,175 @@
+//=============================================================
+//
+// Copyright (c) 2024 Simon Southwell. All rights reserved.
+//
+// Date: 17th October 2026
+//
+// This file is part of the cpu6502 instruction set simulator
+// and contains the header for the fleet runner, running jobs
+// on many model instances over a pool of worker threads.
+//
+// This code is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// The code is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this code. If not, see <http://www.gnu.org/licenses/>.
+//
+//=============================================================
+
+#ifndef _CPU6502_FLEET_H_
+#define _CPU6502_FLEET_H_
+
+// -------------------------------------------------------------------------
+// INCLUDES
+// -------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <vector>
+
+#include "cpu6502_api.h"
+
+// -------------------------------------------------------------------------
+// DEFINES (override-able)
+// -------------------------------------------------------------------------
+
+// Alignment of each worker's state, so that workers' queues do not share
+// cache lines
+#ifndef WY65_FLEET_CACHE_LINE
+#define WY65_FLEET_CACHE_LINE         64
+#endif
+
+// -------------------------------------------------------------------------
+// DEFINES (non-override-able)
+// -------------------------------------------------------------------------
+
+// Number of workers selecting one per hardware thread
+#define WY65_FLEET_DEFAULT_WORKERS    0
+
+// -------------------------------------------------------------------------
+// TYPEDEFS
+// -------------------------------------------------------------------------
+
+// Job hook type, called on the worker thread with the job's model and context
+typedef void (*wy65_p_fleet_hook_t)(cpu6502* p_cpu, void* p_ctx);
+
+// Structure for a job submitted to the fleet. The model is cleared to internal
+// memory (no mapped pages or memory functions), loaded with image_len bytes of
+// p_image at load_addr (the rest of memory zero), reset to cpu_type with the PC
+// at start_addr, and run with the engine and budgets (as for run()). The setup
+// hook, if not NULL, is called after the reset, before the run (e.g. to map
+// devices or set registers), and the done hook after the run (e.g. to inspect
+// memory). The image must remain valid until the job's result is returned.
+typedef struct
+{
+    uint32_t            id;               // Host identifier, returned in the result
+    cpu_type_e          cpu_type;
+    engine_type_e       engine;
+    const uint8_t*      p_image;
+    uint32_t            image_len;
+    uint16_t            load_addr;
+    uint16_t            start_addr;
+    uint64_t            max_instructions;
+    uint64_t            max_cycles;
+    wy65_p_fleet_hook_t p_setup;
+    wy65_p_fleet_hook_t p_done;
+    void*               p_ctx;
+} wy65_fleet_job_t;
+
+// Structure for the result of a job
+typedef struct
+{
+    uint32_t            id;
+    uint32_t            worker;           // Index of worker that ran the job
+    bool                stolen;           // Job was taken from another worker's queue
+    wy65_run_status_t   status;           // Status returned by run()
+    wy65_reg_t          regs;             // Registers at the end of the run
+    double              run_us;           // Wall clock time of the run, in microseconds
+} wy65_fleet_result_t;
+
+// -------------------------------------------------------------------------
+// CLASS DEFINITION
+// -------------------------------------------------------------------------
+
+// Fleet of cpu6502 models, one per worker thread, running submitted jobs.
+// Jobs are queued on the workers' queues in turn. A worker runs jobs from
+// the front of its own queue and, when that is empty, steals from the back
+// of the others' queues, sleeping when there are no queued jobs at all.
+// Results are returned in order of completion. Settings of a worker's model
+// other than those listed for wy65_fleet_job_t (e.g. idle detection or the
+// decode cache) persist between jobs, so hooks changing them must restore them.
+class cpu6502_fleet
+{
+// Public methods
+PUBLIC:
+
+    // Constructor, starting the workers (WY65_FLEET_DEFAULT_WORKERS for one per
+    // hardware thread)
+    LIB6502_API                    cpu6502_fleet(const uint32_t num_workers = WY65_FLEET_DEFAULT_WORKERS);
+
+    // Destructor. Queued jobs are discarded, and jobs in progress stopped (with
+    // request_stop()), without returning results.
+    LIB6502_API                    ~cpu6502_fleet();
+
+    // Queue a job. May be called from any thread, including from job hooks.
+    LIB6502_API void               submit             (const wy65_fleet_job_t &job);
+
+    // Wait for the next completed job's result. Returns false, without waiting,
+    // when all submitted jobs' results have been returned.
+    LIB6502_API bool               wait_result        (wy65_fleet_result_t &result);
+
+    // Return the next completed job's result, if any, without waiting
+    LIB6502_API bool               poll_result        (wy65_fleet_result_t &result);
+
+    LIB6502_API uint32_t           num_workers        (void) { return (uint32_t)workers.size(); };
+
+// Private types and methods
+PRIVATE:
+
+    // Worker state, with the queue of jobs guarded by its own lock
+    struct alignas(WY65_FLEET_CACHE_LINE) worker_t
+    {
+        std::mutex                   lock;
+        std::deque<wy65_fleet_job_t> jobs;
+        cpu6502*                     p_cpu;
+        std::atomic<bool>            busy;
+        std::thread                  thread;
+    };
+
+    void                           worker_loop        (const uint32_t idx);
+    bool                           get_job            (const uint32_t idx, wy65_fleet_job_t &job, bool &stolen);
+    void                           run_job            (const uint32_t idx, const wy65_fleet_job_t &job, const bool stolen);
+
+// Private member variables
+PRIVATE:
+
+    std::vector<worker_t*>         workers;
+
+    // Next worker queue for submission, count of queued jobs and quit flag.
+    // Workers sleep on idle_cv whilst no jobs are queued.
+    std::atomic<uint32_t>          next_worker;
+    std::atomic<uint32_t>          queued;
+    std::atomic<bool>              quit;
+    std::mutex                     idle_lock;
+    std::condition_variable        idle_cv;
+
+    // Completed results, and count of submitted jobs whose results are still
+    // to be returned, guarded by result_lock
+    std::mutex                     result_lock;
+    std::condition_variable        result_cv;
+    std::deque<wy65_fleet_result_t> results;
+    uint64_t                       outstanding;
+};
+
+#endif
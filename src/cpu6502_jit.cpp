@@ -0,0 +1,780 @@
+//=============================================================
+//
+// Copyright (c) 2024 Simon Southwell. All rights reserved.
+//
+// Date: 17th October 2026
+//
+// This file is part of the cpu6502 instruction set simulator
+// and contains the x86-64 dynamic recompiler (JIT) for the
+// block engine.
+//
+// This code is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// The code is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this code. If not, see <http://www.gnu.org/licenses/>.
+//
+//=============================================================
+
+// -------------------------------------------------------------------------
+// INCLUDES
+// -------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "cpu6502.h"
+
+#ifdef WY65_JIT
+#include <sys/mman.h>
+#endif
+
+#ifdef WY65_JIT
+
+// -------------------------------------------------------------------------
+// LOCAL DEFINES
+// -------------------------------------------------------------------------
+
+// Host registers. The 6502 A, X, Y and flags registers are held in R12 to
+// R15 within a compiled block, RBX points to the state registers structure
+// and RBP to the internal memory. All are callee saved, and so preserved
+// over calls to the fallback functions.
+#define JIT_RAX                  0
+#define JIT_RCX                  1
+#define JIT_RDX                  2
+#define JIT_RBX                  3
+#define JIT_RBP                  5
+#define JIT_A                    12
+#define JIT_X                    13
+#define JIT_Y                    14
+#define JIT_P                    15
+
+// Maximum native code size for an instruction, and for a block (WY65_MAX_BLOCK_INSTRS instructions)
+#define JIT_MAX_INSTR_CODE       512
+#define JIT_MAX_BLOCK_CODE       (WY65_MAX_BLOCK_INSTRS * JIT_MAX_INSTR_CODE)
+
+// x86 ALU operation codes (for /r field of 0x80 opcode)
+#define JIT_ALU_OR               1
+#define JIT_ALU_AND              4
+#define JIT_ALU_XOR              6
+
+// -------------------------------------------------------------------------
+// LOCAL STATICS
+// -------------------------------------------------------------------------
+
+// Table of N and Z flags for a result value, constructed at compile time so
+// that it is shared, read only, by all model instances
+struct wy65_jit_nz_tbl_t
+{
+    uint8_t entry[256];
+
+    constexpr wy65_jit_nz_tbl_t() : entry()
+    {
+        for (int idx = 0; idx < 256; idx++)
+        {
+            entry[idx] = (idx == 0 ? ZERO_MASK : 0) | (idx & SIGN_MASK);
+        }
+    }
+};
+
+static constexpr wy65_jit_nz_tbl_t jit_nz_tbl;
+
+// -------------------------------------------------------------------------
+// Native code emitter
+//
+// Emits x86-64 instructions for the fixed set of register usages needed to
+// compile a block. Operand addresses of 6502 memory are 32 bit
+// displacements from RBP (internal memory).
+//
+// -------------------------------------------------------------------------
+
+class jit_emitter
+{
+public:
+    jit_emitter(uint8_t* p_buf) { p = p_buf; }
+
+    uint8_t* p;
+
+    void b    (const uint8_t v)  { *p++ = v; }
+    void d32  (const uint32_t v) { memcpy(p, &v, 4); p += 4; }
+    void i64  (const void* v)    { uint64_t u = (uint64_t)v; memcpy(p, &u, 8); p += 8; }
+
+    // Forward jump with 32 bit displacement, returning location to patch with patch()
+    uint8_t* jcc  (const uint8_t cc) { b(0x0f); b(0x80 | cc); d32(0); return p; }
+    uint8_t* jmp  (void)             { b(0xe9); d32(0); return p; }
+    void     patch(uint8_t* at)      { int32_t rel = (int32_t)(p - at); memcpy(at - 4, &rel, 4); }
+
+    // mov reg64, imm64
+    void mov_r64_imm(const int r, const void* v) { b(0x48 | (r >> 3)); b(0xb8 | (r & 7)); i64(v); }
+
+    // movzx r, byte [rbx + disp32] and mov byte [rbx + disp32], r (state registers)
+    void ld_state (const int r, const uint32_t d) { b(0x44); b(0x0f); b(0xb6); b(0x83 | ((r & 7) << 3)); d32(d); }
+    void st_state (const int r, const uint32_t d) { b(0x44); b(0x88); b(0x83 | ((r & 7) << 3)); d32(d); }
+
+    // mov word [rbx + disp32], imm16
+    void st_state16(const uint32_t d, const uint16_t v) { b(0x66); b(0xc7); b(0x83); d32(d); b(v & 0xff); b(v >> 8); }
+
+    // mov r8, imm8 / mov r8, byte [rbp + disp32] / mov byte [rbp + disp32], r8
+    void mov_r8_imm (const int r, const uint8_t v)   { b(0x41); b(0xb0 | (r & 7)); b(v); }
+    void ld_mem     (const int r, const uint32_t a)  { b(0x44); b(0x8a); b(0x85 | ((r & 7) << 3)); d32(a); }
+    void st_mem     (const int r, const uint32_t a)  { b(0x44); b(0x88); b(0x85 | ((r & 7) << 3)); d32(a); }
+
+    // mov dst8, src8 (both R12 to R15)
+    void mov_r8_r8  (const int dst, const int src)   { b(0x45); b(0x88); b(0xc0 | ((src & 7) << 3) | (dst & 7)); }
+
+    // ALU op r8, imm8 / ALU op r8, byte [rbp + disp32] (op as x86 /r code, r R12 to R15)
+    void alu_imm    (const int op, const int r, const uint8_t v)  { b(0x41); b(0x80); b(0xc0 | (op << 3) | (r & 7)); b(v); }
+    void alu_mem    (const int op, const int r, const uint32_t a) { b(0x44); b((op << 3) | 0x02); b(0x85 | ((r & 7) << 3)); d32(a); }
+
+    // inc/dec r8 (R12 to R15), and inc/dec byte [rbp + disp32]
+    void inc_r8     (const int r) { b(0x41); b(0xfe); b(0xc0 | (r & 7)); }
+    void dec_r8     (const int r) { b(0x41); b(0xfe); b(0xc8 | (r & 7)); }
+    void inc_mem    (const uint32_t a) { b(0xfe); b(0x85); d32(a); }
+    void dec_mem    (const uint32_t a) { b(0xfe); b(0x8d); d32(a); }
+
+    // movzx eax, r8 (R12 to R15) / movzx eax, byte [rbp + disp32] / movzx eax, al
+    void movzx_eax_r8  (const int r)      { b(0x41); b(0x0f); b(0xb6); b(0xc0 | (r & 7)); }
+    void movzx_eax_mem (const uint32_t a) { b(0x0f); b(0xb6); b(0x85); d32(a); }
+    void movzx_eax_al  (void)             { b(0x0f); b(0xb6); b(0xc0); }
+
+    // Set N and Z flags from the value in EAX (other flags preserved unless already cleared)
+    void set_nz (const bool clear = true)
+    {
+        if (clear)
+        {
+            alu_imm(JIT_ALU_AND, JIT_P, (uint8_t)~(ZERO_MASK | SIGN_MASK));
+        }
+        mov_r64_imm(JIT_RCX, jit_nz_tbl.entry);
+        b(0x44); b(0x0a); b(0x3c); b(0x01);                 // or r15b, [rcx + rax]
+    }
+
+    // Load value of r8 into EAX and set N and Z flags from it
+    void set_nz_r8 (const int r) { movzx_eax_r8(r); set_nz(); }
+
+    // Add to the cycle and instruction counts on the stack
+    void add_counts (const uint32_t cycles, const uint32_t instrs)
+    {
+        if (cycles) { b(0x48); b(0x81); b(0x04); b(0x24); d32(cycles); }           // add qword [rsp], imm32
+        if (instrs) { b(0x48); b(0x81); b(0x44); b(0x24); b(0x08); d32(instrs); }  // add qword [rsp+8], imm32
+    }
+
+    // Load/store the 6502 registers from/to the state registers structure
+    void load_regs (void)
+    {
+        ld_state(JIT_A, offsetof(wy65_reg_t, a));
+        ld_state(JIT_X, offsetof(wy65_reg_t, x));
+        ld_state(JIT_Y, offsetof(wy65_reg_t, y));
+        ld_state(JIT_P, offsetof(wy65_reg_t, flags));
+    }
+
+    void store_regs (void)
+    {
+        st_state(JIT_A, offsetof(wy65_reg_t, a));
+        st_state(JIT_X, offsetof(wy65_reg_t, x));
+        st_state(JIT_Y, offsetof(wy65_reg_t, y));
+        st_state(JIT_P, offsetof(wy65_reg_t, flags));
+    }
+
+    // mov word [p_last_pc], last_pc
+    void set_last_pc (uint16_t* p_last_pc, const uint16_t last_pc)
+    {
+        mov_r64_imm(JIT_RAX, p_last_pc);
+        b(0x66); b(0xc7); b(0x00); b(last_pc & 0xff); b(last_pc >> 8);
+    }
+
+    // Prologue: save callee saved registers, clear the counts, and load the
+    // state and memory pointers and 6502 registers
+    void prologue (const void* p_regs, const void* p_mem)
+    {
+        b(0x53); b(0x55);                                                   // push rbx, rbp
+        b(0x41); b(0x54); b(0x41); b(0x55); b(0x41); b(0x56); b(0x41); b(0x57); // push r12-r15
+        b(0x48); b(0x83); b(0xec); b(0x18);                                 // sub rsp, 24
+        b(0x48); b(0xc7); b(0x04); b(0x24); d32(0);                         // mov qword [rsp], 0
+        b(0x48); b(0xc7); b(0x44); b(0x24); b(0x08); d32(0);                // mov qword [rsp+8], 0
+        mov_r64_imm(JIT_RBX, p_regs);
+        mov_r64_imm(JIT_RBP, p_mem);
+        load_regs();
+    }
+
+    // Epilogue: return the counts (in RAX:RDX) and restore callee saved registers
+    void ret (void)
+    {
+        b(0x48); b(0x8b); b(0x04); b(0x24);                                 // mov rax, [rsp]
+        b(0x48); b(0x8b); b(0x54); b(0x24); b(0x08);                        // mov rdx, [rsp+8]
+        b(0x48); b(0x83); b(0xc4); b(0x18);                                 // add rsp, 24
+        b(0x41); b(0x5f); b(0x41); b(0x5e); b(0x41); b(0x5d); b(0x41); b(0x5c); // pop r15-r12
+        b(0x5d); b(0x5b); b(0xc3);                                          // pop rbp, rbx; ret
+    }
+
+    // Leave the block, storing the registers, the next PC and the PC of the
+    // last instruction executed
+    void exit (uint16_t* p_last_pc, const uint16_t next_pc, const uint16_t last_pc)
+    {
+        store_regs();
+        st_state16(offsetof(wy65_reg_t, pc), next_pc);
+        set_last_pc(p_last_pc, last_pc);
+        ret();
+    }
+
+    // movzx ecx, byte [rbx + sp] / inc and dec byte [rbx + sp]
+    void ld_sp_ecx (void) { b(0x0f); b(0xb6); b(0x8b); d32(offsetof(wy65_reg_t, sp)); }
+    void inc_sp    (void) { b(0xfe); b(0x83); d32(offsetof(wy65_reg_t, sp)); }
+    void dec_sp    (void) { b(0xfe); b(0x8b); d32(offsetof(wy65_reg_t, sp)); }
+
+    // Push AL (or an immediate byte) on to the 6502 stack, leaving the address written in ESI
+    void push (const bool is_imm = false, const uint8_t imm = 0)
+    {
+        ld_sp_ecx();
+        if (is_imm) { b(0xc6); b(0x84); b(0x0d); d32(0x100); b(imm); }    // mov byte [rbp + rcx + 0x100], imm8
+        else        { b(0x88); b(0x84); b(0x0d); d32(0x100); }              // mov [rbp + rcx + 0x100], al
+        dec_sp();
+        b(0x8d); b(0xb1); d32(0x100);                                       // lea esi, [rcx + 0x100]
+    }
+
+    // Pop a byte from the 6502 stack into the 32 bit register r (EAX or EDX)
+    void pop (const int r)
+    {
+        inc_sp();
+        ld_sp_ecx();
+        b(0x0f); b(0xb6); b(0x84 | (r << 3)); b(0x0d); d32(0x100);          // movzx r, byte [rbp + rcx + 0x100]
+    }
+
+    // If the address in ESI is block code, call the write function (this, ESI),
+    // which returns in EAX whether the block was invalidated. Returns the
+    // location to patch for when the address is not block code.
+    uint8_t* code_write (const void* p_code_byte, const void* p_cpu, const void* p_func)
+    {
+        mov_r64_imm(JIT_RAX, p_code_byte);
+        b(0x80); b(0x3c); b(0x30); b(0x00);                                 // cmp byte [rax + rsi], 0
+        uint8_t* p_not_code = jcc(0x04);                                    // jz not_code
+        mov_r64_imm(7, p_cpu);                                              // mov rdi, p_cpu
+        mov_r64_imm(JIT_RAX, p_func);
+        b(0xff); b(0xd0);                                                   // call rax
+        return p_not_code;
+    }
+
+    // Call a static function with up to three arguments (RDI, RSI, RDX)
+    void call (const void* p_func, const void* arg0, const void* arg1, const uint32_t arg2)
+    {
+        mov_r64_imm(7, arg0);                                               // mov rdi, arg0
+        mov_r64_imm(6, arg1);                                               // mov rsi, arg1
+        b(0xba); d32(arg2);                                                 // mov edx, arg2
+        mov_r64_imm(JIT_RAX, p_func);
+        b(0xff); b(0xd0);                                                   // call rax
+    }
+};
+
+// -------------------------------------------------------------------------
+// jit_alloc()
+//
+// Allocate the JIT code buffer, as executable memory, and the table of
+// compiled blocks. Returns false if the memory could not be allocated, in
+// which case the JIT engine runs as the block engine.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+bool cpu6502_core<BUS>::jit_alloc (void)
+{
+    void* p_mem = mmap(NULL, WY65_JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (p_mem == MAP_FAILED)
+    {
+        return false;
+    }
+
+    p_jit_code        = (uint8_t*)p_mem;
+    p_jit_tbl         = new jit_fn_t[WY65_ADDR_SPACE_SIZE];
+    jit_code_used     = 0;
+
+    memset(p_jit_tbl, 0, WY65_ADDR_SPACE_SIZE * sizeof(jit_fn_t));
+
+    return true;
+}
+
+// -------------------------------------------------------------------------
+// jit_free()
+//
+// Free the JIT code buffer and table of compiled blocks
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::jit_free (void)
+{
+    if (p_jit_code != NULL)
+    {
+        munmap(p_jit_code, WY65_JIT_CODE_SIZE);
+        delete [] p_jit_tbl;
+
+        p_jit_code    = NULL;
+        p_jit_tbl     = NULL;
+    }
+}
+
+// -------------------------------------------------------------------------
+// jit_exec_uop()
+//
+// Called from compiled code to execute a micro-op with its instruction
+// method, for instructions not compiled natively. The state registers have
+// been updated by the compiled code, with the PC pointing to the next
+// instruction. Returns the cycles for the instruction, and whether the
+// compiled block should be left, which is when the flow of control has
+// changed (e.g. an interrupt), the block was invalidated, or a stop was
+// requested.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+typename cpu6502_core<BUS>::jit_rtn_t cpu6502_core<BUS>::jit_exec_uop (cpu6502_core* p_cpu, const dinstr_t* p_uop, const uint32_t pc)
+{
+    op_t      op;
+    jit_rtn_t rtn_val;
+
+    op.opcode            = p_uop->opcode;
+    op.operand           = p_uop->operand;
+    op.exec_cycles       = p_uop->exec_cycles;
+
+    p_cpu->begin_lazy_flags();
+
+    rtn_val.cycles       = (p_cpu->*p_uop->pFunc)(&op);
+
+    p_cpu->end_lazy_flags();
+
+    // Returned in place of the instruction count (in RDX) is whether to leave the block
+    rtn_val.instructions = p_cpu->state.regs.pc != ((pc + p_uop->instr_bytes) & 0xffff) ||
+                           p_cpu->blk_invalidated || p_cpu->events_pending();
+
+    if (rtn_val.instructions)
+    {
+        p_cpu->jit_last_pc = pc;
+    }
+
+    return rtn_val;
+}
+
+// -------------------------------------------------------------------------
+// jit_code_write()
+//
+// Called from compiled code after a native store to an address flagged as
+// block code. Invalidates the affected blocks, and returns whether the
+// compiled block should be left.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+uint32_t cpu6502_core<BUS>::jit_code_write (cpu6502_core* p_cpu, const uint32_t addr)
+{
+    p_cpu->invalidate_blocks(addr);
+
+    return p_cpu->blk_invalidated;
+}
+
+// -------------------------------------------------------------------------
+// jit_run_block()
+//
+// Execute the block at pc as native code, compiling it first if it has
+// been executed WY65_JIT_THRESHOLD times. Returns false if the block is not
+// (yet) compiled, else updates the cycle count, adds the number of
+// instructions executed to icount, and sets pc to the last instruction
+// executed.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+bool cpu6502_core<BUS>::jit_run_block (uint16_t &pc, uint64_t &icount)
+{
+    if (p_jit_tbl[pc] == NULL)
+    {
+        if (++p_blk_tbl[pc].exec_count < WY65_JIT_THRESHOLD || !jit_compile(pc))
+        {
+            return false;
+        }
+    }
+
+    blk_invalidated   = false;
+
+    // Native code accesses the flags register directly
+    end_lazy_flags();
+
+    jit_rtn_t rtn_val = p_jit_tbl[pc]();
+
+    begin_lazy_flags();
+
+    state.cycles     += rtn_val.cycles;
+    icount           += rtn_val.instructions;
+    pc                = jit_last_pc;
+
+    return true;
+}
+
+// -------------------------------------------------------------------------
+// jit_compile()
+//
+// Compile the block at entry_pc to native code. Instructions that don't
+// access memory, or that access internal memory at a fixed address (zero
+// page and absolute modes), are compiled natively, as are branches and JMP
+// ending a block. All others, and ADC/SBC when in BCD mode, call their
+// instruction method via jit_exec_uop(). With external memory functions
+// registered, or the decode cache enabled, all memory accesses use the
+// instruction methods. Native stores check whether the address is block
+// code, and invalidate blocks as for wr_mem().
+//
+// If the code buffer is full, all blocks are discarded and false returned.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+bool cpu6502_core<BUS>::jit_compile (const uint16_t entry_pc)
+{
+    if (jit_code_used + JIT_MAX_BLOCK_CODE > WY65_JIT_CODE_SIZE)
+    {
+        flush_blocks();
+        return false;
+    }
+
+    const blk_t*    p_blk      = &p_blk_tbl[entry_pc];
+    const dinstr_t* p_uop      = &p_uop_pool[p_blk->first_uop];
+    uint8_t*        p_start    = p_jit_code + jit_code_used;
+    bool            native_mem = !bus.ext_rd() && !bus.ext_wr() && !pages_mapped && !idle_detect && p_dcache == NULL;
+    bool            stack_ok   = native_mem && WY65_MEM_SIZE >= 0x200;
+    uint16_t        pc         = entry_pc;
+    uint16_t        last_pc    = entry_pc;
+    uint32_t        pend_cyc   = 0;
+    uint32_t        pend_instr = 0;
+    bool            ended      = false;
+
+    jit_emitter e(p_start);
+
+    e.prologue(&state.regs, mem);
+
+    for (uint32_t idx = 0; idx < p_blk->num_uops && !ended; idx++, p_uop++)
+    {
+        const char*  str       = instr_tbl[p_uop->opcode].op_str;
+        addr_mode_e  mode      = instr_tbl[p_uop->opcode].addr_mode;
+        bool         is_last   = idx == (uint32_t)(p_blk->num_uops - 1);
+        uint16_t     next_pc   = pc + p_uop->instr_bytes;
+        uint8_t      imm       = p_uop->operand & 0xff;
+        uint32_t     addr      = (mode == ZPG) ? imm : p_uop->operand;
+        bool         is_imm    = mode == IMM;
+        bool         mem_ok    = native_mem && (mode == ZPG || mode == ABS) && addr < WY65_MEM_SIZE;
+        bool         native    = true;
+        bool         is_write  = false;
+        uint32_t     cycles    = p_uop->exec_cycles;
+        uint8_t*     p_done    = NULL;
+
+        // Register from the last letter of loads, stores, compares, transfers
+        // and increment/decrement instructions
+        int          reg       = (str[2] == 'X') ? JIT_X : (str[2] == 'Y') ? JIT_Y : JIT_A;
+
+        last_pc                = pc;
+
+        // Instructions with no memory access
+        if (mode == NON && !strcmp(str, "NOP"))         { cycles = 0; }      // As NOP method
+        else if (mode == NON && !strcmp(str, "CLC"))    { e.alu_imm(JIT_ALU_AND, JIT_P, (uint8_t)~CARRY_MASK); }
+        else if (mode == NON && !strcmp(str, "SEC"))    { e.alu_imm(JIT_ALU_OR,  JIT_P, CARRY_MASK); }
+        else if (mode == NON && !strcmp(str, "CLD"))    { e.alu_imm(JIT_ALU_AND, JIT_P, (uint8_t)~BCD_MASK); }
+        else if (mode == NON && !strcmp(str, "SED"))    { e.alu_imm(JIT_ALU_OR,  JIT_P, BCD_MASK); }
+        else if (mode == NON && !strcmp(str, "CLV"))    { e.alu_imm(JIT_ALU_AND, JIT_P, (uint8_t)~OVFLW_MASK); }
+        else if (mode == NON && !strcmp(str, "TAX"))    { e.mov_r8_r8(JIT_X, JIT_A); e.set_nz_r8(JIT_X); }
+        else if (mode == NON && !strcmp(str, "TAY"))    { e.mov_r8_r8(JIT_Y, JIT_A); e.set_nz_r8(JIT_Y); }
+        else if (mode == NON && !strcmp(str, "TXA"))    { e.mov_r8_r8(JIT_A, JIT_X); e.set_nz_r8(JIT_A); }
+        else if (mode == NON && !strcmp(str, "TYA"))    { e.mov_r8_r8(JIT_A, JIT_Y); e.set_nz_r8(JIT_A); }
+        else if (mode == NON && (!strcmp(str, "INX") || !strcmp(str, "INY"))) { e.inc_r8(reg); e.set_nz_r8(reg); }
+        else if (mode == NON && (!strcmp(str, "DEX") || !strcmp(str, "DEY"))) { e.dec_r8(reg); e.set_nz_r8(reg); }
+
+        // Loads
+        else if ((is_imm || mem_ok) && (!strcmp(str, "LDA") || !strcmp(str, "LDX") || !strcmp(str, "LDY")))
+        {
+            if (is_imm) e.mov_r8_imm(reg, imm); else e.ld_mem(reg, addr);
+            e.set_nz_r8(reg);
+        }
+        // Logical operations
+        else if ((is_imm || mem_ok) && (!strcmp(str, "AND") || !strcmp(str, "ORA") || !strcmp(str, "EOR")))
+        {
+            int op = (str[0] == 'A') ? JIT_ALU_AND : (str[0] == 'O') ? JIT_ALU_OR : JIT_ALU_XOR;
+            if (is_imm) e.alu_imm(op, JIT_A, imm); else e.alu_mem(op, JIT_A, addr);
+            e.set_nz_r8(JIT_A);
+        }
+        // Compares: C set if no borrow, N and Z from the difference
+        else if ((is_imm || mem_ok) && (!strcmp(str, "CMP") || !strcmp(str, "CPX") || !strcmp(str, "CPY")))
+        {
+            e.movzx_eax_r8(reg);
+            if (is_imm) { e.b(0x2c); e.b(imm); }                                // sub al, imm8
+            else        { e.b(0x2a); e.b(0x85); e.d32(addr); }                  // sub al, [rbp + disp32]
+            e.b(0x0f); e.b(0x93); e.b(0xc1);                                    // setae cl
+            e.alu_imm(JIT_ALU_AND, JIT_P, (uint8_t)~(CARRY_MASK | ZERO_MASK | SIGN_MASK));
+            e.b(0x41); e.b(0x08); e.b(0xcf);                                    // or r15b, cl
+            e.movzx_eax_al();
+            e.set_nz(false);
+        }
+        // Binary mode add/subtract. In BCD mode, the instruction method is called.
+        else if ((is_imm || mem_ok) && (!strcmp(str, "ADC") || !strcmp(str, "SBC")))
+        {
+            bool is_sbc = str[0] == 'S';
+
+            e.b(0x41); e.b(0xf6); e.b(0xc7); e.b(BCD_MASK);                     // test r15b, BCD_MASK
+            uint8_t* p_bcd = e.jcc(0x05);                                       // jnz bcd
+
+            e.b(0x41); e.b(0x0f); e.b(0xba); e.b(0xe7); e.b(0x00);              // bt r15d, 0 (CF = C)
+            if (is_sbc) e.b(0xf5);                                              // cmc (CF = borrow)
+            if (is_imm) { e.b(0x41); e.b(0x80); e.b(is_sbc ? 0xdc : 0xd4); e.b(imm); }          // adc/sbb r12b, imm8
+            else        { e.b(0x44); e.b(is_sbc ? 0x1a : 0x12); e.b(0xa5); e.d32(addr); }       // adc/sbb r12b, [rbp + disp32]
+            e.b(0x0f); e.b(is_sbc ? 0x93 : 0x92); e.b(0xc0);                    // setnc/setc al
+            e.b(0x0f); e.b(0x90); e.b(0xc1);                                    // seto cl
+            e.alu_imm(JIT_ALU_AND, JIT_P, (uint8_t)~(CARRY_MASK | ZERO_MASK | OVFLW_MASK | SIGN_MASK));
+            e.b(0x41); e.b(0x08); e.b(0xc7);                                    // or r15b, al
+            e.b(0xc0); e.b(0xe1); e.b(0x06);                                    // shl cl, 6
+            e.b(0x41); e.b(0x08); e.b(0xcf);                                    // or r15b, cl
+            e.movzx_eax_r8(JIT_A);
+            e.set_nz(false);
+            e.add_counts(pend_cyc + p_uop->exec_cycles, pend_instr + 1);
+            p_done = e.jmp();
+
+            e.patch(p_bcd);
+            native = false;
+        }
+        // Stores
+        else if (mem_ok && (!strcmp(str, "STA") || !strcmp(str, "STX") || !strcmp(str, "STY")))
+        {
+            e.st_mem(reg, addr);
+            e.b(0xbe); e.d32(addr);                                             // mov esi, addr
+            is_write = true;
+        }
+        // Increment/decrement memory
+        else if (mem_ok && (!strcmp(str, "INC") || !strcmp(str, "DEC")))
+        {
+            if (str[0] == 'I') e.inc_mem(addr); else e.dec_mem(addr);
+            e.movzx_eax_mem(addr);
+            e.set_nz();
+            e.b(0xbe); e.d32(addr);                                             // mov esi, addr
+            is_write = true;
+        }
+        // Stack pushes and pulls (not PLP, which may cause an interrupt)
+        else if (stack_ok && mode == NON && (!strcmp(str, "PHA") || !strcmp(str, "PHP")))
+        {
+            if (str[2] == 'A') { e.b(0x44); e.b(0x89); e.b(0xe0); }                              // mov eax, r12d
+            else               { e.b(0x44); e.b(0x89); e.b(0xf8); e.b(0x0c); e.b(0x30); }         // mov eax, r15d; or al, 0x30
+            e.push();
+            is_write = true;
+        }
+        else if (stack_ok && mode == NON && !strcmp(str, "PLA"))
+        {
+            e.inc_sp();
+            e.ld_sp_ecx();
+            e.b(0x44); e.b(0x8a); e.b(0xa4); e.b(0x0d); e.d32(0x100);          // mov r12b, [rbp + rcx + 0x100]
+            e.set_nz_r8(JIT_A);
+        }
+        // Subroutine call and return, ending the block. A push to block code
+        // invalidates blocks, but the block is left regardless.
+        else if (stack_ok && mode == ABS && is_last && !strcmp(str, "JSR"))
+        {
+            uint16_t ret_addr = next_pc - 1;
+
+            e.push(true, ret_addr >> 8);
+            e.patch(e.code_write(p_code_byte, this, (void*)&jit_code_write));
+            e.push(true, ret_addr & 0xff);
+            e.patch(e.code_write(p_code_byte, this, (void*)&jit_code_write));
+
+            e.add_counts(pend_cyc + p_uop->exec_cycles, pend_instr + 1);
+            e.exit(&jit_last_pc, p_uop->operand, pc);
+
+            ended = true;
+        }
+        else if (stack_ok && mode == NON && is_last && !strcmp(str, "RTS"))
+        {
+            e.pop(JIT_RAX);
+            e.pop(JIT_RDX);
+            e.b(0xc1); e.b(0xe2); e.b(0x08);                                    // shl edx, 8
+            e.b(0x09); e.b(0xd0);                                               // or eax, edx
+            e.b(0xff); e.b(0xc0);                                               // inc eax
+
+            e.add_counts(pend_cyc + p_uop->exec_cycles, pend_instr + 1);
+            e.store_regs();
+            e.b(0x66); e.b(0x89); e.b(0x83); e.d32(offsetof(wy65_reg_t, pc));   // mov [rbx + pc], ax
+            e.set_last_pc(&jit_last_pc, pc);
+            e.ret();
+
+            ended = true;
+        }
+        // Conditional branches and BRA, ending the block. The cycles for the
+        // taken branch, and page crossing, are known at compile time.
+        else if (mode == REL && is_last && strcmp(str, "???"))
+        {
+            uint16_t target  = next_pc + (int8_t)imm;
+            uint32_t extra   = 1 + (((target ^ next_pc) & 0xff00) ? 1 : 0);
+            uint8_t  mask    = (str[1] == 'P' || str[1] == 'M') ? SIGN_MASK  :
+                               (str[1] == 'V')                  ? OVFLW_MASK :
+                               (str[1] == 'C')                  ? CARRY_MASK :
+                               (str[1] == 'N' || str[1] == 'E') ? ZERO_MASK  : 0;
+            bool     on_set  = !strcmp(str, "BMI") || !strcmp(str, "BVS") || !strcmp(str, "BCS") || !strcmp(str, "BEQ");
+
+            e.add_counts(pend_cyc + p_uop->exec_cycles, pend_instr + 1);
+
+            if (mask != 0)
+            {
+                e.b(0x41); e.b(0xf6); e.b(0xc7); e.b(mask);                     // test r15b, mask
+                uint8_t* p_taken = e.jcc(on_set ? 0x05 : 0x04);                 // jnz/jz taken
+                e.exit(&jit_last_pc, next_pc, pc);
+                e.patch(p_taken);
+            }
+
+            e.add_counts(extra, 0);
+            e.exit(&jit_last_pc, target, pc);
+
+            ended = true;
+        }
+        // Absolute jump, ending the block
+        else if (mode == ABS && is_last && !strcmp(str, "JMP"))
+        {
+            e.add_counts(pend_cyc + p_uop->exec_cycles, pend_instr + 1);
+            e.exit(&jit_last_pc, p_uop->operand, pc);
+
+            ended = true;
+        }
+        else
+        {
+            native = false;
+        }
+
+        if (ended)
+        {
+            break;
+        }
+
+        if (native)
+        {
+            pend_cyc  += cycles;
+            pend_instr++;
+
+            // A native store to block code invalidates blocks as for wr_mem(), leaving
+            // this block if it was invalidated
+            if (is_write)
+            {
+                uint8_t* p_not_code = e.code_write(p_code_byte, this, (void*)&jit_code_write);
+                e.b(0x85); e.b(0xc0);                                           // test eax, eax
+                uint8_t* p_cont = e.jcc(0x04);                                  // jz cont
+                e.add_counts(pend_cyc, pend_instr);
+                e.exit(&jit_last_pc, next_pc, pc);
+                e.patch(p_cont);
+                e.patch(p_not_code);
+            }
+        }
+        else
+        {
+            // Call the instruction method, via jit_exec_uop(), with the registers and
+            // next PC in the state structure, and reload the registers afterwards.
+            // The cycles are returned in RAX, and whether to leave the block in RDX.
+            e.add_counts(pend_cyc, pend_instr + 1);
+
+            e.store_regs();
+            e.st_state16(offsetof(wy65_reg_t, pc), next_pc);
+            e.call((void*)&jit_exec_uop, this, p_uop, pc);
+            e.b(0x48); e.b(0x01); e.b(0x04); e.b(0x24);                         // add [rsp], rax
+            e.load_regs();
+
+            e.b(0x85); e.b(0xd2);                                               // test edx, edx
+            uint8_t* p_cont = e.jcc(0x04);                                      // jz cont
+            e.ret();
+            e.patch(p_cont);
+
+            if (p_done != NULL)
+            {
+                e.patch(p_done);
+            }
+        }
+
+        pend_cyc   = native ? pend_cyc   : 0;
+        pend_instr = native ? pend_instr : 0;
+        pc         = next_pc;
+    }
+
+    // Block ended without a branch or jump (maximum length, or uncacheable code
+    // or a fallback instruction which may change the flow of control follows)
+    if (!ended)
+    {
+        e.add_counts(pend_cyc, pend_instr);
+        e.exit(&jit_last_pc, pc, last_pc);
+    }
+
+    p_jit_tbl[entry_pc] = (jit_fn_t)p_start;
+    jit_code_used      += (uint32_t)(e.p - p_start);
+
+    return true;
+}
+
+#else
+
+// -------------------------------------------------------------------------
+// JIT not supported on this host. The JIT engine runs as the block engine.
+// -------------------------------------------------------------------------
+
+template <class BUS>
+bool cpu6502_core<BUS>::jit_alloc (void)
+{
+    return false;
+}
+
+template <class BUS>
+void cpu6502_core<BUS>::jit_free (void)
+{
+}
+
+template <class BUS>
+bool cpu6502_core<BUS>::jit_run_block (uint16_t &pc, uint64_t &icount)
+{
+    return false;
+}
+
+template <class BUS>
+bool cpu6502_core<BUS>::jit_compile (const uint16_t entry_pc)
+{
+    return false;
+}
+
+template <class BUS>
+typename cpu6502_core<BUS>::jit_rtn_t cpu6502_core<BUS>::jit_exec_uop (cpu6502_core* p_cpu, const dinstr_t* p_uop, const uint32_t pc)
+{
+    jit_rtn_t rtn_val = {0, 0};
+
+    return rtn_val;
+}
+
+template <class BUS>
+uint32_t cpu6502_core<BUS>::jit_code_write (cpu6502_core* p_cpu, const uint32_t addr)
+{
+    return 0;
+}
+
+#endif
+
+// -------------------------------------------------------------------------
+// Instantiate the JIT methods for the default bus, and for WY65_BUS, if
+// defined (see cpu6502.cpp)
+// -------------------------------------------------------------------------
+
+#define WY65_JIT_INSTANTIATE(_bus)                                                                                 \
+    template bool     cpu6502_core<_bus>::jit_alloc      (void);                                                  \
+    template void     cpu6502_core<_bus>::jit_free       (void);                                                  \
+    template bool     cpu6502_core<_bus>::jit_run_block  (uint16_t &pc, uint64_t &icount);                        \
+    template bool     cpu6502_core<_bus>::jit_compile    (const uint16_t entry_pc);                               \
+    template uint32_t cpu6502_core<_bus>::jit_code_write (cpu6502_core<_bus>* p_cpu, const uint32_t addr);        \
+    template cpu6502_core<_bus>::jit_rtn_t                                                                       \
+                      cpu6502_core<_bus>::jit_exec_uop   (cpu6502_core<_bus>* p_cpu,                               \
+                                                          const cpu6502_core<_bus>::dinstr_t* p_uop, const uint32_t pc);
+
+WY65_JIT_INSTANTIATE(wy65_cb_bus_t)
+
+#ifdef WY65_BUS
+WY65_JIT_INSTANTIATE(WY65_BUS)
+#endif
@@ -0,0 +1,699 @@
+//=============================================================
+//
+// Copyright (c) 2024 Simon Southwell. All rights reserved.
+//
+// Date: 17th October 2026
+//
+// This file is part of the cpu6502 instruction set simulator
+// and contains the static recompiler, generating C++ source
+// for the blocks of a program image, and the support for
+// running the generated code in the block engines.
+//
+// This code is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// The code is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this code. If not, see <http://www.gnu.org/licenses/>.
+//
+//=============================================================
+
+// -------------------------------------------------------------------------
+// INCLUDES
+// -------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "cpu6502.h"
+
+// -------------------------------------------------------------------------
+// LOCAL STATICS
+// -------------------------------------------------------------------------
+
+// CPU variant names, as used in generated code
+static const char* const cpu_type_str[WY65_NUM_CPU_TYPES] = {"BASE", "C02", "WRK", "WDC"};
+
+// Definitions at the head of generated code
+static const char* gen_header =
+    "// Model class the code is compiled against, which may be overridden for a host bus\n"
+    "#ifndef WY65_SR_CPU\n"
+    "#define WY65_SR_CPU                cpu6502\n"
+    "#endif\n"
+    "\n"
+    "// Update N and Z flags from an 8 bit value\n"
+    "#define WY65_SR_NZ(_v)             r.flags = (r.flags & ~(ZERO_MASK | SIGN_MASK)) | \\\n"
+    "                                             ((((_v) & 0xff) == 0) ? ZERO_MASK : 0) | ((_v) & SIGN_MASK)\n"
+    "\n"
+    "// Return from a block, with the instruction count and PC of the last instruction\n"
+    "#define WY65_SR_RTN(_n, _last)     { wy65_static_rtn_t rtn = {cyc, _n, _last}; return rtn; }\n"
+    "\n"
+    "// Leave a block after a memory write, if blocks were invalidated or a stop requested\n"
+    "#define WY65_SR_LEAVE(_next, _n, _last) if (p_cpu->sr_leave()) { r.pc = _next; WY65_SR_RTN(_n, _last); }\n";
+
+// -------------------------------------------------------------------------
+// register_static_code()
+//
+// Register a table of statically recompiled blocks, generated by
+// gen_static_code(), for the given CPU variant. Any previously registered
+// blocks are discarded. All existing blocks are flushed so that the static
+// code is matched as blocks are rebuilt (see build_block()).
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::register_static_code (const wy65_static_blk_t* p_blks, const uint32_t num_blks, const cpu_type_e cpu_type)
+{
+    if (p_static_tbl == NULL)
+    {
+        p_static_tbl = new const wy65_static_blk_t*[WY65_ADDR_SPACE_SIZE];
+    }
+
+    memset(p_static_tbl, 0, WY65_ADDR_SPACE_SIZE * sizeof(wy65_static_blk_t*));
+
+    for (uint32_t idx = 0; idx < num_blks; idx++)
+    {
+        p_static_tbl[p_blks[idx].entry_pc] = &p_blks[idx];
+    }
+
+    static_cpu_type = cpu_type;
+
+    flush_blocks();
+}
+
+// -------------------------------------------------------------------------
+// match_static_block()
+//
+// Return the statically recompiled code function for a newly built block,
+// if there is one registered for its entry PC which was compiled, for the
+// current CPU variant, from the same code bytes as the block's. Else
+// returns NULL.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+wy65_static_fn_t cpu6502_core<BUS>::match_static_block (const uint16_t entry_pc, const blk_t* p_blk)
+{
+    const wy65_static_blk_t* p_sblk = p_static_tbl[entry_pc];
+
+    if (p_sblk == NULL || static_cpu_type != state.mode_c ||
+        p_sblk->num_instrs != p_blk->num_uops || p_sblk->num_bytes != p_blk->num_bytes)
+    {
+        return NULL;
+    }
+
+    for (uint32_t idx = 0; idx < p_sblk->num_bytes; idx++)
+    {
+        if (rd_mem((entry_pc + idx) & 0xffff) != p_sblk->p_code[idx])
+        {
+            return NULL;
+        }
+    }
+
+    return p_sblk->pFunc;
+}
+
+// -------------------------------------------------------------------------
+// sr_exec()
+//
+// Execute an instruction with its instruction method, for statically
+// recompiled code. The PC must already point to the next instruction.
+// Returns the number of cycles.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+int cpu6502_core<BUS>::sr_exec (const uint8_t opcode, const uint16_t operand)
+{
+    op_t op;
+
+    op.opcode      = opcode;
+    op.operand     = operand;
+    op.exec_cycles = instr_tbl[opcode].exec_cycles;
+
+    // Instruction methods evaluate the N and Z flags lazily
+    begin_lazy_flags();
+
+    int cycles     = (this->*instr_tbl[opcode].pFunc)(&op);
+
+    end_lazy_flags();
+
+    return cycles;
+}
+
+// -------------------------------------------------------------------------
+// gen_static_addr()
+//
+// Generate, into buf, code calculating the address of a memory operand for
+// the addressing mode, at the given indentation, as for calc_addr(). The
+// base address is also calculated for modes which may cross a page.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+void cpu6502_core<BUS>::gen_static_addr (char* buf, const addr_mode_e mode, const uint32_t operand, const int indent)
+{
+    const uint32_t zp = operand & 0xff;
+    const int      i  = indent;
+
+    switch (mode)
+    {
+    case ZPG: sprintf(buf, "%*suint32_t addr = 0x%02x;\n", i, "", zp); break;
+    case ZPX: sprintf(buf, "%*suint32_t addr = (0x%02x + r.x) & 0xff;\n", i, "", zp); break;
+    case ZPY: sprintf(buf, "%*suint32_t addr = (0x%02x + r.y) & 0xff;\n", i, "", zp); break;
+    case ABS: sprintf(buf, "%*suint32_t addr = 0x%04x;\n", i, "", operand); break;
+    case ABX: sprintf(buf, "%*suint32_t base = 0x%04x;\n%*suint32_t addr = (base + r.x) & 0xffff;\n", i, "", operand, i, ""); break;
+    case ABY: sprintf(buf, "%*suint32_t base = 0x%04x;\n%*suint32_t addr = (base + r.y) & 0xffff;\n", i, "", operand, i, ""); break;
+    case IDX: sprintf(buf, "%*suint32_t ptr  = (0x%02x + r.x) & 0xff;\n"
+                           "%*suint32_t addr = p_cpu->sr_rd_mem(ptr) | (p_cpu->sr_rd_mem((ptr + 1) & 0xff) << 8);\n", i, "", zp, i, ""); break;
+    case IDY: sprintf(buf, "%*suint32_t base = p_cpu->sr_rd_mem(0x%02x) | (p_cpu->sr_rd_mem(0x%02x) << 8);\n"
+                           "%*suint32_t addr = (base + r.y) & 0xffff;\n", i, "", zp, (zp + 1) & 0xff, i, ""); break;
+    case IDZ: sprintf(buf, "%*suint32_t addr = p_cpu->sr_rd_mem(0x%02x) | (p_cpu->sr_rd_mem(0x%02x) << 8);\n", i, "", zp, (zp + 1) & 0xff); break;
+    default:  buf[0] = 0; break;
+    }
+}
+
+// -------------------------------------------------------------------------
+// gen_static_instr()
+//
+// Generate the code for an instruction at pc, being instruction number
+// instr_num (from 0) of a block. Loads, stores, arithmetic and logical
+// operations, shifts, transfers, flag and stack instructions, and the
+// branches, jumps, calls and returns ending a block are generated inline,
+// with the same cycle counts as the instruction methods. All others, and
+// BCD arithmetic, call the instruction method via sr_exec(). Returns true
+// if the generated code always returns from the block.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+bool cpu6502_core<BUS>::gen_static_instr (FILE* fp, const uint16_t pc, const uint32_t instr_num, const bool is_last)
+{
+    uint8_t      opcode   = rd_mem(pc);
+    const tbl_t* p_instr  = &instr_tbl[opcode];
+    const char*  str      = p_instr->op_str;
+    addr_mode_e  mode     = p_instr->addr_mode;
+    uint32_t     cycles   = p_instr->exec_cycles;
+    uint32_t     operand  = 0;
+
+    if (p_instr->op_bytes > 0) operand  = rd_mem((pc + 1) & 0xffff);
+    if (p_instr->op_bytes > 1) operand |= rd_mem((pc + 2) & 0xffff) << 8;
+
+    uint16_t     next_pc  = pc + 1 + p_instr->op_bytes;
+    uint32_t     n        = instr_num + 1;
+
+    bool         is_imm   = mode == IMM;
+    bool         is_mem   = mode == ZPG || mode == ZPX || mode == ZPY || mode == ABS ||
+                            mode == ABX || mode == ABY || mode == IDX || mode == IDY || mode == IDZ;
+    bool         may_pg   = mode == ABX || mode == ABY || mode == IDY;
+    bool         is_jump  = mode == ABS && is_last && (!strcmp(str, "JMP") || !strcmp(str, "JSR"));
+    bool         returns  = false;
+    const char*  data     = is_imm ? NULL : "p_cpu->sr_rd_mem(addr)";
+    char         imm_str[8];
+
+    // Register for loads, stores, compares, transfers and increment/decrement, from last letter
+    const char*  reg      = (str[2] == 'X') ? "r.x" : (str[2] == 'Y') ? "r.y" : "r.a";
+
+    sprintf(imm_str, "0x%02x", operand & 0xff);
+    data                  = is_imm ? imm_str : data;
+
+    fprintf(fp, "\n    // $%04X: %s\n    {\n", pc, str);
+
+    // Memory operand address code, for instructions generated inline
+    char         addr_code[256];
+    gen_static_addr(addr_code, mode, operand, 8);
+
+    // Binary mode ADC/SBC. In BCD mode, the instruction method is called.
+    if ((is_imm || is_mem) && (!strcmp(str, "ADC") || !strcmp(str, "SBC")))
+    {
+        bool is_sbc = str[0] == 'S';
+
+        gen_static_addr(addr_code, mode, operand, 12);
+
+        fprintf(fp, "        if (r.flags & BCD_MASK)\n"
+                    "        {\n"
+                    "            r.pc = 0x%04x;\n"
+                    "            cyc += p_cpu->sr_exec(0x%02x, 0x%04x);\n"
+                    "        }\n"
+                    "        else\n"
+                    "        {\n"
+                    "%s"
+                    "            uint32_t val  = %s;\n"
+                    "            uint32_t carry = r.flags & CARRY_MASK;\n"
+                    "            uint32_t uns  = r.a %c val %s;\n"
+                    "            int32_t  res  = (int8_t)r.a %c (int8_t)val %s;\n"
+                    "            r.flags       = (r.flags & ~(CARRY_MASK | ZERO_MASK | OVFLW_MASK | SIGN_MASK)) |\n"
+                    "                            ((uns >= 0x100U) ? %s) | (((res & 0xff) == 0) ? ZERO_MASK : 0) |\n"
+                    "                            ((res < -128 || res > 127) ? OVFLW_MASK : 0) | (res & SIGN_MASK);\n"
+                    "            r.a           = res & 0xff;\n"
+                    "            cyc          += %d;\n",
+                    next_pc, opcode, operand, addr_code, data,
+                    is_sbc ? '-' : '+', is_sbc ? "- (carry ^ 1)" : "+ carry",
+                    is_sbc ? '-' : '+', is_sbc ? "- (carry ^ 1)" : "+ carry",
+                    is_sbc ? "0 : CARRY_MASK" : "CARRY_MASK : 0", cycles);
+        if (may_pg)
+        {
+            fprintf(fp, "            cyc          += ((addr ^ base) >> 8) ? 1 : 0;\n");
+        }
+        fprintf(fp, "        }\n");
+    }
+    // Loads
+    else if ((is_imm || is_mem) && (!strcmp(str, "LDA") || !strcmp(str, "LDX") || !strcmp(str, "LDY")))
+    {
+        fprintf(fp, "%s        %s = %s;\n        WY65_SR_NZ(%s);\n        cyc += %d;\n", addr_code, reg, data, reg, cycles);
+    }
+    // Logical operations and compares, with a cycle added for page crossing
+    else if ((is_imm || is_mem) && (!strcmp(str, "AND") || !strcmp(str, "ORA") || !strcmp(str, "EOR") ||
+                                    !strcmp(str, "CMP") || !strcmp(str, "CPX") || !strcmp(str, "CPY")))
+    {
+        fprintf(fp, "%s", addr_code);
+
+        if (str[0] == 'C')
+        {
+            reg = (str[2] == 'P') ? "r.a" : reg;
+            fprintf(fp, "        int32_t res = (int32_t)%s - (int32_t)%s;\n"
+                        "        r.flags     = (r.flags & ~(ZERO_MASK | CARRY_MASK | SIGN_MASK)) |\n"
+                        "                      ((res == 0) ? ZERO_MASK : 0) | ((res >= 0) ? CARRY_MASK : 0) | (res & SIGN_MASK);\n",
+                        reg, data);
+        }
+        else
+        {
+            fprintf(fp, "        r.a %c= %s;\n        WY65_SR_NZ(r.a);\n", str[0] == 'A' ? '&' : str[0] == 'O' ? '|' : '^', data);
+        }
+
+        fprintf(fp, "        cyc += %d;\n", cycles);
+        if (may_pg)
+        {
+            fprintf(fp, "        cyc += ((addr ^ base) >> 8) ? 1 : 0;\n");
+        }
+    }
+    // Bit test. N and V not altered for immediate mode.
+    else if ((is_imm || is_mem) && !strcmp(str, "BIT"))
+    {
+        fprintf(fp, "%s        uint32_t val = %s;\n"
+                    "        r.flags      = (r.flags & ~ZERO_MASK) | ((r.a & val) ? 0 : ZERO_MASK);\n", addr_code, data);
+        if (!is_imm)
+        {
+            fprintf(fp, "        r.flags      = (r.flags & ~(OVFLW_MASK | SIGN_MASK)) | (val & (OVFLW_MASK | SIGN_MASK));\n");
+        }
+        fprintf(fp, "        cyc += %d;\n", cycles);
+    }
+    // Stores
+    else if (is_mem && (!strcmp(str, "STA") || !strcmp(str, "STX") || !strcmp(str, "STY") || !strcmp(str, "STZ")))
+    {
+        fprintf(fp, "%s        p_cpu->sr_wr_mem(addr, %s);\n        cyc += %d;\n        WY65_SR_LEAVE(0x%04x, %d, 0x%04x);\n",
+                    addr_code, str[2] == 'Z' ? "0" : reg, cycles, next_pc, n, pc);
+    }
+    // Increment/decrement of accumulator or memory
+    else if ((mode == ACC || is_mem) && (!strcmp(str, "INC") || !strcmp(str, "DEC")))
+    {
+        char op = (str[0] == 'I') ? '+' : '-';
+
+        if (mode == ACC)
+        {
+            fprintf(fp, "        r.a = r.a %c 1;\n        WY65_SR_NZ(r.a);\n        cyc += %d;\n", op, cycles);
+        }
+        else
+        {
+            fprintf(fp, "%s        uint8_t val = p_cpu->sr_rd_mem(addr) %c 1;\n        WY65_SR_NZ(val);\n"
+                        "        p_cpu->sr_wr_mem(addr, val);\n        cyc += %d;\n        WY65_SR_LEAVE(0x%04x, %d, 0x%04x);\n",
+                        addr_code, op, cycles, next_pc, n, pc);
+        }
+    }
+    // Shifts and rotates of accumulator or memory
+    else if ((mode == ACC || is_mem) && (!strcmp(str, "ASL") || !strcmp(str, "LSR") || !strcmp(str, "ROL") || !strcmp(str, "ROR")))
+    {
+        const char* res_str = !strcmp(str, "ASL") ? "(val << 1) & 0xff"                                     :
+                              !strcmp(str, "LSR") ? "val >> 1"                                              :
+                              !strcmp(str, "ROL") ? "((val << 1) | (r.flags & CARRY_MASK)) & 0xff"          :
+                                                    "(val >> 1) | ((r.flags & CARRY_MASK) ? 0x80 : 0)";
+        const char* c_str   = (str[2] == 'L') ? "val & 0x80" : "val & 0x01";
+
+        fprintf(fp, "%s        uint32_t val = %s;\n"
+                    "        uint32_t res = %s;\n"
+                    "        r.flags      = (r.flags & ~(ZERO_MASK | CARRY_MASK | SIGN_MASK)) |\n"
+                    "                       ((res == 0) ? ZERO_MASK : 0) | (res & SIGN_MASK) | ((%s) ? CARRY_MASK : 0);\n",
+                    addr_code, mode == ACC ? "r.a" : "p_cpu->sr_rd_mem(addr)", res_str, c_str);
+
+        // ASL is a cycle quicker for ABX with no page crossing (see ASL())
+        if (!strcmp(str, "ASL") && mode == ABX)
+        {
+            fprintf(fp, "        cyc += %d - (((addr ^ base) >> 8) ? 0 : 1);\n", cycles);
+        }
+        else
+        {
+            fprintf(fp, "        cyc += %d;\n", cycles);
+        }
+
+        if (mode == ACC)
+        {
+            fprintf(fp, "        r.a = res;\n");
+        }
+        else
+        {
+            fprintf(fp, "        p_cpu->sr_wr_mem(addr, res);\n        WY65_SR_LEAVE(0x%04x, %d, 0x%04x);\n", next_pc, n, pc);
+        }
+    }
+    // No operation (including unsupported opcodes), which only skip operand bytes (see NOP())
+    else if (!strcmp(str, "NOP") || !strcmp(str, "???"))
+    {
+    }
+    // Register transfers, increments and decrements, and flag instructions
+    else if (mode == NON && (!strcmp(str, "TAX") || !strcmp(str, "TAY") || !strcmp(str, "TXA") ||
+                             !strcmp(str, "TYA") || !strcmp(str, "TSX")))
+    {
+        const char* dst = (str[2] == 'X') ? "r.x" : (str[2] == 'Y') ? "r.y" : "r.a";
+        const char* src = (str[1] == 'A') ? "r.a" : (str[1] == 'X') ? "r.x" : (str[1] == 'Y') ? "r.y" : "r.sp";
+
+        fprintf(fp, "        %s = %s;\n        WY65_SR_NZ(%s);\n        cyc += %d;\n", dst, src, dst, cycles);
+    }
+    else if (mode == NON && !strcmp(str, "TXS"))
+    {
+        fprintf(fp, "        r.sp = r.x;\n        cyc += %d;\n", cycles);
+    }
+    else if (mode == NON && (!strcmp(str, "INX") || !strcmp(str, "INY") || !strcmp(str, "DEX") || !strcmp(str, "DEY")))
+    {
+        fprintf(fp, "        %s = %s %c 1;\n        WY65_SR_NZ(%s);\n        cyc += %d;\n", reg, reg, str[0] == 'I' ? '+' : '-', reg, cycles);
+    }
+    else if (mode == NON && (!strcmp(str, "CLC") || !strcmp(str, "SEC") || !strcmp(str, "CLD") ||
+                             !strcmp(str, "SED") || !strcmp(str, "CLV")))
+    {
+        const char* mask = (str[2] == 'C') ? "CARRY_MASK" : (str[2] == 'D') ? "BCD_MASK" : "OVFLW_MASK";
+
+        if (str[0] == 'S') fprintf(fp, "        r.flags |= %s;\n", mask);
+        else               fprintf(fp, "        r.flags &= ~%s;\n", mask);
+
+        fprintf(fp, "        cyc += %d;\n", cycles);
+    }
+    // Stack pushes and pulls (not PLP, which may cause an interrupt)
+    else if (mode == NON && (!strcmp(str, "PHA") || !strcmp(str, "PHX") || !strcmp(str, "PHY") || !strcmp(str, "PHP")))
+    {
+        fprintf(fp, "        p_cpu->sr_wr_mem(r.sp | 0x100, %s);\n        r.sp--;\n        cyc += %d;\n        WY65_SR_LEAVE(0x%04x, %d, 0x%04x);\n",
+                    str[2] == 'P' ? "r.flags | 0x30" : reg, cycles, next_pc, n, pc);
+    }
+    else if (mode == NON && (!strcmp(str, "PLA") || !strcmp(str, "PLX") || !strcmp(str, "PLY")))
+    {
+        fprintf(fp, "        r.sp++;\n        %s = p_cpu->sr_rd_mem(r.sp | 0x100);\n        WY65_SR_NZ(%s);\n        cyc += %d;\n",
+                    reg, reg, cycles);
+    }
+    // Branches, ending the block
+    else if (mode == REL && is_last)
+    {
+        uint16_t    target = next_pc + (int8_t)(operand & 0xff);
+        uint32_t    extra  = 1 + (((target ^ next_pc) & 0xff00) ? 1 : 0);
+        const char* cond   = !strcmp(str, "BPL") ? "!(r.flags & SIGN_MASK)"  : !strcmp(str, "BMI") ? "(r.flags & SIGN_MASK)"  :
+                             !strcmp(str, "BVC") ? "!(r.flags & OVFLW_MASK)" : !strcmp(str, "BVS") ? "(r.flags & OVFLW_MASK)" :
+                             !strcmp(str, "BCC") ? "!(r.flags & CARRY_MASK)" : !strcmp(str, "BCS") ? "(r.flags & CARRY_MASK)" :
+                             !strcmp(str, "BNE") ? "!(r.flags & ZERO_MASK)"  : !strcmp(str, "BEQ") ? "(r.flags & ZERO_MASK)"  :
+                                                   "true";
+
+        fprintf(fp, "        if (%s)\n"
+                    "        {\n"
+                    "            cyc += %d;\n"
+                    "            r.pc = 0x%04x;\n"
+                    "            WY65_SR_RTN(%d, 0x%04x);\n"
+                    "        }\n"
+                    "        cyc += %d;\n"
+                    "        r.pc = 0x%04x;\n"
+                    "        WY65_SR_RTN(%d, 0x%04x);\n",
+                    cond, cycles + extra, target, n, pc, cycles, next_pc, n, pc);
+        returns = true;
+    }
+    // Jump, subroutine call and return, ending the block
+    else if (is_jump && !strcmp(str, "JMP"))
+    {
+        fprintf(fp, "        cyc += %d;\n        r.pc = 0x%04x;\n        WY65_SR_RTN(%d, 0x%04x);\n", cycles, operand, n, pc);
+        returns = true;
+    }
+    else if (is_jump)
+    {
+        uint16_t ret_addr = next_pc - 1;
+
+        fprintf(fp, "        p_cpu->sr_wr_mem(r.sp | 0x100, 0x%02x);\n        r.sp--;\n"
+                    "        p_cpu->sr_wr_mem(r.sp | 0x100, 0x%02x);\n        r.sp--;\n"
+                    "        cyc += %d;\n        r.pc = 0x%04x;\n        WY65_SR_RTN(%d, 0x%04x);\n",
+                    ret_addr >> 8, ret_addr & 0xff, cycles, operand, n, pc);
+        returns = true;
+    }
+    else if (mode == NON && is_last && !strcmp(str, "RTS"))
+    {
+        fprintf(fp, "        r.sp++;\n        uint32_t addr = p_cpu->sr_rd_mem(r.sp | 0x100);\n"
+                    "        r.sp++;\n        addr |= p_cpu->sr_rd_mem(r.sp | 0x100) << 8;\n"
+                    "        cyc += %d;\n        r.pc = addr + 1;\n        WY65_SR_RTN(%d, 0x%04x);\n",
+                    cycles, n, pc);
+        returns = true;
+    }
+    // All others call the instruction method, leaving the block if the flow
+    // of control changed
+    else
+    {
+        fprintf(fp, "        r.pc = 0x%04x;\n"
+                    "        cyc += p_cpu->sr_exec(0x%02x, 0x%04x);\n"
+                    "        if (r.pc != 0x%04x || p_cpu->sr_leave())\n"
+                    "        {\n"
+                    "            WY65_SR_RTN(%d, 0x%04x);\n"
+                    "        }\n",
+                    next_pc, opcode, operand, next_pc, n, pc);
+    }
+
+    fprintf(fp, "    }\n");
+
+    return returns;
+}
+
+// -------------------------------------------------------------------------
+// gen_static_code()
+//
+// Generate C++ source to fp for the code reachable from the reset, IRQ and
+// NMI vectors, and any additional entry addresses, in the model's memory.
+// Code is walked, for the current CPU variant, as blocks as formed by the
+// block engine (see build_block()), with branch, jump and call targets,
+// and the instructions that blocks fall through to (such as the return
+// addresses of calls), being further entry points. Indirect jumps use the
+// pointer's value in memory at the time of generation. A function
+// is generated for each block, along with a table of the blocks and a
+// function, <name>_register(), to register them with a model.
+//
+// Code reached only by indexed indirect jumps, or in RAM that is modified,
+// is executed by the block engine as normal. Returns the number of blocks
+// generated.
+//
+// -------------------------------------------------------------------------
+
+template <class BUS>
+int cpu6502_core<BUS>::gen_static_code (FILE* fp, const char* name, const uint16_t* p_entries, const uint32_t num_entries)
+{
+    bool*     p_is_entry = new bool[WY65_ADDR_SPACE_SIZE];
+    uint16_t* p_work     = new uint16_t[WY65_ADDR_SPACE_SIZE];
+    uint32_t  num_work   = 0;
+    int       num_blks   = 0;
+
+    memset(p_is_entry, 0, WY65_ADDR_SPACE_SIZE * sizeof(bool));
+
+    // Add an entry point to be walked, if not already found
+    #define WY65_ADD_ENTRY(_addr) { uint16_t a = (_addr) & 0xffff; if (!p_is_entry[a]) { p_is_entry[a] = true; p_work[num_work++] = a; } }
+
+    WY65_ADD_ENTRY(rd_mem(RESET_VEC_ADDR) | (rd_mem(RESET_VEC_ADDR + 1) << 8));
+    WY65_ADD_ENTRY(rd_mem(IRQ_VEC_ADDR)   | (rd_mem(IRQ_VEC_ADDR   + 1) << 8));
+    WY65_ADD_ENTRY(rd_mem(NMI_VEC_ADDR)   | (rd_mem(NMI_VEC_ADDR   + 1) << 8));
+
+    for (uint32_t idx = 0; idx < num_entries; idx++)
+    {
+        WY65_ADD_ENTRY(p_entries[idx]);
+    }
+
+    // Walk the blocks from each entry point, adding further entry points
+    while (num_work > 0)
+    {
+        uint16_t     pc  = p_work[--num_work];
+        uint32_t     num = 0;
+        const tbl_t* p_instr;
+
+        do
+        {
+            p_instr          = &instr_tbl[rd_mem(pc)];
+
+            uint32_t operand = 0;
+            if (p_instr->op_bytes > 0) operand  = rd_mem((pc + 1) & 0xffff);
+            if (p_instr->op_bytes > 1) operand |= rd_mem((pc + 2) & 0xffff) << 8;
+
+            uint16_t next_pc = pc + 1 + p_instr->op_bytes;
+
+            if (p_instr->addr_mode == REL)
+            {
+                WY65_ADD_ENTRY(next_pc + (int8_t)(operand & 0xff));
+            }
+            else if (p_instr->addr_mode == ZPR)
+            {
+                WY65_ADD_ENTRY(next_pc + (int8_t)(operand >> 8));
+            }
+            else if (p_instr->addr_mode == ABS && (!strcmp(p_instr->op_str, "JMP") || !strcmp(p_instr->op_str, "JSR")))
+            {
+                WY65_ADD_ENTRY(operand);
+            }
+            // Indirect jump targets are taken from the current memory contents. If the
+            // pointer changes at run time, blocks are still matched before use.
+            else if (p_instr->addr_mode == IND)
+            {
+                WY65_ADD_ENTRY(rd_mem(operand) | (rd_mem((operand + 1) & 0xffff) << 8));
+            }
+
+            pc               = next_pc;
+            num++;
+        }
+        while (!p_instr->ends_block && num < WY65_MAX_BLOCK_INSTRS);
+
+        // Blocks fall through to the next instruction, except those ending in an
+        // unconditional jump, a return, or a stop. A break returns after its
+        // signature byte.
+        const char* str = p_instr->op_str;
+        if (!strcmp(str, "BRK"))
+        {
+            WY65_ADD_ENTRY(pc + 1);
+        }
+        else if (strcmp(str, "JMP") && strcmp(str, "RTS") && strcmp(str, "RTI") && strcmp(str, "STP"))
+        {
+            WY65_ADD_ENTRY(pc);
+        }
+    }
+
+    #undef WY65_ADD_ENTRY
+
+    fprintf(fp, "// Statically recompiled code for %s (%s), generated by the cpu6502 model\n\n"
+                "#include \"cpu6502.h\"\n\n%s",
+                name, cpu_type_str[state.mode_c], gen_header);
+
+    // Generate the code bytes and function for each block
+    for (uint32_t entry = 0; entry < WY65_ADDR_SPACE_SIZE; entry++)
+    {
+        if (!p_is_entry[entry])
+        {
+            continue;
+        }
+
+        uint16_t pc       = entry;
+        uint32_t num      = 0;
+        uint32_t num_bytes;
+        bool     ends_block;
+
+        // Count instructions and bytes in the block
+        do
+        {
+            ends_block    = instr_tbl[rd_mem(pc)].ends_block;
+            pc           += 1 + instr_tbl[rd_mem(pc)].op_bytes;
+            num++;
+        }
+        while (!ends_block && num < WY65_MAX_BLOCK_INSTRS);
+
+        num_bytes         = (pc - entry) & 0xffff;
+
+        fprintf(fp, "\n// -------------------------------------------------------------------------\n"
+                    "// Block at $%04X (%d instructions)\n"
+                    "// -------------------------------------------------------------------------\n\n"
+                    "static const uint8_t %s_code_%04x[%d] = {", entry, num, name, entry, num_bytes);
+
+        for (uint32_t idx = 0; idx < num_bytes; idx++)
+        {
+            fprintf(fp, "%s0x%02x", idx ? ", " : "", rd_mem((entry + idx) & 0xffff));
+        }
+
+        fprintf(fp, "};\n\n"
+                    "static wy65_static_rtn_t %s_blk_%04x (void* p_ctx)\n"
+                    "{\n"
+                    "    WY65_SR_CPU* p_cpu = (WY65_SR_CPU*)p_ctx;\n"
+                    "    wy65_reg_t&  r     = *p_cpu->sr_regs();\n"
+                    "    uint32_t     cyc   = 0;\n",
+                    name, entry);
+
+        uint16_t last_pc = pc = entry;
+        bool     returns = false;
+        for (uint32_t idx = 0; idx < num; idx++)
+        {
+            returns       = gen_static_instr(fp, pc, idx, idx == num - 1);
+            last_pc       = pc;
+            pc           += 1 + instr_tbl[rd_mem(pc)].op_bytes;
+        }
+
+        // Exit to the next instruction, for blocks not ending in a branch, jump or return
+        if (!returns)
+        {
+            fprintf(fp, "\n    r.pc = 0x%04x;\n    WY65_SR_RTN(%d, 0x%04x);\n", pc, num, last_pc);
+        }
+
+        fprintf(fp, "}\n");
+
+        num_blks++;
+    }
+
+    // Table of blocks, and registration function
+    fprintf(fp, "\n// -------------------------------------------------------------------------\n"
+                "// Block table and registration\n"
+                "// -------------------------------------------------------------------------\n\n"
+                "static const wy65_static_blk_t %s_blks[] =\n{\n", name);
+
+    for (uint32_t entry = 0; entry < WY65_ADDR_SPACE_SIZE; entry++)
+    {
+        if (p_is_entry[entry])
+        {
+            uint16_t pc  = entry;
+            uint32_t num = 0;
+            bool     ends_block;
+
+            do
+            {
+                ends_block = instr_tbl[rd_mem(pc)].ends_block;
+                pc        += 1 + instr_tbl[rd_mem(pc)].op_bytes;
+                num++;
+            }
+            while (!ends_block && num < WY65_MAX_BLOCK_INSTRS);
+
+            fprintf(fp, "    {0x%04x, %2d, %3d, %s_code_%04x, %s_blk_%04x},\n", entry, num, (pc - entry) & 0xffff, name, entry, name, entry);
+        }
+    }
+
+    fprintf(fp, "};\n\n"
+                "void %s_register (WY65_SR_CPU* p_cpu)\n"
+                "{\n"
+                "    p_cpu->register_static_code(%s_blks, sizeof(%s_blks) / sizeof(%s_blks[0]), %s);\n"
+                "}\n",
+                name, name, name, name, cpu_type_str[state.mode_c]);
+
+    delete [] p_is_entry;
+    delete [] p_work;
+
+    return num_blks;
+}
+
+// -------------------------------------------------------------------------
+// Instantiate the static recompilation methods for the default bus, and for
+// WY65_BUS, if defined (see cpu6502.cpp)
+// -------------------------------------------------------------------------
+
+#define WY65_STATIC_INSTANTIATE(_bus)                                                                              \
+    template void             cpu6502_core<_bus>::register_static_code (const wy65_static_blk_t* p_blks,           \
+                                                                        const uint32_t num_blks,                   \
+                                                                        const cpu_type_e cpu_type);                \
+    template wy65_static_fn_t cpu6502_core<_bus>::match_static_block   (const uint16_t entry_pc,                   \
+                                                                        const cpu6502_core<_bus>::blk_t* p_blk);   \
+    template int              cpu6502_core<_bus>::sr_exec              (const uint8_t opcode, const uint16_t operand); \
+    template void             cpu6502_core<_bus>::gen_static_addr      (char* buf, const cpu6502_core<_bus>::addr_mode_e mode, \
+                                                                        const uint32_t operand, const int indent); \
+    template bool             cpu6502_core<_bus>::gen_static_instr     (FILE* fp, const uint16_t pc,               \
+                                                                        const uint32_t instr_num, const bool is_last); \
+    template int              cpu6502_core<_bus>::gen_static_code      (FILE* fp, const char* name,                \
+                                                                        const uint16_t* p_entries,                 \
+                                                                        const uint32_t num_entries);
+
+WY65_STATIC_INSTANTIATE(wy65_cb_bus_t)
+
+#ifdef WY65_BUS
+WY65_STATIC_INSTANTIATE(WY65_BUS)
+#endif
@@ -43,7 +43,8 @@
 //   value
 // -------------------------------------------------------------------------
 
-int cpu6502::hex2int(const uint8_t *buf, int num_chars)
+template <class BUS>
+int cpu6502_core<BUS>::hex2int(const uint8_t *buf, int num_chars)
 {
     int idx;
     int value = 0;
@@ -83,7 +84,8 @@ int cpu6502::hex2int(const uint8_t *buf, int num_chars)
 //   specified in byte_count.
 // -------------------------------------------------------------------------
 
-void cpu6502::prog_write_data(const uint32_t byte_count, const uint32_t addr, const uint8_t* buf_ptr)
+template <class BUS>
+void cpu6502_core<BUS>::prog_write_data(const uint32_t byte_count, const uint32_t addr, const uint8_t* buf_ptr)
 {
     uint32_t data_byte;
     uint32_t address = addr;
@@ -104,7 +106,8 @@ void cpu6502::prog_write_data(const uint32_t byte_count, const uint32_t addr, co
 //   verification --- 2's complement of sum mod 256 over data bytes.) 
 // -------------------------------------------------------------------------
 
-int cpu6502::read_ihx (const char *filename)
+template <class BUS>
+int cpu6502_core<BUS>::read_ihx (const char *filename)
 {
 
     uint32_t byte_count;
@@ -181,7 +184,8 @@ int cpu6502::read_ihx (const char *filename)
 //   address and data.)
 // -------------------------------------------------------------------------
 
-int cpu6502::read_srec (const char *filename)
+template <class BUS>
+int cpu6502_core<BUS>::read_srec (const char *filename)
 {
 
     uint32_t byte_count;
@@ -257,7 +261,8 @@ int cpu6502::read_srec (const char *filename)
 //
 // -------------------------------------------------------------------------
 
-int cpu6502::read_bin (const char *filename, const uint16_t start_addr)
+template <class BUS>
+int cpu6502_core<BUS>::read_bin (const char *filename, const uint16_t start_addr)
 {
     FILE* file;
     uint16_t load_addr = start_addr;
@@ -291,7 +296,8 @@ int cpu6502::read_bin (const char *filename, const uint16_t start_addr)
 //
 // -------------------------------------------------------------------------
 
-int cpu6502::read_prog (const char *filename, const prog_type_e type, const uint16_t start_addr)
+template <class BUS>
+int cpu6502_core<BUS>::read_prog (const char *filename, const prog_type_e type, const uint16_t start_addr)
 {
     if (type == BIN)
     {
@@ -317,3 +323,24 @@ int cpu6502::read_prog (const char *filename, const prog_type_e type, const uint
 
     return PROG_NO_ERROR;
 }
+
+// -------------------------------------------------------------------------
+// Instantiate the program loading methods for the default bus, and for
+// WY65_BUS, if defined (see cpu6502.cpp)
+// -------------------------------------------------------------------------
+
+#define WY65_READ_INSTANTIATE(_bus)                                                                                \
+    template int  cpu6502_core<_bus>::hex2int         (const uint8_t *buf, int num_chars);                         \
+    template void cpu6502_core<_bus>::prog_write_data (const uint32_t byte_count, const uint32_t addr,             \
+                                                       const uint8_t* buf_ptr);                                    \
+    template int  cpu6502_core<_bus>::read_ihx        (const char *filename);                                      \
+    template int  cpu6502_core<_bus>::read_srec       (const char *filename);                                      \
+    template int  cpu6502_core<_bus>::read_bin        (const char *filename, const uint16_t start_addr);           \
+    template int  cpu6502_core<_bus>::read_prog       (const char *filename, const prog_type_e type,               \
+                                                       const uint16_t start_addr);
+
+WY65_READ_INSTANTIATE(wy65_cb_bus_t)
+
+#ifdef WY65_BUS
+WY65_READ_INSTANTIATE(WY65_BUS)
+#endif
@@ -27,17 +27,13 @@
 #include <cstring>
 
 #include "cpu6502.h"
-#include "pia.h"
+#include "woz_bus.h"
 
 // -------------------------------------------------------------------------
 // LOCAL DEFINES
 // -------------------------------------------------------------------------
 
 #define STRBUFSIZE      256
-#define MEMTOP          0x10000
-#define RAMTOP          0x8000
-#define PAGEMASK        0xF000
-#define PIAPAGEADDR     0xD000
 #define LOAD_BIN_ADDR   0x8000
 
 #define UNSET           -1
@@ -47,56 +43,11 @@
 #define BINPROGNAME     "cpu6502.bin"
 
 // -------------------------------------------------------------------------
-// LOCAL STATICS
+// LOCAL TYPES
 // -------------------------------------------------------------------------
 
-static uint8_t mem[MEMTOP];
-static bool    nolf;
-static bool    rom_wr_en;
-
-// -------------------------------------------------------------------------
-// Callback for cpu6502 memory writes
-// -------------------------------------------------------------------------
-
-static void write_cb (int addr, unsigned char wbyte)
-{
-    // PIA register
-    if ((addr & PAGEMASK) == PIAPAGEADDR)
-    {
-        pia (addr & ~PAGEMASK, wbyte, false, nolf);
-    }
-    // RAM write
-    else
-    {
-        // Only write to ROM if enabled (for loading code)
-        if (rom_wr_en || addr < RAMTOP)
-        {
-            mem[addr % MEMTOP] = wbyte;
-        }
-    }
-}
-
-// -------------------------------------------------------------------------
-// Callback for cpu6502 memory reads
-// -------------------------------------------------------------------------
-
-static int read_cb (int addr)
-{
-    int rbyte;
-    
-    // PIA register
-    if ((addr & PAGEMASK) == PIAPAGEADDR)
-    {
-        rbyte = pia (addr & ~PAGEMASK, 0, true);
-    }
-    // RAM read
-    else
-    {
-        rbyte = mem[addr % MEMTOP];
-    }
-    
-    return rbyte;
-}
+// The model, with the memory and PIA accesses inlined via the bus class
+typedef cpu6502_core<woz_bus_t> woz_cpu_t;
 
 // -------------------------------------------------------------------------
 // Command line argument parser
@@ -184,6 +135,7 @@ static int parse_args(int argc, char**argv, bool &nolf, bool &disassem, prog_typ
 int main (int argc, char** argv)
 {
     bool        disassem = false;
+    bool        nolf;
     prog_type_e type = HEX;
     char        fname[STRBUFSIZE];
     int         load_addr;
@@ -195,14 +147,16 @@ int main (int argc, char** argv)
         return 1;
     }
 
-    // Create a cp6502 CPU object
-    cpu6502 *p_cpu = new cpu6502;
+    // Create a cp6502 CPU object, with its memory bus
+    woz_cpu_t *p_cpu = new woz_cpu_t;
+    woz_bus_t &bus   = p_cpu->get_bus();
 
-    // Register the memory access callback functions
-    p_cpu->register_mem_funcs(write_cb, read_cb);
+    bus.nolf         = nolf;
 
-    // Allow ROM writes when loading program
-    rom_wr_en = true;
+    // Map RAM and ROM directly to memory, with ROM writable for loading the
+    // program. The PIA pages are left unmapped, to be accessed via the bus.
+    p_cpu->map_mem_pages(0,          PIAPAGEADDR,          bus.mem,              bus.mem);
+    p_cpu->map_mem_pages(PIAPAGEEND, MEMTOP - PIAPAGEEND,  bus.mem + PIAPAGEEND, bus.mem + PIAPAGEEND);
 
     // Load the program to memory
     if (p_cpu->read_prog(fname, type, load_addr))
@@ -211,16 +165,24 @@ int main (int argc, char** argv)
         return 1;
     }
 
-    // Disable ROM writes
-    rom_wr_en = false;
-
-    // Update the reset vector if set on the command line
+    // Update the reset vector if set on the command line (whilst ROM is writable)
     if (rst_vector != UNSET)
     {
         p_cpu->wr_mem(RESET_VEC_ADDR,    rst_vector       & MASK_8BIT);
         p_cpu->wr_mem(RESET_VEC_ADDR+1, (rst_vector >> 8) & MASK_8BIT);
     }
 
+    // Map ROM read only, with writes discarded
+    p_cpu->map_rom_pages(RAMTOP,     PIAPAGEADDR - RAMTOP, bus.mem + RAMTOP);
+    p_cpu->map_rom_pages(PIAPAGEEND, MEMTOP - PIAPAGEEND,  bus.mem + PIAPAGEEND);
+
+    // Cache decoded instructions for code in the directly mapped pages
+    p_cpu->enable_decode_cache();
+
+    // Detect the program idling whilst polling the PIA, so that run_forever()
+    // yields the host thread
+    p_cpu->enable_idle_detect();
+
     // Reset the CPU and choose Western Digital instruction extensions
     p_cpu->reset(WDC);
 
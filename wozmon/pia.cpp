@@ -92,11 +92,8 @@ static int _kbhit(void)
 // Simple model of PIA
 // -------------------------------------------------------------------------
 
-int pia (const int addr, const int wbyte, const bool rnw, const bool nolf)
+int pia (pia_state_t &state, const int addr, const int wbyte, const bool rnw, const bool nolf)
 {
-    // Static store for last keyboard press
-    static int lastkey = 0;
-
     // Return byte defaults to 0
     int rbyte          = 0;
 
@@ -107,15 +104,15 @@ int pia (const int addr, const int wbyte, const bool rnw, const bool nolf)
         {
         case KBD:
             // return last keyboard input with b7 set
-            rbyte      = lastkey | BIT7;
+            rbyte      = state.lastkey | BIT7;
             break;
 
         case KBDCR:
             // if keyboard input available, return 0x80, else 0x00
             if (LM32_INPUT_RDY_TTY())
             {
-                lastkey = LM32_GET_INPUT_TTY() & BYTEMASK;
-                rbyte   = BIT7;
+                state.lastkey = LM32_GET_INPUT_TTY() & BYTEMASK;
+                rbyte         = BIT7;
             }
             break;
 
@@ -60,10 +60,20 @@
 #define LM32_INPUT_RDY_TTY _kbhit
 #define LM32_GET_INPUT_TTY _getch
 
+// -------------------------------------------------------------------------
+// TYPEDEFS
+// -------------------------------------------------------------------------
+
+// PIA state, held by each machine
+typedef struct
+{
+    int lastkey;      // Last keyboard press
+} pia_state_t;
+
 // -------------------------------------------------------------------------
 // EXTERNAL PROTOTYPES
 // -------------------------------------------------------------------------
 
-extern int pia (const int addr, const int wbyte, const bool rnw, const bool nolf = false);
+extern int pia (pia_state_t &state, const int addr, const int wbyte, const bool rnw, const bool nolf = false);
 
 #endif
\ No newline at end of file
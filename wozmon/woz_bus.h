@@ -0,0 +1,78 @@
+//=============================================================
+//
+// Copyright (c) 2024 Simon Southwell. All rights reserved.
+//
+// Date: 12th February 2024
+//
+// This file is part of the cpu6502 instruction set simulator.
+//
+// This code is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// The code is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this code. If not, see <http://www.gnu.org/licenses/>.
+//
+//=============================================================
+
+#ifndef _WOZ_BUS_H_
+#define _WOZ_BUS_H_
+
+#include <cstdint>
+
+#include "pia.h"
+
+// -------------------------------------------------------------------------
+// DEFINES
+// -------------------------------------------------------------------------
+
+#define MEMTOP          0x10000
+#define RAMTOP          0x8000
+#define PAGEMASK        0xF000
+#define PIAPAGEADDR     0xD000
+#define PIAPAGEEND      0xE000
+
+// -------------------------------------------------------------------------
+// Memory bus for the cpu6502 model (cpu6502_core<woz_bus_t>), with the PIA
+// accesses compiled inline into the model. RAM and ROM are mapped directly
+// to mem[] in the model's page table, leaving only the PIA pages unmapped,
+// so that the bus sees no other accesses.
+// -------------------------------------------------------------------------
+
+class woz_bus_t
+{
+public:
+    woz_bus_t() : nolf(false) { pia_state.lastkey = 0; };
+
+    // Accesses to unmapped pages go to the bus
+    inline bool ext_rd (void) { return true; };
+    inline bool ext_wr (void) { return true; };
+
+    // PIA register reads
+    inline int read (int addr)
+    {
+        return pia (pia_state, addr & ~PAGEMASK, 0, true);
+    };
+
+    // PIA register writes
+    inline void write (int addr, unsigned char wbyte)
+    {
+        pia (pia_state, addr & ~PAGEMASK, wbyte, false, nolf);
+    };
+
+    // No callbacks to register
+    inline void register_funcs (wy65_p_writemem_t, wy65_p_readmem_t) {};
+    inline void register_funcs (wy65_p_writemem_ctx_t, wy65_p_readmem_ctx_t, void*) {};
+
+    uint8_t     mem[MEMTOP];
+    bool        nolf;
+    pia_state_t pia_state;
+};
+
+#endif